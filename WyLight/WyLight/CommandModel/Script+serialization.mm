@@ -48,37 +48,37 @@
 		ScriptTitle = std::string(cStringScriptTitle);
 	}
 	mScript.setName(ScriptTitle);
-	mScript.push_back(std::unique_ptr<WyLight::FwCmdScript>(new WyLight::FwCmdLoopOn));
+	mScript.push_back(WyLight::FwCmdLoopOn());
 	
 	for (ComplexEffect *cmplx in self.effects) {
 		[cmplx prepareForSendToWCWiflyControl];
 		if (cmplx.waitCommand.boolValue) {
-			mScript.push_back(std::unique_ptr<WyLight::FwCmdScript>(new WyLight::FwCmdWait(cmplx.duration.unsignedIntValue)));
+			mScript.push_back(WyLight::FwCmdWait(cmplx.duration.unsignedIntValue));
 		} else {
 			for (Effect *effect in cmplx.effects) {
 				if ([effect isKindOfClass:[Fade class]]) {
 					Fade* castEffect = (Fade *)effect;
-					mScript.push_back(std::unique_ptr<WyLight::FwCmdScript>(new WyLight::FwCmdSetFade([castEffect.color getARGB],
+					mScript.push_back(WyLight::FwCmdSetFade([castEffect.color getARGB],
 											  									castEffect.duration.unsignedIntValue,
 											 	 								castEffect.address.unsignedIntValue,
-																				castEffect.parallel.boolValue)));
+																				castEffect.parallel.boolValue));
 				} else if ([effect isKindOfClass:[Gradient class]]) {
 					Gradient* castEffect = (Gradient *)effect;
-					mScript.push_back(std::unique_ptr<WyLight::FwCmdScript>(new WyLight::FwCmdSetGradient([castEffect.color1 getARGB],
+					mScript.push_back(WyLight::FwCmdSetGradient([castEffect.color1 getARGB],
 																	[castEffect.color2 getARGB],
 																	castEffect.duration.unsignedIntValue,
 																	castEffect.parallel.boolValue,
 																	castEffect.numberOfLeds.unsignedIntValue,
-																	castEffect.offset.unsignedIntValue)));
+																	castEffect.offset.unsignedIntValue));
 				}
 			}
 		}
 	}
 	
 	if (self.repeatsWhenFinished.boolValue) {
-		mScript.push_back(std::unique_ptr<WyLight::FwCmdScript>(new WyLight::FwCmdLoopOff(0)));
+		mScript.push_back(WyLight::FwCmdLoopOff(0));
 	} else {
-		mScript.push_back(std::unique_ptr<WyLight::FwCmdScript>(new WyLight::FwCmdLoopOff(1)));
+		mScript.push_back(WyLight::FwCmdLoopOff(1));
 	}
 	
 	const char* cStringFilePath = [filePath cStringUsingEncoding:NSASCIIStringEncoding];
@@ -108,7 +108,7 @@
 	tempScript.title = [NSString stringWithCString:mScript.getName().c_str() encoding:NSASCIIStringEncoding];
 	
 	for (const auto& cmd : mScript) {
-		const led_cmd * const data = (led_cmd *)cmd->GetData();
+		const led_cmd * const data = (led_cmd *)cmd.GetData();
 		if (data->cmd == LOOP_OFF) {
 			tempScript.repeatsWhenFinished = data->data.loopEnd.numLoops == 0 ? @(YES) : @(NO);
 			break;
@@ -119,7 +119,7 @@
 		ComplexEffect *comObj = [ComplexEffect insertNewObjectIntoContext:context];
 		comObj.script = tempScript;
 		for (const auto& cmd : mScript) {
-			const led_cmd * const data = (led_cmd *)cmd->GetData();
+			const led_cmd * const data = (led_cmd *)cmd.GetData();
 			if (data->cmd == SET_FADE) {
 				
 				Fade *obj = [Fade insertNewObjectIntoContext:context];
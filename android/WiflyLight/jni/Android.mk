@@ -8,13 +8,22 @@ LOCAL_MODULE := wifly
 LOCAL_SRC_FILES := $(FW_SRC)crc.c
 LOCAL_SRC_FILES += $(LIB_SRC)BroadcastReceiver.cpp
 LOCAL_SRC_FILES += $(LIB_SRC)ClientSocket.cpp
+LOCAL_SRC_FILES += $(LIB_SRC)CompiledScript.cpp
 LOCAL_SRC_FILES += $(LIB_SRC)ComProxy.cpp
+LOCAL_SRC_FILES += $(LIB_SRC)ControlPool.cpp
+LOCAL_SRC_FILES += $(LIB_SRC)EncodedCommand.cpp
 LOCAL_SRC_FILES += $(LIB_SRC)intelhexclass.cpp
 LOCAL_SRC_FILES += $(LIB_SRC)MaskBuffer.cpp
 LOCAL_SRC_FILES += $(LIB_SRC)Script.cpp
+LOCAL_SRC_FILES += $(LIB_SRC)ScriptDiff.cpp
 LOCAL_SRC_FILES += $(LIB_SRC)ScriptManager.cpp
+LOCAL_SRC_FILES += $(LIB_SRC)ScriptOptimizer.cpp
+LOCAL_SRC_FILES += $(LIB_SRC)ScriptSimulator.cpp
+LOCAL_SRC_FILES += $(LIB_SRC)ScriptStreamer.cpp
 LOCAL_SRC_FILES += $(LIB_SRC)StartupManager.cpp
 LOCAL_SRC_FILES += $(LIB_SRC)TelnetProxy.cpp
+LOCAL_SRC_FILES += $(LIB_SRC)UartCredit.cpp
+LOCAL_SRC_FILES += $(LIB_SRC)TraceEvent.cpp
 LOCAL_SRC_FILES += $(LIB_SRC)WiflyControl.cpp
 LOCAL_SRC_FILES += $(LIB_SRC)WiflyControlNoThrow.cpp
 LOCAL_SRC_FILES += WiflyControlJni.cpp
@@ -20,6 +20,9 @@
 #include "ScriptManager.h"
 #include "StartupManager.h"
 #include "WiflyControl.h"
+#include <map>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <unistd.h>
 #include <jni.h>
@@ -41,6 +44,23 @@ namespace WyLight {
 		}
 	}
 
+	/**
+	 * ScriptManagers are kept alive for the lifetime of the app, so their
+	 * script cache is reused by all calls for the same directory.
+	 */
+	ScriptManager& GetScriptManager(const std::string& path) throw (FatalError)
+	{
+		static std::mutex managersMutex;
+		static std::map<std::string, std::unique_ptr<ScriptManager> > managers;
+
+		std::lock_guard<std::mutex> lock(managersMutex);
+		std::unique_ptr<ScriptManager>& manager = managers[path];
+		if(!manager) {
+			manager.reset(new ScriptManager(path));
+		}
+		return *manager;
+	}
+
 	extern "C" {
 		jlong Java_de_WyLight_WyLight_BroadcastReceiver_create(JNIEnv *env, jobject ref, jstring path)
 		{
@@ -73,7 +93,10 @@ namespace WyLight {
 			try {
 				Endpoint& remote = ((BroadcastReceiver *)pBroadcastReceiver)->GetEndpointByFingerprint(fingerprint);
 				++remote;
-				return reinterpret_cast<jlong>(new Control(remote.GetIp(), remote.GetPort()));
+				std::unique_ptr<Control> control(new Control(remote.GetIp(), remote.GetPort(), remote.GetInterface()));
+				// the app expects connection errors to be reported by connect()
+				control->WaitConnected();
+				return reinterpret_cast<jlong>(control.release());
 			} catch(FatalError& e) {
 				ThrowJniException(env, e);
 			}
@@ -226,13 +249,13 @@ namespace WyLight {
 
 		jint Java_de_WyLight_WyLight_library_FwCmdScriptAdapter_getFadeColor(JNIEnv *env, jobject ref, jlong pNative)
 		{
-			auto fadeCommand = reinterpret_cast<const FwCmdSetFade *>(pNative);
+			auto fadeCommand = reinterpret_cast<const ScriptCommand *>(pNative);
 			return fadeCommand->argb();
 		}
 
 		jint Java_de_WyLight_WyLight_library_FwCmdScriptAdapter_getFadeTime(JNIEnv *env, jobject ref, jlong pNative)
 		{
-			auto fadeCommand = reinterpret_cast<const FwCmdSetFade *>(pNative);
+			auto fadeCommand = reinterpret_cast<const ScriptCommand *>(pNative);
 			return fadeCommand->fadeTime();
 		}
 
@@ -244,50 +267,64 @@ namespace WyLight {
 		 */
 		jlong Java_de_WyLight_WyLight_library_FwCmdScriptAdapter_getGradientColors(JNIEnv *env, jobject ref, jlong pNative)
 		{
-			auto cmd = reinterpret_cast<const FwCmdSetGradient *>(pNative);
+			auto cmd = reinterpret_cast<const ScriptCommand *>(pNative);
 			uint64_t dualColor = ((uint64_t)cmd->EndColor()) << 32 | cmd->StartColor();
 			return dualColor;
 		}
 
 		void Java_de_WyLight_WyLight_library_FwCmdScriptAdapter_setFadeColor(JNIEnv *env, jobject ref, jlong pNative, jint argb)
 		{
-			auto fadeCommand = reinterpret_cast<FwCmdSetFade *>(pNative);
+			auto fadeCommand = reinterpret_cast<ScriptCommand *>(pNative);
 			fadeCommand->argb(argb);
 		}
 
 		void Java_de_WyLight_WyLight_library_FwCmdScriptAdapter_setFadeTime(JNIEnv *env, jobject ref, jlong pNative, jshort tmms)
 		{
-			auto fadeCommand = reinterpret_cast<FwCmdSetFade *>(pNative);
+			auto fadeCommand = reinterpret_cast<ScriptCommand *>(pNative);
 			fadeCommand->fadeTime(tmms);
 		}
 
 		void Java_de_WyLight_WyLight_library_FwCmdScriptAdapter_setGradientColors(JNIEnv *env, jobject ref, jlong pNative, jint startArgb, jint endArgb)
 		{
-			auto cmd = reinterpret_cast<FwCmdSetGradient *>(pNative);
+			auto cmd = reinterpret_cast<ScriptCommand *>(pNative);
 			cmd->StartColor(startArgb);
 			cmd->EndColor(endArgb);
 		}
 
 		jstring Java_de_WyLight_WyLight_library_FwCmdScriptAdapter_getToken(JNIEnv *env, jobject ref, jlong pNative, jint argb)
 		{
-			auto command = reinterpret_cast<FwCmdSetFade *>(pNative);
-			return env->NewStringUTF(command->TOKEN.data());
+			auto command = reinterpret_cast<const ScriptCommand *>(pNative);
+			return env->NewStringUTF(command->GetToken().data());
 		}
 
 		jchar Java_de_WyLight_WyLight_library_FwCmdScriptAdapter_getType(JNIEnv *env, jobject ref, jlong pNative)
 		{
-			auto command = reinterpret_cast<FwCommand*>(pNative);
+			auto command = reinterpret_cast<const ScriptCommand *>(pNative);
 			return command->GetType();
 		}
 
+		/**
+		 * The commands are stored in a vector, so the returned pointer is only
+		 * valid until the script is modified. It is looked up again for each
+		 * access of a FwCmdScriptAdapter instead of being cached.
+		 */
+		jlong Java_de_WyLight_WyLight_library_FwCmdScriptAdapter_getCommand(JNIEnv *env, jobject ref, jlong pScript, jint position)
+		{
+			Script *const script = reinterpret_cast<Script *>(pScript);
+			if((position >= 0) && (script->size() > (size_t)position)) {
+				return reinterpret_cast<jlong>(&(*script)[position]);
+			}
+			return 0;
+		}
+
 		void Java_de_WyLight_WyLight_library_ScriptAdapter_addFade(JNIEnv *env, jobject ref, jlong pNative, jint argb, jint addr, jshort fadeTime)
 		{
-			reinterpret_cast<Script *>(pNative)->push_back(std::unique_ptr<FwCmdScript>(new FwCmdSetFade(argb, fadeTime, addr)));
+			reinterpret_cast<Script *>(pNative)->push_back(ScriptCommand::Fade(argb, fadeTime, addr));
 		}
 
 		void Java_de_WyLight_WyLight_library_ScriptAdapter_addGradient(JNIEnv *env, jobject ref, jlong pNative, jint argb_1, jint argb_2, jshort fadeTime)
 		{
-			reinterpret_cast<Script *>(pNative)->push_back(std::unique_ptr<FwCmdScript>(new FwCmdSetGradient(argb_1, argb_2, fadeTime)));
+			reinterpret_cast<Script *>(pNative)->push_back(ScriptCommand::Gradient(argb_1, argb_2, fadeTime));
 		}
 
 		void Java_de_WyLight_WyLight_library_ScriptAdapter_clear(JNIEnv *env, jobject ref, jlong pNative)
@@ -295,17 +332,6 @@ namespace WyLight {
 			reinterpret_cast<Script *>(pNative)->clear();
 		}
 
-		jlong Java_de_WyLight_WyLight_library_ScriptAdapter_getItem(JNIEnv *env, jobject ref, jlong pNative, jint position)
-		{
-			const Script *const pScript = reinterpret_cast<Script *>(pNative);
-			if(pScript->size() > position) {
-				auto fwCmdScript = pScript->begin();
-				std::advance(fwCmdScript, position);
-				return reinterpret_cast<jlong>((*fwCmdScript).get());
-			}
-			return 0;
-		}
-
 		jstring Java_de_WyLight_WyLight_library_ScriptAdapter_name(JNIEnv *env, jobject ref, jlong pNative)
 		{
 			const std::string& myName = reinterpret_cast<Script *>(pNative)->getName();
@@ -335,8 +361,7 @@ namespace WyLight {
 			jstring result = NULL;
 			const char *const myPath = env->GetStringUTFChars(path, 0);
 			try {
-				ScriptManager manager {myPath};
-				result = env->NewStringUTF(manager.getScriptName(index).data());
+				result = env->NewStringUTF(GetScriptManager(myPath).getScriptName(index).data());
 			} catch(FatalError& e) {
 					ThrowJniException(env, e);
 			}
@@ -371,8 +396,7 @@ namespace WyLight {
 			const char *const myPath = env->GetStringUTFChars(path, 0);
 			jint numScripts = 0;
 			try {
-				ScriptManager manager {myPath};
-				numScripts = manager.numScripts();
+				numScripts = GetScriptManager(myPath).numScripts();
 			} catch(FatalError& e) {
 				ThrowJniException(env, e);
 			}
@@ -44,18 +44,30 @@ public class FwCmdScriptAdapter {
 
 	private native int setFadeTime(long pNative, short time);
 
-	private final long mNative;
+	private native long getCommand(long pScript, int position);
+
+	private final long mScript;
+	private final int mPosition;
 
 	public enum Type {
 		UNKOWN, FADE, GRADIENT
 	}
 
-	public FwCmdScriptAdapter(long pNative) {
-		mNative = pNative;
+	public FwCmdScriptAdapter(long pScript, int position) {
+		mScript = pScript;
+		mPosition = position;
+	}
+
+	/**
+	 * The command is looked up for each access, a pointer into the script
+	 * would become invalid, when the script grows.
+	 */
+	private long getNative() {
+		return getCommand(mScript, mPosition);
 	}
 
 	public int getColor() {
-		if (0 != mNative) {
+		if (0 != getNative()) {
 			if (getType() == Type.GRADIENT) {
 				final int[] colors = getGradientColor();
 				final int r = Color.red(colors[0]) + Color.red(colors[1]);
@@ -63,15 +75,15 @@ public class FwCmdScriptAdapter {
 				final int b = Color.blue(colors[0]) + Color.blue(colors[1]);
 				return Color.rgb(r / 2, g / 2, b / 2);
 			}
-			return getFadeColor(mNative);
+			return getFadeColor(getNative());
 		}
 		return 0;
 	}
 
 	public int[] getGradientColor() {
 		int[] temp = new int[2];
-		if (0 != mNative) {
-			long dual = getGradientColors(mNative);
+		if (0 != getNative()) {
+			long dual = getGradientColors(getNative());
 			temp[0] = (int) (dual & 0xffffffff);
 			temp[1] = (int) (dual >> 32);
 		}
@@ -79,15 +91,15 @@ public class FwCmdScriptAdapter {
 	}
 
 	public int getTime() {
-		if (0 != mNative) {
-			return getFadeTime(mNative);
+		if (0 != getNative()) {
+			return getFadeTime(getNative());
 		}
 		return 0;
 	}
 
 	public Type getType() {
-		if (0 != mNative) {
-			switch (getType(mNative)) {
+		if (0 != getNative()) {
+			switch (getType(getNative())) {
 			case 0xF9:
 				return Type.GRADIENT;
 			case 0xFC:
@@ -115,20 +127,20 @@ public class FwCmdScriptAdapter {
 	}
 
 	public void setColor(int argb) {
-		if (0 != mNative) {
-			setFadeColor(mNative, argb);
+		if (0 != getNative()) {
+			setFadeColor(getNative(), argb);
 		}
 	}
 
 	public void setGradientColors(int startArgb, int endArgb) {
-		if (0 != mNative) {
-			setGradientColors(mNative, startArgb, endArgb);
+		if (0 != getNative()) {
+			setGradientColors(getNative(), startArgb, endArgb);
 		}
 	}
 
 	public void setTime(short time) {
-		if (0 != mNative) {
-			setFadeTime(mNative, time);
+		if (0 != getNative()) {
+			setFadeTime(getNative(), time);
 		}
 	}
 }
@@ -40,8 +40,6 @@ public class ScriptAdapter extends BaseAdapter {
 
 	private native long create(String filename);
 
-	private native long getItem(long pNative, int position);
-
 	private native String name(long pNative);
 
 	private native int numCommands(long pNative);
@@ -94,11 +92,11 @@ public class ScriptAdapter extends BaseAdapter {
 	}
 
 	public FwCmdScriptAdapter getItem(int position) {
-		return new FwCmdScriptAdapter(getItem(mNative, position));
+		return new FwCmdScriptAdapter(mNative, position);
 	}
 
 	public long getItemId(int position) {
-		return getItem(mNative, position);
+		return position;
 	}
 
 	public String getName() {
@@ -17,6 +17,7 @@
     along with Wifly_Light.  If not, see <http://www.gnu.org/licenses/>. */
 
 #include "BroadcastReceiver.h"
+#include "ControlPool.h"
 #include "WiflyControlCli.h"
 #include "WiflyControlCmd.h"
 #include "WiflyControlException.h"
@@ -39,10 +40,9 @@ void newRemoteCallback(const size_t index, const WyLight::Endpoint& newEndpoint)
 char* getCmdOption(char ** begin, char ** end, const std::string & option);
 bool cmdOptionExists(char** begin, char** end, const std::string& option);
 
-WiflyControlCli::WiflyControlCli(uint32_t addr, uint16_t port)
-	: mControl(addr, port), mRunning(true)
+WiflyControlCli::WiflyControlCli(std::unique_ptr<WyLight::Control>&& control)
+	: mControl(std::move(control)), mRunning(true)
 {
-	cout << "Connecting to " << std::hex << addr << ':' << port << std::endl;
 }
 
 void WiflyControlCli::Run(void)
@@ -62,7 +62,7 @@ void WiflyControlCli::Run(void)
 		} else {
 			pCmd = WiflyControlCmdBuilder::GetCmd(nextCmd);
 			if(NULL != pCmd) {
-				pCmd->Run(mControl);
+				pCmd->Run(*mControl);
 			}
 		}
 	}
@@ -84,7 +84,7 @@ void WiflyControlCli::ShowHelp(void) const
 }
 
 WyLight::Control& WiflyControlCli::getControl() {
-	return mControl;
+	return *mControl;
 }
 
 void newRemoteCallback(const size_t index, const WyLight::Endpoint& newEndpoint)
@@ -112,11 +112,12 @@ bool cmdOptionExists(char** begin, char** end, const std::string& option)
 int main(int argc, char *argv[])
 {
 	if (cmdOptionExists(argv, argv + argc, "-?") || cmdOptionExists(argv, argv + argc, "-help")) {
-		std::cout << "Usage: \nno parameters: default usage.\n-c \"123.123.123.123\" to connect to a specific IP immediately.\n\n";
+		std::cout << "Usage: \nno parameters: default usage.\n-c \"123.123.123.123\" to connect to a specific IP immediately.\n-i \"eth0,vlan10\" to discover devices only on the listed network interfaces.\n-w to pre-connect to the most recently used devices while waiting for your selection.\n\n";
 		return 0;
 	}
 
 	WyLight::Endpoint e;
+	std::unique_ptr<WyLight::Control> control;
 
 	if (cmdOptionExists(argv, argv + argc, "-c")) {
 
@@ -128,7 +129,22 @@ int main(int argc, char *argv[])
 
 	} else {
 
-		WyLight::BroadcastReceiver receiver(55555, "recent.txt", newRemoteCallback);
+		std::vector<std::string> interfaces;
+		if (cmdOptionExists(argv, argv + argc, "-i")) {
+			std::stringstream interfaceList(getCmdOption(argv, argv + argc, "-i"));
+			std::string name;
+			while(std::getline(interfaceList, name, ',')) {
+				interfaces.push_back(name);
+			}
+		}
+
+		WyLight::BroadcastReceiver receiver(55555, "recent.txt", newRemoteCallback, interfaces);
+
+		// start warm up before the receiver thread modifies the recent endpoints
+		WyLight::ControlPool pool;
+		if (cmdOptionExists(argv, argv + argc, "-w")) {
+			pool.WarmUp(receiver);
+		}
 		std::thread t(std::ref(receiver));
 
 		// wait for user input
@@ -143,9 +159,21 @@ int main(int argc, char *argv[])
 		t.join();
 
 		e = receiver.GetEndpoint(selection);
+		control = pool.Acquire(e);
 	}
 
-	WiflyControlCli cli(e.GetIp(), e.GetPort());
+	if (!control) {
+		control.reset(new WyLight::Control(e.GetIp(), e.GetPort(), e.GetInterface()));
+	}
+	cout << "Connecting to " << std::hex << e.GetIp() << ':' << e.GetPort() << std::endl;
+	try {
+		control->WaitConnected();
+	} catch(WyLight::FatalError& error) {
+		cout << "Connection failed because of " << error << std::endl;
+		return 1;
+	}
+	cout << "Connected to " << std::hex << e.GetIp() << ':' << e.GetPort() << std::endl;
+	WiflyControlCli cli(std::move(control));
 
 	cli.Run();
 }
@@ -20,17 +20,18 @@
 #define _WIFLYCONTROLCLI_H_
 #include <string>
 #include "WiflyControl.h"
+#include <memory>
 #include <stdint.h>
 
 class WiflyControlCli
 {
 private:
-	WyLight::Control mControl;
+	std::unique_ptr<WyLight::Control> mControl;
 	bool mRunning;
 	void ShowHelp(void) const;
 
 public:
-	WiflyControlCli(uint32_t addr, uint16_t port);
+	WiflyControlCli(std::unique_ptr<WyLight::Control>&& control);
 	void Run(void);
 	WyLight::Control& getControl(void);
 };
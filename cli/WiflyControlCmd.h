@@ -20,12 +20,18 @@
 #define _WIFLYCONTROLCMD_H_
 #include "FwCommand.h"
 #include "trace.h"
+#include "ScriptDiff.h"
+#include "ScriptSimulator.h"
+#include "ScriptStreamer.h"
 #include "StartupManager.h"
+#include <chrono>
+#include <fstream>
 #include <iostream>
 #include <string>
 #include <iomanip>
 #include <stdint.h>
 #include <memory>
+#include <thread>
 
 //TODO remove this dependencies!!!
 using std::cin;
@@ -439,7 +445,7 @@ class ControlCmdPrintCycletime : public WiflyControlCmd
 public:
 	ControlCmdPrintCycletime(void) : WiflyControlCmd(
 			string("print_cycletime"),
-			string("' - prints all timevalues of internal methode execution times")) {};
+			string("' - prints count, mean, percentiles and max of internal methode execution times")) {};
 
 	virtual void Run(WyLight::Control& control) const {
 		cout << "Transmitting command print cycletime... ";
@@ -488,6 +494,83 @@ public:
 
 };
 
+class ControlCmdPrintTraceEvents : public WiflyControlCmd
+{
+public:
+	ControlCmdPrintTraceEvents(void) : WiflyControlCmd(
+			string("print_trace_events"),
+			string("' - displays the timestamped events recorded by the pic")) {};
+
+	virtual void Run(WyLight::Control& control) const {
+		cout << "Reading trace events... ";
+		try {
+			WyLight::TraceEventLog log;
+			control.FwGetTraceEvents(log);
+			cout << "done.\n\n" << log << '\n';
+		} catch(WyLight::FatalError& e)   {
+			cout << "failed! because of: " << e << '\n';
+		}
+	};
+};
+
+class ControlCmdRecordTraceEvents : public WiflyControlCmd
+{
+public:
+	ControlCmdRecordTraceEvents(void) : WiflyControlCmd(
+			string("record_trace_events"),
+			string(" <duration> <file>'\n")
+			+ string("    <duration> time to record in milliseconds, the event buffers of the pic are read every 50ms\n")
+			+ string("    <file> path of the output in the json trace event format, open it with chrome://tracing")) {};
+
+	virtual void Run(WyLight::Control& control) const {
+		static const auto POLL_INTERVAL = std::chrono::milliseconds(50);
+		unsigned int duration;
+		string path;
+		cin >> duration >> path;
+		cout << "Recording trace events... ";
+		try {
+			WyLight::TraceEventLog log;
+			const auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(duration);
+			do {
+				control.FwGetTraceEvents(log);
+				std::this_thread::sleep_for(POLL_INTERVAL);
+			} while(std::chrono::steady_clock::now() < end);
+			control.FwGetTraceEvents(log);
+
+			std::ofstream out(path);
+			log.WriteChromeTrace(out);
+			cout << "done.\n" << log.Events().size() << " events written to '" << path << "', " << log.NumLost() << " lost\n";
+		} catch(WyLight::FatalError& e)   {
+			cout << "failed! because of: " << e << '\n';
+		}
+	};
+};
+
+class ControlCmdPrintStats : public WiflyControlCmd
+{
+public:
+	ControlCmdPrintStats(void) : WiflyControlCmd(
+			string("print_stats"),
+			string("' - displays the counters of received bytes, commands and errors of the pic")) {};
+
+	virtual void Run(WyLight::Control& control) const {
+		cout << "Reading statistics... ";
+		try {
+			const device_stats stats = control.FwGetStats();
+			cout << "done.\n\n";
+			cout << "received bytes:      " << stats.rxBytes << '\n';
+			cout << "commands:            " << stats.commands << '\n';
+			cout << "crc errors:          " << stats.crcErrors << '\n';
+			cout << "length errors:       " << stats.lengthErrors << '\n';
+			cout << "script full:         " << stats.scriptFull << '\n';
+			cout << "buffer overflows:    " << stats.ringOverflows << '\n';
+			cout << "buffer high water:   " << (int)stats.ringHighWater << " of " << RingBufferSize << " bytes\n";
+		} catch(WyLight::FatalError& e)   {
+			cout << "failed! because of: " << e << '\n';
+		}
+	};
+};
+
 class ControlCmdClearScript : public WiflyControlCmd
 {
 public:
@@ -585,6 +668,132 @@ public:
 	};
 };
 
+class ControlCmdCompileScript : public WiflyControlCmd
+{
+public:
+	ControlCmdCompileScript(void) : WiflyControlCmd(
+			string("compile"),
+			string(" <script> <compiled>'\n")
+			+ string("    <script> path of the script in text format\n")
+			+ string("    <compiled> path for the compiled script f.e. myscript") + WyLight::CompiledScript::EXTENSION) {};
+
+	virtual void Run(WyLight::Control& control) const {
+		string scriptPath, compiledPath;
+		cin >> scriptPath >> compiledPath;
+		cout << "Compiling '" << scriptPath << "'... ";
+		TRY_CATCH_COUT(WyLight::CompiledScript::Compile(WyLight::Script(scriptPath), compiledPath));
+	};
+};
+
+class ControlCmdDecompileScript : public WiflyControlCmd
+{
+public:
+	ControlCmdDecompileScript(void) : WiflyControlCmd(
+			string("decompile"),
+			string(" <compiled> <script>'\n")
+			+ string("    <compiled> path of the compiled script\n")
+			+ string("    <script> path for the script in text format")) {};
+
+	virtual void Run(WyLight::Control& control) const {
+		string compiledPath, scriptPath;
+		cin >> compiledPath >> scriptPath;
+		cout << "Decompiling '" << compiledPath << "'... ";
+		TRY_CATCH_COUT(WyLight::Script::serialize(scriptPath, WyLight::CompiledScript(compiledPath).ToScript()));
+	};
+};
+
+class ControlCmdSendScript : public WiflyControlCmd
+{
+public:
+	ControlCmdSendScript(void) : WiflyControlCmd(
+			string("sendscript"),
+			string(" <script>'\n")
+			+ string("    <script> path of the script, compiled scripts (") + WyLight::CompiledScript::EXTENSION + string(") are send without parsing")) {};
+
+	virtual void Run(WyLight::Control& control) const {
+		string path;
+		cin >> path;
+		const string& ext = WyLight::CompiledScript::EXTENSION;
+		cout << "Transmitting script '" << path << "'... ";
+		if((path.size() > ext.size()) && (0 == path.compare(path.size() - ext.size(), ext.size(), ext))) {
+			TRY_CATCH_COUT(control << WyLight::CompiledScript(path));
+		} else {
+			TRY_CATCH_COUT(control << WyLight::Script(path));
+		}
+	};
+};
+
+class ControlCmdUpdateScript : public WiflyControlCmd
+{
+public:
+	ControlCmdUpdateScript(void) : WiflyControlCmd(
+			string("updatescript"),
+			string(" <old> <new>'\n")
+			+ string("    <old> path of the script, which was sent before\n")
+			+ string("    <new> path of the edited script, only the changed commands are sent")) {};
+
+	virtual void Run(WyLight::Control& control) const {
+		string oldPath, newPath;
+		cin >> oldPath >> newPath;
+		cout << "Updating script '" << oldPath << "' to '" << newPath << "'... ";
+		try {
+			const WyLight::ScriptDiff diff(WyLight::Script(oldPath), WyLight::Script(newPath), control.FwGetScriptState());
+			diff.Apply(control);
+			cout << "done, " << diff.NumCommands() << " commands sent.\n";
+		} catch(std::exception& e) {
+			cout << "failed! because of: " << e.what() << '\n';
+		}
+	};
+};
+
+class ControlCmdStreamScript : public WiflyControlCmd
+{
+public:
+	ControlCmdStreamScript(void) : WiflyControlCmd(
+			string("streamscript"),
+			string(" <script>'\n")
+			+ string("    <script> path of the script in text format, it is send while it plays, so it may be longer than the script buffer")) {};
+
+	virtual void Run(WyLight::Control& control) const {
+		string path;
+		cin >> path;
+		cout << "Streaming script '" << path << "'... ";
+		TRY_CATCH_COUT(WyLight::ScriptStreamer(WyLight::Script(path)).Run(control));
+	};
+};
+
+class ControlCmdSimulateScript : public WiflyControlCmd
+{
+public:
+	ControlCmdSimulateScript(void) : WiflyControlCmd(
+			string("simulate"),
+			string(" <script> <interval> <frames>'\n")
+			+ string("    <script> path of the script in text format\n")
+			+ string("    <interval> time between two frames in hundredths of a second\n")
+			+ string("    <frames> number of frames to print, the colors are calculated like the firmware does")) {};
+
+	virtual void Run(WyLight::Control& control) const {
+		string path;
+		uint64_t interval;
+		size_t numFrames;
+		cin >> path >> interval >> numFrames;
+		try {
+			WyLight::ScriptSimulator simulator {WyLight::Script(path)};
+			uint64_t time = 0;
+			for(const auto& frame : simulator.Render(interval, numFrames)) {
+				cout << std::dec << setw(8) << time << ':' << hex;
+				for(const auto& color : frame) {
+					cout << ' ' << setw(6) << setfill('0') << (color & 0xffffff);
+				}
+				cout << setfill(' ') << '\n';
+				time += interval;
+			}
+		} catch(std::exception& e) {
+			cout << "failed! because of: " << e.what() << '\n';
+		}
+	};
+};
+
 class ControlCmdSetRtc : public WiflyControlCmd
 {
 public:
@@ -732,12 +941,21 @@ static const std::shared_ptr<const WiflyControlCmd> s_Cmds[] = {
 	std::shared_ptr<const WiflyControlCmd>(new ControlCmdClearScript()),
 	std::shared_ptr<const WiflyControlCmd>(new ControlCmdSetFade()),
 	std::shared_ptr<const WiflyControlCmd>(new ControlCmdSetGradient()),
+	std::shared_ptr<const WiflyControlCmd>(new ControlCmdCompileScript()),
+	std::shared_ptr<const WiflyControlCmd>(new ControlCmdDecompileScript()),
+	std::shared_ptr<const WiflyControlCmd>(new ControlCmdSendScript()),
+	std::shared_ptr<const WiflyControlCmd>(new ControlCmdSimulateScript()),
+	std::shared_ptr<const WiflyControlCmd>(new ControlCmdStreamScript()),
+	std::shared_ptr<const WiflyControlCmd>(new ControlCmdUpdateScript()),
 	std::shared_ptr<const WiflyControlCmd>(new ControlCmdStartBl()),
 	std::shared_ptr<const WiflyControlCmd>(new ControlCmdTest()),
 	std::shared_ptr<const WiflyControlCmd>(new ControlCmdStressTest()),
 	std::shared_ptr<const WiflyControlCmd>(new ControlCmdPrintTracebuffer()),
+	std::shared_ptr<const WiflyControlCmd>(new ControlCmdPrintTraceEvents()),
+	std::shared_ptr<const WiflyControlCmd>(new ControlCmdRecordTraceEvents()),
 	std::shared_ptr<const WiflyControlCmd>(new ControlCmdPrintFwVersion()),
 	std::shared_ptr<const WiflyControlCmd>(new ControlCmdPrintCycletime()),
+	std::shared_ptr<const WiflyControlCmd>(new ControlCmdPrintStats()),
 	std::shared_ptr<const WiflyControlCmd>(new ControlCmdSetRtc()),
 	std::shared_ptr<const WiflyControlCmd>(new ControlCmdGetRtc()),
 	std::shared_ptr<const WiflyControlCmd>(new ControlCmdLoopOn()),
@@ -30,6 +30,7 @@
 
 bank2 struct CommandBuffer g_CmdBuf;
 bank5 struct response_frame g_ResponseBuf;
+struct device_stats g_Stats;
 static bit g_Odd_STX_Received;
 
 /** PRIVATE METHODES **/
@@ -41,6 +42,7 @@ static void WriteByte(uns8 byte)
 		g_CmdBuf.counter++;
 		Crc_AddCrc(byte, &g_CmdBuf.CrcH, &g_CmdBuf.CrcL);
 	} else {
+		g_Stats.lengthErrors++;
 		CommandIO_Error();
 	}
 }
@@ -102,8 +104,16 @@ void CommandIO_Error()
 
 void CommandIO_GetCommands()
 {
+	/* the buffer is never fuller than right before we drain it */
+	uns8 used = RingBufferSize - RingBuf_NumFree(&g_RingBuf);
+	if(used > g_Stats.ringHighWater) {
+		g_Stats.ringHighWater = used;
+	}
+
 	if(RingBuf_HasError(&g_RingBuf)) {
 		Trace_String(ERROR_RECEIVEBUFFER_FULL);//RingbufferFull
+		Trace_Event(eTRACE_RECEIVEBUFFER_FULL, 0);
+		g_Stats.ringOverflows++;
 		// *** if a RingBufError occure, I have to throw away the current command,
 		// *** because the last byte was not saved. Commandstring is inconsistent
 		RingBuf_Init(&g_RingBuf);
@@ -115,6 +125,7 @@ void CommandIO_GetCommands()
 	{
 		// *** get new_byte from ringbuffer
 		uns8 new_byte = RingBuf_Get(&g_RingBuf);
+		g_Stats.rxBytes++;
 		switch(g_CmdBuf.state)
 		{
 			case CS_WaitForSTX:
@@ -153,9 +164,11 @@ void CommandIO_GetCommands()
 					
 					/* CRC Check */
 					if((0 == g_CmdBuf.CrcL) && (0 == g_CmdBuf.CrcH)) {
+						Trace_Event(eTRACE_COMMAND, g_CmdBuf.buffer[0]);
+						g_Stats.commands++;
 						// [0] contains cmd_frame->cmd. Reply this cmd as response to client
 	#ifndef __CC8E__
-						mRetValue = ScriptCtrl_Add((struct led_cmd *)&g_CmdBuf.buffer[0]);
+						mRetValue = (ErrorCode)ScriptCtrl_Add((struct led_cmd *)&g_CmdBuf.buffer[0]);
 	#else
 						mRetValue = ScriptCtrl_Add(&g_CmdBuf.buffer[0]);
 	#endif
@@ -163,7 +176,11 @@ void CommandIO_GetCommands()
 							/* do not send a response if client does not want an echo */
 							break;
 						}
+						if(mRetValue == SCRIPTBUFFER_FULL) {
+							g_Stats.scriptFull++;
+						}
 					} else {
+						g_Stats.crcErrors++;
 						mRetValue = CRC_CHECK_FAILED;
 					}
 					/* send response */
@@ -229,7 +246,7 @@ void CommandIO_CreateResponse(struct response_frame *mFrame, uns8 cmd, ErrorCode
 	};
 	case GET_CYCLETIME:
 	{
-		uns8 bytesPrint = Timer_PrintCycletime(&(mFrame->data.max_cycle_times[0]), sizeof(struct response_frame) - 4);
+		uns8 bytesPrint = Timer_PrintCycletime(&(mFrame->data.cycletimes[0]), sizeof(struct response_frame) - 4);
 		mFrame->length += bytesPrint;
 		break;
 	};
@@ -239,6 +256,12 @@ void CommandIO_CreateResponse(struct response_frame *mFrame, uns8 cmd, ErrorCode
 		mFrame->length += bytesPrint;
 		break;
 	};
+	case GET_TRACE_EVENTS:
+	{
+		uns8 bytesPrint = Trace_PrintEvents(&mFrame->data.traceEvents, sizeof(struct response_frame) - 4);
+		mFrame->length += bytesPrint;
+		break;
+	};
 	case GET_FW_VERSION:
 	{
 		uns16 tempVersion = Version_Print();
@@ -256,6 +279,32 @@ void CommandIO_CreateResponse(struct response_frame *mFrame, uns8 cmd, ErrorCode
 		mFrame->length += sizeof(uns8);
 		break;
 	}
+	case GET_SCRIPT_STATE:
+	{
+		ScriptCtrl_GetState(&mFrame->data.scriptState);
+		mFrame->length += sizeof(struct script_state);
+		break;
+	}
+	case GET_UART_CREDIT:
+	{
+		/* the bytes, which follow this request, are still in the buffer. Any
+		 * byte the host sends after the request reduces this credit. */
+		mFrame->data.uartCredit = RingBuf_NumFree(&g_RingBuf);
+		mFrame->length += sizeof(uns8);
+		break;
+	}
+	case GET_STATS:
+	{
+		mFrame->data.stats.rxBytes = htonl(g_Stats.rxBytes);
+		mFrame->data.stats.commands = htons(g_Stats.commands);
+		mFrame->data.stats.crcErrors = htons(g_Stats.crcErrors);
+		mFrame->data.stats.lengthErrors = htons(g_Stats.lengthErrors);
+		mFrame->data.stats.scriptFull = htons(g_Stats.scriptFull);
+		mFrame->data.stats.ringOverflows = htons(g_Stats.ringOverflows);
+		mFrame->data.stats.ringHighWater = g_Stats.ringHighWater;
+		mFrame->length += sizeof(struct device_stats);
+		break;
+	}
 	default:
 		break;
 	}
@@ -23,7 +23,7 @@
 #include "wifly_cmd.h"
 
 /* "+3" is need, because the crc is not in sizeof(cmd_frame) */
-#define CMDFRAMELENGTH (NUM_OF_LED * 3 + sizeof(struct led_cmd) + 3)
+#define CMDFRAMELENGTH (NUM_OF_LED_PER_SEGMENT * 3 + sizeof(struct led_cmd) + 3)
 
 #ifdef __CC8E__
 #if (CMDFRAMELENGTH > 255)
@@ -45,6 +45,7 @@ struct CommandBuffer {
 };
 extern bank2 struct CommandBuffer g_CmdBuf;
 extern bank5 struct response_frame g_ResponseBuf;
+extern struct device_stats g_Stats;
 
 void CommandIO_Init();
 
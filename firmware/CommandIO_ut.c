@@ -61,6 +61,10 @@ uns8 ScriptCtrl_Add(struct led_cmd *pCmd)
 {
 	return 1;
 }
+void ScriptCtrl_GetState(struct script_state *pState)
+{
+	memcpy(pState, g_RandomDataPool, sizeof(struct script_state));
+}
 
 uns8 SPI_Send(uns8 temp)
 {
@@ -76,7 +80,7 @@ void Rtc_Ctl(enum RTC_request req,struct rtc_time *pRtcTime)
 	}
 }
 
-uns8 Timer_PrintCycletime(uns16 *pArray, uns16 arraySize)
+uns8 Timer_PrintCycletime(struct cycletime_stats *pArray, uns16 arraySize)
 {
 	int i;
 	uns8 *pData = (uns8 *)pArray;
@@ -97,6 +101,12 @@ uns8 Trace_Print(uns8 *pArray, uns16 arraySize)
 	return i;
 }
 
+uns8 Trace_PrintEvents(struct trace_events *pEvents, const uns16 arraySize)
+{
+	memcpy(pEvents, g_RandomDataPool, sizeof(struct trace_events));
+	return sizeof(struct trace_events);
+}
+
 /*--------------- TEST FUNCTIONS----------------*/
 
 
@@ -383,6 +393,133 @@ int ut_CommandIO_CreateResponse_FW_VERSION(void)
 	TestCaseEnd();
 }
 
+int ut_CommandIO_CreateResponse_TRACE_EVENTS(void)
+{
+	TestCaseBegin();
+	struct response_frame mFrame;
+
+	CommandIO_CreateResponse(&mFrame, GET_TRACE_EVENTS, OK);
+	CHECK(mFrame.cmd == GET_TRACE_EVENTS);
+	CHECK(mFrame.length == 4 + sizeof(struct trace_events));
+	CHECK(mFrame.state == OK);
+	CHECK(0 == memcmp(&mFrame.data.traceEvents, g_RandomDataPool, sizeof(struct trace_events)));
+	TestCaseEnd();
+}
+
+int ut_CommandIO_CreateResponse_UART_CREDIT(void)
+{
+	TestCaseBegin();
+	struct response_frame mFrame;
+	uns8 i;
+
+	RingBuf_Init(&g_RingBuf);
+	CommandIO_CreateResponse(&mFrame, GET_UART_CREDIT, OK);
+	CHECK(mFrame.cmd == GET_UART_CREDIT);
+	CHECK(mFrame.length == 4 + sizeof(uns8));
+	CHECK(mFrame.state == OK);
+	CHECK(mFrame.data.uartCredit == RingBufferSize);
+
+	// bytes, which are still in the receive buffer, reduce the credit
+	for(i = 0; i < 100; i++) {
+		RingBuf_Put(&g_RingBuf, i);
+	}
+	CommandIO_CreateResponse(&mFrame, GET_UART_CREDIT, OK);
+	CHECK(mFrame.data.uartCredit == RingBufferSize - 100);
+	RingBuf_Init(&g_RingBuf);
+
+	TestCaseEnd();
+}
+
+/* masks <byte> like the host does */
+static void PutMasked(const uns8 byte)
+{
+	if(byte == STX || byte == DLE || byte == ETX) {
+		RingBuf_Put(&g_RingBuf, DLE);
+	}
+	RingBuf_Put(&g_RingBuf, byte);
+}
+
+static void PutFrame(const uns8 *pData, const uns8 length)
+{
+	uns8 crcH, crcL, i;
+	Crc_NewCrc(&crcH, &crcL);
+	RingBuf_Put(&g_RingBuf, STX);
+	for(i = 0; i < length; i++) {
+		Crc_AddCrc(pData[i], &crcH, &crcL);
+		PutMasked(pData[i]);
+	}
+	PutMasked(crcH);
+	PutMasked(crcL);
+	RingBuf_Put(&g_RingBuf, ETX);
+}
+
+int ut_CommandIO_Stats(void)
+{
+	TestCaseBegin();
+	struct response_frame mFrame;
+	const uns8 fade[] = { SET_FADE, 0x01, 0x02 };
+	uns32 numBytes = 0;
+	uns16 i;
+
+	memset(&g_Stats, 0, sizeof(g_Stats));
+	RingBuf_Init(&g_RingBuf);
+	CommandIO_Init();
+
+	// the stub of ScriptCtrl_Add rejects each command with SCRIPTBUFFER_FULL
+	PutFrame(fade, sizeof(fade));
+	numBytes += RingBufferSize - RingBuf_NumFree(&g_RingBuf);
+	CommandIO_GetCommands();
+	CHECK(1 == g_Stats.commands);
+	CHECK(1 == g_Stats.scriptFull);
+	CHECK(0 == g_Stats.crcErrors);
+
+	for(i = 0; i < sizeof(dummyFrame_completeFrame); i++) {
+		RingBuf_Put(&g_RingBuf, dummyFrame_completeFrame[i]);
+	}
+	numBytes += sizeof(dummyFrame_completeFrame);
+	CommandIO_GetCommands();
+	CHECK(1 == g_Stats.commands);
+	CHECK(1 == g_Stats.crcErrors);
+
+	// a frame longer than the command buffer
+	RingBuf_Put(&g_RingBuf, STX);
+	for(i = 0; i <= CMDFRAMELENGTH; i++) {
+		RingBuf_Put(&g_RingBuf, 0x01);
+		if(0 == (i % 100)) {
+			numBytes += RingBufferSize - RingBuf_NumFree(&g_RingBuf);
+			CommandIO_GetCommands();
+		}
+	}
+	RingBuf_Put(&g_RingBuf, ETX);
+	numBytes += RingBufferSize - RingBuf_NumFree(&g_RingBuf);
+	CommandIO_GetCommands();
+	CHECK(1 == g_Stats.lengthErrors);
+	CHECK(1 == g_Stats.crcErrors);
+	CHECK(0 == g_Stats.ringOverflows);
+	CHECK(100 == g_Stats.ringHighWater);
+
+	// the bytes in a full buffer are discarded
+	for(i = 0; i <= RingBufferSize; i++) {
+		RingBuf_Put(&g_RingBuf, 0x01);
+	}
+	CommandIO_GetCommands();
+	CHECK(1 == g_Stats.ringOverflows);
+	CHECK(RingBufferSize == g_Stats.ringHighWater);
+	CHECK(numBytes == g_Stats.rxBytes);
+
+	CommandIO_CreateResponse(&mFrame, GET_STATS, OK);
+	CHECK(mFrame.cmd == GET_STATS);
+	CHECK(mFrame.length == 4 + sizeof(struct device_stats));
+	CHECK(numBytes == ntohl(mFrame.data.stats.rxBytes));
+	CHECK(1 == ntohs(mFrame.data.stats.commands));
+	CHECK(1 == ntohs(mFrame.data.stats.crcErrors));
+	CHECK(1 == ntohs(mFrame.data.stats.lengthErrors));
+	CHECK(1 == ntohs(mFrame.data.stats.scriptFull));
+	CHECK(1 == ntohs(mFrame.data.stats.ringOverflows));
+	CHECK(RingBufferSize == mFrame.data.stats.ringHighWater);
+	TestCaseEnd();
+}
+
 int ut_CommandIO_CreateResponse_SET_FADE(void)
 {
 	TestCaseBegin();
@@ -456,6 +593,9 @@ int main(int argc, const char *argv[])
 	RunTest(true, ut_CommandIO_CreateResponse_CYCLETIME);
 	RunTest(true, ut_CommandIO_CreateResponse_TRACE);
 	RunTest(true, ut_CommandIO_CreateResponse_FW_VERSION);
+	RunTest(true, ut_CommandIO_CreateResponse_TRACE_EVENTS);
+	RunTest(true, ut_CommandIO_CreateResponse_UART_CREDIT);
+	RunTest(true, ut_CommandIO_Stats);
 	RunTest(true, ut_CommandIO_CreateResponse_SET_FADE);
 	RunTest(true, ut_CommandIO_Create_n_Send);
 	UnitTestMainEnd();
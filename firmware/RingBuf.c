@@ -65,3 +65,9 @@ bit RingBuf_IsEmpty(const struct RingBuffer *pBuf)
 	//Platform_EnableAllInterrupts();
 	return write == read;
 }
+
+uns8 RingBuf_NumFree(const struct RingBuffer *pBuf)
+{
+	uns8 used = pBuf->write - pBuf->read;
+	return RingBufferSize - used;
+}
@@ -50,6 +50,12 @@ extern bank7 struct RingBuffer g_RingBuf;
 bit RingBuf_HasError(struct RingBuffer *pBuf);
 bit RingBuf_IsEmpty(const struct RingBuffer *pBuf);
 
+/**
+ * Number of bytes, which can be added before the buffer is full.
+ * The firmware advertises this to the host as uart credit (GET_UART_CREDIT)
+ */
+uns8 RingBuf_NumFree(const struct RingBuffer *pBuf);
+
 
 /**
  * Initialize the ring buffer and all associated variables
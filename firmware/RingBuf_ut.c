@@ -73,11 +73,38 @@ int ut_RingBuf_PutGet(void)
 	TestCaseEnd();
 }
 
+int ut_RingBuf_NumFree(void)
+{
+	TestCaseBegin();
+	struct RingBuffer testBuffer;
+	uns8 data;
+
+	RingBuf_Init(&testBuffer);
+	CHECK(RingBufferSize == RingBuf_NumFree(&testBuffer));
+
+	// the free space is reported correctly, when the indices wrap around
+	for(data = 0; data < 200; data++) {
+		RingBuf_Put(&testBuffer, data);
+		RingBuf_Get(&testBuffer);
+	}
+	for(data = 0; data < RingBufferSize; data++) {
+		CHECK(RingBufferSize - data == RingBuf_NumFree(&testBuffer));
+		RingBuf_Put(&testBuffer, data);
+	}
+	CHECK(0 == RingBuf_NumFree(&testBuffer));
+	CHECK(!RingBuf_HasError(&testBuffer));
+
+	RingBuf_Get(&testBuffer);
+	CHECK(1 == RingBuf_NumFree(&testBuffer));
+	TestCaseEnd();
+}
+
 int main(int argc, const char *argv[])
 {
 	UnitTestMainBegin();
 	RunTest(true, ut_RingBuf_Init);
 	RunTest(true, ut_RingBuf_PutGet);
+	RunTest(true, ut_RingBuf_NumFree);
 	UnitTestMainEnd();
 }
 
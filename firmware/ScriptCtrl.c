@@ -22,6 +22,7 @@
 #include "eeprom.h"
 #include "error.h"
 #include "trace.h"
+#include "usart.h"
 
 /**************** private functions/ macros *****************/
 /**
@@ -35,28 +36,42 @@
 #define ScriptBufInc(x) ((x + 1) & SCRIPTCTRL_NUM_CMD_MAX)
 
 /**
- * Setter for ScriptBuf.inLoop
+ * Helper to convert a slot index relative to ScriptBuf.read into a ScriptBuf pointer
  */
-#define ScriptBufSetInLoop(x) { \
-		Eeprom_Write(EEPROM_SCRIPTBUF_INLOOP, x); \
-		gScriptBuf.inLoop = x; \
-}
+#define ScriptBufSlot(index) ((gScriptBuf.read + (index)) & SCRIPTCTRL_NUM_CMD_MAX)
 
 /**
- * Setter for ScriptBuf.read
+ * Number of commands stored in the script ring
  */
-#define ScriptBufSetRead(x) { \
-		Eeprom_Write(EEPROM_SCRIPTBUF_READ, x); \
-		gScriptBuf.read = x; \
-}
+#define ScriptBufNumUsed() ((gScriptBuf.write - gScriptBuf.read) & SCRIPTCTRL_NUM_CMD_MAX)
 
 /**
- * Setter for ScriptBuf.write
+ * The pointer log contains entries of two bytes: <read> | lap bit and <write>.
+ * The lap bit toggles each time the log wraps around, so the current entry
+ * is the last one with the lap bit of the first entry.
  */
-#define ScriptBufSetWrite(x) { \
-		Eeprom_Write(EEPROM_SCRIPTBUF_WRITE, x); \
-		gScriptBuf.write = x; \
-}
+#define EEPROM_SCRIPTBUF_LOG ScriptBufAddr(SCRIPTCTRL_NUM_CMD_MAX + 1)
+#define SCRIPTBUF_LOG_NUM_ENTRIES (EEPROM_SCRIPTBUF_LOG_SIZE / 2)
+#define SCRIPTBUF_LOG_LAP 0x80
+
+/**
+ * The layout marker follows the pointer log. It contains a version and the
+ * size of a stored command, a ring of a firmware with another layout is
+ * cleared. Increment the version, if the format of the stored commands
+ * changes without changing their size.
+ */
+#define EEPROM_SCRIPTBUF_LAYOUT (EEPROM_SCRIPTBUF_LOG + EEPROM_SCRIPTBUF_LOG_SIZE)
+#define SCRIPTBUF_LAYOUT_VERSION 1
+
+#ifdef __CC8E__
+/* the script ring, its pointer log and the layout marker have to fit into the 1024 bytes of data eeprom */
+typedef uns8 ScriptBufFitsIntoEeprom[((EEPROM_SCRIPTBUF_LAYOUT + EEPROM_SCRIPTBUF_LAYOUT_SIZE) <= 1024) ? 1 : -1];
+#endif
+
+/**
+ * Pointers of the script ring changed since they were stored in eeprom
+ */
+#define ScriptBufIsPersisted() ((gScriptBuf.read == gScriptBuf.persistedRead) && (gScriptBuf.write == gScriptBuf.persistedWrite))
 
 /**
  * Prototyp - Private function
@@ -64,9 +79,23 @@
  */
 uns8 ScriptCtrl_Write(const struct led_cmd *pCmd);
 
+/**
+ * Prototyp - Private function
+ * store <read> and <write> in the next entry of the eeprom log
+ */
+void ScriptCtrl_Persist(void);
+
+/**
+ * Prototyp - Private function
+ * copy <length> bytes of a command to the RAM copy of the script ring
+ */
+void ScriptCtrl_Copy(uns8 *pDest, const uns8 *pSrc, const uns8 length);
+
 /* private globals */
 struct ScriptBuf gScriptBuf;
-struct led_cmd nextCmd;
+
+/* RAM copy of the script ring in eeprom */
+struct led_cmd gScriptCache[SCRIPTCTRL_NUM_CMD_MAX + 1];
 
 uns8 ScriptCtrl_Add(struct led_cmd *pCmd)
 {
@@ -109,6 +138,7 @@ uns8 ScriptCtrl_Add(struct led_cmd *pCmd)
 	{
 		CommandIO_CreateResponse(&g_ResponseBuf, START_BL, OK);
 		CommandIO_SendResponse(&g_ResponseBuf);
+		UART_Flush();
 		Platform_EnableBootloaderAutostart();
 		softReset();
 		/* never reach this */
@@ -134,7 +164,7 @@ uns8 ScriptCtrl_Add(struct led_cmd *pCmd)
 #endif /* #ifdef __CC8E__ */
 	case SET_COLOR_DIRECT:
 	{
-		Ledstrip_SetColorDirect((uns8 *)&pCmd->data.set_color_direct.ptr_led_array);
+		Ledstrip_SetColorDirect(pCmd->data.set_color_direct.segment, (uns8 *)&pCmd->data.set_color_direct.ptr_led_array);
 		return NO_RESPONSE;
 	}
 #ifdef __CC8E__
@@ -163,6 +193,30 @@ uns8 ScriptCtrl_Add(struct led_cmd *pCmd)
 	{
 		return OK;
 	}
+	case GET_SCRIPT_STATE:
+	{
+		return OK;
+	}
+	case GET_TRACE_EVENTS:
+	{
+		return OK;
+	}
+	case GET_UART_CREDIT:
+	{
+		return OK;
+	}
+	case GET_STATS:
+	{
+		return OK;
+	}
+	case SET_SCRIPT_SLOT:
+	{
+		return ScriptCtrl_SetSlot(&pCmd->data.set_script_slot);
+	}
+	case TRUNCATE_SCRIPT:
+	{
+		return ScriptCtrl_Truncate(pCmd->data.truncate_script.index);
+	}
 	default:
 	{
 		return BAD_COMMAND_CODE;
@@ -173,22 +227,144 @@ uns8 ScriptCtrl_Add(struct led_cmd *pCmd)
 
 void ScriptCtrl_Clear(void)
 {
-	ScriptBufSetInLoop(FALSE);
-	ScriptBufSetRead(EEPROM_SCRIPTBUF_BASE);
-	ScriptBufSetWrite(EEPROM_SCRIPTBUF_BASE);
+	gScriptBuf.inLoop = FALSE;
+	gScriptBuf.read = 0;
+	gScriptBuf.write = 0;
 	gScriptBuf.execute = gScriptBuf.read;
 	gScriptBuf.waitValue = 0;
 	gScriptBuf.isClearing = FALSE;
+
+	/* the old script must not come back after a power loss */
+	ScriptCtrl_Persist();
 }
 
 void ScriptCtrl_Init(void)
 {
-	gScriptBuf.inLoop = Eeprom_Read(EEPROM_SCRIPTBUF_INLOOP);
-	gScriptBuf.read = Eeprom_Read(EEPROM_SCRIPTBUF_READ);
-	gScriptBuf.write = Eeprom_Read(EEPROM_SCRIPTBUF_WRITE);
+	uns16 tempAddress = EEPROM_SCRIPTBUF_LOG;
+	uns8 i;
+
+	/* the pointers of another layout might point to garbage, the ring starts empty */
+	if((SCRIPTBUF_LAYOUT_VERSION != Eeprom_Read(EEPROM_SCRIPTBUF_LAYOUT))
+	   || (sizeof(struct led_cmd) != Eeprom_Read(EEPROM_SCRIPTBUF_LAYOUT + 1))) {
+		for(i = 0; i < EEPROM_SCRIPTBUF_LOG_SIZE; i++) {
+			Eeprom_Write(tempAddress + i, 0);
+		}
+		Eeprom_Write(EEPROM_SCRIPTBUF_LAYOUT + 1, sizeof(struct led_cmd));
+		Eeprom_Write(EEPROM_SCRIPTBUF_LAYOUT, SCRIPTBUF_LAYOUT_VERSION);
+	}
+
+	/* find the current entry of the pointer log */
+	const uns8 lap = Eeprom_Read(tempAddress) & SCRIPTBUF_LOG_LAP;
+	for(i = 1; i < SCRIPTBUF_LOG_NUM_ENTRIES; i++) {
+		if(lap != (Eeprom_Read(tempAddress + 2) & SCRIPTBUF_LOG_LAP)) {
+			break;
+		}
+		tempAddress += 2;
+	}
+	gScriptBuf.logIndex = i - 1;
+	gScriptBuf.logLap = lap;
+	gScriptBuf.read = Eeprom_Read(tempAddress) & SCRIPTCTRL_NUM_CMD_MAX;
+	gScriptBuf.write = Eeprom_Read(tempAddress + 1) & SCRIPTCTRL_NUM_CMD_MAX;
+	gScriptBuf.persistedRead = gScriptBuf.read;
+	gScriptBuf.persistedWrite = gScriptBuf.write;
+	gScriptBuf.persistDelay = SCRIPTCTRL_PERSIST_DELAY;
+
+	/* a loop is entered again by its LOOP_ON, which is still stored at <read> */
+	gScriptBuf.inLoop = FALSE;
 	gScriptBuf.execute = gScriptBuf.read;
 	gScriptBuf.isRunning = TRUE;
+
+	for(i = 0; i <= SCRIPTCTRL_NUM_CMD_MAX; i++) {
+		Eeprom_ReadBlock((uns8 *)&gScriptCache[i], ScriptBufAddr(i), sizeof(struct led_cmd));
+	}
+}
+
+void ScriptCtrl_Persist(void)
+{
+	uns8 index = gScriptBuf.logIndex + 1;
+	if(index >= SCRIPTBUF_LOG_NUM_ENTRIES) {
+		index = 0;
+		gScriptBuf.logLap ^= SCRIPTBUF_LOG_LAP;
+	}
+
+	/* the lap bit is written last, a partial entry isn't valid */
+	uns16 tempAddress = EEPROM_SCRIPTBUF_LOG + index + index;
+	Eeprom_Write(tempAddress + 1, gScriptBuf.write);
+	Eeprom_Write(tempAddress, gScriptBuf.read | gScriptBuf.logLap);
+
+	gScriptBuf.logIndex = index;
+	gScriptBuf.persistedRead = gScriptBuf.read;
+	gScriptBuf.persistedWrite = gScriptBuf.write;
+	gScriptBuf.persistDelay = SCRIPTCTRL_PERSIST_DELAY;
+}
+
+void ScriptCtrl_GetState(struct script_state *pState)
+{
+	/* one slot stays unused to tell a full from an empty ring */
+	pState->numFree = (gScriptBuf.read - gScriptBuf.write - 1) & SCRIPTCTRL_NUM_CMD_MAX;
+	pState->read = gScriptBuf.read;
+	pState->execute = gScriptBuf.execute;
+	pState->write = gScriptBuf.write;
+}
+
+uns8 ScriptCtrl_SetSlot(const struct cmd_set_script_slot *pSlot)
+{
+	if(gScriptBuf.isClearing || (pSlot->index >= ScriptBufNumUsed())) {
+		return BAD_SCRIPT_INDEX;
+	}
+
+	if((pSlot->cmd != SET_FADE) && (pSlot->cmd != SET_GRADIENT) && (pSlot->cmd != WAIT)) {
+		return BAD_SCRIPT_INDEX;
+	}
+
+	const uns8 slot = ScriptBufSlot(pSlot->index);
+	struct led_cmd *pCached = &gScriptCache[slot];
+	if((pCached->cmd == LOOP_ON) || (pCached->cmd == LOOP_OFF)) {
+		return BAD_SCRIPT_INDEX;
+	}
+
+	/* only the bytes of the new command, to save eeprom write cycles */
+	ScriptCtrl_Copy((uns8 *)pCached, &pSlot->cmd, sizeof(pSlot->cmd) + sizeof(pSlot->data));
+	Eeprom_WriteBlock(&pSlot->cmd, ScriptBufAddr(slot), sizeof(pSlot->cmd) + sizeof(pSlot->data));
+	return OK;
 }
+
+uns8 ScriptCtrl_Truncate(const uns8 index)
+{
+	if(gScriptBuf.isClearing || (index > ScriptBufNumUsed())) {
+		return BAD_SCRIPT_INDEX;
+	}
+
+	/* rebuild the loop stack ScriptCtrl_Add() needs for the next commands */
+	uns8 newWrite = ScriptBufSlot(index);
+	uns8 slot = gScriptBuf.read;
+	uns8 depth = 0;
+	while(slot != newWrite) {
+		uns8 cmd = gScriptCache[slot].cmd;
+		if(cmd == LOOP_ON) {
+			gScriptBuf.loopStart[depth] = slot;
+			depth++;
+		} else if(cmd == LOOP_OFF) {
+			depth--;
+		}
+		slot = ScriptBufInc(slot);
+	}
+	gScriptBuf.loopDepth = depth;
+
+	/* the next command to execute was removed, continue with the next we receive */
+	if(((gScriptBuf.execute - gScriptBuf.read) & SCRIPTCTRL_NUM_CMD_MAX) > index) {
+		gScriptBuf.execute = newWrite;
+		if(depth == 0) {
+			gScriptBuf.inLoop = FALSE;
+		}
+	}
+	gScriptBuf.write = newWrite;
+
+	/* the removed slots will be reused, so they have to leave the ring in eeprom now */
+	ScriptCtrl_Persist();
+	return OK;
+}
+
 //TODO Add a Methode to test the Errorbits and there responses
 
 void ScriptCtrl_Run(void)
@@ -198,109 +374,115 @@ void ScriptCtrl_Run(void)
 		ScriptCtrl_Clear();
 	}
 
-	if(!gScriptBuf.isRunning) return;
-
-	if(gScriptBuf.waitValue > 0) {
-		return;
+	/* collect pointer changes, until the last update in eeprom is old enough */
+	if((0 == gScriptBuf.persistDelay) && !ScriptBufIsPersisted()) {
+		ScriptCtrl_Persist();
 	}
 
-	/* cmd available? */
-	if(gScriptBuf.execute == gScriptBuf.write) {
-		return;
-	}
+	if(!gScriptBuf.isRunning) return;
 
-	/* read next cmd from buffer */
-	uns16 tempAddress = ScriptBufAddr(gScriptBuf.execute);
-	Eeprom_ReadBlock((uns8 *)&nextCmd, tempAddress, sizeof(nextCmd));
+	/* run everything, which doesn't take time, so simultaneous changes start in the same frame */
+	uns8 budget;
+	for(budget = SCRIPTCTRL_RUN_BUDGET; budget > 0; budget--) {
+		if(gScriptBuf.waitValue > 0) {
+			return;
+		}
 
-	switch(nextCmd.cmd)
-	{
-	case LOOP_ON:
-	{
-		//Trace_String("LOOP_ON;");
-		/* move execute pointer to the next command */
-		gScriptBuf.execute = ScriptBufInc(gScriptBuf.execute);
-		ScriptBufSetInLoop(TRUE);
-		break;
-	}
-	case LOOP_OFF:
-	{
-		if(LOOP_INFINITE == nextCmd.data.loopEnd.counter) {
-			//Trace_String("End of infinite loop reached;");
-			/* move execute pointer to the top of this loop */
-			gScriptBuf.execute = nextCmd.data.loopEnd.startIndex;
-		} else if(nextCmd.data.loopEnd.counter > 1)   {
-			/*Trace_String("normal loop iteration");
-			//Trace_Hex(nextCmd.data.loopEnd.counter);
-			//Trace_Hex(nextCmd.data.loopEnd.depth);
-			Trace_String(";");*/
-			/* update counter and set execute pointer to start of the loop */
-			nextCmd.data.loopEnd.counter--;
-			Eeprom_WriteBlock((uns8 *)&nextCmd, tempAddress, sizeof(struct led_cmd));
-
-			/* move execute pointer to the top of this loop */
-			gScriptBuf.execute = nextCmd.data.loopEnd.startIndex;
-		} else {
-			if(0 == nextCmd.data.loopEnd.depth) {
-				//Trace_String("End of top loop reached;");
-				/* move execute pointer to the next command */
-				gScriptBuf.execute = ScriptBufInc(gScriptBuf.execute);
-
-				/* delete loop body from buffer */
-				ScriptBufSetRead(gScriptBuf.execute);
-				ScriptBufSetInLoop(FALSE);
+		/* cmd available? */
+		if(gScriptBuf.execute == gScriptBuf.write) {
+			return;
+		}
+
+		/* next cmd from the RAM copy of the buffer */
+		struct led_cmd *pCmd = &gScriptCache[gScriptBuf.execute];
+		Trace_Event(eTRACE_SCRIPT_COMMAND, pCmd->cmd);
+
+		switch(pCmd->cmd)
+		{
+		case LOOP_ON:
+		{
+			//Trace_String("LOOP_ON;");
+			/* move execute pointer to the next command */
+			gScriptBuf.execute = ScriptBufInc(gScriptBuf.execute);
+			gScriptBuf.inLoop = TRUE;
+			break;
+		}
+		case LOOP_OFF:
+		{
+			if(LOOP_INFINITE == pCmd->data.loopEnd.counter) {
+				//Trace_String("End of infinite loop reached;");
+				/* move execute pointer to the top of this loop */
+				gScriptBuf.execute = pCmd->data.loopEnd.startIndex;
+			} else if(pCmd->data.loopEnd.counter > 1)   {
+				/*Trace_String("normal loop iteration");
+				//Trace_Hex(pCmd->data.loopEnd.counter);
+				//Trace_Hex(pCmd->data.loopEnd.depth);
+				Trace_String(";");*/
+				/* update counter in RAM only and set execute pointer to start of the loop */
+				pCmd->data.loopEnd.counter--;
+
+				/* move execute pointer to the top of this loop */
+				gScriptBuf.execute = pCmd->data.loopEnd.startIndex;
 			} else {
-				//Trace_String("End of inner loop reached;");
-				/* reinit counter for next iteration */
-				nextCmd.data.loopEnd.counter = nextCmd.data.loopEnd.numLoops;
-				uns16 tempAddress = ScriptBufAddr(gScriptBuf.execute);
-				Eeprom_WriteBlock((uns8 *)&nextCmd, tempAddress, sizeof(struct led_cmd));
-
-				/* move execute pointer to the next command */
-				gScriptBuf.execute = ScriptBufInc(gScriptBuf.execute);
+				if(0 == pCmd->data.loopEnd.depth) {
+					//Trace_String("End of top loop reached;");
+					/* move execute pointer to the next command */
+					gScriptBuf.execute = ScriptBufInc(gScriptBuf.execute);
+
+					/* delete loop body from buffer */
+					gScriptBuf.read = gScriptBuf.execute;
+					gScriptBuf.inLoop = FALSE;
+				} else {
+					//Trace_String("End of inner loop reached;");
+					/* reinit counter for next iteration */
+					pCmd->data.loopEnd.counter = pCmd->data.loopEnd.numLoops;
+
+					/* move execute pointer to the next command */
+					gScriptBuf.execute = ScriptBufInc(gScriptBuf.execute);
+				}
 			}
+			break;
 		}
-		break;
-	}
-	case SET_FADE:
-	{
-		Ledstrip_SetFade(&nextCmd.data.set_fade);
-		if(nextCmd.data.set_fade.parallelFade == 0) {
-			gScriptBuf.waitValue = ntohs(nextCmd.data.set_fade.fadeTmms);
-		}
+		case SET_FADE:
+		{
+			Ledstrip_SetFade(&pCmd->data.set_fade);
+			if(pCmd->data.set_fade.parallelFade == 0) {
+				gScriptBuf.waitValue = ntohs(pCmd->data.set_fade.fadeTmms);
+			}
 
-		/* move execute pointer to the next command */
-		gScriptBuf.execute = ScriptBufInc(gScriptBuf.execute);
-		if(!gScriptBuf.inLoop) {
-			ScriptBufSetRead(gScriptBuf.execute);
-		}
-		break;
-	}
-	case SET_GRADIENT:
-	{
-		Ledstrip_SetGradient(&nextCmd.data.set_gradient);
-		if((nextCmd.data.set_gradient.parallelAndOffset & 0x80) == 0) {
-			gScriptBuf.waitValue = ntohs(nextCmd.data.set_gradient.fadeTmms);
+			/* move execute pointer to the next command */
+			gScriptBuf.execute = ScriptBufInc(gScriptBuf.execute);
+			if(!gScriptBuf.inLoop) {
+				gScriptBuf.read = gScriptBuf.execute;
+			}
+			break;
 		}
+		case SET_GRADIENT:
+		{
+			Ledstrip_SetGradient(&pCmd->data.set_gradient);
+			if((pCmd->data.set_gradient.parallelAndOffset & 0x80) == 0) {
+				gScriptBuf.waitValue = ntohs(pCmd->data.set_gradient.fadeTmms);
+			}
 
-		/* move execute pointer to the next command */
-		gScriptBuf.execute = ScriptBufInc(gScriptBuf.execute);
-		if(!gScriptBuf.inLoop) {
-			ScriptBufSetRead(gScriptBuf.execute);
+			/* move execute pointer to the next command */
+			gScriptBuf.execute = ScriptBufInc(gScriptBuf.execute);
+			if(!gScriptBuf.inLoop) {
+				gScriptBuf.read = gScriptBuf.execute;
+			}
+			break;
+		}
+		case WAIT:
+		{
+			/* TODO we should disable interrupts while changing waitValue */
+			gScriptBuf.waitValue = ntohs(pCmd->data.wait.waitTmms);
+			/* move execute pointer to the next command */
+			gScriptBuf.execute = ScriptBufInc(gScriptBuf.execute);
+			if(!gScriptBuf.inLoop) {
+				gScriptBuf.read = gScriptBuf.execute;
+			}
+			break;
 		}
-		break;
-	}
-	case WAIT:
-	{
-		/* TODO we should disable interrupts while changing waitValue */
-		gScriptBuf.waitValue = ntohs(nextCmd.data.wait.waitTmms);
-		/* move execute pointer to the next command */
-		gScriptBuf.execute = ScriptBufInc(gScriptBuf.execute);
-		if(!gScriptBuf.inLoop) {
-			ScriptBufSetRead(gScriptBuf.execute);
 		}
-		break;
-	}
 	}
 }
 
@@ -312,19 +494,38 @@ uns8 ScriptCtrl_Write(const struct led_cmd *pCmd)
 
 	uns8 writeNext = ScriptBufInc(gScriptBuf.write);
 	if(writeNext != gScriptBuf.read) {
+		/* executed slots are reused, they have to leave the ring in eeprom first */
+		if(((gScriptBuf.write - gScriptBuf.persistedRead) & SCRIPTCTRL_NUM_CMD_MAX) < ((gScriptBuf.persistedWrite - gScriptBuf.persistedRead) & SCRIPTCTRL_NUM_CMD_MAX)) {
+			ScriptCtrl_Persist();
+		}
+
+		ScriptCtrl_Copy((uns8 *)&gScriptCache[gScriptBuf.write], (const uns8 *)pCmd, sizeof(struct led_cmd));
 		uns16 tempAddress = ScriptBufAddr(gScriptBuf.write);
 		Eeprom_WriteBlock((const uns8 *)pCmd, tempAddress, sizeof(struct led_cmd));
-		ScriptBufSetWrite(writeNext);
+		gScriptBuf.write = writeNext;
 		return OK;
 	}
 	return SCRIPTBUFFER_FULL;
 }
 
+void ScriptCtrl_Copy(uns8 *pDest, const uns8 *pSrc, const uns8 length)
+{
+	uns8 i;
+	for(i = 0; i < length; i++) {
+		*pDest = *pSrc;
+		pDest++;
+		pSrc++;
+	}
+}
+
 void ScriptCtrl_DecrementWaitValue(void)
 {
 	if(gScriptBuf.waitValue > 0) {
 		gScriptBuf.waitValue = gScriptBuf.waitValue - 1;
 	}
+	if(gScriptBuf.persistDelay > 0) {
+		gScriptBuf.persistDelay = gScriptBuf.persistDelay - 1;
+	}
 }
 
 void ScriptCtrl_CheckAndDecrementWaitValue(void)
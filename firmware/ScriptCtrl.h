@@ -23,17 +23,38 @@
 #include "wifly_cmd.h"
 #include "error.h"
 
-#define SCRIPTCTRL_NUM_CMD_MAX 63                       /*BITMASK */
 #define SCRIPTCTRL_LOOP_DEPTH_MAX 4
 
+/* minimum number of waitValue ticks between two updates of the pointers in eeprom */
+#define SCRIPTCTRL_PERSIST_DELAY 500
+
+/* maximum number of commands ScriptCtrl_Run() executes in one pass of the main cycle,
+ * enough for one parallel fade per led of a segment and a few loop commands */
+#define SCRIPTCTRL_RUN_BUDGET (NUM_OF_LED_PER_SEGMENT + 8)
+
+/**
+ * The commands of the script ring are executed from a RAM copy, the eeprom
+ * is only read at startup. Commands are written to eeprom, when they are
+ * added, but loop counters are only kept in RAM. After a power loss each
+ * loop starts with its full number of iterations.
+ *
+ * <read> and <write> are stored in a wear levelled log in eeprom. Changes are
+ * collected for at least SCRIPTCTRL_PERSIST_DELAY ticks and stored at once.
+ * <persistedRead>/<persistedWrite> are the pointers stored in the log entry <logIndex>.
+ */
 struct ScriptBuf {
 	uns16 waitValue;
+	uns16 persistDelay;
 	uns8 loopStart[SCRIPTCTRL_LOOP_DEPTH_MAX];
 	uns8 loopDepth;
 	uns8 execute;
 	uns8 read;
 	uns8 write;
 	uns8 inLoop;
+	uns8 persistedRead;
+	uns8 persistedWrite;
+	uns8 logIndex;
+	uns8 logLap;
 	bit isRunning;
 	bit isClearing;
 };
@@ -51,17 +72,38 @@ uns8 ScriptCtrl_Add(struct led_cmd *pCmd);
 void ScriptCtrl_Clear(void);
 
 /**
- * Initialize script controller.
+ * Initialize script controller, the script ring is restored from eeprom.
  */
 void ScriptCtrl_Init(void);
 
 /**
- * Read next available command from eeprom and run it.
+ * Report the free slots and the pointers of the script ring
+ */
+void ScriptCtrl_GetState(struct script_state *pState);
+
+/**
+ * Overwrite a command in the script ring, to edit a script without uploading it again.
+ * Loop commands can't be overwritten, because the loop information is resolved
+ * while they are added.
+ */
+uns8 ScriptCtrl_SetSlot(const struct cmd_set_script_slot *pSlot);
+
+/**
+ * Remove all commands beginning with slot <index> from the script ring, following
+ * commands are added at this position.
+ */
+uns8 ScriptCtrl_Truncate(const uns8 index);
+
+/**
+ * Run the available commands until one of them takes time (a wait or a fade,
+ * which isn't parallel) or SCRIPTCTRL_RUN_BUDGET commands were executed. Store
+ * changed pointers of the script ring, if SCRIPTCTRL_PERSIST_DELAY passed
+ * since they were stored last.
  */
 void ScriptCtrl_Run(void);
 
 /**
- * Decrements the wait counter of the script controller
+ * Decrements the wait counter and the persist delay of the script controller
  */
 void ScriptCtrl_DecrementWaitValue(void);
 
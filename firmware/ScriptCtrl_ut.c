@@ -25,9 +25,11 @@
 int gSetColorDirectWasCalled;
 int gSetFadeWasCalled;
 int gSetGradientWasCalled;
+uns8 gLastFadeRed;
 
 /**************** includes and functions for wrapping ****************/
 #include "ScriptCtrl.h"
+#include "eeprom.h"
 jmp_buf g_ResetEnvironment;
 struct ScriptBuf gScriptBuf;
 struct response_frame g_ResponseBuf;
@@ -38,6 +40,9 @@ void CommandIO_CreateResponse(struct response_frame *mFrame, uns8 cmd)
 void CommandIO_SendResponse(struct response_frame *mFrame)
 {}
 
+void UART_Flush(void)
+{}
+
 void Ledstrip_SetColorDirect(struct cmd_set_fade *pCmd)
 {
 	Trace_String("Ledstrip_SetColorDirect was called\n");
@@ -47,7 +52,8 @@ void Ledstrip_SetColorDirect(struct cmd_set_fade *pCmd)
 void Ledstrip_SetFade(struct cmd_set_fade *pCmd)
 {
 	Trace_String("Ledstrip_SetFade was called\n");
-	gSetFadeWasCalled = TRUE;
+	gSetFadeWasCalled++;
+	gLastFadeRed = pCmd->red;
 }
 
 void Ledstrip_SetGradient(struct cmd_set_fade *pCmd)
@@ -56,6 +62,25 @@ void Ledstrip_SetGradient(struct cmd_set_fade *pCmd)
 	gSetGradientWasCalled = TRUE;
 }
 
+/* the wait of the last command expired, run the commands until the next one, which takes time */
+static void NextTick(void)
+{
+	gScriptBuf.waitValue = 0;
+	gSetFadeWasCalled = 0;
+	ScriptCtrl_Run();
+}
+
+/* a fade of one tick, it blocks the script until the next tick */
+static void AddFade(const uns8 red)
+{
+	struct led_cmd testCmd;
+	memset(&testCmd, 0, sizeof(testCmd));
+	testCmd.cmd = SET_FADE;
+	testCmd.data.set_fade.red = red;
+	testCmd.data.set_fade.fadeTmms = htons(1);
+	ScriptCtrl_Add(&testCmd);
+}
+
 /******************************* test functions *******************************/
 /* add simple command and read back */
 int ut_ScriptCtrl_SimpleReadWrite(void)
@@ -115,70 +140,54 @@ int ut_ScriptCtrl_SimpleLoop(void)
 	ScriptCtrl_Add(&testCmd);
 
 	/* add dummy command to buffer */
-	testCmd.cmd = SET_FADE;
-	ScriptCtrl_Add(&testCmd);
+	AddFade(1);
 
 	/* add loop end to buffer */
 	testCmd.cmd = LOOP_OFF;
 	testCmd.data.loopEnd.numLoops = NUM_TEST_LOOPS;
 	ScriptCtrl_Add(&testCmd);
 
-	/* start loop should be read */
+	/* start loop should be read together with the first dummy command */
 	CHECK(!gScriptBuf.inLoop)
-	ScriptCtrl_Run();
+	NextTick();
 	CHECK(gScriptBuf.inLoop);
+	CHECK(1 == gSetFadeWasCalled);
 
 	int i;
-	for(i = 0; i < NUM_TEST_LOOPS; i++) {
-		/* dummy command should be executed */
-		gSetFadeWasCalled = FALSE;
-		ScriptCtrl_Run();
-		CHECK(gSetFadeWasCalled);
-
-		/* now next loop should be called */
-		gSetFadeWasCalled = FALSE;
-		ScriptCtrl_Run();
-		CHECK(!gSetFadeWasCalled);
+	for(i = 1; i < NUM_TEST_LOOPS; i++) {
+		/* the loop end jumps back to the dummy command */
+		NextTick();
+		CHECK(1 == gSetFadeWasCalled);
+		CHECK(gScriptBuf.inLoop);
 	}
 
-	/* no more command should be available */
-	gSetFadeWasCalled = FALSE;
-	ScriptCtrl_Run();
-	CHECK(!gSetFadeWasCalled);
+	/* the last loop end leaves the loop, no more command should be available */
+	NextTick();
+	CHECK(0 == gSetFadeWasCalled);
+	CHECK(!gScriptBuf.inLoop);
 	TestCaseEnd();
 }
 
+#define OUTER_FADE 1
+#define INNER_FADE 2
+
 int ut_ScriptCtrl_DoOuterInnerLoop(int loopCount)
 {
 	TestCaseBegin();
 	int i, j;
 	for(i = 0; i < loopCount; i++) {
 		/* outer dummy command should be executed */
-		gSetFadeWasCalled = FALSE;
-		ScriptCtrl_Run();
-		CHECK(gSetFadeWasCalled);
-
-		/* start inner loop should be read */
-		CHECK(gScriptBuf.inLoop)
-		ScriptCtrl_Run();
+		NextTick();
+		CHECK(1 == gSetFadeWasCalled);
+		CHECK(OUTER_FADE == gLastFadeRed);
 		CHECK(gScriptBuf.inLoop);
 
 		for(j = 0; j < loopCount; j++) {
-			/* outer dummy command should be executed */
-			gSetFadeWasCalled = FALSE;
-			ScriptCtrl_Run();
-			CHECK(gSetFadeWasCalled);
-
-			/* now next inner loop should be called */
-			gSetFadeWasCalled = FALSE;
-			ScriptCtrl_Run();
-			CHECK(!gSetFadeWasCalled);
+			/* inner dummy command should be executed, the start or end of the inner loop is read along */
+			NextTick();
+			CHECK(1 == gSetFadeWasCalled);
+			CHECK(INNER_FADE == gLastFadeRed);
 		}
-
-		/* now next outer loop should be called */
-		gSetFadeWasCalled = FALSE;
-		ScriptCtrl_Run();
-		CHECK(!gSetFadeWasCalled);
 	}
 	TestCaseEnd();
 }
@@ -196,16 +205,14 @@ int ut_ScriptCtrl_InnerLoop(void)
 	ScriptCtrl_Add(&testCmd);
 
 	/* add outer dummy command to buffer */
-	testCmd.cmd = SET_FADE;
-	ScriptCtrl_Add(&testCmd);
+	AddFade(OUTER_FADE);
 
 	/* add inner loop begin to buffer */
 	testCmd.cmd = LOOP_ON;
 	ScriptCtrl_Add(&testCmd);
 
 	/* add inner dummy command to buffer */
-	testCmd.cmd = SET_FADE;
-	ScriptCtrl_Add(&testCmd);
+	AddFade(INNER_FADE);
 
 	/* add inner loop end to buffer */
 	testCmd.cmd = LOOP_OFF;
@@ -217,16 +224,13 @@ int ut_ScriptCtrl_InnerLoop(void)
 	testCmd.data.loopEnd.numLoops = NUM_TEST_LOOPS;
 	ScriptCtrl_Add(&testCmd);
 
-	/* start outer loop should be read */
+	/* start outer loop is read with the first outer dummy command */
 	CHECK(!gScriptBuf.inLoop)
-	ScriptCtrl_Run();
-	CHECK(gScriptBuf.inLoop);
 
 	errors += ut_ScriptCtrl_DoOuterInnerLoop(NUM_TEST_LOOPS);
 
 	/* no more command should be available */
-	gSetFadeWasCalled = FALSE;
-	ScriptCtrl_Run();
+	NextTick();
 	CHECK(!gSetFadeWasCalled);
 	TestCaseEnd();
 }
@@ -243,16 +247,14 @@ int ut_ScriptCtrl_InfiniteLoop(void)
 	ScriptCtrl_Add(&testCmd);
 
 	/* add outer dummy command to buffer */
-	testCmd.cmd = SET_FADE;
-	ScriptCtrl_Add(&testCmd);
+	AddFade(OUTER_FADE);
 
 	/* add inner loop begin to buffer */
 	testCmd.cmd = LOOP_ON;
 	ScriptCtrl_Add(&testCmd);
 
 	/* add inner dummy command to buffer */
-	testCmd.cmd = SET_FADE;
-	ScriptCtrl_Add(&testCmd);
+	AddFade(INNER_FADE);
 
 	/* add inner loop end to buffer */
 	testCmd.cmd = LOOP_OFF;
@@ -264,10 +266,8 @@ int ut_ScriptCtrl_InfiniteLoop(void)
 	testCmd.data.loopEnd.numLoops = LOOP_INFINITE;
 	ScriptCtrl_Add(&testCmd);
 
-	/* start outer loop should be read */
+	/* start outer loop is read with the first outer dummy command */
 	CHECK(!gScriptBuf.inLoop)
-	ScriptCtrl_Run();
-	CHECK(gScriptBuf.inLoop);
 
 	/* multiple calls should be no problem since we are in an infinite loop */
 	errors += ut_ScriptCtrl_DoOuterInnerLoop(NUM_TEST_LOOPS);
@@ -279,8 +279,7 @@ int ut_ScriptCtrl_InfiniteLoop(void)
 	ScriptCtrl_Add(&testCmd);
 
 	/* buffer should be empty again */
-	gSetFadeWasCalled = FALSE;
-	ScriptCtrl_Run();
+	NextTick();
 	CHECK(!gSetFadeWasCalled);
 	TestCaseEnd();
 }
@@ -354,6 +353,373 @@ int ut_ScriptCtrl_Wait(void)
 	TestCaseEnd();
 }
 
+/* free slots and pointers of the script ring */
+int ut_ScriptCtrl_GetState(void)
+{
+	TestCaseBegin();
+	struct led_cmd testCmd;
+	struct script_state state;
+	ScriptCtrl_Clear();
+
+	ScriptCtrl_GetState(&state);
+	CHECK(SCRIPTCTRL_NUM_CMD_MAX == state.numFree);
+
+	testCmd.cmd = WAIT;
+	testCmd.data.wait.waitTmms = htons(10);
+	ScriptCtrl_Add(&testCmd);
+	ScriptCtrl_Add(&testCmd);
+	ScriptCtrl_Add(&testCmd);
+	ScriptCtrl_GetState(&state);
+	CHECK(SCRIPTCTRL_NUM_CMD_MAX - 3 == state.numFree);
+	CHECK(state.read == state.execute);
+	CHECK(((state.read + 3) & SCRIPTCTRL_NUM_CMD_MAX) == state.write);
+
+	/* executed commands release their slot */
+	ScriptCtrl_Run();
+	ScriptCtrl_GetState(&state);
+	CHECK(SCRIPTCTRL_NUM_CMD_MAX - 2 == state.numFree);
+	CHECK(state.read == state.execute);
+
+	/* a full ring reports no free slot */
+	while(OK == ScriptCtrl_Add(&testCmd));
+	ScriptCtrl_GetState(&state);
+	CHECK(0 == state.numFree);
+	TestCaseEnd();
+}
+
+/* overwrite and truncate commands in the script ring */
+int ut_ScriptCtrl_EditScript(void)
+{
+	TestCaseBegin();
+	struct led_cmd testCmd;
+	struct script_state state;
+	ScriptCtrl_Clear();
+	gScriptBuf.loopDepth = 0;
+
+	/* fade, loop, fade, loop_off */
+	testCmd.cmd = SET_FADE;
+	testCmd.data.set_fade.parallelFade = 1;
+	ScriptCtrl_Add(&testCmd);
+	testCmd.cmd = LOOP_ON;
+	ScriptCtrl_Add(&testCmd);
+	testCmd.cmd = SET_FADE;
+	ScriptCtrl_Add(&testCmd);
+	testCmd.cmd = LOOP_OFF;
+	testCmd.data.loopEnd.numLoops = 2;
+	ScriptCtrl_Add(&testCmd);
+
+	/* replace the first fade with a wait */
+	testCmd.cmd = SET_SCRIPT_SLOT;
+	testCmd.data.set_script_slot.index = 0;
+	testCmd.data.set_script_slot.cmd = WAIT;
+	testCmd.data.set_script_slot.data.wait.waitTmms = htons(10);
+	CHECK(OK == ScriptCtrl_Add(&testCmd));
+	gSetFadeWasCalled = FALSE;
+	ScriptCtrl_Run();
+	CHECK(!gSetFadeWasCalled);
+	CHECK(10 == gScriptBuf.waitValue);
+	gScriptBuf.waitValue = 0;
+
+	/* the executed wait left the ring, so index 0 is the loop start now.
+	 * Loop commands and slots behind the last command can't be overwritten */
+	testCmd.data.set_script_slot.index = 0;
+	CHECK(BAD_SCRIPT_INDEX == ScriptCtrl_Add(&testCmd));
+	testCmd.data.set_script_slot.index = 2;
+	CHECK(BAD_SCRIPT_INDEX == ScriptCtrl_Add(&testCmd));
+	testCmd.data.set_script_slot.index = 1;
+	CHECK(OK == ScriptCtrl_Add(&testCmd));
+	testCmd.data.set_script_slot.cmd = LOOP_ON;
+	CHECK(BAD_SCRIPT_INDEX == ScriptCtrl_Add(&testCmd));
+
+	/* enter the loop, the fade was replaced by a wait */
+	ScriptCtrl_Run();
+	ScriptCtrl_Run();
+	CHECK(gScriptBuf.inLoop);
+	CHECK(10 == gScriptBuf.waitValue);
+	gScriptBuf.waitValue = 0;
+
+	/* remove the end of the running loop */
+	testCmd.cmd = TRUNCATE_SCRIPT;
+	testCmd.data.truncate_script.index = 4;
+	CHECK(BAD_SCRIPT_INDEX == ScriptCtrl_Add(&testCmd));
+	testCmd.data.truncate_script.index = 2;
+	CHECK(OK == ScriptCtrl_Add(&testCmd));
+	ScriptCtrl_GetState(&state);
+	CHECK(SCRIPTCTRL_NUM_CMD_MAX - 2 == state.numFree);
+	CHECK(state.execute == state.write);
+	CHECK(1 == gScriptBuf.loopDepth);
+
+	/* a new end of the loop refers to the remaining loop start */
+	testCmd.cmd = SET_FADE;
+	ScriptCtrl_Add(&testCmd);
+	testCmd.cmd = LOOP_OFF;
+	testCmd.data.loopEnd.numLoops = 2;
+	ScriptCtrl_Add(&testCmd);
+	gSetFadeWasCalled = FALSE;
+	ScriptCtrl_Run();
+	CHECK(gSetFadeWasCalled);
+	ScriptCtrl_Run();
+	ScriptCtrl_Run();
+	CHECK(10 == gScriptBuf.waitValue);
+	gScriptBuf.waitValue = 0;
+	gSetFadeWasCalled = FALSE;
+	ScriptCtrl_Run();
+	CHECK(gSetFadeWasCalled);
+	ScriptCtrl_Run();
+	CHECK(!gScriptBuf.inLoop);
+	ScriptCtrl_GetState(&state);
+	CHECK(SCRIPTCTRL_NUM_CMD_MAX == state.numFree);
+	TestCaseEnd();
+}
+
+#define EEPROM_RING_SIZE ((SCRIPTCTRL_NUM_CMD_MAX + 1) * sizeof(struct led_cmd))
+#define EEPROM_SIZE (EEPROM_RING_SIZE + EEPROM_SCRIPTBUF_LOG_SIZE + EEPROM_SCRIPTBUF_LAYOUT_SIZE)
+
+static void ReadEeprom(uns8 *pBuffer)
+{
+	uns16 i;
+	for(i = 0; i < EEPROM_SIZE; i++) {
+		pBuffer[i] = Eeprom_Read(i);
+	}
+}
+
+static size_t NumChangedBytes(const uns8 *pBuffer)
+{
+	size_t changed = 0;
+	uns16 i;
+	for(i = 0; i < EEPROM_SIZE; i++) {
+		changed += (pBuffer[i] != Eeprom_Read(i));
+	}
+	return changed;
+}
+
+/* start again like after a power loss */
+static void PowerLoss(void)
+{
+	memset(&gScriptBuf, 0, sizeof(gScriptBuf));
+	ScriptCtrl_Init();
+}
+
+/* running a script doesn't write to eeprom, pointer changes are stored together */
+int ut_ScriptCtrl_Persist(void)
+{
+	TestCaseBegin();
+	static uns8 eeprom[EEPROM_SIZE];
+	struct led_cmd testCmd;
+	struct script_state state;
+	int i;
+	memset(&testCmd, 0, sizeof(testCmd));
+	PowerLoss();
+	ScriptCtrl_Clear();
+	gScriptBuf.loopDepth = 0;
+
+	/* fade, loop, fade, loop_off, fade */
+	testCmd.cmd = SET_FADE;
+	ScriptCtrl_Add(&testCmd);
+	testCmd.cmd = LOOP_ON;
+	ScriptCtrl_Add(&testCmd);
+	testCmd.cmd = SET_FADE;
+	ScriptCtrl_Add(&testCmd);
+	testCmd.cmd = LOOP_OFF;
+	testCmd.data.loopEnd.numLoops = NUM_TEST_LOOPS;
+	ScriptCtrl_Add(&testCmd);
+	testCmd.cmd = SET_FADE;
+	ScriptCtrl_Add(&testCmd);
+
+	/* the new script is stored with the first command */
+	for(i = 0; i < SCRIPTCTRL_PERSIST_DELAY; i++) {
+		ScriptCtrl_DecrementWaitValue();
+	}
+	ScriptCtrl_Run();
+	ReadEeprom(eeprom);
+
+	for(i = 1; i < 3 + 2 * NUM_TEST_LOOPS; i++) {
+		ScriptCtrl_Run();
+	}
+	ScriptCtrl_GetState(&state);
+	CHECK(SCRIPTCTRL_NUM_CMD_MAX == state.numFree);
+	CHECK(0 == NumChangedBytes(eeprom));
+
+	/* the script was completed, before the pointers were stored */
+	PowerLoss();
+	ScriptCtrl_GetState(&state);
+	CHECK(SCRIPTCTRL_NUM_CMD_MAX - 5 == state.numFree);
+
+	/* one log entry, after the delay passed */
+	for(i = 0; i < 3 + 2 * NUM_TEST_LOOPS; i++) {
+		ScriptCtrl_Run();
+	}
+	for(i = 0; i < SCRIPTCTRL_PERSIST_DELAY; i++) {
+		ScriptCtrl_DecrementWaitValue();
+	}
+	ScriptCtrl_Run();
+	CHECK(2 == NumChangedBytes(eeprom));
+	PowerLoss();
+	ScriptCtrl_GetState(&state);
+	CHECK(SCRIPTCTRL_NUM_CMD_MAX == state.numFree);
+	TestCaseEnd();
+}
+
+/* loop counters are only kept in RAM, an interrupted loop starts again */
+int ut_ScriptCtrl_PowerLossInLoop(void)
+{
+	TestCaseBegin();
+	struct led_cmd testCmd;
+	int i, numFades;
+	memset(&testCmd, 0, sizeof(testCmd));
+	ScriptCtrl_Clear();
+	gScriptBuf.loopDepth = 0;
+
+	testCmd.cmd = LOOP_ON;
+	ScriptCtrl_Add(&testCmd);
+	AddFade(1);
+	testCmd.cmd = LOOP_OFF;
+	testCmd.data.loopEnd.numLoops = 3;
+	ScriptCtrl_Add(&testCmd);
+	gScriptBuf.persistDelay = 0;
+
+	/* the first two iterations */
+	NextTick();
+	NextTick();
+	CHECK(gScriptBuf.inLoop);
+
+	PowerLoss();
+	CHECK(!gScriptBuf.inLoop);
+	numFades = 0;
+	for(i = 0; i < 20; i++) {
+		NextTick();
+		numFades += gSetFadeWasCalled;
+	}
+	CHECK(3 == numFades);
+	CHECK(!gScriptBuf.inLoop);
+	TestCaseEnd();
+}
+
+/* commands, which don't take time, start in the same pass of the main cycle */
+int ut_ScriptCtrl_ZeroTimeCommands(void)
+{
+	TestCaseBegin();
+	struct led_cmd testCmd;
+	int i;
+	memset(&testCmd, 0, sizeof(testCmd));
+	ScriptCtrl_Clear();
+	gScriptBuf.loopDepth = 0;
+
+	/* one parallel fade for each led, a parallel gradient, wait, fade */
+	testCmd.cmd = SET_FADE;
+	testCmd.data.set_fade.parallelFade = 1;
+	testCmd.data.set_fade.fadeTmms = htons(100);
+	for(i = 0; i < NUM_OF_LED_PER_SEGMENT; i++) {
+		ScriptCtrl_Add(&testCmd);
+	}
+	testCmd.cmd = SET_GRADIENT;
+	testCmd.data.set_gradient.parallelAndOffset = 0x80;
+	ScriptCtrl_Add(&testCmd);
+	testCmd.cmd = WAIT;
+	testCmd.data.wait.waitTmms = htons(5);
+	ScriptCtrl_Add(&testCmd);
+	AddFade(1);
+
+	gSetGradientWasCalled = FALSE;
+	NextTick();
+	CHECK(NUM_OF_LED_PER_SEGMENT == gSetFadeWasCalled);
+	CHECK(gSetGradientWasCalled);
+	CHECK(5 == gScriptBuf.waitValue);
+
+	/* the fade waits for the next tick */
+	gSetFadeWasCalled = 0;
+	ScriptCtrl_Run();
+	CHECK(0 == gSetFadeWasCalled);
+	NextTick();
+	CHECK(1 == gSetFadeWasCalled);
+
+	/* a loop of parallel fades never waits, each pass is limited */
+	ScriptCtrl_Clear();
+	testCmd.cmd = LOOP_ON;
+	ScriptCtrl_Add(&testCmd);
+	testCmd.cmd = SET_FADE;
+	ScriptCtrl_Add(&testCmd);
+	testCmd.cmd = LOOP_OFF;
+	testCmd.data.loopEnd.numLoops = LOOP_INFINITE;
+	ScriptCtrl_Add(&testCmd);
+	NextTick();
+	CHECK(SCRIPTCTRL_RUN_BUDGET / 2 == gSetFadeWasCalled);
+	CHECK(gScriptBuf.inLoop);
+	TestCaseEnd();
+}
+
+/* the pointers are restored from each entry of the wear levelled log */
+int ut_ScriptCtrl_PersistLog(void)
+{
+	TestCaseBegin();
+	static uns8 eeprom[EEPROM_SIZE];
+	const size_t numEntries = EEPROM_SCRIPTBUF_LOG_SIZE / 2;
+	size_t i;
+	PowerLoss();
+	ReadEeprom(eeprom);
+	for(i = 0; i < 3 * numEntries + 5; i++) {
+		gScriptBuf.read = (uns8)(i * 7) & SCRIPTCTRL_NUM_CMD_MAX;
+		gScriptBuf.write = (uns8)(i * 3) & SCRIPTCTRL_NUM_CMD_MAX;
+		gScriptBuf.persistDelay = 0;
+		ScriptCtrl_Run();
+		PowerLoss();
+		CHECK(((i * 7) & SCRIPTCTRL_NUM_CMD_MAX) == gScriptBuf.read);
+		CHECK(((i * 3) & SCRIPTCTRL_NUM_CMD_MAX) == gScriptBuf.write);
+		CHECK(gScriptBuf.read == gScriptBuf.execute);
+	}
+
+	/* the script ring wasn't touched */
+	for(i = 0; i < EEPROM_RING_SIZE; i++) {
+		CHECK(eeprom[i] == Eeprom_Read(i));
+	}
+	TestCaseEnd();
+}
+
+/* the pointers of a ring with another layout are discarded */
+int ut_ScriptCtrl_LayoutMarker(void)
+{
+	TestCaseBegin();
+	const uns16 layout = EEPROM_RING_SIZE + EEPROM_SCRIPTBUF_LOG_SIZE;
+	uns16 i;
+	PowerLoss();
+	gScriptBuf.read = 5;
+	gScriptBuf.write = 9;
+	gScriptBuf.persistDelay = 0;
+	ScriptCtrl_Run();
+
+	/* the marker is kept, so are the pointers */
+	PowerLoss();
+	CHECK(5 == gScriptBuf.read);
+	CHECK(9 == gScriptBuf.write);
+
+	/* a firmware with another size of led_cmd left its pointers */
+	Eeprom_Write(layout + 1, sizeof(struct led_cmd) - 1);
+	PowerLoss();
+	CHECK(0 == gScriptBuf.read);
+	CHECK(0 == gScriptBuf.write);
+	CHECK(sizeof(struct led_cmd) == Eeprom_Read(layout + 1));
+
+	/* an unknown version with garbage in the log */
+	for(i = EEPROM_RING_SIZE; i < layout; i++) {
+		Eeprom_Write(i, 0x5a);
+	}
+	Eeprom_Write(layout, 0xff);
+	PowerLoss();
+	CHECK(0 == gScriptBuf.read);
+	CHECK(0 == gScriptBuf.write);
+	CHECK(0xff != Eeprom_Read(layout));
+
+	/* the cleared log works as before */
+	gScriptBuf.read = 3;
+	gScriptBuf.write = 7;
+	gScriptBuf.persistDelay = 0;
+	ScriptCtrl_Run();
+	PowerLoss();
+	CHECK(3 == gScriptBuf.read);
+	CHECK(7 == gScriptBuf.write);
+	TestCaseEnd();
+}
+
 /* test ADD_COLOR command */
 int ut_ScriptCtrl_AddColor(void)
 {
@@ -377,6 +743,13 @@ int main(int argc, const char *argv[])
 	RunTest(false, ut_ScriptCtrl_FullBuffer);
 	RunTest(true,  ut_ScriptCtrl_StartBootloader);
 	RunTest(true,  ut_ScriptCtrl_Wait);
+	RunTest(true,  ut_ScriptCtrl_GetState);
+	RunTest(true,  ut_ScriptCtrl_EditScript);
+	RunTest(true,  ut_ScriptCtrl_Persist);
+	RunTest(true,  ut_ScriptCtrl_PowerLossInLoop);
+	RunTest(true,  ut_ScriptCtrl_ZeroTimeCommands);
+	RunTest(true,  ut_ScriptCtrl_PersistLog);
+	RunTest(true,  ut_ScriptCtrl_LayoutMarker);
 	RunTest(false, ut_ScriptCtrl_AddColor);
 	RunTest(false, ut_ScriptCtrl_RtcCommands);
 	UnitTestMainEnd();
@@ -60,7 +60,7 @@ uns8 Eeprom_Read(const uns16 adress)
 #include "ScriptCtrl.h"
 #include "wifly_cmd.h"
 #include <assert.h>
-static uns8 g_Eeprom[(1 + SCRIPTCTRL_NUM_CMD_MAX) * sizeof(struct led_cmd)];
+static uns8 g_Eeprom[(1 + SCRIPTCTRL_NUM_CMD_MAX) * sizeof(struct led_cmd) + EEPROM_SCRIPTBUF_LOG_SIZE + EEPROM_SCRIPTBUF_LAYOUT_SIZE];
 
 uns8 Eeprom_Read(const uns16 adress)
 {
@@ -23,9 +23,10 @@
 
 /* globals */
 #define EEPROM_SCRIPTBUF_BASE 0
-#define EEPROM_SCRIPTBUF_INLOOP 0x3fd
-#define EEPROM_SCRIPTBUF_READ 0x3fb
-#define EEPROM_SCRIPTBUF_WRITE 0x3f9
+/* the log of the script ring pointers follows the script ring */
+#define EEPROM_SCRIPTBUF_LOG_SIZE 64
+/* the layout marker of the script ring follows the log */
+#define EEPROM_SCRIPTBUF_LAYOUT_SIZE 2
 
 /* eeprom access functions */
 void Eeprom_Write(const uns16 adress, const uns8 data);
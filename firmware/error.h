@@ -32,7 +32,8 @@ typedef enum __attribute__ ((__packed__)) {
 	CRC_CHECK_FAILED,
 	BAD_PACKET,                                     //ringbuffer or commandIo overflow
 	BAD_COMMAND_CODE,
-	NO_RESPONSE
+	NO_RESPONSE,
+	BAD_SCRIPT_INDEX                                //slot doesn't exist or can't be edited
 }
 ErrorCode;
 
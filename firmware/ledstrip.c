@@ -18,6 +18,7 @@
 
 #include "ledstrip.h"
 #include "spi.h"
+#include "timer.h"
 #ifdef __CC8E__
 #include "MATH16.H"
 #endif /* #ifdef __CC8E__ */
@@ -25,6 +26,61 @@
 struct LedBuffer gLedBuf;
 struct cmd_set_fade mFade;
 
+/**
+ * 0xffff / divisor, used to replace the loop based divisions of the PIC
+ * by a multiplication @see Divide()
+ */
+const uns16 g_Reciprocal[256] = {
+	0x0000, 0xffff, 0x7fff, 0x5555, 0x3fff, 0x3333, 0x2aaa, 0x2492,
+	0x1fff, 0x1c71, 0x1999, 0x1745, 0x1555, 0x13b1, 0x1249, 0x1111,
+	0x0fff, 0x0f0f, 0x0e38, 0x0d79, 0x0ccc, 0x0c30, 0x0ba2, 0x0b21,
+	0x0aaa, 0x0a3d, 0x09d8, 0x097b, 0x0924, 0x08d3, 0x0888, 0x0842,
+	0x07ff, 0x07c1, 0x0787, 0x0750, 0x071c, 0x06eb, 0x06bc, 0x0690,
+	0x0666, 0x063e, 0x0618, 0x05f4, 0x05d1, 0x05b0, 0x0590, 0x0572,
+	0x0555, 0x0539, 0x051e, 0x0505, 0x04ec, 0x04d4, 0x04bd, 0x04a7,
+	0x0492, 0x047d, 0x0469, 0x0456, 0x0444, 0x0432, 0x0421, 0x0410,
+	0x03ff, 0x03f0, 0x03e0, 0x03d2, 0x03c3, 0x03b5, 0x03a8, 0x039b,
+	0x038e, 0x0381, 0x0375, 0x0369, 0x035e, 0x0353, 0x0348, 0x033d,
+	0x0333, 0x0329, 0x031f, 0x0315, 0x030c, 0x0303, 0x02fa, 0x02f1,
+	0x02e8, 0x02e0, 0x02d8, 0x02d0, 0x02c8, 0x02c0, 0x02b9, 0x02b1,
+	0x02aa, 0x02a3, 0x029c, 0x0295, 0x028f, 0x0288, 0x0282, 0x027c,
+	0x0276, 0x0270, 0x026a, 0x0264, 0x025e, 0x0259, 0x0253, 0x024e,
+	0x0249, 0x0243, 0x023e, 0x0239, 0x0234, 0x0230, 0x022b, 0x0226,
+	0x0222, 0x021d, 0x0219, 0x0214, 0x0210, 0x020c, 0x0208, 0x0204,
+	0x01ff, 0x01fc, 0x01f8, 0x01f4, 0x01f0, 0x01ec, 0x01e9, 0x01e5,
+	0x01e1, 0x01de, 0x01da, 0x01d7, 0x01d4, 0x01d0, 0x01cd, 0x01ca,
+	0x01c7, 0x01c3, 0x01c0, 0x01bd, 0x01ba, 0x01b7, 0x01b4, 0x01b2,
+	0x01af, 0x01ac, 0x01a9, 0x01a6, 0x01a4, 0x01a1, 0x019e, 0x019c,
+	0x0199, 0x0197, 0x0194, 0x0192, 0x018f, 0x018d, 0x018a, 0x0188,
+	0x0186, 0x0183, 0x0181, 0x017f, 0x017d, 0x017a, 0x0178, 0x0176,
+	0x0174, 0x0172, 0x0170, 0x016e, 0x016c, 0x016a, 0x0168, 0x0166,
+	0x0164, 0x0162, 0x0160, 0x015e, 0x015c, 0x015a, 0x0158, 0x0157,
+	0x0155, 0x0153, 0x0151, 0x0150, 0x014e, 0x014c, 0x014a, 0x0149,
+	0x0147, 0x0146, 0x0144, 0x0142, 0x0141, 0x013f, 0x013e, 0x013c,
+	0x013b, 0x0139, 0x0138, 0x0136, 0x0135, 0x0133, 0x0132, 0x0130,
+	0x012f, 0x012e, 0x012c, 0x012b, 0x0129, 0x0128, 0x0127, 0x0125,
+	0x0124, 0x0123, 0x0121, 0x0120, 0x011f, 0x011e, 0x011c, 0x011b,
+	0x011a, 0x0119, 0x0118, 0x0116, 0x0115, 0x0114, 0x0113, 0x0112,
+	0x0111, 0x010f, 0x010e, 0x010d, 0x010c, 0x010b, 0x010a, 0x0109,
+	0x0108, 0x0107, 0x0106, 0x0105, 0x0104, 0x0103, 0x0102, 0x0101
+};
+
+/**
+ * Division in bounded time: the estimate of the quotient by the reciprocal
+ * is at most one too small, for any dividend and a divisor > 0
+ */
+static uns16 Divide(const uns16 dividend, const uns8 divisor)
+{
+	uns32 product = dividend;
+	product *= g_Reciprocal[divisor];
+	uns16 quotient = product >> 16;
+	uns16 remainder = dividend - quotient * divisor;
+	if(remainder >= divisor) {
+		quotient++;
+	}
+	return quotient;
+}
+
 
 /**
  * Since we often work with a rotating bitmask which is greater
@@ -40,15 +96,16 @@ struct cmd_set_fade mFade;
 }
 
 /**
- * This macro is used to iterate over each led and each color.
+ * This macro is used to iterate over each led and each color from <k> up to <end>.
  * <BLOCK> is executed if the led color was selected in <pCmd->addr>
  * <ELSE> is executed if not
+ * <pCmd->addr> is applied to each segment again.
  */
 #define FOR_EACH_MASKED_LED_DO(BLOCK, ELSE) { \
 		uns8 *address = pCmd->addr; \
-		uns8 k,mask; \
+		uns8 mask; \
 		mask = 0x01; \
-		for(k = 0; k < sizeof(gLedBuf.led_array); k++) {        \
+		for( ; k < end; k++) {        \
 			if(0 != (*address & mask)) { \
 				BLOCK \
 			} \
@@ -56,12 +113,17 @@ struct cmd_set_fade mFade;
 				ELSE \
 			} \
 			INC_BIT_COUNTER(address, mask); \
+			if(address == pCmd->addr + sizeof(pCmd->addr)) { \
+				address = pCmd->addr; \
+			} \
 		} \
 }
 
 /**
  * This is a sub-macro of <FOR_EACH_MASKED_LED_DO> used in fade precalculations
  * to calculate the fading parameters(<periodeLength>, <stepSize> and <delta>) for <newColor>
+ * <stepSize> is the smallest value, which allows the fade to complete within
+ * <fadeTmms>: delta / stepSize <= fadeTmms. <fadeTmms> has to be at least 1.
 **/
 #define CALC_COLOR(newColor)  \
 	{ \
@@ -76,18 +138,22 @@ struct cmd_set_fade mFade;
 			delta = newColor - delta;  \
 			*(stepAddress) &= ~(stepMask); \
 		}  \
+		if(0 != delta) { \
+			gLedBuf.active[k >> 3] |= stepMask; \
+		} else { \
+			gLedBuf.active[k >> 3] &= ~(stepMask); \
+		} \
 			INC_BIT_COUNTER(stepAddress, stepMask); \
 		stepSize = 0x01; \
 		temp16 = 0; \
 		if((0 != delta))  \
 		{ \
-			do { \
-				temp8 = delta / stepSize; \
-				temp16 = fadeTmms / temp8;  \
-				if(temp16 < 1) { \
-					stepSize += 1; } \
+			temp8 = delta; \
+			if(delta > fadeTmms) { \
+				stepSize = Divide(delta, fadeTmms + 1) + 1; \
+				temp8 = Divide(delta, stepSize); \
 			} \
-			while(temp16 < 1); \
+			temp16 = Divide(fadeTmms, temp8);  \
 		} \
 		gLedBuf.stepSize[k] = stepSize; \
 		gLedBuf.delta[k] = delta; \
@@ -103,6 +169,7 @@ void Ledstrip_FadeOffLeds(void)
 	mFade.addr[2] = 0xff;
 	mFade.addr[3] = 0xff;
 	mFade.fadeTmms = htons(200);
+	mFade.segment = SEGMENT_ALL;
 
 	mFade.red = 0x00;
 	mFade.green = 0x00;
@@ -117,55 +184,44 @@ void Ledstrip_Init(void)
 	SPI_Init();
 
 	// initialize variables
-	uns8 i = sizeof(gLedBuf.led_array);
-	do {
-		i--;
-		gLedBuf.led_array[i] = 0;
-	}
-	while(0 != i);
-	/*-------------------------------------*/
-	i = sizeof(gLedBuf.delta);
-	do {
-		i--;
-		gLedBuf.delta[i] = 0;
-	}
-	while(0 != i);
-	/*-------------------------------------*/
-	i = sizeof(gLedBuf.cyclesLeft);
-	do {
-		i--;
-		gLedBuf.cyclesLeft[i] = 0;
-	}
-	while(0 != i);
-	/*-------------------------------------*/
-	i = sizeof(gLedBuf.periodeLength);
-	do {
-		i--;
-		gLedBuf.periodeLength[i] = 0;
+	led_index k;
+	for(k = 0; k < sizeof(gLedBuf.led_array); k++) {
+		gLedBuf.led_array[k] = 0;
+		gLedBuf.delta[k] = 0;
+		gLedBuf.cyclesLeft[k] = 0;
+		gLedBuf.periodeLength[k] = 0;
+		gLedBuf.stepSize[k] = 0;
 	}
-	while(0 != i);
 	/*-------------------------------------*/
-	i = sizeof(gLedBuf.step);
-	do {
-		i--;
+	uns8 i;
+	for(i = 0; i < sizeof(gLedBuf.step); i++) {
 		gLedBuf.step[i] = 0;
+		gLedBuf.active[i] = 0;
 	}
-	while(0 != i);
-	/*-------------------------------------*/
-	i = sizeof(gLedBuf.stepSize);
-	do {
-		i--;
-		gLedBuf.stepSize[i] = 0;
-	}
-	while(0 != i);
 
 	gLedBuf.fadeTmms = 0;
+	gLedBuf.dirty = FALSE;
+	gLedBuf.ticksSinceOutput = 0;
+
+	// switch all leds off
+	SPI_SendLedBuffer(gLedBuf.led_array);
 }
 
-void Ledstrip_SetColorDirect(uns8 *pValues)
+void Ledstrip_SetColorDirect(const uns8 segment, uns8 *pValues)
 {
-	uns8 k, red, green, blue;
-	for(k = 0; k < sizeof(gLedBuf.led_array); ) {
+	if(segment >= NUM_OF_SEGMENTS) {
+		return;
+	}
+
+	const led_index first = segment * (NUM_OF_LED_PER_SEGMENT * 3);
+	led_index end = first + NUM_OF_LED_PER_SEGMENT * 3;
+	if(end > sizeof(gLedBuf.led_array)) {
+		end = sizeof(gLedBuf.led_array);
+	}
+
+	led_index k;
+	uns8 red, green, blue;
+	for(k = first; k < end; ) {
 		red = *pValues;
 		++pValues;
 		green = *pValues;
@@ -185,64 +241,118 @@ void Ledstrip_SetColorDirect(uns8 *pValues)
 		gLedBuf.delta[k] = 0;
 		++k;
 	}
+
+	gLedBuf.dirty = TRUE;
+
+	// all fades of this segment are stopped, the last byte might be used partially
+	led_index last = end >> 3;
+	if(0 != (end & 0x07)) {
+		last++;
+	}
+	for(k = first >> 3; k < last; k++) {
+		gLedBuf.active[k] = 0;
+	}
 }
 
 void Ledstrip_DoFade(void)
 {
-	uns8 k, stepmask, stepSize;
-	uns8 *stepaddress = gLedBuf.step;
-	stepmask = 0x01;
-	uns16 periodeLength;
-
-	/* Update cyclesLeft Value for all LED's */
-
-	for(k = 0; k < sizeof(gLedBuf.delta); k++) {
-		if((gLedBuf.delta[k] > 0) && (gLedBuf.cyclesLeft[k] > 0)) {
-			gLedBuf.cyclesLeft[k]--;
+	led_index k;
+	uns8 i, mask, active, stepSize;
+
+	for(i = 0; i < sizeof(gLedBuf.active); i++) {
+		active = gLedBuf.active[i];
+		// skip eight colors at once, if none of them is fading
+		if(0 == active) {
+			continue;
 		}
-	}
 
-	for(k = 0; k < sizeof(gLedBuf.delta); k++) {
-		// fade active on this led and current periode is over?
-		if((gLedBuf.delta[k] > 0) && (gLedBuf.cyclesLeft[k] == 0)) {
-			stepSize = gLedBuf.stepSize[k];
-			// reset cycle counters
-			if(gLedBuf.delta[k] < stepSize) {
-				stepSize = gLedBuf.delta[k];
-				gLedBuf.delta[k] = 0;
-			} else {
-				gLedBuf.delta[k] -= stepSize;
-			}
-			periodeLength = gLedBuf.periodeLength[k];
-			gLedBuf.cyclesLeft[k] = periodeLength;
-
-			// update rgb value by one step
-			if(0 != ((*stepaddress) & stepmask)) {
-				gLedBuf.led_array[k] -= stepSize;
-			} else {
-				gLedBuf.led_array[k] += stepSize;
+		k = i << 3;
+		for(mask = 0x01; 0 != mask; mask <<= 1) {
+			// fade active on this led and current periode is over?
+			if(0 != (active & mask)) {
+				if(gLedBuf.cyclesLeft[k] > 0) {
+					gLedBuf.cyclesLeft[k]--;
+				}
+
+				if(gLedBuf.cyclesLeft[k] == 0) {
+					stepSize = gLedBuf.stepSize[k];
+					// reset cycle counters
+					if(gLedBuf.delta[k] < stepSize) {
+						stepSize = gLedBuf.delta[k];
+						gLedBuf.delta[k] = 0;
+					} else {
+						gLedBuf.delta[k] -= stepSize;
+					}
+
+					// fade completed
+					if(0 == gLedBuf.delta[k]) {
+						gLedBuf.active[i] &= ~mask;
+					}
+					gLedBuf.cyclesLeft[k] = gLedBuf.periodeLength[k];
+
+					// update rgb value by one step
+					if(0 != (gLedBuf.step[i] & mask)) {
+						gLedBuf.led_array[k] -= stepSize;
+					} else {
+						gLedBuf.led_array[k] += stepSize;
+					}
+					gLedBuf.dirty = TRUE;
+				}
 			}
+			k++;
 		}
-		INC_BIT_COUNTER(stepaddress, stepmask);
 	}
-
 }
 
 void Ledstrip_UpdateLed(void)
 {
+#if LEDSTRIP_REFRESH_TICKS > 0
+	gLedBuf.ticksSinceOutput++;
+	if(gLedBuf.ticksSinceOutput >= LEDSTRIP_REFRESH_TICKS) {
+		gLedBuf.dirty = TRUE;
+	}
+#endif
+	if(!gLedBuf.dirty) {
+		// no frame to wait for, so the next tick follows immediately
+		Timer1Enable();
+		return;
+	}
+	gLedBuf.dirty = FALSE;
+	gLedBuf.ticksSinceOutput = 0;
 	SPI_SendLedBuffer(gLedBuf.led_array);
 }
 
 void Ledstrip_SetFade(struct cmd_set_fade *pCmd)
 {
-	// constant for this fade used in CALC_COLOR
+	// nothing to do for segments beyond the strip
+	if((SEGMENT_ALL != pCmd->segment) && (pCmd->segment >= NUM_OF_SEGMENTS)) {
+		return;
+	}
+
+	Timer_StartStopwatch(eSET_FADE);
+
+	// constant for this fade used in CALC_COLOR, a fade time of zero is handled as one
 	uns16 fadeTmms = ntohs(pCmd->fadeTmms);
+	if(0 == fadeTmms) {
+		fadeTmms = 1;
+	}
 
+	led_index k = 0;
+	led_index end = sizeof(gLedBuf.led_array);
 	uns8 *stepAddress = gLedBuf.step;
 	uns8 stepMask = 0x01;
 	uns16 temp16;
 	uns8 red,green,blue,delta,stepSize,temp8;
 
+	// limit the fade to a single segment
+	if(SEGMENT_ALL != pCmd->segment) {
+		k = pCmd->segment * (NUM_OF_LED_PER_SEGMENT * 3);
+		stepAddress += pCmd->segment * (NUM_OF_LED_PER_SEGMENT * 3 / 8);
+		if(end - k > NUM_OF_LED_PER_SEGMENT * 3) {
+			end = k + NUM_OF_LED_PER_SEGMENT * 3;
+		}
+	}
+
 	red = pCmd->red;
 	green = pCmd->green;
 	blue = pCmd->blue;
@@ -263,6 +373,8 @@ void Ledstrip_SetFade(struct cmd_set_fade *pCmd)
 			INC_BIT_COUNTER(stepAddress, stepMask);
 		}
 		);
+
+	Timer_StopStopwatch(eSET_FADE);
 }
 
 #define CALC_DELTA(target,source_1,source_2) { \
@@ -271,7 +383,7 @@ void Ledstrip_SetFade(struct cmd_set_fade *pCmd)
 			target = target - source_2; \
 		else \
 			target = source_2 - target; \
-		target = target / numOfLeds; }
+		target = Divide(target, numOfLeds); }
 
 // To add or sub the diff from color by each loop run to get the right color for
 // every led. If compare is greater then color, this macro add's diff, otherwise it sub's diff
@@ -283,9 +395,19 @@ void Ledstrip_SetFade(struct cmd_set_fade *pCmd)
 
 void Ledstrip_SetGradient(struct cmd_set_gradient *pCmd)
 {
+	// nothing to do for segments beyond the strip
+	if(pCmd->segment >= NUM_OF_SEGMENTS) {
+		return;
+	}
+
+	Timer_StartStopwatch(eSET_GRADIENT);
+
 	uns16 fadeTmms = ntohs(pCmd->fadeTmms);
+	if(0 == fadeTmms) {
+		fadeTmms = 1;
+	}
 
-	uns8 offset = pCmd->parallelAndOffset & 0x7f;
+	led_index offset = pCmd->segment * NUM_OF_LED_PER_SEGMENT + (pCmd->parallelAndOffset & 0x7f);
 	uns8 numOfLeds = pCmd->numberOfLeds - 1;
 	uns8 deltaRed, deltaGreen, deltaBlue;
 
@@ -302,14 +424,14 @@ void Ledstrip_SetGradient(struct cmd_set_gradient *pCmd)
 
 	//define variables for CALC_COLOR macro
 	uns16 temp16;
-	uns8 k,delta,stepSize,temp8;
+	led_index k;
+	uns8 delta,stepSize,temp8;
 	uns8 *stepAddress = gLedBuf.step;
 	uns8 stepMask = 0x01;
 
 	offset = offset * 3;
-	numOfLeds = numOfLeds * 3;
-
-	const uns8 endPosition = offset + numOfLeds;
+	led_index endPosition = numOfLeds;
+	endPosition = offset + endPosition * 3;
 
 	for(k = 0; k < NUM_OF_LED * 3; k++) {
 		if(k >= endPosition) {
@@ -337,6 +459,8 @@ void Ledstrip_SetGradient(struct cmd_set_gradient *pCmd)
 		} else
 			INC_BIT_COUNTER(stepAddress, stepMask);
 	}
+
+	Timer_StopStopwatch(eSET_GRADIENT);
 }
 
 #ifdef DEBUG
@@ -365,6 +489,10 @@ void Ledstrip_Test(unsigned char address)
 		gLedBuf.delta[i] = 0;
 		cur = cur << 1;
 	}
+	for(i = 0; i < sizeof(gLedBuf.active); i++) {
+		gLedBuf.active[i] = 0;
+	}
+	gLedBuf.dirty = TRUE;
 	Ledstrip_UpdateLed();
 }
 #endif
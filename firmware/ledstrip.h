@@ -22,6 +22,25 @@
 #include "platform.h"
 #include "wifly_cmd.h"
 
+/* index into the color arrays of <gLedBuf>, wide enough for all leds */
+#if (NUM_OF_LED * 3) > 255
+typedef uns16 led_index;
+#else
+typedef uns8 led_index;
+#endif
+
+/* number of bytes for a bitmask with one bit per color of each led */
+#define LEDSTRIP_MASK_SIZE ((NUM_OF_LED * 3 + 7) / 8)
+
+#ifdef __CC8E__
+/* sizeof() isn't available to the preprocessor, so the RAM of <gLedBuf> and
+ * the SPI frame is summed up by hand: 7 bytes per color in <gLedBuf>, one in
+ * the frame, both bitmasks and the remaining members of both structures */
+#if (NUM_OF_LED * 3 * 8 + 2 * LEDSTRIP_MASK_SIZE + 9) > LEDSTRIP_RAM_BUDGET
+#error NUM_OF_LED is too large, gLedBuf and the SPI frame exceed LEDSTRIP_RAM_BUDGET
+#endif
+#endif
+
 /**
  * This structure is used for calculations to manipulate the ledstrip state
  *
@@ -31,15 +50,21 @@
  * <periodeLength> number of cycles in each periode, cyclesLeft is reset to this value, each periode
  * <step> bitmask, if bit is set <led_array> is decremented each periode, if cleared incremented
  * <stepSize> <led_array> is decremented/incremented by this value each periode
+ * <active> bitmask, bit is set while a fade is running on this color (delta > 0)
+ * <dirty> set when <led_array> changed since the last output to the leds
+ * <ticksSinceOutput> number of ledstrip updates without output, used to refresh the leds
  */
 struct LedBuffer {
 	uns8 led_array[NUM_OF_LED * 3];
 	uns8 delta[NUM_OF_LED * 3];
 	uns16 cyclesLeft[NUM_OF_LED * 3];
 	uns16 periodeLength[NUM_OF_LED * 3];
-	uns8 step[NUM_OF_LED / 8 * 3];
+	uns8 step[LEDSTRIP_MASK_SIZE];
+	uns8 active[LEDSTRIP_MASK_SIZE];
 	uns8 stepSize[NUM_OF_LED * 3];
 	uns16 fadeTmms;
+	uns8 dirty;
+	uns8 ticksSinceOutput;
 };
 
 extern struct LedBuffer gLedBuf;
@@ -51,16 +76,17 @@ void Ledstrip_Init(void);
 
 /**
  * Callback if a "set_color_direct" command is received.
- * ledstrip is updated according to the provided values.
+ * the leds of <segment> are updated according to the provided values.
  * *pValues indicates the start of the Value-Array.
- * Length of the Array is always NUM_OF_LED * 3
+ * Length of the Array is always NUM_OF_LED_PER_SEGMENT * 3
  */
-void Ledstrip_SetColorDirect(uns8 *pValues);
+void Ledstrip_SetColorDirect(const uns8 segment, uns8 *pValues);
 
 /**
  * Callback if a "set_fade" command is received.
  * fading parameters are calculated and stored to be used in
  * Ledstrip_DoFade() which is called in the main cycle
+ * The address mask selects leds of <pCmd->segment> or of each segment for SEGMENT_ALL.
  */
 void Ledstrip_SetFade(struct cmd_set_fade *pCmd);
 
@@ -68,19 +94,25 @@ void Ledstrip_SetFade(struct cmd_set_fade *pCmd);
  * Callback if a "set_gradient" command is received.
  * fading parameters are calculated and stored to be used in
  * Ledstrip_DoFade() which is called in the main cycle
+ * The gradient starts <offset> leds after the first led of <pCmd->segment>.
  */
 void Ledstrip_SetGradient(struct cmd_set_gradient *pCmd);
 
 /**
- * called by the main cycle
- * update the ledstrip accourding to the precalculated parameters in <gLedBuf>
- */
-/**
- * callback for the fadecycle timer
- * updates cyclesLeft part of the global <gLedBuf>
+ * called by the main cycle for each fadecycle timer tick
+ * update the ledstrip accourding to the precalculated parameters in <gLedBuf>.
+ * Only colors with a running fade are visited in a single pass, so a tick
+ * without any fade costs only a check of the <active> bitmask.
 **/
 void Ledstrip_DoFade(void);
 
+/**
+ * called by the main cycle for each ledstrip timer tick
+ * hands a snapshot of <gLedBuf.led_array> to the SPI interrupt and returns
+ * without waiting for the transmission.
+ * The frame is only sent if it is <dirty> or LEDSTRIP_REFRESH_TICKS passed
+ * since the last output, otherwise Timer1 is enabled again immediately.
+**/
 void Ledstrip_UpdateLed(void);
 
 void Ledstrip_FadeOffLeds(void);
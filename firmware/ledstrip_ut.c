@@ -19,6 +19,7 @@
 #include "ledstrip.h"
 #include "unittest.h"
 #include <stdbool.h>
+#include <string.h>
 
 #define NUM_TEST_LOOPS 255
 
@@ -26,9 +27,23 @@
 /** Dummies and wrapper functions */
 #include "ScriptCtrl.h"
 void SPI_Init(void) {};
-void SPI_SendLedBuffer(void) {};
+static size_t g_NumFrames;
+void SPI_SendLedBuffer(uns8 *array) {
+	g_NumFrames++;
+};
+void Timer_StartStopwatch(const enum CYCLETIME_METHODE destMethode) {};
+void Timer_StopStopwatch(const enum CYCLETIME_METHODE destMethode) {};
 struct ScriptBuf gScriptBuf;
 
+/* the colors of the whole strip, one frame per segment */
+static void SetColorDirect(uns8 *pValues)
+{
+	uns8 segment;
+	for(segment = 0; segment < NUM_OF_SEGMENTS; segment++) {
+		Ledstrip_SetColorDirect(segment, pValues + segment * NUM_OF_LED_PER_SEGMENT * 3);
+	}
+}
+
 int ut_Ledstrip_Init(void)
 {
 	TestCaseBegin();
@@ -71,13 +86,247 @@ int ut_Ledstrip_SetColorDirect(void)
 		testCmd[i] = i;
 	}
 
-	Ledstrip_SetColorDirect(testCmd);
+	SetColorDirect(testCmd);
 	for(i = 0; i < NUM_OF_LED * 3; i += 3) {
 		// led_array is ordered brg not rgb!
-		CHECK(i == (gLedBuf.led_array[i + 2]));
-		CHECK(i + 1 == (gLedBuf.led_array[i + 1]));
-		CHECK(i + 2 == (gLedBuf.led_array[i]));
+		CHECK((uns8)i == (gLedBuf.led_array[i + 2]));
+		CHECK((uns8)(i + 1) == (gLedBuf.led_array[i + 1]));
+		CHECK((uns8)(i + 2) == (gLedBuf.led_array[i]));
+	}
+	TestCaseEnd();
+}
+
+/**
+ * Fade parameters as they were calculated by the loop based divisions
+ */
+static void Reference_CalcColor(uns8 delta, uns16 fadeTmms, uns8 *pStepSize, uns16 *pPeriodeLength)
+{
+	uns8 stepSize = 1;
+	uns16 periodeLength = 0;
+	if(0 != delta) {
+		do {
+			periodeLength = fadeTmms / (delta / stepSize);
+			if(periodeLength < 1) {
+				stepSize++;
+			}
+		}
+		while(periodeLength < 1);
+	}
+	*pStepSize = stepSize;
+	*pPeriodeLength = periodeLength;
+}
+
+int ut_Ledstrip_SetFadeParameters(void)
+{
+	TestCaseBegin();
+	size_t i, first;
+	uns16 fadeTmms;
+	uns8 colors[NUM_OF_LED * 3];
+	uns8 stepSize;
+	uns16 periodeLength;
+	struct cmd_set_fade fade = {{0xff, 0xff, 0xff, 0xff}, 0xff, 0xff, 0xff, 0};
+	fade.segment = SEGMENT_ALL;
+
+	// fade each delta from 1 to 255 with each fade time
+	for(first = 0; first < 255; first += sizeof(colors)) {
+		for(i = 0; i < sizeof(colors); i++) {
+			colors[i] = (first + i < 255) ? first + i : 0;
+		}
+
+		fadeTmms = 0;
+		do {
+			fadeTmms++;
+			fade.fadeTmms = htons(fadeTmms);
+			SetColorDirect(colors);
+			Ledstrip_SetFade(&fade);
+			for(i = 0; i < sizeof(colors); i++) {
+				Reference_CalcColor(0xff - colors[i], fadeTmms, &stepSize, &periodeLength);
+				// led_array is ordered bgr
+				const size_t k = i - i % 3 + 2 - i % 3;
+				CHECK(stepSize == gLedBuf.stepSize[k]);
+				CHECK(periodeLength == gLedBuf.periodeLength[k]);
+			}
+		}
+		while(0xffff != fadeTmms);
+	}
+	TestCaseEnd();
+}
+
+int ut_Ledstrip_DoFade(void)
+{
+	TestCaseBegin();
+	size_t i;
+	struct LedBuffer idle;
+	struct cmd_set_fade fade = {{0x01, 0x00, 0x00, 0x80}, 0x40, 0x00, 0x10, 0};
+	fade.fadeTmms = htons(8);
+
+	Ledstrip_Init();
+	Ledstrip_SetFade(&fade);
+
+	// only the fading colors of the first and the last led of the segment are active, led_array is ordered bgr
+	CHECK(0x05 == gLedBuf.active[0]);
+	CHECK(0xa0 == gLedBuf.active[NUM_OF_LED_PER_SEGMENT * 3 / 8 - 1]);
+	for(i = 1; i < sizeof(gLedBuf.active); i++) {
+		CHECK((NUM_OF_LED_PER_SEGMENT * 3 / 8 - 1 == i) || (0 == gLedBuf.active[i]));
+	}
+
+	for(i = 0; i < 7; i++) {
+		Ledstrip_DoFade();
+	}
+	CHECK(0 != gLedBuf.active[0]);
+	Ledstrip_DoFade();
+
+	// fade completed within its time
+	for(i = 0; i < sizeof(gLedBuf.active); i++) {
+		CHECK(0 == gLedBuf.active[i]);
+	}
+	CHECK(0x10 == gLedBuf.led_array[0]);
+	CHECK(0x00 == gLedBuf.led_array[1]);
+	CHECK(0x40 == gLedBuf.led_array[2]);
+	CHECK(0x00 == gLedBuf.led_array[3]);
+	CHECK(0x10 == gLedBuf.led_array[NUM_OF_LED_PER_SEGMENT * 3 - 3]);
+	CHECK(0x40 == gLedBuf.led_array[NUM_OF_LED_PER_SEGMENT * 3 - 1]);
+
+	// an idle tick doesn't change anything
+	memcpy(&idle, &gLedBuf, sizeof(idle));
+	Ledstrip_DoFade();
+	CHECK(0 == memcmp(&idle, &gLedBuf, sizeof(idle)));
+
+	// set color direct stops all fades
+	fade.red = 0x80;
+	Ledstrip_SetFade(&fade);
+	CHECK(0 != gLedBuf.active[0]);
+	Ledstrip_SetColorDirect(0, idle.led_array);
+	CHECK(0 == gLedBuf.active[0]);
+	CHECK(0 == gLedBuf.active[NUM_OF_LED_PER_SEGMENT * 3 / 8 - 1]);
+	TestCaseEnd();
+}
+
+/**
+ * This test is build with more than one segment, @see Makefile.firmware
+ */
+int ut_Ledstrip_Segments(void)
+{
+	TestCaseBegin();
+	size_t i;
+	const size_t segmentSize = NUM_OF_LED_PER_SEGMENT * 3;
+	uns8 colors[NUM_OF_LED_PER_SEGMENT * 3];
+	struct cmd_set_fade fade = {{0x01, 0x00, 0x00, 0x80}, 0x40, 0x20, 0x10, 0};
+	struct cmd_set_gradient gradient = {0x10, 0x10, 0x10, 0x40, 0x40, 0x40, 0x00, NUM_OF_LED_PER_SEGMENT};
+	fade.fadeTmms = htons(8);
+	gradient.fadeTmms = htons(8);
+	CHECK(NUM_OF_SEGMENTS > 2);
+
+	// a direct frame sets the leds of a single segment
+	Ledstrip_Init();
+	memset(colors, 0xff, sizeof(colors));
+	Ledstrip_SetColorDirect(1, colors);
+	Ledstrip_SetColorDirect(NUM_OF_SEGMENTS, colors);
+	for(i = 0; i < sizeof(gLedBuf.led_array); i++) {
+		CHECK(((i >= segmentSize) && (i < 2 * segmentSize)) == (0xff == gLedBuf.led_array[i]));
+	}
+
+	// the address mask is counted from the first led of the segment
+	Ledstrip_Init();
+	fade.segment = 2;
+	Ledstrip_SetFade(&fade);
+	for(i = 0; i < sizeof(gLedBuf.active); i++) {
+		if(2 * segmentSize / 8 == i) {
+			CHECK(0x07 == gLedBuf.active[i]);
+		} else if(3 * segmentSize / 8 - 1 == i) {
+			CHECK(0xe0 == gLedBuf.active[i]);
+		} else {
+			CHECK(0 == gLedBuf.active[i]);
+		}
+	}
+	fade.segment = NUM_OF_SEGMENTS;
+	Ledstrip_Init();
+	Ledstrip_SetFade(&fade);
+	for(i = 0; i < sizeof(gLedBuf.active); i++) {
+		CHECK(0 == gLedBuf.active[i]);
+	}
+
+	// ... or from the first led of each segment
+	fade.segment = SEGMENT_ALL;
+	Ledstrip_SetFade(&fade);
+	for(i = 0; i < NUM_OF_LED; i++) {
+		const bool selected = (0 == i % NUM_OF_LED_PER_SEGMENT) || (NUM_OF_LED_PER_SEGMENT - 1 == i % NUM_OF_LED_PER_SEGMENT);
+		CHECK(selected == (0 != gLedBuf.delta[3 * i]));
+	}
+	for(i = 0; i < 8; i++) {
+		Ledstrip_DoFade();
+	}
+	CHECK(0x10 == gLedBuf.led_array[segmentSize]);
+	CHECK(0x40 == gLedBuf.led_array[sizeof(gLedBuf.led_array) - 1]);
+
+	// a direct frame stops only the fades of its segment
+	fade.segment = SEGMENT_ALL;
+	fade.red = 0x80;
+	Ledstrip_SetFade(&fade);
+	Ledstrip_SetColorDirect(1, colors);
+	CHECK(0 != gLedBuf.active[0]);
+	for(i = segmentSize / 8; i < 2 * segmentSize / 8; i++) {
+		CHECK(0 == gLedBuf.active[i]);
+	}
+	CHECK(0 != gLedBuf.active[sizeof(gLedBuf.active) - 1]);
+
+	// a gradient of segment 1 spans its leds
+	Ledstrip_Init();
+	gradient.segment = 1;
+	Ledstrip_SetGradient(&gradient);
+	for(i = 0; i < NUM_OF_LED; i++) {
+		const bool selected = (i >= NUM_OF_LED_PER_SEGMENT) && (i < 2 * NUM_OF_LED_PER_SEGMENT);
+		CHECK(selected == (0 != gLedBuf.delta[3 * i]));
+	}
+	CHECK(0x10 == gLedBuf.delta[segmentSize]);
+	CHECK(0x40 == gLedBuf.delta[2 * segmentSize - 1]);
+	TestCaseEnd();
+}
+
+/* frames are only sent to the leds, if they changed */
+int ut_Ledstrip_UpdateLed(void)
+{
+	TestCaseBegin();
+	uns8 leds[NUM_OF_LED * 3];
+	size_t i;
+	g_NumFrames = 0;
+	Ledstrip_Init();
+	CHECK(1 == g_NumFrames);
+
+	// nothing changed
+	Ledstrip_DoFade();
+	Ledstrip_UpdateLed();
+	CHECK(1 == g_NumFrames);
+
+	memset(leds, 0x20, sizeof(leds));
+	SetColorDirect(leds);
+	Ledstrip_UpdateLed();
+	CHECK(2 == g_NumFrames);
+	Ledstrip_UpdateLed();
+	CHECK(2 == g_NumFrames);
+
+	// the fade parameters alone don't change the frame, but each step does
+	struct cmd_set_fade fade = {{0xff, 0xff, 0xff, 0xff}, 0xff, 0xff, 0xff, 0};
+	fade.fadeTmms = htons(10);
+	fade.segment = SEGMENT_ALL;
+	Ledstrip_SetFade(&fade);
+	Ledstrip_UpdateLed();
+	CHECK(2 == g_NumFrames);
+	for(i = 0; (i < 1000) && (0 != gLedBuf.active[0]); i++) {
+		Ledstrip_DoFade();
+		Ledstrip_UpdateLed();
+	}
+	CHECK(0 == gLedBuf.active[0]);
+	CHECK(g_NumFrames > 2);
+	CHECK(g_NumFrames <= 2 + i);
+
+	// the idle frame is refreshed periodically
+	const size_t numFrames = g_NumFrames;
+	for(i = 0; i < 3 * LEDSTRIP_REFRESH_TICKS; i++) {
+		Ledstrip_DoFade();
+		Ledstrip_UpdateLed();
 	}
+	CHECK(numFrames + 3 == g_NumFrames);
 	TestCaseEnd();
 }
 
@@ -87,6 +336,10 @@ int main(int argc, const char *argv[])
 	RunTest(true, ut_Ledstrip_Init);
 	//RunTest(true, ut_Ledstrip_SetColor);
 	RunTest(true, ut_Ledstrip_SetColorDirect);
+	RunTest(true, ut_Ledstrip_SetFadeParameters);
+	RunTest(true, ut_Ledstrip_DoFade);
+	RunTest(true, ut_Ledstrip_Segments);
+	RunTest(true, ut_Ledstrip_UpdateLed);
 	UnitTestMainEnd();
 }
 
@@ -30,6 +30,7 @@
 #include "CommandIO.h"
 #include "ledstrip.h"
 #include "timer.h"
+#include "spi.h"
 #include "rtc.h"
 #include "ScriptCtrl.h"
 #include "trace.h"
@@ -83,14 +84,15 @@ interrupt HighPriorityInterrupt(void)
 interrupt LowPriorityInterrupt(void)
 {
 	int_save_registers
-#if 0
+	/* the handlers dereference pointers and index arrays, which uses FSR0/1 and PROD */
 	uns16 sv_FSR0 = FSR0;
 	uns16 sv_FSR1 = FSR1;
+	uns8 sv_PRODL = PRODL;
+	uns8 sv_PRODH = PRODH;
+#if 0
 	uns16 sv_FSR2 = FSR2;
 	uns8 sv_PCLATH = PCLATH;
 	uns8 sv_PCLATU = PCLATU;
-	uns8 sv_PRODL = PRODL;
-	uns8 sv_PRODH = PRODH;
 	uns24 sv_TBLPTR = TBLPTR;
 	uns8 sv_TABLAT = TABLAT;
 #endif
@@ -107,17 +109,32 @@ interrupt LowPriorityInterrupt(void)
 		Timer1Disable();
 		Timer1Interrupt();
 	}
+
+	if(SSP1IF && SSP1IE) {
+		SPI_Interrupt();
+	}
+
+	if(TX1IF && TX1IE) {
+		UART_Interrupt();
+	}
+
+#ifdef DEBUG
+	if(TMR3IF) {
+		g_TraceEpoch = g_TraceEpoch + 1;
+		Timer3Interrupt();
+	}
+#endif /* #ifdef DEBUG */
 #if 0
-	FSR0 = sv_FSR0;
-	FSR1 = sv_FSR1;
 	FSR2 = sv_FSR2;
 	PCLATH = sv_PCLATH;
 	PCLATU = sv_PCLATU;
-	PRODL = sv_PRODL;
-	PRODH = sv_PRODH;
 	TBLPTR = sv_TBLPTR;
 	TABLAT = sv_TABLAT;
 #endif
+	PRODH = sv_PRODH;
+	PRODL = sv_PRODL;
+	FSR1 = sv_FSR1;
+	FSR0 = sv_FSR0;
 	int_restore_registers
 }
 
@@ -180,8 +197,8 @@ int main(int argc, const char** argv)
 			do_and_measure(CommandIO_GetCommands);
 
 		if(g_UpdateLedStrip > 0) {
+			/* Timer1 is enabled again, when the SPI interrupt completed the frame or no frame was sent */
 			do_and_measure(Ledstrip_UpdateLed);
-			Timer1Enable();
 			g_UpdateLedStrip = 0;
 		}
 		Timer_StopStopwatch(eMAIN);
@@ -227,6 +244,7 @@ void InitAll()
 	CommandIO_CreateResponse(&g_ResponseBuf, FW_STARTED, OK);
 	CommandIO_SendResponse(&g_ResponseBuf);
 	Trace_String(" Init Done ");
+	Trace_Event(eTRACE_INIT_DONE, 0);
 	Platform_DisableBootloaderAutostart();
 }
 
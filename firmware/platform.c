@@ -100,4 +100,14 @@ uns16 ntohs(uns16 networkShort)
 	return retval;
 }
 
+uns32 htonl(uns32 hostLong)
+{
+	uns32 retval;
+	retval.low8 = hostLong.high8;
+	retval.midL8 = hostLong.midH8;
+	retval.midH8 = hostLong.midL8;
+	retval.high8 = hostLong.low8;
+	return retval;
+}
+
 #endif /* __CC8E__ */
@@ -24,7 +24,24 @@
 #define FALSE 0
 
 //*********************** CONFIGURATION ********************************************
+/* number of leds on the strip, limited by RAM */
+#ifndef NUM_OF_LED
 #define NUM_OF_LED 32
+#endif
+
+/* bytes of the 3896 byte RAM of the PIC18F26K22 left for the led buffers,
+ * after the uart, command, script and trace buffers are allocated */
+#define LEDSTRIP_RAM_BUDGET 1280
+
+/* commands address the leds in segments of 32, which matches the 32 bit address masks */
+#define NUM_OF_LED_PER_SEGMENT 32
+#define NUM_OF_SEGMENTS ((NUM_OF_LED + NUM_OF_LED_PER_SEGMENT - 1) / NUM_OF_LED_PER_SEGMENT)
+
+/* an unchanged frame is sent again after this number of ledstrip updates
+ * to recover leds from glitches on the wire, 0 disables the refresh */
+#ifndef LEDSTRIP_REFRESH_TICKS
+#define LEDSTRIP_REFRESH_TICKS 60
+#endif
 
 #ifdef __CC8E__
 	#include "inline.h"
@@ -50,6 +67,7 @@ void Platform_CheckInputs();
 
 uns16 htons(uns16 hostShort);
 uns16 ntohs(uns16 networkShort);
+uns32 htonl(uns32 hostLong);
 
 /*** This Function will Disable the Autostart to the Bootloader.
 * At Startup, Bootloader checks the last EEPROM-Cell. If there is
@@ -69,12 +87,19 @@ void Platform_EnableBootloaderAutostart();
 typedef int8_t bit;
 typedef uint8_t uns8;
 typedef uint16_t uns16;
+typedef uint32_t uns32;
 
 //global variables
 extern bit g_led_off;
 extern uns8 g_UpdateFade;
 extern jmp_buf g_ResetEnvironment;
 
+/* 2 MHz counter like Timer3 of the PIC, implemented in x86_wrapper.c */
+uns16 Platform_PerformanceCounter(void);
+
+/* overflows of the performance counter, emulates the timer3 interrupt */
+uns16 Platform_PerformanceEpoch(void);
+
 	#define bank1
 	#define bank2
 	#define bank3
@@ -93,7 +118,7 @@ extern jmp_buf g_ResetEnvironment;
 	#define InitFET(x)
 	#define Platform_IOInit(x)
 	#define Platform_OsciInit(x)
-	#define Platform_ReadPerformanceCounter(x) x = 0; /* TODO implement this on X86 */
+	#define Platform_ReadPerformanceCounter(x) x = Platform_PerformanceCounter();
 	#define softReset(x) longjmp(g_ResetEnvironment, 1)
 	#define softResetJumpDestination(x) setjmp(g_ResetEnvironment)
 
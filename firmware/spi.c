@@ -17,8 +17,18 @@
  along with Wifly_Light.  If not, see <http://www.gnu.org/licenses/>. */
 
 #include "spi.h"
+#include "timer.h"
+#include "trace.h"
+
+struct SpiFrame g_SpiFrame;
 
 #ifdef __CC8E__
+#define SPI_Transmit(x) SSP1IF = 0; SSP1BUF = x;
+#define SPI_InterruptEnable(x) SSP1IE = 1;
+#define SPI_InterruptDisable(x) SSP1IE = 0; SSP1IF = 0;
+/* setting the flag in software triggers the first interrupt */
+#define SPI_InterruptTrigger(x) SSP1IF = 1;
+
 void SPI_Init()
 {
 	ANSELC = FALSE;         /* Set PORTC to digital IO */
@@ -31,30 +41,61 @@ void SPI_Init()
 	CKE = TRUE;             /* Transmit occures on transition from active to Idle clock state */
 	SSP1CON1 .0 = TRUE;      /* SPI MASTER mode, clock = Fosc/16 */
 	SSPEN = TRUE;           /* Enables the serial port and configures SCK, SDO, SDI */
+
+	SSP1IE = FALSE;         /* the interrupt is only enabled while a frame is transmitted */
+	SSP1IP = FALSE;         /* low priority, the UART receiver must not be delayed */
+	g_SpiFrame.busy = FALSE;
 }
 
 uns8 SPI_Send(const uns8 data)
 {
+	while(SPI_IsBusy()) ;   /* Wait for the ledstrip frame */
+
 	SSP1IF = FALSE;         /* Reset interruptflag, that end of transmisson can be detected */
 	SSP1BUF = data;
 	while(SSP1IF == 0) ;    /* Wait for end of transmission */
 
 	return SSP1BUF;
 }
+#else
+/* the x86 wrapper emulates the interrupt and the shift register with SPI_Send() */
+#define SPI_Transmit(x) SPI_Send(x);
+#define SPI_InterruptEnable(x)
+#define SPI_InterruptDisable(x)
+#define SPI_InterruptTrigger(x)
+#endif /* #ifdef CC8E */
 
 void SPI_SendLedBuffer(uns8 *array)
 {
-	const uns8 *end = (uns8 *) (array + (NUM_OF_LED * 3));                           /* array must be the address of the first byte*/
-	/* calculate where the end is */
-	for(; array < end; array++) {           /* send all data */
-		SPI_Send(*array);
+	if(SPI_IsBusy()) {
+		return;
 	}
 
-/* If we really have to garantee a sleep after data was written to the LEDs, it should be added here.
- * Other locations would be more attractive to avoid a waiting core, but here it is much clearer and easier
- * to find for later optimization. In my opinion we should spend this 1ms waste here, before we make the main
- * loop more complex. */
-}
-#endif /* #ifdef CC8E */
+	uns8 *pDest = g_SpiFrame.data;
+	const uns8 *end = pDest + sizeof(g_SpiFrame.data);
+	for(; pDest < end; pDest++) {
+		*pDest = *array;
+		array++;
+	}
 
+	g_SpiFrame.pNext = g_SpiFrame.data;
+	g_SpiFrame.remaining = sizeof(g_SpiFrame.data);
+	g_SpiFrame.busy = TRUE;
+	Trace_Event(eTRACE_LEDSTRIP_FRAME, 0);
+	SPI_InterruptTrigger();
+	SPI_InterruptEnable();
+}
 
+void SPI_Interrupt(void)
+{
+	if(0 == g_SpiFrame.remaining) {
+		SPI_InterruptDisable();
+		g_SpiFrame.busy = FALSE;
+		Timer1Enable();
+		Trace_IsrEvent(eTRACE_LEDSTRIP_FRAME_DONE, 0);
+		return;
+	}
+	SPI_Transmit(*g_SpiFrame.pNext);
+	g_SpiFrame.pNext++;
+	g_SpiFrame.remaining--;
+}
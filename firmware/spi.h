@@ -21,8 +21,46 @@
 
 #include "platform.h"
 
+/**
+ * The ledstrip frame is shifted out by the SPI interrupt from its own buffer.
+ * SPI_SendLedBuffer() takes a snapshot of the leds, so the main cycle can
+ * continue to fade the next frame without waiting for the transmission and
+ * without tearing the frame in transmission.
+ *
+ * <data> copy of the led colors, which is transmitted
+ * <pNext> next byte to transmit
+ * <remaining> number of bytes left in this frame
+ * <busy> set until the interrupt completed the frame
+ */
+struct SpiFrame {
+	uns8 data[NUM_OF_LED * 3];
+	uns8 *pNext;
+	uns16 remaining;
+	uns8 busy;
+};
+
+extern struct SpiFrame g_SpiFrame;
+
+#define SPI_IsBusy(x) (0 != g_SpiFrame.busy)
+
 void SPI_Init();
+
+/**
+ * Blocking transmission of a single byte, waits for a pending frame first
+ */
 uns8 SPI_Send(const uns8 data);
+
+/**
+ * Copy NUM_OF_LED * 3 bytes from <array> and start their transmission in
+ * the background. The call is ignored, while the previous frame is busy.
+ */
 void SPI_SendLedBuffer(uns8 *array);
 
+/**
+ * Called for each transmitted byte, sends the next byte of <g_SpiFrame>.
+ * After the last byte Timer1 is enabled, so the next ledstrip update
+ * follows after the latch time of the leds.
+ */
+void SPI_Interrupt(void);
+
 #endif
@@ -0,0 +1,110 @@
+/*
+ Copyright (C) 2014 Nils Weiss, Patrick Bruenn.
+
+ This file is part of Wifly_Light.
+
+ Wifly_Light is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Wifly_Light is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Wifly_Light.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include "platform.h"
+#include "unittest.h"
+#include "spi.h"
+#include <stdbool.h>
+
+/* the emulated shift register records each transmitted byte */
+static uns8 g_Transmitted[NUM_OF_LED * 3 * 2];
+static size_t g_NumTransmitted;
+
+uns8 SPI_Send(const uns8 data)
+{
+	if(g_NumTransmitted < sizeof(g_Transmitted)) {
+		g_Transmitted[g_NumTransmitted] = data;
+	}
+	g_NumTransmitted++;
+	return data;
+}
+
+static void Spi_Reset(void)
+{
+	memset(&g_SpiFrame, 0, sizeof(g_SpiFrame));
+	g_NumTransmitted = 0;
+}
+
+/* the frame is transmitted by the interrupt, the caller doesn't wait for it */
+int ut_Spi_SendLedBuffer(void)
+{
+	TestCaseBegin();
+	uns8 leds[NUM_OF_LED * 3];
+	size_t i;
+	Spi_Reset();
+	for(i = 0; i < sizeof(leds); i++) {
+		leds[i] = (uns8)i;
+	}
+
+	CHECK(!SPI_IsBusy());
+	SPI_SendLedBuffer(leds);
+	CHECK(SPI_IsBusy());
+	CHECK(0 == g_NumTransmitted);
+
+	// one byte per interrupt and a last interrupt to complete the frame
+	for(i = 0; i < sizeof(leds); i++) {
+		SPI_Interrupt();
+		CHECK(SPI_IsBusy());
+	}
+	CHECK(sizeof(leds) == g_NumTransmitted);
+	SPI_Interrupt();
+	CHECK(!SPI_IsBusy());
+	CHECK(0 == memcmp(leds, g_Transmitted, sizeof(leds)));
+	TestCaseEnd();
+}
+
+/* changes of the leds during the transmission don't tear the frame */
+int ut_Spi_DoubleBuffer(void)
+{
+	TestCaseBegin();
+	uns8 leds[NUM_OF_LED * 3];
+	uns8 first[NUM_OF_LED * 3];
+	Spi_Reset();
+	memset(leds, 0x11, sizeof(leds));
+	memcpy(first, leds, sizeof(first));
+
+	SPI_SendLedBuffer(leds);
+	SPI_Interrupt();
+	SPI_Interrupt();
+	memset(leds, 0x22, sizeof(leds));
+
+	// a frame in progress isn't restarted
+	SPI_SendLedBuffer(leds);
+	while(SPI_IsBusy()) {
+		SPI_Interrupt();
+	}
+	CHECK(sizeof(leds) == g_NumTransmitted);
+	CHECK(0 == memcmp(first, g_Transmitted, sizeof(first)));
+
+	// the next frame contains all changes
+	SPI_SendLedBuffer(leds);
+	while(SPI_IsBusy()) {
+		SPI_Interrupt();
+	}
+	CHECK(2 * sizeof(leds) == g_NumTransmitted);
+	CHECK(0 == memcmp(leds, g_Transmitted + sizeof(leds), sizeof(leds)));
+	TestCaseEnd();
+}
+
+int main(int argc, const char *argv[])
+{
+	UnitTestMainBegin();
+	RunTest(true, ut_Spi_SendLedBuffer);
+	RunTest(true, ut_Spi_DoubleBuffer);
+	UnitTestMainEnd();
+}
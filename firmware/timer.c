@@ -87,33 +87,76 @@ void Timer_StartStopwatch(const enum CYCLETIME_METHODE destMethode)
 void Timer_StopStopwatch(const enum CYCLETIME_METHODE destMethode)
 {
 	uns16 tempTime,temp16;
+	uns8 bucket, i;
+	struct cycletime_stats *pStats = &g_CycleTimeBuffer.stats[destMethode];
 
 	Platform_ReadPerformanceCounter(tempTime);
 
-	if(g_CycleTimeBuffer.tempCycleTime[destMethode] < tempTime) {
-		tempTime = tempTime - g_CycleTimeBuffer.tempCycleTime[destMethode];
-	} else {
-		temp16 = 0xffff - g_CycleTimeBuffer.tempCycleTime[destMethode];
-		tempTime += temp16;
+	/* the unsigned subtraction takes care of a counter overflow */
+	tempTime -= g_CycleTimeBuffer.tempCycleTime[destMethode];
+	g_CycleTimeBuffer.tempCycleTime[destMethode] = 0;
+
+	if(tempTime > pStats->max) {
+		pStats->max = tempTime;
 	}
 
-	if(tempTime > g_CycleTimeBuffer.maxCycleTime[destMethode]) {
-		g_CycleTimeBuffer.maxCycleTime[destMethode] = tempTime;
+	if(0xffff == pStats->count) {
+		pStats->count = pStats->count >> 1;
+		pStats->total = pStats->total >> 1;
 	}
-	g_CycleTimeBuffer.tempCycleTime[destMethode] = 0;
+	pStats->count++;
+	pStats->total += tempTime;
+
+	bucket = 0;
+	temp16 = tempTime >> CYCLETIME_HISTOGRAM_SHIFT;
+	while((temp16 != 0) && (bucket < CYCLETIME_HISTOGRAM_SIZE - 1)) {
+		temp16 = temp16 >> 1;
+		bucket++;
+	}
+
+	if(0xff == pStats->histogram[bucket]) {
+		for(i = 0; i < CYCLETIME_HISTOGRAM_SIZE; i++) {
+			/* round up, so rare cycle times don't disappear */
+			pStats->histogram[i] = (pStats->histogram[i] >> 1) + (pStats->histogram[i] & 0x01);
+		}
+	}
+	pStats->histogram[bucket]++;
 }
 
-uns8 Timer_PrintCycletime(uns16 *pArray, const uns16 arraySize)
+uns8 Timer_PrintCycletime(struct cycletime_stats *pArray, const uns16 arraySize)
 {
-	uns16 i, temp16;
-	for(i = 0; i < CYCLETIME_METHODE_ENUM_SIZE && i < arraySize; i++) {
-		temp16 = g_CycleTimeBuffer.maxCycleTime[i];
-		temp16 = htons(temp16);
-		*pArray = temp16;
+	uns8 i, j, bytesPrint;
+	uns16 temp16;
+	uns32 temp32;
+	struct cycletime_stats *pStats;
+
+	bytesPrint = 0;
+	for(i = 0; i < CYCLETIME_METHODE_ENUM_SIZE; i++) {
+		if(bytesPrint + sizeof(struct cycletime_stats) > arraySize) {
+			break;
+		}
+		pStats = &g_CycleTimeBuffer.stats[i];
+
+		temp16 = htons(pStats->max);
+		pArray->max = temp16;
+		pStats->max = 0;
+
+		temp16 = htons(pStats->count);
+		pArray->count = temp16;
+		pStats->count = 0;
+
+		temp32 = htonl(pStats->total);
+		pArray->total = temp32;
+		pStats->total = 0;
+
+		for(j = 0; j < CYCLETIME_HISTOGRAM_SIZE; j++) {
+			pArray->histogram[j] = pStats->histogram[j];
+			pStats->histogram[j] = 0;
+		}
 		pArray++;
-		g_CycleTimeBuffer.maxCycleTime[i] = 0;
+		bytesPrint += sizeof(struct cycletime_stats);
 	}
-	return i + i;
+	return bytesPrint;
 }
 #else
 
@@ -123,9 +166,9 @@ void Timer_StartStopwatch(const enum CYCLETIME_METHODE destMethode)
 void Timer_StopStopwatch(const enum CYCLETIME_METHODE destMethode)
 {}
 
-uns8 Timer_PrintCycletime(uns16 *pArray, const uns16 arraySize)
+uns8 Timer_PrintCycletime(struct cycletime_stats *pArray, const uns16 arraySize)
 {
 	return 0;
 }
 
-#endif /*DEBUG*/
\ No newline at end of file
+#endif /*DEBUG*/
\ No newline at end of file
@@ -25,7 +25,7 @@ enum CYCLETIME_METHODE {
 	eLedstrip_DoFade,               //01
 	eSET_FADE,                      //02
 	eSET_COLOR,                     //03
-	e_EMPTY_METHODE_0,              //04
+	eSET_GRADIENT,                  //04
 	e_EMPTY_METHODE_1,              //05
 	eLedstrip_UpdateLed,            //06
 	eCommandIO_GetCommands, 		//07
@@ -38,8 +38,24 @@ enum CYCLETIME_METHODE {
 
 extern enum CYCLETIME_METHODE enumMethode;
 
+/**
+ * Cycle times are sorted into log2 buckets. The first bucket takes all times
+ * below (1 << CYCLETIME_HISTOGRAM_SHIFT) ticks of the 2MHz stopwatch (64us),
+ * each following bucket twice as much. The last bucket takes everything
+ * from 4ms upwards.
+ */
+#define CYCLETIME_HISTOGRAM_SIZE 8
+#define CYCLETIME_HISTOGRAM_SHIFT 7
+
+struct __attribute__((__packed__)) cycletime_stats {
+	uns16 max;        /* longest cycle time in ticks of 0.5us */
+	uns16 count;      /* number of measurements */
+	uns32 total;      /* sum of all measurements in ticks, total / count is the mean */
+	uns8 histogram[CYCLETIME_HISTOGRAM_SIZE];
+};
+
 struct CycleTimeBuffer {
-	uns16 maxCycleTime[CYCLETIME_METHODE_ENUM_SIZE];
+	struct cycletime_stats stats[CYCLETIME_METHODE_ENUM_SIZE];
 	uns16 tempCycleTime[CYCLETIME_METHODE_ENUM_SIZE];
 };
 
@@ -54,11 +70,19 @@ void Timer_Init();
 void Timer_StartStopwatch(const enum CYCLETIME_METHODE destMethode);
 
 /**
-** Function terminates the Stopwatch and print out the measured Time over UART
+** Function terminates the Stopwatch and adds the measured Time to the statistics
+** of <destMethode>. Before count or a histogram bucket would overflow, the
+** values are halved. This keeps the mean and the shape of the histogram, a
+** bucket with at least one measurement never drops to zero.
 **/
 void Timer_StopStopwatch(const enum CYCLETIME_METHODE destMethode);
 
-uns8 Timer_PrintCycletime(uns16 *pArray, const uns16 arraySize);
+/**
+** Copies the statistics of all methodes in network byte order to <pArray> and
+** resets them. <arraySize> is the space available in bytes.
+** @return number of bytes written to <pArray>
+**/
+uns8 Timer_PrintCycletime(struct cycletime_stats *pArray, const uns16 arraySize);
 
 #ifdef __CC8E__
 #define Timer1Interrupt(x) TMR1IF = 0; 
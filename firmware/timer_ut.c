@@ -0,0 +1,116 @@
+/*
+ Copyright (C) 2014 Nils Weiss, Patrick Bruenn.
+
+ This file is part of Wifly_Light.
+
+ Wifly_Light is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Wifly_Light is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Wifly_Light.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include "platform.h"
+#include "unittest.h"
+#include "timer.h"
+#include <stdbool.h>
+
+/* the emulated performance counter only moves when the test says so */
+static uns16 g_PerformanceCounter;
+
+uns16 Platform_PerformanceCounter(void)
+{
+	return g_PerformanceCounter;
+}
+
+static void Measure(const enum CYCLETIME_METHODE methode, const uns16 start, const uns16 duration)
+{
+	g_PerformanceCounter = start;
+	Timer_StartStopwatch(methode);
+	g_PerformanceCounter = start + duration;
+	Timer_StopStopwatch(methode);
+}
+
+/* each measurement lands in its log2 bucket, long ones in the last bucket */
+int ut_Timer_Histogram(void)
+{
+	TestCaseBegin();
+	struct cycletime_stats stats[CYCLETIME_METHODE_ENUM_SIZE];
+	memset(&g_CycleTimeBuffer, 0, sizeof(g_CycleTimeBuffer));
+
+	Measure(eMAIN, 100, 0);
+	Measure(eMAIN, 100, 127);
+	Measure(eMAIN, 100, 128);
+	Measure(eMAIN, 100, 255);
+	Measure(eMAIN, 100, 256);
+	Measure(eMAIN, 100, 8191);
+	Measure(eMAIN, 100, 8192);
+	Measure(eMAIN, 100, 30000);
+	/* the counter wraps around during the measurement */
+	Measure(eMAIN, 0xff00, 0x1000);
+	Measure(eScriptCtrl_Run, 0, 500);
+
+	CHECK(sizeof(stats) == Timer_PrintCycletime(stats, sizeof(stats)));
+	CHECK(9 == ntohs(stats[eMAIN].count));
+	CHECK(30000 == ntohs(stats[eMAIN].max));
+	CHECK(0 + 127 + 128 + 255 + 256 + 8191 + 8192 + 30000 + 0x1000 == ntohl(stats[eMAIN].total));
+	CHECK(2 == stats[eMAIN].histogram[0]);
+	CHECK(2 == stats[eMAIN].histogram[1]);
+	CHECK(1 == stats[eMAIN].histogram[2]);
+	CHECK(0 == stats[eMAIN].histogram[3]);
+	CHECK(0 == stats[eMAIN].histogram[4]);
+	CHECK(0 == stats[eMAIN].histogram[5]);
+	CHECK(2 == stats[eMAIN].histogram[6]);
+	CHECK(2 == stats[eMAIN].histogram[7]);
+
+	CHECK(1 == ntohs(stats[eScriptCtrl_Run].count));
+	CHECK(1 == stats[eScriptCtrl_Run].histogram[2]);
+	CHECK(0 == ntohs(stats[eSET_FADE].count));
+
+	/* reading resets the statistics */
+	CHECK(sizeof(stats) == Timer_PrintCycletime(stats, sizeof(stats)));
+	CHECK(0 == ntohs(stats[eMAIN].count));
+	CHECK(0 == ntohs(stats[eMAIN].max));
+	CHECK(0 == ntohl(stats[eMAIN].total));
+	CHECK(0 == stats[eMAIN].histogram[7]);
+
+	/* only complete entries are written */
+	CHECK(2 * sizeof(stats[0]) == Timer_PrintCycletime(stats, 3 * sizeof(stats[0]) - 1));
+	TestCaseEnd();
+}
+
+/* values are halved before they overflow, rare cycle times stay in the histogram */
+int ut_Timer_Saturation(void)
+{
+	TestCaseBegin();
+	struct cycletime_stats stats[CYCLETIME_METHODE_ENUM_SIZE];
+	unsigned int i;
+	memset(&g_CycleTimeBuffer, 0, sizeof(g_CycleTimeBuffer));
+
+	Measure(eMAIN, 0, 10000);
+	for(i = 0; i < 0xffff; i++) {
+		Measure(eMAIN, 0, 200);
+	}
+	CHECK(sizeof(stats) == Timer_PrintCycletime(stats, sizeof(stats)));
+	CHECK(0x8000 == ntohs(stats[eMAIN].count));
+	CHECK(10000 == ntohs(stats[eMAIN].max));
+	/* the mean is still close to 200 ticks */
+	CHECK(200 == ntohl(stats[eMAIN].total) / ntohs(stats[eMAIN].count));
+	CHECK(128 <= stats[eMAIN].histogram[1]);
+	CHECK(1 == stats[eMAIN].histogram[7]);
+	TestCaseEnd();
+}
+
+int main(int argc, const char *argv[])
+{
+	UnitTestMainBegin();
+	RunTest(true, ut_Timer_Histogram);
+	RunTest(true, ut_Timer_Saturation);
+	UnitTestMainEnd();
+}
@@ -24,6 +24,9 @@ struct RingBuffer g_TraceBuf;
 void Trace_Init(void)
 {
 	RingBuf_Init(&g_TraceBuf);
+
+	/* timer3 overflows extend the timestamps of the trace events */
+	TMR3IE = TRUE;
 }
 
 void PutToBuf(const uns8 Byte)
@@ -132,3 +135,127 @@ uns8 Trace_Print(uns8 *pArray, const uns16 arraySize)
 	return 0;
 }
 #endif
+
+#ifdef DEBUG
+struct TraceEventBuffer g_TraceEvents;
+struct TraceEventBuffer g_TraceIsrEvents;
+
+#ifdef __CC8E__
+uns16 g_TraceEpoch;
+
+/* the overflow interrupt of timer3 might still be pending, when we read timer3 */
+#define Trace_ReadTimestamp(epoch, time) { \
+	do { \
+		epoch = g_TraceEpoch; \
+		Platform_ReadPerformanceCounter(time); \
+	} while(epoch != g_TraceEpoch); \
+	if(TMR3IF && (0 == (time.high8 & 0x80))) epoch++; }
+#else
+#define Trace_ReadTimestamp(epoch, time) { \
+	do { \
+		epoch = Platform_PerformanceEpoch(); \
+		Platform_ReadPerformanceCounter(time); \
+	} while(epoch != Platform_PerformanceEpoch()); }
+#endif
+
+#define TraceEventInc(x) ((x + 1) & (TRACE_EVENT_BUFFER_SIZE - 1))
+
+/* Trace_IsrEvent() is a copy of this, functions can't be shared by the interrupt and the main cycle */
+void Trace_Event(const uns8 id, const uns8 arg)
+{
+	uns8 write, writeNext;
+	uns16 epoch, time;
+	struct trace_event *pEvent;
+
+	write = g_TraceEvents.write;
+	writeNext = TraceEventInc(write);
+	if(writeNext == g_TraceEvents.read) {
+		g_TraceEvents.numLost++;
+		return;
+	}
+
+	Trace_ReadTimestamp(epoch, time);
+	pEvent = &g_TraceEvents.event[write];
+	pEvent->id = id;
+	pEvent->arg = arg;
+	pEvent->epoch = epoch;
+	pEvent->time = time;
+	g_TraceEvents.write = writeNext;
+}
+
+void Trace_IsrEvent(const uns8 id, const uns8 arg)
+{
+	uns8 write, writeNext;
+	uns16 epoch, time;
+	struct trace_event *pEvent;
+
+	write = g_TraceIsrEvents.write;
+	writeNext = TraceEventInc(write);
+	if(writeNext == g_TraceIsrEvents.read) {
+		g_TraceIsrEvents.numLost++;
+		return;
+	}
+
+	Trace_ReadTimestamp(epoch, time);
+	pEvent = &g_TraceIsrEvents.event[write];
+	pEvent->id = id | TRACE_EVENT_ISR;
+	pEvent->arg = arg;
+	pEvent->epoch = epoch;
+	pEvent->time = time;
+	g_TraceIsrEvents.write = writeNext;
+}
+
+/* the slot at <read> is released after it was copied, the writer might use it immediately */
+uns8 Trace_MoveEvents(struct TraceEventBuffer *pBuf, struct trace_event *pDest)
+{
+	uns8 read, numEvents;
+	uns16 temp16;
+	struct trace_event *pEvent;
+
+	numEvents = 0;
+	read = pBuf->read;
+	while(read != pBuf->write) {
+		pEvent = &pBuf->event[read];
+		pDest->id = pEvent->id;
+		pDest->arg = pEvent->arg;
+		temp16 = htons(pEvent->epoch);
+		pDest->epoch = temp16;
+		temp16 = htons(pEvent->time);
+		pDest->time = temp16;
+		pDest++;
+		numEvents++;
+		read = TraceEventInc(read);
+		pBuf->read = read;
+	}
+	return numEvents;
+}
+
+uns8 Trace_PrintEvents(struct trace_events *pEvents, const uns16 arraySize)
+{
+	uns8 numEvents, numLost;
+
+	/* both buffers always fit into the response */
+	if(arraySize < sizeof(struct trace_events)) {
+		return 0;
+	}
+
+	numLost = g_TraceIsrEvents.numLost;
+	numLost -= g_TraceIsrEvents.numLostReported;
+	g_TraceIsrEvents.numLostReported += numLost;
+	pEvents->numLost = numLost;
+
+	numLost = g_TraceEvents.numLost;
+	numLost -= g_TraceEvents.numLostReported;
+	g_TraceEvents.numLostReported += numLost;
+	pEvents->numLost += numLost;
+
+	numEvents = Trace_MoveEvents(&g_TraceIsrEvents, &pEvents->event[0]);
+	numEvents += Trace_MoveEvents(&g_TraceEvents, &pEvents->event[numEvents]);
+	return sizeof(pEvents->numLost) + numEvents * sizeof(struct trace_event);
+}
+#else
+uns8 Trace_PrintEvents(struct trace_events *pEvents, const uns16 arraySize)
+{
+	return 0;
+}
+#endif
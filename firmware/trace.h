@@ -28,6 +28,42 @@
 #include "TargetConditionals.h"
 #endif
 
+/**
+ * Binary trace events can be recorded from the main cycle and the low
+ * priority interrupt.
+ * Each event is stored with a timestamp in ticks of timer3 (0.5us). The
+ * upper 16 bit of the timestamp count the overflows of timer3, so it wraps
+ * only every 35 minutes. Events from the interrupt are reported with
+ * TRACE_EVENT_ISR set in their id.
+ */
+enum TRACE_EVENT {
+	eTRACE_INIT_DONE,               //00
+	eTRACE_RECEIVEBUFFER_FULL,      //01 the current command was dropped
+	eTRACE_COMMAND,                 //02 arg: code of a received command frame
+	eTRACE_SCRIPT_COMMAND,          //03 arg: code of the command ScriptCtrl_Run() executes
+	eTRACE_LEDSTRIP_FRAME,          //04 the transmission of a ledstrip frame starts
+	eTRACE_LEDSTRIP_FRAME_DONE,     //05 isr: the last byte of the ledstrip frame was sent
+	eTRACE_UART_TX_DONE,            //06 isr: the uart transmit buffer ran empty
+	TRACE_EVENT_ENUM_SIZE //!!! MUST be the last element of the enum
+};
+
+#define TRACE_EVENT_ISR 0x80
+
+/* number of events in each of the two buffers, has to be a power of 2 */
+#define TRACE_EVENT_BUFFER_SIZE 16
+
+struct __attribute__((__packed__)) trace_event {
+	uns8 id;
+	uns8 arg;
+	uns16 epoch;    /* overflows of timer3 */
+	uns16 time;     /* timer3 */
+};
+
+struct __attribute__((__packed__)) trace_events {
+	uns8 numLost;   /* events dropped, because a buffer was full */
+	struct trace_event event[2 * TRACE_EVENT_BUFFER_SIZE];
+};
+
 #ifdef DEBUG
 extern struct RingBuffer g_TraceBuf;
 #ifdef __CC8E__
@@ -107,5 +143,48 @@ uns8 Trace_Print(uns8 *pArray, const uns16 arraySize);
 	#define TraceBuffer(ZONE, BUFFER, LENGTH, BUFFER_FORMAT, ...)
 	#define Trace(ZONE, ...)
 #endif
+
+#ifdef DEBUG
+/**
+ * Each buffer has a single writer and is read in the main cycle by
+ * Trace_PrintEvents(), this way no locks are required.
+ */
+struct TraceEventBuffer {
+	struct trace_event event[TRACE_EVENT_BUFFER_SIZE];
+	uns8 read;
+	uns8 write;
+	uns8 numLost;   /* only written by the writer, wraps around */
+	uns8 numLostReported;   /* only written by the reader */
+};
+extern struct TraceEventBuffer g_TraceEvents;
+extern struct TraceEventBuffer g_TraceIsrEvents;
+#ifdef __CC8E__
+/* incremented by the timer3 interrupt */
+extern uns16 g_TraceEpoch;
+#endif
+
+/**
+ * Record an event from the main cycle
+ */
+void Trace_Event(const uns8 id, const uns8 arg);
+
+/**
+ * Record an event from the low priority interrupt. Never call this from the
+ * high priority interrupt, it could interrupt another call. The event slot is
+ * addressed through FSR0 and PRODL/PRODH, LowPriorityInterrupt() saves them.
+ */
+void Trace_IsrEvent(const uns8 id, const uns8 arg);
+#else
+	#define Trace_Event(id, arg)
+	#define Trace_IsrEvent(id, arg)
+#endif
+
+/**
+ * Moves all recorded events in network byte order to <pEvents>, first the
+ * ones of the interrupt then the ones of the main cycle. <arraySize> is the
+ * space available in bytes.
+ * @return number of bytes written to <pEvents>
+ */
+uns8 Trace_PrintEvents(struct trace_events *pEvents, const uns16 arraySize);
 #endif /* #ifndef _TRACE_H_ */
 
@@ -0,0 +1,160 @@
+/*
+ Copyright (C) 2014 Nils Weiss, Patrick Bruenn.
+
+ This file is part of Wifly_Light.
+
+ Wifly_Light is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Wifly_Light is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Wifly_Light.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include "platform.h"
+#include "unittest.h"
+#include "trace.h"
+#include "wifly_cmd.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+#define NUM_ISR_EVENTS 20000
+
+/* the emulated timer3 only moves when the test says so */
+static uint32_t g_PerformanceCounter;
+
+uns16 Platform_PerformanceCounter(void)
+{
+	return (uns16)g_PerformanceCounter;
+}
+
+uns16 Platform_PerformanceEpoch(void)
+{
+	return (uns16)(g_PerformanceCounter >> 16);
+}
+
+static void Trace_Reset(void)
+{
+	memset(&g_TraceEvents, 0, sizeof(g_TraceEvents));
+	memset(&g_TraceIsrEvents, 0, sizeof(g_TraceIsrEvents));
+}
+
+/* events are reported in network byte order, the ones of the interrupt first */
+int ut_Trace_PrintEvents(void)
+{
+	TestCaseBegin();
+	struct trace_events events;
+	Trace_Reset();
+
+	g_PerformanceCounter = 0x0001fffe;
+	Trace_Event(eTRACE_COMMAND, SET_COLOR_DIRECT);
+	g_PerformanceCounter = 0x00020003;
+	Trace_IsrEvent(eTRACE_UART_TX_DONE, 0);
+	g_PerformanceCounter = 0x00020004;
+	Trace_Event(eTRACE_SCRIPT_COMMAND, WAIT);
+
+	CHECK(1 + 3 * sizeof(struct trace_event) == Trace_PrintEvents(&events, sizeof(events)));
+	CHECK(0 == events.numLost);
+	CHECK((eTRACE_UART_TX_DONE | TRACE_EVENT_ISR) == events.event[0].id);
+	CHECK(2 == ntohs(events.event[0].epoch));
+	CHECK(3 == ntohs(events.event[0].time));
+	CHECK(eTRACE_COMMAND == events.event[1].id);
+	CHECK(SET_COLOR_DIRECT == events.event[1].arg);
+	CHECK(1 == ntohs(events.event[1].epoch));
+	CHECK(0xfffe == ntohs(events.event[1].time));
+	CHECK(eTRACE_SCRIPT_COMMAND == events.event[2].id);
+	CHECK(WAIT == events.event[2].arg);
+
+	/* the buffers are empty afterwards */
+	CHECK(1 == Trace_PrintEvents(&events, sizeof(events)));
+
+	/* too small for both buffers */
+	Trace_Event(eTRACE_INIT_DONE, 0);
+	CHECK(0 == Trace_PrintEvents(&events, sizeof(events) - 1));
+	CHECK(1 + sizeof(struct trace_event) == Trace_PrintEvents(&events, sizeof(events)));
+	TestCaseEnd();
+}
+
+/* full buffers drop the new events, which are reported only once */
+int ut_Trace_Lost(void)
+{
+	TestCaseBegin();
+	struct trace_events events;
+	uns8 i;
+	Trace_Reset();
+
+	for(i = 0; i < TRACE_EVENT_BUFFER_SIZE + 5; i++) {
+		Trace_Event(eTRACE_COMMAND, i);
+		Trace_IsrEvent(eTRACE_LEDSTRIP_FRAME_DONE, i);
+	}
+	CHECK(1 + 2 * (TRACE_EVENT_BUFFER_SIZE - 1) * sizeof(struct trace_event) == Trace_PrintEvents(&events, sizeof(events)));
+	CHECK(2 * 6 == events.numLost);
+	for(i = 0; i < TRACE_EVENT_BUFFER_SIZE - 1; i++) {
+		CHECK(i == events.event[i].arg);
+		CHECK(i == events.event[TRACE_EVENT_BUFFER_SIZE - 1 + i].arg);
+	}
+
+	Trace_Event(eTRACE_COMMAND, 0);
+	CHECK(1 + sizeof(struct trace_event) == Trace_PrintEvents(&events, sizeof(events)));
+	CHECK(0 == events.numLost);
+	TestCaseEnd();
+}
+
+/* the interrupt records events, while the main cycle reads them */
+static volatile bool g_IsrDone;
+
+static void *Interrupt(void *unused)
+{
+	unsigned int i;
+	for(i = 0; i < NUM_ISR_EVENTS; i++) {
+		Trace_IsrEvent(eTRACE_LEDSTRIP_FRAME_DONE, (uns8)i);
+		if(0 == (i % 8)) {
+			usleep(1);
+		}
+	}
+	g_IsrDone = true;
+	return NULL;
+}
+
+int ut_Trace_Concurrent(void)
+{
+	TestCaseBegin();
+	struct trace_events events;
+	pthread_t isrThread;
+	unsigned int numEvents = 0, numLost = 0, numCorrupted = 0, i;
+	bool isrDone;
+	Trace_Reset();
+
+	g_IsrDone = false;
+	pthread_create(&isrThread, 0, Interrupt, 0);
+	do {
+		isrDone = g_IsrDone;
+		uns8 bytes = Trace_PrintEvents(&events, sizeof(events));
+		numLost += events.numLost;
+		for(i = 0; i < (bytes - 1u) / sizeof(struct trace_event); i++) {
+			numCorrupted += ((eTRACE_LEDSTRIP_FRAME_DONE | TRACE_EVENT_ISR) != events.event[i].id);
+		}
+		numEvents += i;
+	} while(!isrDone);
+	pthread_join(isrThread, NULL);
+
+	CHECK(NUM_ISR_EVENTS == numEvents + numLost);
+	CHECK(0 == numCorrupted);
+	CHECK(0 < numEvents);
+	TestCaseEnd();
+}
+
+int main(int argc, const char *argv[])
+{
+	UnitTestMainBegin();
+	RunTest(true, ut_Trace_PrintEvents);
+	RunTest(true, ut_Trace_Lost);
+	RunTest(true, ut_Trace_Concurrent);
+	UnitTestMainEnd();
+}
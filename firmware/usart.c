@@ -17,11 +17,22 @@
  along with Wifly_Light.  If not, see <http://www.gnu.org/licenses/>. */
 
 #include "usart.h"
+#include "trace.h"
+
+struct RingBuffer g_UartTxBuf;
 
 #ifdef __CC8E__
+#define UART_Transmit(x) TXREG1 = x;
+/* TX1IF is set as long as the transmit register is empty, enabling the interrupt triggers it */
+#define UART_InterruptEnable(x) TX1IE = 1;
+#define UART_InterruptDisable(x) TX1IE = 0;
+#define UART_IsTransmitting(x) (0 == TRMT1)
+
 //*******  Initialisierungs-Funktion  *************************************************
 void UART_Init()
 {
+	RingBuf_Init(&g_UartTxBuf);
+
 	//USART TX Pin als Ausgang
 	TRISC .6 = 0;
 	BRGH1 = 1;                                        // High Baudrate activated
@@ -36,16 +47,50 @@ void UART_Init()
 	TXEN1 = 1;               // Enable_Tx;
 	RC1IE = 1;                 // Rx Interrupt aus
 	ADDEN1 = 0;                               // Disable Adressdetection
+	TX1IE = 0;               // Tx Interrupt only while bytes are queued
+	TX1IP = 0;               // low priority, the receiver must not be delayed
 }
+#else
+/* the x86 wrapper drains the buffer with the pace of the uart */
+#define UART_InterruptEnable(x)
+#define UART_InterruptDisable(x)
+#define UART_IsTransmitting(x) FALSE
+
+void UART_Init()
+{
+	RingBuf_Init(&g_UartTxBuf);
+}
+#endif /* #ifdef CC8E */
 
 //*******  Sende-char-Funktion  *************************************************
 void UART_Send(const uns8 ch)
 {
-	while(!TX1IF) ;
-	TXREG1 = ch;
+	while(0 == RingBuf_NumFree(&g_UartTxBuf)) ;
+	RingBuf_Put(&g_UartTxBuf, ch);
+	UART_InterruptEnable();
 }
 
-#endif /* #ifdef CC8E */
+void UART_Flush(void)
+{
+	while(!RingBuf_IsEmpty(&g_UartTxBuf)) ;
+	while(UART_IsTransmitting()) ;
+}
+
+void UART_Interrupt(void)
+{
+	/* RingBuf_Get() isn't used here, the main cycle might be inside of it */
+	uns8 read = g_UartTxBuf.read;
+	if(read == g_UartTxBuf.write) {
+		UART_InterruptDisable();
+		return;
+	}
+	UART_Transmit(g_UartTxBuf.data[read]);
+	read = RingBufInc(read);
+	g_UartTxBuf.read = read;
+	if(read == g_UartTxBuf.write) {
+		Trace_IsrEvent(eTRACE_UART_TX_DONE, 0);
+	}
+}
 
 #if 0
 /* NOT USED CODE ----- REMOVE IF WE DON'T NEED IT ANYMORE */
@@ -19,10 +19,39 @@
 #ifndef _USART_H_
 #define _USART_H_
 #include "platform.h"
+#include "RingBuf.h"
+
+/**
+ * Responses are queued in <g_UartTxBuf> and transmitted by the TX interrupt,
+ * so the main cycle doesn't wait ~87us for each byte at 115200 baud.
+ */
+extern struct RingBuffer g_UartTxBuf;
 
 void UART_Init();
+
+/**
+ * Queue <ch> for transmission. Only if the buffer is full, this waits
+ * until the interrupt transmitted a byte.
+ */
 void UART_Send(const uns8 ch);
 
+/**
+ * Wait until all queued bytes are transmitted, f.e. before a reset
+ */
+void UART_Flush(void);
+
+/**
+ * Called while the transmit register is empty, sends the next queued byte
+ * and disables itself when the buffer runs empty. The queued byte is read
+ * indirectly through FSR0, so the interrupt has to save it for the main cycle.
+ */
+void UART_Interrupt(void);
+
+#ifndef __CC8E__
+/* emulated transmit register, implemented in x86_wrapper.c */
+void UART_Transmit(const uns8 ch);
+#endif
+
 /* UNUSED FUNCTIONS: REMOVE IF WE DON'T NEED THEM ANYMORE */
 /*void UART_SendString(const char *string);
 void UART_SendArray(const uns8 *array, const uns8 length);
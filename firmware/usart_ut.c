@@ -0,0 +1,107 @@
+/*
+ Copyright (C) 2014 Nils Weiss, Patrick Bruenn.
+
+ This file is part of Wifly_Light.
+
+ Wifly_Light is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Wifly_Light is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Wifly_Light.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include "platform.h"
+#include "unittest.h"
+#include "usart.h"
+#include "RingBuf.c"
+#include <pthread.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+#define NUM_TEST_BYTES (RingBufferSize + 100)
+
+/* the emulated transmit register records each transmitted byte */
+static uns8 g_Transmitted[NUM_TEST_BYTES];
+static volatile size_t g_NumTransmitted;
+
+void UART_Transmit(const uns8 ch)
+{
+	if(g_NumTransmitted < sizeof(g_Transmitted)) {
+		g_Transmitted[g_NumTransmitted] = ch;
+	}
+	g_NumTransmitted++;
+}
+
+/* the interrupt transmits one byte each 10us until all test bytes are out */
+static void *TxInterrupt(void *unused)
+{
+	while(g_NumTransmitted < NUM_TEST_BYTES) {
+		usleep(10);
+		UART_Interrupt();
+	}
+	return NULL;
+}
+
+/* bytes are queued and transmitted by the interrupt, the caller doesn't wait for them */
+int ut_Uart_Send(void)
+{
+	TestCaseBegin();
+	uns8 i;
+	UART_Init();
+	g_NumTransmitted = 0;
+
+	for(i = 0; i < 10; i++) {
+		UART_Send(i);
+	}
+	CHECK(0 == g_NumTransmitted);
+
+	for(i = 0; i < 10; i++) {
+		UART_Interrupt();
+		CHECK(i + 1 == g_NumTransmitted);
+		CHECK(i == g_Transmitted[i]);
+	}
+
+	// an empty buffer doesn't transmit anything
+	UART_Interrupt();
+	CHECK(10 == g_NumTransmitted);
+	CHECK(RingBuf_IsEmpty(&g_UartTxBuf));
+	TestCaseEnd();
+}
+
+/* a full buffer blocks the caller until the interrupt made room, nothing is lost */
+int ut_Uart_Backpressure(void)
+{
+	TestCaseBegin();
+	pthread_t interrupt;
+	size_t i;
+	UART_Init();
+	g_NumTransmitted = 0;
+
+	CHECK(0 == pthread_create(&interrupt, 0, TxInterrupt, 0));
+	for(i = 0; i < NUM_TEST_BYTES; i++) {
+		UART_Send((uns8)i);
+	}
+	UART_Flush();
+	CHECK(RingBuf_IsEmpty(&g_UartTxBuf));
+	pthread_join(interrupt, NULL);
+
+	CHECK(NUM_TEST_BYTES == g_NumTransmitted);
+	for(i = 0; i < NUM_TEST_BYTES; i++) {
+		CHECK((uns8)i == g_Transmitted[i]);
+	}
+	TestCaseEnd();
+}
+
+int main(int argc, const char *argv[])
+{
+	UnitTestMainBegin();
+	RunTest(true, ut_Uart_Send);
+	RunTest(true, ut_Uart_Backpressure);
+	UnitTestMainEnd();
+}
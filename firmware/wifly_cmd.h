@@ -24,6 +24,7 @@
 #include "rtc.h"
 #include "RingBuf.h"
 #include "timer.h"
+#include "trace.h"
 #include "error.h"
 #include "VersionFile.h"
 
@@ -60,9 +61,18 @@
 #define GET_FW_VERSION 0xED
 #define FW_STARTED 0xEC
 #define GET_LED_TYP 0xEB
+#define GET_SCRIPT_STATE 0xEA
+#define SET_SCRIPT_SLOT 0xE9
+#define TRUNCATE_SCRIPT 0xE8
+#define GET_UART_CREDIT 0xE7
+#define GET_TRACE_EVENTS 0xE6
+#define GET_STATS 0xE5
 
 #define LOOP_INFINITE 0
 
+/* the address mask of a fade applies to each segment */
+#define SEGMENT_ALL 0xff
+
 #define FW_MAX_MESSAGE_LENGTH 128
 
 //*********************** STRUCT DECLARATION *********************************************
@@ -73,8 +83,9 @@ struct __attribute__((__packed__)) cmd_set_fade {
 	uns8 blue;
 	uns8 parallelFade;
 	uns16 fadeTmms; //fadetime in ten ms
+	uns8 segment; //the leds of <addr> are counted from the first led of this segment or SEGMENT_ALL
 #ifdef __cplusplus
-	void Set(uint32_t __addr, uint32_t argb, uint8_t parallel, uint16_t fadeTime) {
+	void Set(uint32_t __addr, uint32_t argb, uint8_t parallel, uint16_t fadeTime, uint8_t __segment = SEGMENT_ALL) {
 		addr[3] = (uint8_t)(__addr >> 24);
 		addr[2] = (uint8_t)(__addr >> 16);
 		addr[1] = (uint8_t)(__addr >> 8);
@@ -84,12 +95,14 @@ struct __attribute__((__packed__)) cmd_set_fade {
 		blue = (uint8_t)(argb);
 		parallelFade = parallel;
 		fadeTmms = htons(std::max((uint16_t)1, fadeTime));
+		segment = __segment;
 	};
 
 	std::ostream& Write(std::ostream& out, size_t& indentation) const {
 		const uint32_t addrVal = addr[3] << 24 | addr[2] << 16 | addr[1] << 8 | addr[0];
 		const uint32_t argbVal = red << 16 | green << 8 | blue;
-		return out << "0x" << std::hex << addrVal << " 0x" << std::hex << argbVal << ' ' << std::dec << ntohs(fadeTmms) << ' ' << (int)parallelFade;
+		out << "0x" << std::hex << addrVal << " 0x" << std::hex << argbVal << ' ' << std::dec << ntohs(fadeTmms) << ' ' << (int)parallelFade;
+		return (SEGMENT_ALL != segment) ? out << ' ' << (int)segment : out;
 	};
 #endif /* #ifdef __cplusplus */
 };
@@ -104,9 +117,10 @@ struct __attribute__((__packed__)) cmd_set_gradient {
 	uns8 parallelAndOffset; //most significant bit is the parallel bit, the 7 lower bit's hold the number of the offset
 	uns8 numberOfLeds;
 	uns16 fadeTmms; //fadetime in ten ms
+	uns8 segment; //the offset is counted from the first led of this segment
 
 #ifdef __cplusplus
-	void Set(uint32_t argb_1, uint32_t argb_2, uint8_t parallel, uint8_t offset, uint8_t length, uint16_t fadeTime) {
+	void Set(uint32_t argb_1, uint32_t argb_2, uint8_t parallel, uint8_t offset, uint8_t length, uint16_t fadeTime, uint8_t __segment = 0) {
 //		if (offset > 0x7f) throw FatalError("Invalid Parameter, offset is greater than 127");
 		red_1 = (uint8_t)(argb_1 >> 16);
 		green_1 = (uint8_t)(argb_1 >> 8);
@@ -117,12 +131,14 @@ struct __attribute__((__packed__)) cmd_set_gradient {
 		parallelAndOffset = (parallel ? 0x80 : 0x00) | (offset & 0x7F);
 		numberOfLeds = length;
 		fadeTmms = htons(std::max((uint16_t)1, fadeTime));
+		segment = __segment;
 	};
 
 	std::ostream& Write(std::ostream& out, size_t& indentation) const {
 		const uint32_t argbVal_1 = red_1 << 16 | green_1 << 8 | blue_1;
 		const uint32_t argbVal_2 = red_2 << 16 | green_2 << 8 | blue_2;
-		return out << "0x" << std::hex << argbVal_1 << " 0x" << std::hex << argbVal_2 << ' ' << std::dec << ntohs(fadeTmms) << ' ' << (int)(parallelAndOffset & 0x7F) << ' ' << (int)numberOfLeds << ' ' << (int)(parallelAndOffset & 0x80);
+		out << "0x" << std::hex << argbVal_1 << " 0x" << std::hex << argbVal_2 << ' ' << std::dec << ntohs(fadeTmms) << ' ' << (int)(parallelAndOffset & 0x7F) << ' ' << (int)numberOfLeds << ' ' << (int)(parallelAndOffset & 0x80);
+		return (0 != segment) ? out << ' ' << (int)segment : out;
 	};
 #endif
 };
@@ -138,14 +154,17 @@ struct __attribute__((__packed__)) cmd_wait {
 	uns16 waitTmms;
 };
 
+/* one frame carries the colors of a single segment, longer strips are updated segment by segment */
 struct __attribute__((__packed__)) cmd_set_color_direct {
+	uns8 segment;
 #ifdef __CC8E__
 	uns8 ptr_led_array;
 #else
-	uns8 ptr_led_array[NUM_OF_LED * 3];
+	uns8 ptr_led_array[NUM_OF_LED_PER_SEGMENT * 3];
 #ifdef __cplusplus
-	void Set(const uint8_t red, const uint8_t green, const uint8_t blue, const uint32_t addr)
+	void Set(const uint8_t red, const uint8_t green, const uint8_t blue, const uint32_t addr, const uint8_t __segment = 0)
 	{
+		segment = __segment;
 		memset(ptr_led_array, 0, sizeof(ptr_led_array));
 		uint8_t *pCur = ptr_led_array;
 		for(uint32_t mask = 0x1; mask > 0; mask = mask << 1) {
@@ -162,8 +181,9 @@ struct __attribute__((__packed__)) cmd_set_color_direct {
 		}
 	};
 
-	void Set(const uint8_t *pBuffer, size_t bufferLength)
+	void Set(const uint8_t *pBuffer, size_t bufferLength, const uint8_t __segment = 0)
 	{
+		segment = __segment;
 		bufferLength = std::min(bufferLength, sizeof(ptr_led_array));
 		memcpy(ptr_led_array, pBuffer, bufferLength);
 		memset(ptr_led_array + bufferLength, 0, sizeof(ptr_led_array) - bufferLength);
@@ -172,6 +192,43 @@ struct __attribute__((__packed__)) cmd_set_color_direct {
 #endif
 };
 
+struct __attribute__((__packed__)) cmd_set_script_slot {
+	uns8 index; /* slot relative to the oldest command in the script ring */
+	uns8 cmd; /* the new command, loop commands can't be replaced */
+	union {
+		struct cmd_set_fade set_fade;
+		struct cmd_wait wait;
+		struct cmd_set_gradient set_gradient;
+	}
+	data;
+};
+
+struct __attribute__((__packed__)) cmd_truncate_script {
+	uns8 index; /* first slot to remove, relative to the oldest command in the script ring */
+};
+
+/* the script ring has SCRIPTCTRL_NUM_CMD_MAX + 1 slots, one is always kept free,
+ * the slot indices of script_state wrap with this bitmask */
+#define SCRIPTCTRL_NUM_CMD_MAX 63
+
+struct __attribute__((__packed__)) script_state {
+	uns8 numFree; /* number of free slots in the script ring */
+	uns8 read; /* oldest slot, which is still in use f.e. by a running loop */
+	uns8 execute; /* slot of the next command to execute */
+	uns8 write; /* slot for the next command we receive */
+};
+
+/* counters since the last reset of the firmware, the 16 bit ones wrap around */
+struct __attribute__((__packed__)) device_stats {
+	uns32 rxBytes; /* bytes read from the uart receive buffer */
+	uns16 commands; /* frames, which passed the crc check */
+	uns16 crcErrors;
+	uns16 lengthErrors; /* frames too long for the command buffer */
+	uns16 scriptFull; /* commands rejected with SCRIPTBUFFER_FULL */
+	uns16 ringOverflows; /* the uart receive buffer was full and bytes were lost */
+	uns8 ringHighWater; /* maximum number of bytes in the uart receive buffer */
+};
+
 struct __attribute__((__packed__)) response_frame {
 	uns16 length;           /* only for Firmware, do not use in Client */
 	uns8 cmd;
@@ -180,8 +237,12 @@ struct __attribute__((__packed__)) response_frame {
 		struct rtc_time time;
 		uns16 versionData;
 		uns8 trace_string[RingBufferSize];
-		uns16 max_cycle_times[CYCLETIME_METHODE_ENUM_SIZE];
+		struct cycletime_stats cycletimes[CYCLETIME_METHODE_ENUM_SIZE];
 		uns8 ledTyp;
+		struct script_state scriptState;
+		uns8 uartCredit; /* free bytes in the uart receive buffer */
+		struct trace_events traceEvents;
+		struct device_stats stats;
 	}
 	data;
 };
@@ -195,6 +256,8 @@ struct __attribute__((__packed__)) led_cmd {
 		struct rtc_time set_rtc;
 		struct cmd_set_color_direct set_color_direct;
 		struct cmd_set_gradient set_gradient;
+		struct cmd_set_script_slot set_script_slot;
+		struct cmd_truncate_script truncate_script;
 	}
 	data;
 };
@@ -18,11 +18,14 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include "x86_wrapper.h"
 #include "RingBuf.h"
 #include "ScriptCtrl.h"
 #include "timer.h"
+#include "spi.h"
+#include "usart.h"
 #include "Version.h"
 
 extern unsigned char do_update_fade;
@@ -31,8 +34,11 @@ extern unsigned char do_update_fade;
 
 bit g_led_off = 1; //X86 replacement for PORTC.0
 pthread_mutex_t g_led_mutex = PTHREAD_MUTEX_INITIALIZER;
+/* the low priority interrupts of the PIC never interrupt each other */
+pthread_mutex_t g_isr_mutex = PTHREAD_MUTEX_INITIALIZER;
 uns8 g_led_status[NUM_OF_LED * 3];
 extern uns8 g_UpdateLed;
+extern uns8 g_UpdateLedStrip;
 
 struct RingBuffer g_TraceBuf;
 extern struct ScriptBuf gScriptBuf;
@@ -134,9 +140,40 @@ void *timer1_interrupt(void *unused)
 {
 	for(;; ) {
 		usleep(1000);
-		Ledstrip_UpdateLed();
+		g_UpdateLedStrip++;
 	}
 }
+
+/* shifts out a whole frame at once, so opengl never shows a partial frame */
+void *spi_interrupt(void *unused)
+{
+	for(;; ) {
+		usleep(100);
+		if(SPI_IsBusy()) {
+			pthread_mutex_lock(&g_led_mutex);
+			pthread_mutex_lock(&g_isr_mutex);
+			while(SPI_IsBusy()) {
+				SPI_Interrupt();
+			}
+			pthread_mutex_unlock(&g_isr_mutex);
+			pthread_mutex_unlock(&g_led_mutex);
+		}
+	}
+}
+/* transmits the queued response bytes with the pace of 115200 baud */
+void *uart_tx_interrupt(void *unused)
+{
+	for(;; ) {
+		usleep(1000);
+		int i;
+		pthread_mutex_lock(&g_isr_mutex);
+		for(i = 0; i < 12; i++) {
+			UART_Interrupt();
+		}
+		pthread_mutex_unlock(&g_isr_mutex);
+	}
+}
+
 void *timer4_interrupt(void *unused)
 {
 	for(;; ) {
@@ -149,17 +186,32 @@ void *timer4_interrupt(void *unused)
 	}
 }
 
+static uint64_t PerformanceCounter(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 2000000 + now.tv_nsec / 500;
+}
+
+uns16 Platform_PerformanceCounter(void)
+{
+	return (uns16)PerformanceCounter();
+}
+
+uns16 Platform_PerformanceEpoch(void)
+{
+	return (uns16)(PerformanceCounter() >> 16);
+}
+
 void Rtc_Init() {}
 void Rtc_Ctl(enum RTC_request req,struct rtc_time *pRtcTime) {}
 
-void UART_Init() {}
-void UART_Send(uns8 ch)
+void UART_Transmit(const uns8 ch)
 {
-	printf("0x%02x(%c)\n", ch, ch);
 	send(g_uartSocket, &ch, sizeof(ch), 0);
 }
 void SPI_Init() {}
-char SPI_Send(uns8 data)
+uns8 SPI_Send(const uns8 data)
 {
 	int i;
 	for(i = 3 * NUM_OF_LED - 1; i > 0; i--) {
@@ -169,21 +221,6 @@ char SPI_Send(uns8 data)
 	return g_led_status[0];
 }
 
-void SPI_SendLedBuffer(uns8 *array) //!!! CHECK if GIE=0 during the sendroutine improves the result
-{
-	//array must be the address of the first byte
-	uns8 *end;
-	//calculate where the end is
-	end = array + (NUM_OF_LED * 3);
-	//send all
-
-	pthread_mutex_lock(&g_led_mutex);
-	for(; array < end; array++) {
-		SPI_Send(*array);
-	}
-	pthread_mutex_unlock(&g_led_mutex);
-}
-
 void init_x86(int start_gl)
 {
 	pthread_t broadcastThread;
@@ -191,6 +228,8 @@ void init_x86(int start_gl)
 	pthread_t glThread;
 	pthread_t timer1Thread;
 	pthread_t timer4Thread;
+	pthread_t spiThread;
+	pthread_t uartTxThread;
 
 	pthread_create(&broadcastThread, 0, BroadcastLoop,    0);
 	pthread_create(&isrThread,       0, InterruptRoutine, 0);
@@ -198,4 +237,6 @@ void init_x86(int start_gl)
 		pthread_create(&glThread,        0, gl_start,         0);
 	pthread_create(&timer1Thread,    0, timer1_interrupt, 0);
 	pthread_create(&timer4Thread,    0, timer4_interrupt, 0);
+	pthread_create(&spiThread,       0, spi_interrupt,    0);
+	pthread_create(&uartTxThread,    0, uart_tx_interrupt, 0);
 }
@@ -25,6 +25,7 @@
 #include <fstream>
 #include <stdio.h>
 #include <mutex>
+#include <net/if.h>
 
 namespace WyLight {
 
@@ -38,9 +39,16 @@ namespace WyLight {
 	Endpoint BroadcastReceiver::EMPTY_ENDPOINT {};
 
 
-	BroadcastReceiver::BroadcastReceiver(uint16_t port, const std::string& recentFilename, const std::function<void(size_t index, const Endpoint& newRemote)>& onNewRemote)
+	BroadcastReceiver::BroadcastReceiver(uint16_t port, const std::string& recentFilename, const std::function<void(size_t index, const Endpoint& newRemote)>& onNewRemote, const std::vector<std::string>& interfaces)
 		: mPort(port), mIsRunning(true), mNumInstances(0), mRecentFilename(recentFilename), mOnNewRemote(onNewRemote)
 	{
+		for(const auto& name : interfaces) {
+			const uint32_t index = if_nametoindex(name.c_str());
+			if(0 == index) {
+				throw FatalError("BroadcastReceiver: unknown network interface '" + name + "'");
+			}
+			mInterfaces.insert(index);
+		}
 		ReadRecentEndpoints(mRecentFilename);
 	}
 
@@ -55,13 +63,15 @@ namespace WyLight {
 		// only one thread allowed per instance
 		if(0 == std::atomic_fetch_add(&mNumInstances, 1))
 			try {
+				// one socket serves all interfaces, IP_PKTINFO tells us where a broadcast came from
+				UdpSocket udpSock(INADDR_ANY, mPort, true, 1);
 				size_t numRemotes = mIpTable.size();
 				timeval endTime, now;
 				gettimeofday(&endTime, NULL);
 				timeval_add(&endTime, pTimeout);
 				do
 				{
-					const Endpoint remote = GetNextRemote(pTimeout);
+					const Endpoint remote = GetNextRemote(udpSock, pTimeout);
 					if(remote.IsValid()) {
 						numRemotes++;
 					}
@@ -97,15 +107,25 @@ namespace WyLight {
 	Endpoint BroadcastReceiver::GetNextRemote(timeval *timeout) throw (FatalError)
 	{
 		UdpSocket udpSock(INADDR_ANY, mPort, true, 1);
+		return GetNextRemote(udpSock, timeout);
+	}
+
+	Endpoint BroadcastReceiver::GetNextRemote(const UdpSocket& udpSock, timeval *timeout) throw (FatalError)
+	{
 		sockaddr_storage remoteAddr;
 		socklen_t remoteAddrLength = sizeof(remoteAddr);
+		uint32_t interfaceIndex = 0;
 
 		BroadcastMessage msg;
-		const size_t bytesRead = udpSock.RecvFrom((uint8_t *)&msg, sizeof(msg), timeout, (sockaddr *)&remoteAddr, &remoteAddrLength);
+		const size_t bytesRead = udpSock.RecvFrom((uint8_t *)&msg, sizeof(msg), timeout, (sockaddr *)&remoteAddr, &remoteAddrLength, &interfaceIndex);
 		TraceBuffer(ZONE_VERBOSE, msg.deviceId, sizeof(msg.deviceId), "%c", "%zu bytes broadcast message received DeviceId: \n", bytesRead);
 		if(msg.IsWiflyBroadcast(bytesRead)) {
+			if(!IsAcceptedInterface(interfaceIndex)) {
+				Trace(ZONE_INFO, "Broadcast on interface %u ignored\n", interfaceIndex);
+				return Endpoint();
+			}
 			Trace(ZONE_INFO, "Broadcast detected\n");
-			Endpoint newRemote(remoteAddr, remoteAddrLength, msg.port, std::string((char *)&msg.deviceId[0]));
+			Endpoint newRemote(remoteAddr, remoteAddrLength, msg.port, std::string((char *)&msg.deviceId[0]), interfaceIndex);
 			newRemote.SetScore(1);
 			return LockedInsert(newRemote) ? newRemote : Endpoint();
 		}
@@ -124,12 +144,20 @@ namespace WyLight {
 			if(ref.IsValid()) {
 				ref.SetDeviceId(newEndpoint.GetDeviceId());
 				ref.SetScore(1);
+				if(0 != newEndpoint.GetInterface()) {
+					ref.SetInterface(newEndpoint.GetInterface());
+				}
 				if(mOnNewRemote) mOnNewRemote(0,ref);
 			}
 		}
 		return true;
 	}
 
+	bool BroadcastReceiver::IsAcceptedInterface(uint32_t interfaceIndex) const
+	{
+		return mInterfaces.empty() || (mInterfaces.end() != mInterfaces.find(interfaceIndex));
+	}
+
 	size_t BroadcastReceiver::NumRemotes(void) const
 	{
 		return mIpTable.size();
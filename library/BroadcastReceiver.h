@@ -31,6 +31,7 @@
 #include <set>
 #include <string>
 #include <functional>
+#include <vector>
 
 namespace WyLight {
 
@@ -50,8 +51,10 @@ namespace WyLight {
 		 * @param path to the containing files used to store recent remotes
 		 * @param port to listen on, deault is @see BROADCAST_PORT
 		 * @param onNewEndpoint callback, which is called if a new endpoint got discovered
+		 * @param interfaces names of the network interfaces (f.e. "eth0", "vlan10") to discover endpoints on, an empty list accepts broadcasts from all interfaces (default)
+		 * @throw FatalError if one of the interfaces doesn't exist
 		 */
-		BroadcastReceiver(uint16_t port = BROADCAST_PORT, const std::string& recentFilename = "", const std::function<void(size_t index, const Endpoint& newEndpoint)>& onNewEndpoint = NULL);
+		BroadcastReceiver(uint16_t port = BROADCAST_PORT, const std::string& recentFilename = "", const std::function<void(size_t index, const Endpoint& newEndpoint)>& onNewEndpoint = NULL, const std::vector<std::string>& interfaces = {});
 
 		/*
 		 * Stop receiving loop and cleanup
@@ -59,7 +62,7 @@ namespace WyLight {
 		~BroadcastReceiver(void);
 
 		/**
-		 * Listen for broadcasts and print them to a stream
+		 * Listen for broadcasts on all configured interfaces with a single socket
 		 * @param timeout in seconds, until execution is terminated, to wait indefinetly use NULL (default)
 		 */
 		void operator() (timeval *timeout = NULL) throw (FatalError);
@@ -117,6 +120,7 @@ namespace WyLight {
 
 	private:
 		const uint16_t mPort;
+		std::set<uint32_t> mInterfaces;
 		std::set<Endpoint> mIpTableShadow;
 		std::map<size_t, Endpoint> mIpTable;
 		volatile bool mIsRunning;
@@ -131,6 +135,21 @@ namespace WyLight {
 		 * @return true if a new endpoint was added, false if it already existed or an error occur
 		 */
 		bool LockedInsert(Endpoint& endpoint);
+
+		/**
+		 * Receive the next broadcast on an already bound socket
+		 * @param udpSock socket bound to the broadcast port
+		 * @param timeout to wait until give up, use NULL to wait forever
+		 * @return an empty Endpoint object in case of an error or a broadcast from a filtered interface, else the discovered Endpoint
+		 * @throw FatalError if something failed seriously in the underlying socket
+		 */
+		Endpoint GetNextRemote(const UdpSocket& udpSock, timeval *timeout) throw (FatalError);
+
+		/**
+		 * @param interfaceIndex of the interface a broadcast was received on
+		 * @return true if no interface set was configured or interfaceIndex is part of it
+		 */
+		bool IsAcceptedInterface(uint32_t interfaceIndex) const;
 	};
 }
 #endif /* #ifndef _BROADCAST_RECEIVER_H_ */
@@ -24,6 +24,7 @@
 #include <vector>
 #include <iostream>
 #include <unistd.h>
+#include <net/if.h>
 
 using std::vector;
 using namespace WyLight;
@@ -77,10 +78,12 @@ uint8_t g_TestSocketRecvBuffer[10240];
 uint8_t *g_TestSocketRecvBufferPos = g_TestSocketRecvBuffer;
 size_t g_TestSocketRecvBufferSize = 0;
 const sockaddr_in *g_TestSocketRecvAddr;
+uint32_t g_TestSocketRecvInterface = 0;
 
-void SetTestSocket(const sockaddr_in *addr, size_t offset, void *pData, size_t dataLength)
+void SetTestSocket(const sockaddr_in *addr, size_t offset, void *pData, size_t dataLength, uint32_t interfaceIndex = 0)
 {
 	g_TestSocketRecvAddr = addr;
+	g_TestSocketRecvInterface = interfaceIndex;
 		memcpy(g_TestSocketRecvBuffer + offset, pData, dataLength);
 	g_TestSocketRecvBufferPos = g_TestSocketRecvBuffer;
 	g_TestSocketRecvBufferSize = offset + dataLength;
@@ -89,16 +92,17 @@ void SetTestSocket(const sockaddr_in *addr, size_t offset, void *pData, size_t d
 ClientSocket::ClientSocket(uint32_t addr, uint16_t port, int style) throw (FatalError) : mSock(0), mSockAddr(addr, port) {}
 ClientSocket::~ClientSocket(void) {}
 
-UdpSocket::UdpSocket(uint32_t addr, uint16_t port, bool doBind, int enableBroadcast) throw (FatalError)
+UdpSocket::UdpSocket(uint32_t addr, uint16_t port, bool doBind, int enableBroadcast, uint32_t interfaceIndex) throw (FatalError)
 	: ClientSocket(addr, port, SOCK_DGRAM) {}
 
-size_t UdpSocket::RecvFrom(uint8_t *pBuffer, size_t length, timeval *timeout, struct sockaddr *remoteAddr, socklen_t *remoteAddrLength) const throw (FatalError)
+size_t UdpSocket::RecvFrom(uint8_t *pBuffer, size_t length, timeval *timeout, struct sockaddr *remoteAddr, socklen_t *remoteAddrLength, uint32_t *pInterfaceIndex) const throw (FatalError)
 {
 	const size_t bytesToSend = std::min(g_TestSocketRecvBufferSize, length);
 	if(bytesToSend > 0) {
 		memcpy(pBuffer,    g_TestSocketRecvBufferPos, bytesToSend);
 		memcpy(remoteAddr, g_TestSocketRecvAddr,      sizeof(sockaddr_in));
 		*remoteAddrLength = sizeof(sockaddr_in);
+		if(pInterfaceIndex) *pInterfaceIndex = g_TestSocketRecvInterface;
 		g_TestSocketRecvBufferPos += bytesToSend;
 		g_TestSocketRecvBufferSize -= bytesToSend;
 	}
@@ -328,6 +332,62 @@ size_t ut_BroadcastReceiver_TestRecentEndpoints2(void)
 	TestCaseEnd();
 }
 
+size_t ut_BroadcastReceiver_TestInterfaceFilter(void)
+{
+	TestCaseBegin();
+	const uint32_t loopback = if_nametoindex("lo");
+	CHECK(0 != loopback);
+
+	// broadcast from an interface outside of the set is ignored
+	SetTestSocket(&g_FirstRemote, 0, capturedBroadcastMessage, sizeof(capturedBroadcastMessage), loopback + 1);
+	g_TestOut.str("");
+	BroadcastReceiver dummyReceiver(BroadcastReceiver::BROADCAST_PORT, "", TestCallback, {"lo"});
+	std::thread myThread(std::ref(dummyReceiver));
+	nanosleep(&NANOSLEEP_TIME, NULL);
+	CHECK(0 == dummyReceiver.NumRemotes());
+
+	// broadcast from a selected interface is accepted and the interface is recorded
+	SetTestSocket(&g_SecondRemote, 0, capturedBroadcastMessage_2, sizeof(capturedBroadcastMessage_2), loopback);
+	nanosleep(&NANOSLEEP_TIME, NULL);
+	dummyReceiver.Stop();
+	myThread.join();
+
+	CHECK(0 == g_TestOut.str().compare("0:1 127.0.0.2:2000  :  WiFly_Light\n"));
+	CHECK(1 == dummyReceiver.NumRemotes());
+	CHECK(0x7F000002 == dummyReceiver.GetEndpoint(0).GetIp());
+	CHECK(loopback == dummyReceiver.GetEndpoint(0).GetInterface());
+
+	bool unknownInterfaceThrows = false;
+	try {
+		BroadcastReceiver invalid(BroadcastReceiver::BROADCAST_PORT, "", TestCallback, {"no_such_nic0"});
+	} catch(FatalError& e) {
+		unknownInterfaceThrows = true;
+	}
+	CHECK(unknownInterfaceThrows);
+	TestCaseEnd();
+}
+
+size_t ut_BroadcastReceiver_TestEndpointDeviceId(void)
+{
+	TestCaseBegin();
+	Endpoint first(0x7F000001, 2000, 1, "WiFly_Light");
+	Endpoint second(0x7F000002, 2000, 1, std::string("WiFly_") + "Light");
+	Endpoint other(0x7F000001, 2000, 1, "WiFly-EZX");
+
+	// equal ids share the same interned storage
+	CHECK(&first.GetDeviceId() == &second.GetDeviceId());
+	CHECK(0 == first.GetDeviceId().compare("WiFly_Light"));
+	CHECK(first != other);
+
+	Endpoint copy = other;
+	CHECK(copy == other);
+	copy.SetDeviceId("WiFly_Light");
+	CHECK(copy.GetDeviceId() == first.GetDeviceId());
+	CHECK(0 == other.GetDeviceId().compare("WiFly-EZX"));
+	CHECK(0 == Endpoint().GetDeviceId().compare(""));
+	CHECK(std::hash<Endpoint>()(first) == std::hash<Endpoint>()(other));
+	TestCaseEnd();
+}
 
 int main (int argc, const char *argv[])
 {
@@ -339,6 +399,8 @@ int main (int argc, const char *argv[])
 	RunTest(true, ut_BroadcastReceiver_TestNoTimeout);
 	RunTest(true, ut_BroadcastReceiver_TestRecentEndpoints);
 	RunTest(true, ut_BroadcastReceiver_TestRecentEndpoints2);
+	RunTest(true, ut_BroadcastReceiver_TestInterfaceFilter);
+	RunTest(true, ut_BroadcastReceiver_TestEndpointDeviceId);
 	UnitTestMainEnd();
 }
 
@@ -21,8 +21,9 @@
 
 #include <algorithm>
 #include <arpa/inet.h>
+#include <net/if.h>
 #include <netinet/tcp.h>
-#include <sys/select.h>
+#include <poll.h>
 #include <string>
 #include <errno.h>
 #include <fcntl.h>
@@ -43,7 +44,32 @@ namespace WyLight {
 
 	static const int g_DebugZones = ZONE_ERROR | ZONE_WARNING | ZONE_INFO;// | ZONE_VERBOSE;
 
-#define ESTABLISH_CONNECTION_TIMEOUT 5
+	/**
+	 * Wait for <events> on a single descriptor. poll() is used instead of select()
+	 * because FD_SET() corrupts the stack for descriptors >= FD_SETSIZE.
+	 * @param timeoutMs to wait, -1 to block indefinitely
+	 * @return 1 if the descriptor is ready, 0 on timeout, -1 on failure
+	 */
+	static int PollSingle(int fd, short events, int timeoutMs)
+	{
+		pollfd pfd {fd, events, 0};
+		int result;
+		do {
+			result = poll(&pfd, 1, timeoutMs);
+		} while((-1 == result) && (EINTR == errno));
+		return result;
+	}
+
+	static int ToMilliseconds(const timeval *timeout)
+	{
+		// round up, so tiny timeouts don't degrade into a non blocking poll
+		return (NULL == timeout) ? -1 : (timeout->tv_sec * 1000 + (timeout->tv_usec + 999) / 1000);
+	}
+
+	static int ToMilliseconds(const timespec *timeout)
+	{
+		return (NULL == timeout) ? -1 : (timeout->tv_sec * 1000 + (timeout->tv_nsec + 999999) / 1000000);
+	}
 
 	ClientSocket::ClientSocket()
 		: mSock(-1), mSockAddr(0, 0)
@@ -78,25 +104,42 @@ namespace WyLight {
 
 	bool ClientSocket::Select(timeval *timeout) const throw (FatalError)
 	{
-		/* prepare socket set for select() */
-		fd_set readSockets;
-		FD_ZERO(&readSockets);
-		FD_SET(mSock, &readSockets);
-
 		/* wait for receive data */
-		const int selectState = select(mSock + 1, &readSockets, NULL, NULL, timeout);
-		if(0 == selectState) {
+		const int pollState = PollSingle(mSock, POLLIN, ToMilliseconds(timeout));
+		if(0 == pollState) {
 			Trace(ZONE_INFO, "Select timed out\n");
 			return true;
 		}
 
-		/* and check if socket was correct */
-		if((1 != selectState) || (!FD_ISSET(mSock, &readSockets))) {
-			throw FatalError("something strange happen in select() called by TcpSocket::Recv()");
+		if(1 != pollState) {
+			throw FatalError("something strange happen in poll() called by ClientSocket::Select() errno: " + std::to_string(errno));
 		}
 		return false;
 	}
 
+	void ClientSocket::BindToInterface(uint32_t interfaceIndex) const throw (FatalError)
+	{
+		if(0 == interfaceIndex) {
+			return;
+		}
+#if defined(SO_BINDTODEVICE)
+		char interfaceName[IF_NAMESIZE];
+		if(NULL == if_indextoname(interfaceIndex, interfaceName)) {
+			throw FatalError("BindToInterface: unknown interface index " + std::to_string(interfaceIndex));
+		}
+		if(0 != setsockopt(mSock, SOL_SOCKET, SO_BINDTODEVICE, interfaceName, strlen(interfaceName))) {
+			throw FatalError("BindToInterface: setsockopt() failed with errno: " + std::to_string(errno));
+		}
+#elif defined(IP_BOUND_IF)
+		const int index = interfaceIndex;
+		if(0 != setsockopt(mSock, IPPROTO_IP, IP_BOUND_IF, &index, sizeof(index))) {
+			throw FatalError("BindToInterface: setsockopt() failed with errno: " + std::to_string(errno));
+		}
+#else
+		Trace(ZONE_WARNING, "Binding to interface %u is not supported on this platform\n", interfaceIndex);
+#endif
+	}
+
 	TcpServerSocket::TcpServerSocket(uint32_t addr, uint16_t port) throw (ConnectionLost, FatalError)
 		: ClientSocket(addr, port, SOCK_STREAM)
 	{
@@ -116,13 +159,11 @@ namespace WyLight {
 	}
 
 	TcpSocket::TcpSocket(int listenSocket, const struct timespec *timeout) throw (ConnectionLost, FatalError)
+		: mState(CONNECTED)
 	{
 		// wait for remote socket to connect
 		if (timeout) {
-			fd_set readfds;
-			FD_ZERO(&readfds);
-			FD_SET(listenSocket, &readfds);
-			if(pselect(listenSocket + 1, &readfds, NULL, NULL, timeout, NULL) <= 0) {
+			if(PollSingle(listenSocket, POLLIN, ToMilliseconds(timeout)) <= 0) {
 				throw FatalError("accept() timed out");
 			}
 		}
@@ -140,14 +181,18 @@ namespace WyLight {
 #endif
 	}
 
-	TcpSocket::TcpSocket(uint32_t addr, uint16_t port) throw (ConnectionLost, FatalError)
-		: ClientSocket(addr, port, SOCK_STREAM)
+	TcpSocket::TcpSocket(uint32_t addr, uint16_t port, uint32_t interfaceIndex, uint32_t connectTimeoutMs) throw (ConnectionLost, FatalError)
+		: ClientSocket(addr, port, SOCK_STREAM), mState(CONNECTING),
+		mConnectDeadline(std::chrono::steady_clock::now() + std::chrono::milliseconds(connectTimeoutMs))
 	{
 		const int yes = 1;
 		//optional, steal port if necessary
 		if(0 != setsockopt(mSock, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes))) {
 			throw FatalError("setsockopt() failed");
 		}
+
+		// route the connection through the interface the remote was discovered on
+		BindToInterface(interfaceIndex);
 		
 		//disable nagle algorithm
 		const int flag = 1;
@@ -161,47 +206,79 @@ namespace WyLight {
 		fcntl(mSock, F_SETFL, socketArgs);
 
 		const int result = connect(mSock, reinterpret_cast<sockaddr *>(&mSockAddr), sizeof(mSockAddr));
-		if(result != 0) {
-			if(errno != EINPROGRESS) {
-				throw ConnectionLost("connect() failed", addr, port);
-			}
+		if((result != 0) && (errno != EINPROGRESS)) {
+			throw ConnectionLost("connect() failed", addr, port);
+		}
+
+#ifdef SO_NOSIGPIPE
+		int set = 1;
+		setsockopt(mSock, SOL_SOCKET, SO_NOSIGPIPE, (void *)&set, sizeof(int));
+#endif
+		if(0 == result) {
+			CompleteConnect(0);
+		}
+	}
 
-			const struct timespec timeout {ESTABLISH_CONNECTION_TIMEOUT, 0};
-			fd_set writefds;
-			FD_ZERO(&writefds);
-			FD_SET(mSock, &writefds);
+	TcpSocket::State TcpSocket::CompleteConnect(int timeoutMs) const
+	{
+		if(CONNECTING != mState) {
+			return mState;
+		}
 
-			// wait for socket to connect
-			if(pselect(mSock + 1, NULL, &writefds, NULL, &timeout, NULL) <= 0) {
-				throw ConnectionLost("connect() failed with timeout", addr, port);
+		// wait for socket to connect
+		const int pollState = PollSingle(mSock, POLLOUT, timeoutMs);
+		if(0 == pollState) {
+			if(std::chrono::steady_clock::now() >= mConnectDeadline) {
+				Trace(ZONE_WARNING, "connect() timed out\n");
+				mState = FAILED;
 			}
+			return mState;
+		}
 
-			// check if error pending on socket
-			int errorStatus;
-			socklen_t option_len = sizeof(errorStatus);
-			if(0 != getsockopt(mSock, SOL_SOCKET, SO_ERROR, &errorStatus, &option_len)) {
-				throw ConnectionLost("connect() failed with mysterious error", addr, port);
-			}
-			if(0 != errorStatus) {
-				throw ConnectionLost("connect() failed with error", addr, port);
-			}
+		// check if error pending on socket
+		int errorStatus;
+		socklen_t option_len = sizeof(errorStatus);
+		if((1 != pollState) || (0 != getsockopt(mSock, SOL_SOCKET, SO_ERROR, &errorStatus, &option_len)) || (0 != errorStatus)) {
+			Trace(ZONE_WARNING, "connect() failed\n");
+			mState = FAILED;
+			return mState;
 		}
+
 		const int restSockArgs = fcntl(mSock, F_GETFL, NULL) & (~O_NONBLOCK);
 		fcntl(mSock, F_SETFL, restSockArgs);
+		mState = CONNECTED;
+		return mState;
+	}
 
-#ifdef SO_NOSIGPIPE
-		int set = 1;
-		setsockopt(mSock, SOL_SOCKET, SO_NOSIGPIPE, (void *)&set, sizeof(int));
-#endif
+	TcpSocket::State TcpSocket::GetState(void) const
+	{
+		return CompleteConnect(0);
+	}
+
+	void TcpSocket::WaitConnected(void) const throw (ConnectionLost)
+	{
+		if(CONNECTED == mState) {
+			return;
+		}
+
+		const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(mConnectDeadline - std::chrono::steady_clock::now()).count();
+		if(CONNECTED != CompleteConnect(std::max<int>(0, remaining))) {
+			if(CONNECTING == mState) {
+				mState = FAILED;
+			}
+			throw ConnectionLost("connect() failed with timeout", ntohl(mSockAddr.sin_addr.s_addr), ntohs(mSockAddr.sin_port));
+		}
 	}
 
 	size_t TcpSocket::Recv(uint8_t *pBuffer, size_t length, timeval *timeout) const throw(FatalError)
 	{
+		WaitConnected();
 		return Select(timeout) ? 0 : recv(mSock, pBuffer, length, 0);
 	}
 
 	size_t TcpSocket::Send(const uint8_t *frame, size_t length) const
 	{
+		WaitConnected();
 		TraceBuffer(ZONE_VERBOSE, frame, length, "%02x ", "Sending on socket 0x%04x, %zu bytes: ", mSock, length);
 		const ssize_t result = send(mSock, frame, length, TCP_SEND_FLAGS);
 		if(result == -1) {
@@ -210,7 +287,22 @@ namespace WyLight {
 		return result;
 	}
 
-	UdpSocket::UdpSocket(uint32_t addr, uint16_t port, bool doBind, int enableBroadcast) throw (FatalError)
+	size_t TcpSocket::Send(const struct iovec *pVector, size_t count) const
+	{
+		WaitConnected();
+		Trace(ZONE_VERBOSE, "Sending %zu buffers on socket 0x%04x\n", count, mSock);
+		struct msghdr msg;
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = const_cast<struct iovec *>(pVector);
+		msg.msg_iovlen = count;
+		const ssize_t result = sendmsg(mSock, &msg, TCP_SEND_FLAGS);
+		if(result == -1) {
+			throw FatalError("sendmsg failed with returnvalue -1 and errno:" + std::to_string(errno));
+		}
+		return result;
+	}
+
+	UdpSocket::UdpSocket(uint32_t addr, uint16_t port, bool doBind, int enableBroadcast, uint32_t interfaceIndex) throw (FatalError)
 		: ClientSocket(addr, port, SOCK_DGRAM)
 	{
 		if(0 != setsockopt(mSock, SOL_SOCKET, SO_BROADCAST, &enableBroadcast, sizeof(enableBroadcast))) {
@@ -223,14 +315,66 @@ namespace WyLight {
 			throw FatalError("setsockopt() failed");
 		}
 
+#ifdef IP_PKTINFO
+		// request the receiving interface of each datagram as ancillary data
+		if(doBind && 0 != setsockopt(mSock, IPPROTO_IP, IP_PKTINFO, &yes, sizeof(yes))) {
+			throw FatalError("setsockopt() failed");
+		}
+#endif
+
+		BindToInterface(interfaceIndex);
+
 		if(doBind && 0 != bind(mSock, reinterpret_cast<struct sockaddr *>(&mSockAddr), sizeof(struct sockaddr))) {
 			throw FatalError("Bind UDP socket failed");
 		}
 	}
 
-	size_t UdpSocket::RecvFrom(uint8_t *pBuffer, size_t length, timeval *timeout, struct sockaddr *remoteAddr, socklen_t *remoteAddrLength) const throw (FatalError)
+	size_t UdpSocket::RecvFrom(uint8_t *pBuffer, size_t length, timeval *timeout, struct sockaddr *remoteAddr, socklen_t *remoteAddrLength, uint32_t *pInterfaceIndex) const throw (FatalError)
 	{
-		return Select(timeout) ? 0 : recvfrom(mSock, pBuffer, length, 0, remoteAddr, remoteAddrLength);
+		if(Select(timeout)) {
+			return 0;
+		}
+
+		iovec payload {pBuffer, length};
+		// the control buffer has to be aligned like the cmsghdr it contains
+		union {
+			cmsghdr align;
+#ifdef IP_PKTINFO
+			uint8_t buffer[CMSG_SPACE(sizeof(in_pktinfo))];
+#else
+			uint8_t buffer[CMSG_SPACE(sizeof(int))];
+#endif
+		} ancillary;
+		msghdr msg;
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_name = remoteAddr;
+		msg.msg_namelen = (NULL == remoteAddrLength) ? 0 : *remoteAddrLength;
+		msg.msg_iov = &payload;
+		msg.msg_iovlen = 1;
+		msg.msg_control = ancillary.buffer;
+		msg.msg_controllen = sizeof(ancillary.buffer);
+
+		const ssize_t bytesRead = recvmsg(mSock, &msg, 0);
+		if(-1 == bytesRead) {
+			Trace(ZONE_WARNING, "recvmsg() failed with errno: %d\n", errno);
+			return 0;
+		}
+
+		if(NULL != remoteAddrLength) {
+			*remoteAddrLength = msg.msg_namelen;
+		}
+
+		if(NULL != pInterfaceIndex) {
+			*pInterfaceIndex = 0;
+#ifdef IP_PKTINFO
+			for(cmsghdr *pCmsg = CMSG_FIRSTHDR(&msg); NULL != pCmsg; pCmsg = CMSG_NXTHDR(&msg, pCmsg)) {
+				if((IPPROTO_IP == pCmsg->cmsg_level) && (IP_PKTINFO == pCmsg->cmsg_type)) {
+					*pInterfaceIndex = reinterpret_cast<const in_pktinfo *>(CMSG_DATA(pCmsg))->ipi_ifindex;
+				}
+			}
+#endif
+		}
+		return bytesRead;
 	}
 
 	size_t UdpSocket::Send(const uint8_t *frame, size_t length) const
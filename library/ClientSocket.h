@@ -21,12 +21,15 @@
 
 #include "WiflyControlException.h"
 
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <ostream>
 #include <stddef.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
 #include <sys/time.h>
+#include <sys/uio.h>
 
 namespace WyLight {
 
@@ -80,11 +83,18 @@ namespace WyLight {
 		/**
 		 * wait for data on the low level socket
 		 * @param timeout to wait for data, to block indefinitly use NULL, which is default
-		 * @return true if select() timed out, false if data is ready
+		 * @return true if the wait timed out, false if data is ready
 		 * @throw FatalError if something very unexpected happens
 		 */
 		bool Select(timeval *timeout) const throw (FatalError);
 
+		/**
+		 * Restrict all traffic of this socket to a single network interface
+		 * @param interfaceIndex of the network interface, 0 leaves the socket unbound
+		 * @throw FatalError if the platform refuses to bind the socket to the interface
+		 */
+		void BindToInterface(uint32_t interfaceIndex) const throw (FatalError);
+
 		/**
 		 * Interface to send a data frame with a given length, you have to implement
 		 * this function in child classes
@@ -128,6 +138,14 @@ namespace WyLight {
 	class TcpSocket : public ClientSocket
 	{
 	public:
+		static const uint32_t DEFAULT_CONNECT_TIMEOUT_MS = 5000;
+
+		enum State {
+			CONNECTING = 0,
+			CONNECTED,
+			FAILED
+		};
+
 		/**
 		 * Create a new TCP socket with accept()
 		 * @param listenSocket file descriptor for the listening socket
@@ -137,13 +155,28 @@ namespace WyLight {
 		TcpSocket(int listenSocket, const struct timespec *timeout = NULL) throw (ConnectionLost, FatalError);
 
 		/**
-		 * Create a new TCP socket with connect()
+		 * Create a new TCP socket and start a non-blocking connect(). The constructor
+		 * returns immediately, the connection is completed on first use or by WaitConnected().
 		 * @param Addr IPv4 address in host byte order
 		 * @param port IPv4 port number in host byte order
+		 * @param interfaceIndex network interface to route the connection through, 0 lets the routing table decide (default)
+		 * @param connectTimeoutMs time in milliseconds the connection may take to establish, measured from construction
 		 * @throw FatalError if the base class constructor fails @see ClientSocket#ClientSocket
-		 * @throw ConnectionLost if connect() fails on the internal socket
+		 * @throw ConnectionLost if connect() fails immediately on the internal socket
 		 */
-		TcpSocket(uint32_t Addr, uint16_t port) throw (ConnectionLost, FatalError);
+		TcpSocket(uint32_t Addr, uint16_t port, uint32_t interfaceIndex = 0, uint32_t connectTimeoutMs = DEFAULT_CONNECT_TIMEOUT_MS) throw (ConnectionLost, FatalError);
+
+		/**
+		 * Check the progress of the connect() without blocking
+		 * @return current state of the connection
+		 */
+		State GetState(void) const;
+
+		/**
+		 * Block until the connection is established or the connect timeout expired
+		 * @throw ConnectionLost if the connection failed or timed out
+		 */
+		void WaitConnected(void) const throw (ConnectionLost);
 
 		/**
 		 * Receive data from the remote socket.
@@ -160,12 +193,33 @@ namespace WyLight {
 		 */
 		virtual size_t Send(const uint8_t *frame, size_t length) const;
 
+		/**
+		 * Send several buffers in order with a single system call
+		 * @param pVector array of buffers to send
+		 * @param count number of buffers in pVector
+		 * @return number of bytes sent
+		 * @throw FatalError if sending failed
+		 */
+		size_t Send(const struct iovec *pVector, size_t count) const;
+
 		/**
 		 * Wrapper to TcpSocket#Send(const uint8_t *frame, size_t length)
 		 */
 		size_t Send(const std::string& msg) const {
 			return Send(reinterpret_cast<const uint8_t*>(msg.data()), msg.length());
 		}
+
+	private:
+		/* GetState() and WaitConnected() might complete the connect() from different threads */
+		mutable std::atomic<State> mState;
+		std::chrono::steady_clock::time_point mConnectDeadline;
+
+		/**
+		 * Poll for the completion of a pending connect()
+		 * @param timeoutMs to wait, 0 to return immediately
+		 * @return updated state of the connection
+		 */
+		State CompleteConnect(int timeoutMs) const;
 	};
 
 /**
@@ -179,9 +233,10 @@ namespace WyLight {
 		 * @param port IPv4 port number in host byte order
 		 * @param doBind set to true to
 		 * @param enableBroadcast use 1 to enable broadcast else set 0 (default)
+		 * @param interfaceIndex network interface to send through, 0 lets the routing table decide (default)
 		 * @throw FatalError if the base class constructor fails
 		 */
-		UdpSocket(uint32_t addr, uint16_t port, bool doBind = true, int enableBroadcast = 0) throw (FatalError);
+		UdpSocket(uint32_t addr, uint16_t port, bool doBind = true, int enableBroadcast = 0, uint32_t interfaceIndex = 0) throw (FatalError);
 
 		/**
 		 * Receive data from the remote socket.
@@ -190,10 +245,11 @@ namespace WyLight {
 		 * @param timeout to wait for data, to block indefinitly use NULL, which is default
 		 * @param remoteAddr pointer to a struct where the senders address should be stored, this param is optional use NULL to ignore it
 		 * @param remoteAddrLength size of the struct remoteAddr is pointing to, after a successfull call with no NULL pointers in remoteAddrLength and remoteAddr it will point to the size of the written remoteAddr struct
+		 * @param pInterfaceIndex optional pointer to store the index of the interface the datagram was received on, 0 if the platform can't tell
 		 * @return number of bytes read into \<pBuffer\>, 0 in case of a timeout
 		 * @throw FatalError if something very unexpected happens
 		 */
-		size_t RecvFrom(uint8_t *pBuffer, size_t length, timeval *timeout = NULL, struct sockaddr *remoteAddr = NULL, socklen_t *remoteAddrLength = NULL) const throw (FatalError);
+		size_t RecvFrom(uint8_t *pBuffer, size_t length, timeval *timeout = NULL, struct sockaddr *remoteAddr = NULL, socklen_t *remoteAddrLength = NULL, uint32_t *pInterfaceIndex = NULL) const throw (FatalError);
 
 		virtual size_t Send(const uint8_t *frame, size_t length) const;
 	};
@@ -0,0 +1,147 @@
+/*
+ Copyright (C) 2013 Nils Weiss, Patrick Bruenn.
+
+ This file is part of Wifly_Light.
+
+ Wifly_Light is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Wifly_Light is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Wifly_Light.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include "unittest.h"
+#include "ClientSocket.h"
+#include "WiflyControl.h"
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/select.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace WyLight;
+
+static const uint32_t g_DebugZones = ZONE_ERROR | ZONE_WARNING | ZONE_INFO | ZONE_VERBOSE;
+
+static const size_t NUM_FILLER_DESCRIPTORS = 2048;
+static const uint16_t TEST_PORT = 34567;
+
+/**
+ * Raise the soft limit of open files, so we can push the next socket descriptors beyond FD_SETSIZE
+ * @return true if the limit is high enough for the stress test
+ */
+static bool RaiseFileLimit(void)
+{
+	rlimit limit;
+	if(0 != getrlimit(RLIMIT_NOFILE, &limit)) {
+		return false;
+	}
+	const rlim_t required = NUM_FILLER_DESCRIPTORS + 64;
+	if(limit.rlim_cur >= required) {
+		return true;
+	}
+	if((RLIM_INFINITY != limit.rlim_max) && (limit.rlim_max < required)) {
+		return false;
+	}
+	limit.rlim_cur = required;
+	return 0 == setrlimit(RLIMIT_NOFILE, &limit);
+}
+
+size_t ut_ClientSocket_RecvTimeout(void)
+{
+	TestCaseBegin();
+	TcpServerSocket server(INADDR_LOOPBACK, TEST_PORT);
+	TcpSocket client(INADDR_LOOPBACK, TEST_PORT);
+	const timespec acceptTimeout {1, 0};
+	TcpSocket accepted(server.GetSocket(), &acceptTimeout);
+
+	uint8_t buffer[8];
+	timeval timeout {0, 10000};
+	CHECK(0 == client.Recv(buffer, sizeof(buffer), &timeout));
+
+	const uint8_t data[] = {0x12, 0x34};
+	CHECK(sizeof(data) == accepted.Send(data, sizeof(data)));
+	timeout = {1, 0};
+	CHECK(sizeof(data) == client.Recv(buffer, sizeof(buffer), &timeout));
+	CHECK(0 == memcmp(data, buffer, sizeof(data)));
+	TestCaseEnd();
+}
+
+size_t ut_ClientSocket_LazyConnect(void)
+{
+	TestCaseBegin();
+	{
+		TcpServerSocket server(INADDR_LOOPBACK, TEST_PORT);
+		Control control(INADDR_LOOPBACK, TEST_PORT, 0, 1000);
+		control.WaitConnected();
+		CHECK(TcpSocket::CONNECTED == control.GetConnectionState());
+	}
+
+	// nobody is listening anymore, construction succeeds, first use reports the failure
+	TcpSocket refused(INADDR_LOOPBACK, TEST_PORT, 0, 1000);
+	bool throws = false;
+	try {
+		refused.WaitConnected();
+	} catch (ConnectionLost& e) {
+		throws = true;
+	}
+	CHECK(throws);
+	CHECK(TcpSocket::FAILED == refused.GetState());
+
+	uint8_t buffer[8];
+	throws = false;
+	try {
+		refused.Recv(buffer, sizeof(buffer));
+	} catch (FatalError& e) {
+		throws = true;
+	}
+	CHECK(throws);
+	TestCaseEnd();
+}
+
+size_t ut_ClientSocket_ManyDescriptors(void)
+{
+	TestCaseBegin();
+	std::vector<int> filler;
+	while(filler.size() < NUM_FILLER_DESCRIPTORS) {
+		const int fd = open("/dev/null", O_RDONLY);
+		CHECK(-1 != fd);
+		if(-1 == fd) break;
+		filler.push_back(fd);
+	}
+
+	{
+		TcpServerSocket server(INADDR_LOOPBACK, TEST_PORT);
+		CHECK(server.GetSocket() >= FD_SETSIZE);
+
+		Control control(INADDR_LOOPBACK, TEST_PORT);
+		const timespec acceptTimeout {1, 0};
+		TcpSocket accepted(server.GetSocket(), &acceptTimeout);
+		CHECK(accepted.GetSocket() >= FD_SETSIZE);
+
+		// pretend to be the firmware answering the sync request
+		const uint8_t ident = FW_IDENT;
+		accepted.Send(&ident, sizeof(ident));
+		CHECK(FW_IDENT == control.GetTargetMode());
+	}
+
+	for(auto fd : filler) {
+		close(fd);
+	}
+	TestCaseEnd();
+}
+
+int main (int argc, const char *argv[])
+{
+	UnitTestMainBegin();
+	RunTest(true, ut_ClientSocket_RecvTimeout);
+	RunTest(true, ut_ClientSocket_LazyConnect);
+	RunTest(RaiseFileLimit(), ut_ClientSocket_ManyDescriptors);
+	UnitTestMainEnd();
+}
@@ -40,10 +40,23 @@ namespace WyLight {
 		gettimeofday(&endTime, NULL);
 		timeval_add(&endTime, pTimeout);
 		UnmaskBuffer recvBuffer {length};
+		size_t bytesUsed;
+
+		/* the previous response might have been received together with the beginning of this one */
+		if(!mPending.empty()) {
+			std::vector<uint8_t> pending;
+			pending.swap(mPending);
+			if(recvBuffer.Unmask(pending.data(), pending.size(), checkCrc, crcInLittleEndian, &bytesUsed)) {
+				mPending.assign(pending.begin() + bytesUsed, pending.end());
+				memcpy(pBuffer, recvBuffer.Data(), recvBuffer.Size());
+				return recvBuffer.Size();
+			}
+		}
 
 		do {
 			const size_t bytesMasked = mSock.Recv(pBuffer, length - recvBuffer.Size(), pTimeout);
-			if(recvBuffer.Unmask(pBuffer, bytesMasked, checkCrc, crcInLittleEndian)) {
+			if(recvBuffer.Unmask(pBuffer, bytesMasked, checkCrc, crcInLittleEndian, &bytesUsed)) {
+				mPending.assign(pBuffer + bytesUsed, pBuffer + bytesMasked);
 				memcpy(pBuffer, recvBuffer.Data(), recvBuffer.Size());
 				return recvBuffer.Size();
 			}
@@ -64,6 +77,38 @@ namespace WyLight {
 		return Send(cmd.GetData(), cmd.GetSize(), reinterpret_cast<uint8_t *>(pResponse), responseSize, true, false, false);
 	}
 
+	void ComProxy::Send(const EncodedCommand *pCommands, size_t numCommands, response_frame *pResponses, size_t *pBytesRead) const throw(ConnectionTimeout, FatalError)
+	{
+		mPending.clear();
+		Write(pCommands, numCommands);
+
+		for(size_t i = 0; i < numCommands; ++i) {
+			pBytesRead[i] = RecvResponse(pResponses + i);
+		}
+	}
+
+	void ComProxy::Write(const EncodedCommand *pCommands, size_t numCommands) const throw(FatalError)
+	{
+		std::vector<iovec> frames(numCommands);
+		size_t numBytes = 0;
+		for(size_t i = 0; i < numCommands; ++i) {
+			frames[i].iov_base = const_cast<uint8_t *>(pCommands[i].Data());
+			frames[i].iov_len = pCommands[i].Size();
+			numBytes += pCommands[i].Size();
+		}
+
+		if(numBytes != mSock.Send(frames.data(), frames.size())) {
+			throw FatalError("mSock.Send() failed");
+		}
+	}
+
+	size_t ComProxy::RecvResponse(response_frame *pResponse) const throw(ConnectionTimeout)
+	{
+		/* firmware responses use a big endian crc */
+		timeval timeout = RESPONSE_TIMEOUT;
+		return Recv(reinterpret_cast<uint8_t *>(pResponse), sizeof(response_frame), &timeout, true, false);
+	}
+
 	size_t ComProxy::Send(const uint8_t *pRequest, const size_t requestSize, uint8_t *pResponse, size_t responseSize, bool checkCrc, bool doSync, bool crcInLittleEndian) const throw(ConnectionTimeout, FatalError)
 	{
 		if(doSync) {
@@ -72,6 +117,9 @@ namespace WyLight {
 			}
 		}
 
+		/* a new request, anything left from previous responses is outdated */
+		mPending.clear();
+
 		/* mask control characters in request and add crc */
 		MaskBuffer maskBuffer {BL_MAX_MESSAGE_LENGTH};
 		maskBuffer.Mask(pRequest, pRequest + requestSize, crcInLittleEndian);
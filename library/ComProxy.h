@@ -21,10 +21,13 @@
 
 #include "BlRequest.h"
 #include "ClientSocket.h"
+#include "EncodedCommand.h"
 #include "trace.h"
 #include "FwCommand.h"
 #include "wifly_cmd.h"
 
+#include <vector>
+
 namespace WyLight {
 
 	class ComProxy
@@ -59,6 +62,35 @@ namespace WyLight {
 		 */
 		size_t Send(const FwCommand& request, response_frame *pResponse, size_t responseSize) const throw(ConnectionTimeout, FatalError);
 
+		/*
+		 * Send already encoded firmware commands with a single vectored write and
+		 * receive their responses afterwards
+		 * @param pCommands array of encoded commands, each of them has to require a response
+		 * @param numCommands number of commands in pCommands
+		 * @param pResponses array of numCommands buffers for the response frames
+		 * @param pBytesRead array to store the number of bytes read into each response or 0 if its crc check fails
+		 * @throw ConnectionTimeout if a timeout occurred
+		 * @throw FatalError if sending to socket failed
+		 */
+		void Send(const EncodedCommand *pCommands, size_t numCommands, response_frame *pResponses, size_t *pBytesRead) const throw(ConnectionTimeout, FatalError);
+
+		/*
+		 * Send already encoded firmware commands with a single vectored write.
+		 * Responses aren't read, use RecvResponse() to collect them in order.
+		 * @param pCommands array of encoded commands
+		 * @param numCommands number of commands in pCommands
+		 * @throw FatalError if sending to socket failed
+		 */
+		void Write(const EncodedCommand *pCommands, size_t numCommands) const throw(FatalError);
+
+		/*
+		 * Receive the next response frame of the firmware
+		 * @param pResponse pointer to buffer for the response frame
+		 * @return number of bytes read into pResponse or 0 if crc check fails
+		 * @throw ConnectionTimeout if a timeout occurred
+		 */
+		size_t RecvResponse(response_frame *pResponse) const throw(ConnectionTimeout);
+
 		/*
 		 * Send a byte sequence to force a uart baud rate synchronisation between WLAN module and PIC
 		 * @return mode of target: BL_IDENT for Bootloader mode, FW_IDENT for Firmware mode
@@ -72,6 +104,11 @@ namespace WyLight {
 		 */
 		const TcpSocket& mSock;
 
+		/*
+		 * Bytes received after the end of a response, they belong to the next pipelined response
+		 */
+		mutable std::vector<uint8_t> mPending;
+
 		/*
 		 * Receive data on the TcpSocket @see mSock, unmask the control characters and write the plain message into pBuffer
 		 * @param pBuffer to store the read data
@@ -33,6 +33,15 @@ using namespace WyLight;
 #define CRC_SIZE 2
 static const uint32_t g_DebugZones = ZONE_ERROR | ZONE_WARNING | ZONE_INFO | ZONE_VERBOSE;
 
+const std::string FwCmdSetFade::TOKEN("fade");
+const std::string FwCmdSetGradient::TOKEN("gradient");
+const std::string FwCmdLoopOn::TOKEN("loop");
+const std::string FwCmdLoopOff::TOKEN("loop_off");
+const std::string FwCmdWait::TOKEN("wait");
+
+const size_t FwCmdScript::INDENTATION_MAX;
+const char FwCmdScript::INDENTATION_CHARACTER;
+
 ClientSocket::ClientSocket(uint32_t addr, uint16_t port, int style) throw (FatalError) : mSock(0), mSockAddr(addr, port) {}
 ClientSocket::~ClientSocket(void) {}
 
@@ -49,6 +58,8 @@ const uint8_t dummyBlFlashEraseResponsePure[] = {0x03};
 uint8_t g_TestSocketRecvBuffer[10240];
 size_t g_TestSocketRecvBufferPos = 0;
 size_t g_TestSocketRecvBufferSize = 0;
+size_t g_TestSocketRecvChunkSize = 1;
+size_t g_TestSocketNumVectoredSends = 0;
 uint8_t g_TestSocketSendBuffer[10240];
 size_t g_TestSocketSendBufferPos = 0;
 timespec g_TestSocketSendDelay;
@@ -73,19 +84,49 @@ ClientSocket::ClientSocket()
 
 
 /**
- * For each call to Recv() we only return one byte of data to simulate a very
- * fragmented response from pic.
+ * For each call to Recv() we only return one byte of data by default to simulate
+ * a very fragmented response from pic. Set g_TestSocketRecvChunkSize to receive
+ * several pipelined responses at once.
  */
 size_t TcpSocket::Recv(uint8_t *pBuffer, size_t length, timeval *timeout) const throw (FatalError)
 {
 	nanosleep(&g_TestSocketSendDelay, NULL);
 	Trace(ZONE_VERBOSE, "%p %u of %u wait for %u\n", pBuffer, g_TestSocketRecvBufferPos, g_TestSocketRecvBufferSize, length);
-	if(g_TestSocketRecvBufferPos < g_TestSocketRecvBufferSize) {
-		*pBuffer = g_TestSocketRecvBuffer[g_TestSocketRecvBufferPos];
-		g_TestSocketRecvBufferPos++;
-		return 1;
+	const size_t bytesRead = std::min(std::min(length, g_TestSocketRecvChunkSize), g_TestSocketRecvBufferSize - g_TestSocketRecvBufferPos);
+	memcpy(pBuffer, g_TestSocketRecvBuffer + g_TestSocketRecvBufferPos, bytesRead);
+	g_TestSocketRecvBufferPos += bytesRead;
+	return bytesRead;
+}
+
+/**
+ * Vectored writes carry firmware commands, each of them is answered with OK
+ */
+size_t TcpSocket::Send(const struct iovec *pVector, size_t count) const
+{
+	++g_TestSocketNumVectoredSends;
+	g_TestSocketRecvBufferPos = 0;
+	g_TestSocketRecvBufferSize = 0;
+	size_t numBytes = 0;
+	for(size_t i = 0; i < count; ++i) {
+		const uint8_t *const pFrame = reinterpret_cast<const uint8_t *>(pVector[i].iov_base);
+		memcpy(g_TestSocketSendBuffer + g_TestSocketSendBufferPos, pFrame, pVector[i].iov_len);
+		g_TestSocketSendBufferPos += pVector[i].iov_len;
+		numBytes += pVector[i].iov_len;
+
+		UnmaskBuffer request {BL_MAX_MESSAGE_LENGTH};
+		request.Unmask(pFrame, pVector[i].iov_len, true, false);
+
+		response_frame response;
+		response.length = sizeof(uns8) + sizeof(uns16) + sizeof(ErrorCode);
+		response.cmd = request.Data()[0];
+		response.state = OK;
+		const uint8_t *const pResponse = reinterpret_cast<const uint8_t *>(&response);
+		MaskBuffer masked {BL_MAX_MESSAGE_LENGTH};
+		masked.Mask(pResponse, pResponse + response.length, false);
+		memcpy(g_TestSocketRecvBuffer + g_TestSocketRecvBufferSize, masked.Data(), masked.Size());
+		g_TestSocketRecvBufferSize += masked.Size();
 	}
-	return 0;
+	return numBytes;
 }
 
 size_t TcpSocket::Send(const uint8_t *frame, size_t length) const
@@ -359,6 +400,45 @@ size_t ut_ComProxy_BlFuseWriteRequest(void)
 	NOT_IMPLEMENTED();
 }
 
+size_t ut_ComProxy_EncodedCommands(void)
+{
+	TestCaseBegin();
+	TcpSocket dummySock(0, 0);
+	ComProxy testee(dummySock);
+
+	/* an encoded command holds the same frame ComProxy::Send(const FwCommand&) would mask */
+	FwCmdSetFade fade(0xff102030, 100, 0x0000ffff, false);
+	const EncodedCommand encoded(fade);
+	MaskBuffer masked {BL_MAX_MESSAGE_LENGTH};
+	masked.Mask(fade.GetData(), fade.GetData() + fade.GetSize(), false);
+	CHECK(masked.Size() == encoded.Size());
+	CHECK(0 == memcmp(masked.Data(), encoded.Data(), encoded.Size()));
+	CHECK(SET_FADE == encoded.GetType());
+	CHECK(encoded.IsResponseRequired());
+
+	/* all frames leave in one write, their responses arrive in one chunk */
+	const EncodedSequence sequence {encoded, EncodedCommand(FwCmdWait(10)), encoded, EncodedCommand(FwCmdClearScript())};
+	response_frame responses[4];
+	size_t bytesRead[4];
+	g_TestSocketNumVectoredSends = 0;
+	g_TestSocketSendBufferPos = 0;
+	g_TestSocketRecvChunkSize = sizeof(g_TestSocketRecvBuffer);
+	testee.Send(sequence.data(), sequence.size(), responses, bytesRead);
+	g_TestSocketRecvChunkSize = 1;
+	CHECK(1 == g_TestSocketNumVectoredSends);
+
+	size_t pos = 0;
+	for(size_t i = 0; i < sequence.size(); ++i) {
+		CHECK(0 == memcmp(sequence[i].Data(), g_TestSocketSendBuffer + pos, sequence[i].Size()));
+		pos += sequence[i].Size();
+		CHECK(sizeof(uns8) + sizeof(uns16) + sizeof(ErrorCode) == bytesRead[i]);
+		CHECK(sequence[i].GetType() == responses[i].cmd);
+		CHECK(OK == responses[i].state);
+	}
+	CHECK(pos == g_TestSocketSendBufferPos);
+	TestCaseEnd();
+}
+
 size_t ut_ComProxy_BlInfoRequest(void)
 {
 	TestCaseBegin();
@@ -405,6 +485,7 @@ int main (int argc, const char *argv[])
 	RunTest(false, ut_ComProxy_BlFuseWriteRequest);
 	RunTest(true,  ut_ComProxy_BlInfoRequest);
 	RunTest(true,  ut_ComProxy_BlRunAppRequest);
+	RunTest(true,  ut_ComProxy_EncodedCommands);
 	RunTest(true,  ut_ComProxy_SyncWithTarget);
 	UnitTestMainEnd();
 }
@@ -0,0 +1,156 @@
+/*
+ Copyright (C) 2013 Nils Weiss, Patrick Bruenn.
+
+ This file is part of Wifly_Light.
+
+ Wifly_Light is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Wifly_Light is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Wifly_Light.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include "CompiledScript.h"
+#include "crc.h"
+#include "trace.h"
+
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace WyLight {
+
+	static const uint32_t g_DebugZones = ZONE_ERROR | ZONE_WARNING | ZONE_INFO | ZONE_VERBOSE;
+	static const uint8_t MAGIC[4] = {'W', 'Y', 'S', 'C'};
+
+	const std::string CompiledScript::EXTENSION {".wyscriptc"};
+	const uint16_t CompiledScript::FORMAT_VERSION;
+
+	static uint16_t BuildCrc(const uint8_t *pData, size_t length, uint16_t crc = 0)
+	{
+		for(const uint8_t *const pEnd = pData + length; pData < pEnd; ++pData) {
+			Crc_AddCrc16(*pData, &crc);
+		}
+		return crc;
+	}
+
+	static bool IsScriptCommand(uint8_t type)
+	{
+		return (SET_FADE == type) || (SET_GRADIENT == type) || (WAIT == type) || (LOOP_ON == type) || (LOOP_OFF == type);
+	}
+
+	CompiledScript::CompiledScript(const std::string& filename) throw (FatalError)
+		: mMapping(MAP_FAILED), mMappingSize(0), mCommands(NULL), mNumCommands(0)
+	{
+		const int fd = open(filename.c_str(), O_RDONLY);
+		if(-1 == fd) {
+			throw FatalError("Open '" + filename + "' to read compiled script failed");
+		}
+
+		struct stat fileStat;
+		if((0 != fstat(fd, &fileStat)) || (fileStat.st_size < (off_t)sizeof(Header))) {
+			close(fd);
+			throw FatalError("'" + filename + "' is too small for a compiled script");
+		}
+
+		mMappingSize = fileStat.st_size;
+		mMapping = mmap(NULL, mMappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if(MAP_FAILED == mMapping) {
+			throw FatalError("mmap() '" + filename + "' failed");
+		}
+
+		const uint8_t *const pData = reinterpret_cast<const uint8_t *>(mMapping);
+		const Header& header = *reinterpret_cast<const Header *>(pData);
+		const size_t nameLength = ntohs(header.nameLength);
+		mNumCommands = ntohl(header.numCommands);
+
+		std::string error;
+		if(0 != memcmp(header.magic, MAGIC, sizeof(MAGIC))) {
+			error = "is no compiled script";
+		} else if(FORMAT_VERSION != ntohs(header.version)) {
+			error = "has unsupported version";
+		} else if((uint64_t)mMappingSize != sizeof(Header) + nameLength + (uint64_t)mNumCommands * sizeof(ScriptCommand)) {
+			error = "has an invalid size";
+		} else if(ntohs(header.crc) != BuildCrc(pData + sizeof(Header), mMappingSize - sizeof(Header))) {
+			error = "is corrupted";
+		}
+
+		if(error.empty()) {
+			mName.assign(reinterpret_cast<const char *>(pData + sizeof(Header)), nameLength);
+			mCommands = reinterpret_cast<const ScriptCommand *>(pData + sizeof(Header) + nameLength);
+			for(const auto& cmd : *this) {
+				if(!IsScriptCommand(cmd.GetType())) {
+					error = "contains an invalid command";
+					break;
+				}
+			}
+		}
+
+		if(!error.empty()) {
+			munmap(mMapping, mMappingSize);
+			throw FatalError("'" + filename + "' " + error);
+		}
+		Trace(ZONE_VERBOSE, "mapped '%s' with %zu commands\n", filename.c_str(), mNumCommands);
+	}
+
+	CompiledScript::~CompiledScript(void)
+	{
+		munmap(mMapping, mMappingSize);
+	}
+
+	Script CompiledScript::ToScript(void) const
+	{
+		Script script;
+		script.setName(mName);
+		script.reserve(mNumCommands);
+		for(const auto& cmd : *this) {
+			script.push_back(cmd);
+		}
+		return script;
+	}
+
+	void CompiledScript::Compile(const Script& script, const std::string& filename) throw (FatalError)
+	{
+		const std::string& name = script.getName();
+		if(name.size() > 0xffff) {
+			throw FatalError("Script name is too long to compile '" + filename + "'");
+		}
+
+		uint16_t crc = BuildCrc(reinterpret_cast<const uint8_t *>(name.data()), name.size());
+		for(const auto& cmd : script) {
+			crc = BuildCrc(reinterpret_cast<const uint8_t *>(&cmd), sizeof(cmd), crc);
+		}
+
+		Header header;
+		memcpy(header.magic, MAGIC, sizeof(MAGIC));
+		header.version = htons(FORMAT_VERSION);
+		header.nameLength = htons((uint16_t)name.size());
+		header.numCommands = htonl((uint32_t)script.size());
+		header.crc = htons(crc);
+		header.reserved = 0;
+
+		std::ofstream outFile(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+		if(!outFile.is_open()) {
+			throw FatalError("Open '" + filename + "' to save compiled script failed");
+		}
+		outFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		outFile.write(name.data(), name.size());
+		// the records are stored contiguous, so they can be written at once
+		if(script.size() > 0) {
+			outFile.write(reinterpret_cast<const char *>(&*script.begin()), script.size() * sizeof(ScriptCommand));
+		}
+		outFile.close();
+		if(outFile.fail()) {
+			throw FatalError("Writing compiled script '" + filename + "' failed");
+		}
+	}
+} /* namespace WyLight */
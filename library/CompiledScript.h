@@ -0,0 +1,92 @@
+/*
+ Copyright (C) 2013 Nils Weiss, Patrick Bruenn.
+
+ This file is part of Wifly_Light.
+
+ Wifly_Light is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Wifly_Light is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Wifly_Light.  If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef __WyLight__CompiledScript__
+#define __WyLight__CompiledScript__
+
+#include "Script.h"
+#include "WiflyControlException.h"
+
+#include <stdint.h>
+#include <string>
+
+namespace WyLight {
+
+	/******************************************************************************/
+	/*! \file CompiledScript.h
+	 * \brief Read only, memory mapped script in binary format
+	 *
+	 * Layout of a compiled script file, all numbers in network byte order:
+	 * - Header: magic "WYSC", version, length of the name, number of commands,
+	 *   CRC16 over name and commands
+	 * - name of the script, not zero terminated
+	 * - commands as ScriptCommand records, which are the frames send to the firmware
+	 *
+	 * The file is mapped into memory and its commands are uploaded as they are,
+	 * nothing is parsed or encoded again.
+	 *******************************************************************************/
+	class CompiledScript
+	{
+	public:
+		struct __attribute__((__packed__)) Header {
+			uint8_t magic[4];
+			uint16_t version;
+			uint16_t nameLength;
+			uint32_t numCommands;
+			uint16_t crc;
+			uint16_t reserved;
+		};
+
+		static const std::string EXTENSION;
+		static const uint16_t FORMAT_VERSION = 2;
+
+		/**
+		 * Map <filename> into memory and validate it
+		 * @throw FatalError if the file can't be mapped, is truncated, has an unknown
+		 *        version or a checksum mismatch
+		 */
+		CompiledScript(const std::string& filename) throw (FatalError);
+		CompiledScript(const CompiledScript&) = delete;
+		CompiledScript& operator=(const CompiledScript&) = delete;
+		~CompiledScript(void);
+
+		const ScriptCommand *begin(void) const { return mCommands; };
+		const ScriptCommand *end(void) const { return mCommands + mNumCommands; };
+		size_t size(void) const { return mNumCommands; };
+		const std::string& getName(void) const { return mName; };
+
+		/**
+		 * Convert back into a Script, f.e. to save it as text again
+		 */
+		Script ToScript(void) const;
+
+		/**
+		 * Write <script> in the compiled binary format to <filename>
+		 * @throw FatalError if writing the file failed or the script name is too long
+		 */
+		static void Compile(const Script& script, const std::string& filename) throw (FatalError);
+
+	private:
+		void *mMapping;
+		size_t mMappingSize;
+		const ScriptCommand *mCommands;
+		size_t mNumCommands;
+		std::string mName;
+	};
+} /* namespace WyLight */
+#endif /* #ifndef __WyLight__CompiledScript__ */
@@ -0,0 +1,136 @@
+/*
+ Copyright (C) 2013 Nils Weiss, Patrick Bruenn.
+
+ This file is part of Wifly_Light.
+
+ Wifly_Light is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Wifly_Light is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Wifly_Light.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include "unittest.h"
+#include "CompiledScript.h"
+#include <cstdio>
+#include <fstream>
+#include <unistd.h>
+
+using namespace WyLight;
+
+static const uint32_t g_DebugZones = ZONE_ERROR | ZONE_WARNING | ZONE_INFO | ZONE_VERBOSE;
+
+const std::string FwCmdSetFade::TOKEN("fade");
+const std::string FwCmdSetGradient::TOKEN("gradient");
+const std::string FwCmdLoopOn::TOKEN("loop");
+const std::string FwCmdLoopOff::TOKEN("loop_off");
+const std::string FwCmdWait::TOKEN("wait");
+
+const size_t FwCmdScript::INDENTATION_MAX;
+const char FwCmdScript::INDENTATION_CHARACTER;
+
+static const std::string COMPILED_FILE {"./binary/TestOutput" + CompiledScript::EXTENSION};
+
+/**
+ * Overwrite one byte of <filename> at <offset>
+ */
+static void Corrupt(const std::string& filename, size_t offset, char value)
+{
+	std::fstream file(filename, std::ios::in | std::ios::out | std::ios::binary);
+	file.seekp(offset);
+	file.put(value);
+}
+
+static bool Throws(const std::string& filename)
+{
+	try {
+		CompiledScript compiled(filename);
+	} catch (FatalError& e) {
+		return true;
+	}
+	return false;
+}
+
+size_t ut_CompiledScript_RoundTrip(void)
+{
+	TestCaseBegin();
+	const Script refScript("TestInput2.txt");
+	CompiledScript::Compile(refScript, COMPILED_FILE);
+
+	CompiledScript compiled(COMPILED_FILE);
+	CHECK(refScript.size() == compiled.size());
+	CHECK(0 == compiled.getName().compare("TestInput Version One"));
+
+	auto refCmd = refScript.begin();
+	for(const auto& cmd : compiled) {
+		CHECK(*refCmd++ == cmd);
+	}
+
+	// compiled commands are the frames we send to the firmware
+	const FwCmdSetFade refFade(0x112233, 100, 0x1234, true);
+	CHECK(refFade.GetSize() == compiled.begin()[2].GetSize());
+	CHECK(0 == memcmp(refFade.GetData(), compiled.begin()[2].GetData(), refFade.GetSize()));
+
+	Script decompiled = compiled.ToScript();
+	CHECK(refScript == decompiled);
+	CHECK(refScript.getName() == decompiled.getName());
+	TestCaseEnd();
+}
+
+size_t ut_CompiledScript_EmptyScript(void)
+{
+	TestCaseBegin();
+	Script empty;
+	CompiledScript::Compile(empty, COMPILED_FILE);
+	CompiledScript compiled(COMPILED_FILE);
+	CHECK(0 == compiled.size());
+	CHECK(compiled.begin() == compiled.end());
+	CHECK(compiled.getName().empty());
+	TestCaseEnd();
+}
+
+size_t ut_CompiledScript_Invalid(void)
+{
+	TestCaseBegin();
+	const Script refScript("TestInput.txt");
+	const size_t nameLength = refScript.getName().size();
+	const size_t firstCommand = sizeof(CompiledScript::Header) + nameLength;
+
+	CHECK(Throws("./binary/NonExisting" + CompiledScript::EXTENSION));
+	CHECK(Throws("TestInput.txt"));
+
+	CompiledScript::Compile(refScript, COMPILED_FILE);
+	CHECK(!Throws(COMPILED_FILE));
+
+	// flipped bit in a command
+	Corrupt(COMPILED_FILE, firstCommand + sizeof(ScriptCommand) + 3, 0x7f);
+	CHECK(Throws(COMPILED_FILE));
+
+	// unknown version
+	CompiledScript::Compile(refScript, COMPILED_FILE);
+	Corrupt(COMPILED_FILE, 5, CompiledScript::FORMAT_VERSION + 1);
+	CHECK(Throws(COMPILED_FILE));
+
+	// truncated
+	CompiledScript::Compile(refScript, COMPILED_FILE);
+	CHECK(0 == truncate(COMPILED_FILE.c_str(), firstCommand + 5));
+	CHECK(Throws(COMPILED_FILE));
+
+	std::remove(COMPILED_FILE.c_str());
+	TestCaseEnd();
+}
+
+int main (int argc, const char *argv[])
+{
+	UnitTestMainBegin();
+	RunTest(true, ut_CompiledScript_RoundTrip);
+	RunTest(true, ut_CompiledScript_EmptyScript);
+	RunTest(true, ut_CompiledScript_Invalid);
+	UnitTestMainEnd();
+}
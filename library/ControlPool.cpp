@@ -0,0 +1,128 @@
+/*
+ Copyright (C) 2013 Nils Weiss, Patrick Bruenn.
+
+ This file is part of Wifly_Light.
+
+ Wifly_Light is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Wifly_Light is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Wifly_Light.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include "ControlPool.h"
+#include "trace.h"
+#include <algorithm>
+#include <thread>
+
+namespace WyLight {
+
+	static const uint32_t g_DebugZones = ZONE_ERROR | ZONE_WARNING | ZONE_INFO;
+
+	ControlPool::ControlPool(size_t maxConnections) : mMaxConnections(maxConnections) {}
+
+	ControlPool::~ControlPool(void)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		if(mPending.empty()) {
+			return;
+		}
+
+		// warm ups of offline endpoints last until the connect timeout, don't block the caller on them
+		std::thread reaper([](std::map<uint64_t, std::future<WarmConnection> > pending) {
+			for(auto& unused : pending) {
+				// an unused connection is closed with its WarmConnection
+				unused.second.wait();
+			}
+		}, std::move(mPending));
+		reaper.detach();
+	}
+
+	size_t ControlPool::WarmUp(const std::vector<Endpoint>& recent)
+	{
+		std::vector<Endpoint> candidates(recent);
+		std::stable_sort(candidates.begin(), candidates.end(), [](const Endpoint& lhs, const Endpoint& rhs) {
+			return lhs.GetScore() > rhs.GetScore();
+		});
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		size_t numStarted = 0;
+		for(const auto& remote : candidates) {
+			if(mPending.size() >= mMaxConnections) {
+				break;
+			}
+			if(!remote.IsValid() || (0 == remote.GetScore()) || (mPending.count(remote.AsUint64()) > 0)) {
+				continue;
+			}
+			Trace(ZONE_INFO, "warm up %08x:%u\n", remote.GetIp(), remote.GetPort());
+			mPending[remote.AsUint64()] = std::async(std::launch::async, &ControlPool::Connect, remote);
+			++numStarted;
+		}
+		return numStarted;
+	}
+
+	size_t ControlPool::WarmUp(BroadcastReceiver& receiver)
+	{
+		std::vector<Endpoint> recent;
+		for(size_t i = 0; i < receiver.NumRemotes(); ++i) {
+			recent.push_back(receiver.GetEndpoint(i));
+		}
+		return WarmUp(recent);
+	}
+
+	std::unique_ptr<Control> ControlPool::Acquire(const Endpoint& remote, uint16_t *pFwVersion) throw (ConnectionLost, FatalError)
+	{
+		std::future<WarmConnection> pending;
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			auto it = mPending.find(remote.AsUint64());
+			if(mPending.end() != it) {
+				pending = std::move(it->second);
+				mPending.erase(it);
+			}
+		}
+
+		if(pending.valid()) {
+			try {
+				WarmConnection warm = pending.get();
+				if(pFwVersion) *pFwVersion = warm.fwVersion;
+				return std::move(warm.control);
+			} catch(std::exception& e) {
+				Trace(ZONE_WARNING, "warm up of %08x:%u failed: %s, reconnecting\n", remote.GetIp(), remote.GetPort(), e.what());
+			}
+		}
+
+		if(pFwVersion) *pFwVersion = 0;
+		std::unique_ptr<Control> control(new Control(remote.GetIp(), remote.GetPort(), remote.GetInterface()));
+		control->WaitConnected();
+		return control;
+	}
+
+	size_t ControlPool::NumPending(void) const
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		return mPending.size();
+	}
+
+	ControlPool::WarmConnection ControlPool::Connect(const Endpoint remote)
+	{
+		WarmConnection warm {std::unique_ptr<Control>(new Control(remote.GetIp(), remote.GetPort(), remote.GetInterface())), 0, 0};
+		warm.control->WaitConnected();
+		try {
+			warm.mode = warm.control->GetTargetMode();
+			if(FW_IDENT == warm.mode) {
+				warm.fwVersion = warm.control->FwGetVersion();
+			}
+		} catch(std::exception& e) {
+			// the connection itself is established, leave the rest to the StartupManager
+			Trace(ZONE_WARNING, "probing %08x:%u failed: %s\n", remote.GetIp(), remote.GetPort(), e.what());
+		}
+		return warm;
+	}
+}
@@ -0,0 +1,109 @@
+/*
+ Copyright (C) 2013 Nils Weiss, Patrick Bruenn.
+
+ This file is part of Wifly_Light.
+
+ Wifly_Light is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Wifly_Light is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Wifly_Light.  If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef _CONTROL_POOL_H_
+#define _CONTROL_POOL_H_
+
+#include "BroadcastReceiver.h"
+#include "Endpoint.h"
+#include "WiflyControl.h"
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <vector>
+
+namespace WyLight {
+
+	/******************************************************************************/
+	/*! \file ControlPool.h
+	 * \brief Speculative pre-connect to recently used endpoints
+	 *
+	 * Opens connections to the top-scored recent endpoints in parallel and probes
+	 * their operation mode and firmware version, while the application is still
+	 * waiting for a broadcast or user input. Acquire() hands out the already
+	 * connected Control or falls back to a regular connect.
+	 *******************************************************************************/
+	class ControlPool
+	{
+	public:
+		static const size_t DEFAULT_POOL_SIZE = 3;
+
+		/**
+		 * @param maxConnections number of endpoints to pre-connect to in WarmUp()
+		 */
+		ControlPool(size_t maxConnections = DEFAULT_POOL_SIZE);
+		ControlPool(const ControlPool& other) = delete;
+		ControlPool& operator=(const ControlPool& other) = delete;
+
+		/**
+		 * Returns immediately, pending connection attempts finish in the background
+		 * and all connections which were never acquired are closed there
+		 */
+		~ControlPool(void);
+
+		/**
+		 * Start connecting in parallel to the top-scored endpoints. Endpoints with a score
+		 * of zero (never used) or already warming up are skipped.
+		 * @param recent candidates, usually the recent endpoints of a BroadcastReceiver
+		 * @return number of connection attempts started
+		 */
+		size_t WarmUp(const std::vector<Endpoint>& recent);
+
+		/**
+		 * Start connecting to the recent endpoints known to <receiver>
+		 * @see WarmUp(const std::vector<Endpoint>&)
+		 */
+		size_t WarmUp(BroadcastReceiver& receiver);
+
+		/**
+		 * Hand out a connection to <remote>. If a warm up for <remote> is still in progress
+		 * this call blocks until it completed. If no warm up was started or it failed a new
+		 * connection is established the regular way.
+		 * @param remote endpoint to connect to
+		 * @param pFwVersion if not NULL, receives the firmware version probed during warm up, 0 if unknown or target is in bootloader mode
+		 * @return a connected Control, ownership is passed to the caller
+		 * @throw ConnectionLost, FatalError if the fallback connect fails
+		 */
+		std::unique_ptr<Control> Acquire(const Endpoint& remote, uint16_t *pFwVersion = NULL) throw (ConnectionLost, FatalError);
+
+		/**
+		 * @return number of warm ups not yet acquired
+		 */
+		size_t NumPending(void) const;
+
+	private:
+		struct WarmConnection {
+			std::unique_ptr<Control> control;
+			size_t mode;
+			uint16_t fwVersion;
+		};
+
+		const size_t mMaxConnections;
+		std::map<uint64_t, std::future<WarmConnection> > mPending;
+		mutable std::mutex mMutex;
+
+		/**
+		 * Connect to <remote> and probe mode and firmware version, executed asynchronously
+		 * @throw anything Control throws on connect, the exception is delivered by the future
+		 */
+		static WarmConnection Connect(const Endpoint remote);
+	};
+}
+#endif /* #ifndef _CONTROL_POOL_H_ */
@@ -0,0 +1,200 @@
+/*
+ Copyright (C) 2013 Nils Weiss, Patrick Bruenn.
+
+ This file is part of Wifly_Light.
+
+ Wifly_Light is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Wifly_Light is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Wifly_Light.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include "trace.h"
+#include "unittest.h"
+#include "ControlPool.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace WyLight {
+
+	static const uint32_t g_DebugZones = ZONE_ERROR | ZONE_WARNING | ZONE_INFO | ZONE_VERBOSE;
+
+	static const uint32_t UNREACHABLE_IP = 0x0a00000f;
+	static const uint32_t SLOW_IP = 0x0a000010;
+	static const std::chrono::milliseconds SLOW_CONNECT(500);
+	static const uint16_t TEST_FW_VERSION = 0x0102;
+	static std::atomic<size_t> g_NumConnects(0);
+	static std::atomic<size_t> g_NumSlowConnects(0);
+	static std::vector<Endpoint> g_RecentEndpoints;
+
+	/***** Wrappers ****/
+	ClientSocket::ClientSocket(uint32_t addr, uint16_t port, int style) throw (FatalError) : mSock(0), mSockAddr(addr, port) {}
+	ClientSocket::~ClientSocket(void) {}
+	TcpSocket::TcpSocket(uint32_t addr, uint16_t port, uint32_t interfaceIndex, uint32_t connectTimeoutMs) throw (ConnectionLost, FatalError) : ClientSocket(addr, port, 0) {}
+	size_t TcpSocket::Send(const uint8_t *frame, size_t length) const {
+		return length;
+	}
+	UdpSocket::UdpSocket(uint32_t addr, uint16_t port, bool doBind, int enableBroadcast, uint32_t interfaceIndex) throw (FatalError) : ClientSocket(addr, port, SOCK_DGRAM) {}
+	size_t UdpSocket::Send(const uint8_t *frame, size_t length) const {
+		return length;
+	}
+	ComProxy::ComProxy(const TcpSocket& sock) : mSock (sock) {}
+	TelnetProxy::TelnetProxy(const TcpSocket& sock) : mSock (sock) {}
+
+	Control::Control(uint32_t addr, uint16_t port, uint32_t interfaceIndex, uint32_t connectTimeoutMs)
+		: mTcpSock(addr, port, interfaceIndex), mUdpSock(addr, port, false, 0, interfaceIndex), mProxy(mTcpSock), mTelnet(mTcpSock), mCredit(0)
+	{
+		++g_NumConnects;
+		if(UNREACHABLE_IP == addr) {
+			throw ConnectionLost("connect() failed", addr, port);
+		}
+		if(SLOW_IP == addr) {
+			std::this_thread::sleep_for(SLOW_CONNECT);
+			++g_NumSlowConnects;
+		}
+	}
+
+	void Control::WaitConnected(void) const throw (ConnectionLost) {}
+
+	size_t Control::GetTargetMode(void) const throw(FatalError)
+	{
+		return FW_IDENT;
+	}
+
+	uint16_t Control::FwGetVersion() throw (WyLight::ConnectionTimeout, WyLight::FatalError, WyLight::ScriptBufferFull)
+	{
+		return TEST_FW_VERSION;
+	}
+
+	BroadcastReceiver::BroadcastReceiver(uint16_t port, const std::string& recentFilename, const std::function<void(size_t index, const Endpoint& newRemote)>& onNewRemote, const std::vector<std::string>& interfaces)
+		: mPort(port), mIsRunning(false), mNumInstances(0), mRecentFilename(recentFilename), mOnNewRemote(onNewRemote)
+	{}
+
+	BroadcastReceiver::~BroadcastReceiver(void) {}
+
+	Endpoint& BroadcastReceiver::GetEndpoint(size_t index)
+	{
+		return g_RecentEndpoints[index];
+	}
+
+	size_t BroadcastReceiver::NumRemotes(void) const
+	{
+		return g_RecentEndpoints.size();
+	}
+
+	size_t ut_ControlPool_WarmUpTopScored(void)
+	{
+		TestCaseBegin();
+		ControlPool testee(2);
+		std::vector<Endpoint> recent {
+			Endpoint(0x7f000001, 2000, 1),
+			Endpoint(0x7f000002, 2000, 0),
+			Endpoint(0x7f000003, 2000, 7),
+			Endpoint(0x7f000004, 2000, 3)
+		};
+
+		g_NumConnects = 0;
+		CHECK(2 == testee.WarmUp(recent));
+		CHECK(2 == testee.NumPending());
+
+		// pool is full, nothing more to start
+		CHECK(0 == testee.WarmUp(recent));
+
+		uint16_t fwVersion = 0;
+		std::unique_ptr<Control> ctrl = testee.Acquire(recent[2], &fwVersion);
+		CHECK(NULL != ctrl.get());
+		CHECK(TEST_FW_VERSION == fwVersion);
+		CHECK(1 == testee.NumPending());
+
+		ctrl = testee.Acquire(recent[3], &fwVersion);
+		CHECK(NULL != ctrl.get());
+		CHECK(TEST_FW_VERSION == fwVersion);
+		CHECK(0 == testee.NumPending());
+		CHECK(2 == g_NumConnects);
+
+		// score 1 endpoint was not warmed up, it is connected on demand
+		ctrl = testee.Acquire(recent[0], &fwVersion);
+		CHECK(NULL != ctrl.get());
+		CHECK(0 == fwVersion);
+		CHECK(3 == g_NumConnects);
+		TestCaseEnd();
+	}
+
+	size_t ut_ControlPool_WarmUpFromReceiver(void)
+	{
+		TestCaseBegin();
+		g_RecentEndpoints = {
+			Endpoint(0x7f000001, 2000, 2),
+			Endpoint(0x7f000001, 2000, 2),
+			Endpoint(0x7f000005, 2000, 1)
+		};
+		BroadcastReceiver receiver;
+		ControlPool testee;
+
+		// duplicates are only warmed up once
+		CHECK(2 == testee.WarmUp(receiver));
+		CHECK(2 == testee.NumPending());
+
+		// unused warm ups would keep connecting beyond the end of this test
+		CHECK(NULL != testee.Acquire(g_RecentEndpoints[0]).get());
+		CHECK(NULL != testee.Acquire(g_RecentEndpoints[2]).get());
+		CHECK(0 == testee.NumPending());
+		TestCaseEnd();
+	}
+
+	size_t ut_ControlPool_WarmUpFailed(void)
+	{
+		TestCaseBegin();
+		ControlPool testee;
+		const Endpoint unreachable(UNREACHABLE_IP, 2000, 5);
+		g_NumConnects = 0;
+		CHECK(1 == testee.WarmUp(std::vector<Endpoint> {unreachable}));
+
+		// warm up failed, Acquire() retries the regular way and reports that failure
+		try {
+			testee.Acquire(unreachable);
+			CHECK(false);
+		} catch (ConnectionLost& e) {
+			CHECK(2 == g_NumConnects);
+		}
+		CHECK(0 == testee.NumPending());
+		TestCaseEnd();
+	}
+	size_t ut_ControlPool_DestroyUnused(void)
+	{
+		TestCaseBegin();
+		g_NumSlowConnects = 0;
+		const auto start = std::chrono::steady_clock::now();
+		{
+			ControlPool testee;
+			CHECK(1 == testee.WarmUp(std::vector<Endpoint> {Endpoint(SLOW_IP, 2000, 5)}));
+		}
+		// the pool is gone, but the warm up is still connecting in the background
+		CHECK(std::chrono::steady_clock::now() - start < SLOW_CONNECT);
+		CHECK(0 == g_NumSlowConnects);
+
+		std::this_thread::sleep_for(2 * SLOW_CONNECT);
+		CHECK(1 == g_NumSlowConnects);
+		TestCaseEnd();
+	}
+} /* namespace WyLight */
+
+using namespace WyLight;
+
+int main (int argc, const char *argv[])
+{
+	UnitTestMainBegin();
+	RunTest(true, ut_ControlPool_WarmUpTopScored);
+	RunTest(true, ut_ControlPool_WarmUpFromReceiver);
+	RunTest(true, ut_ControlPool_WarmUpFailed);
+	RunTest(true, ut_ControlPool_DestroyUnused);
+	UnitTestMainEnd();
+}
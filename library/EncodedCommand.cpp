@@ -0,0 +1,42 @@
+/*
+ Copyright (C) 2013 Nils Weiss, Patrick Bruenn.
+
+ This file is part of Wifly_Light.
+
+ Wifly_Light is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Wifly_Light is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Wifly_Light.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include "EncodedCommand.h"
+#include "MaskBuffer.h"
+
+namespace WyLight {
+
+	EncodedCommand::EncodedCommand(const FwCommand& cmd)
+		: mType(cmd.GetType()), mResponseRequired(cmd.IsResponseRequired())
+	{
+		// firmware frames use a big endian crc @see ComProxy#Send(const FwCommand&, ...)
+		MaskBuffer maskBuffer {BL_MAX_MESSAGE_LENGTH};
+		maskBuffer.Mask(cmd.GetData(), cmd.GetData() + cmd.GetSize(), false);
+		mFrame.assign(maskBuffer.Data(), maskBuffer.Data() + maskBuffer.Size());
+	}
+
+	EncodedSequence Encode(const Script& script)
+	{
+		EncodedSequence sequence;
+		sequence.reserve(script.size());
+		for(const auto& cmd : script) {
+			sequence.push_back(EncodedCommand(FwCmdScriptCommand(cmd)));
+		}
+		return sequence;
+	}
+} /* namespace WyLight */
@@ -0,0 +1,69 @@
+/*
+ Copyright (C) 2013 Nils Weiss, Patrick Bruenn.
+
+ This file is part of Wifly_Light.
+
+ Wifly_Light is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Wifly_Light is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Wifly_Light.  If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef __WyLight__EncodedCommand__
+#define __WyLight__EncodedCommand__
+
+#include "FwCommand.h"
+#include "Script.h"
+
+#include <stdint.h>
+#include <vector>
+
+namespace WyLight {
+
+	/******************************************************************************/
+	/*! \file EncodedCommand.h
+	 * \brief Firmware command frame, which is masked and checksummed only once
+	 *
+	 * Sending a FwCommand masks its control characters and appends the CRC on
+	 * each send. An EncodedCommand keeps the finished wire frame, so the same
+	 * command can be sent to any number of devices without encoding it again.
+	 * The frame is never modified after construction, so one object may be
+	 * shared by several threads.
+	 *
+	 * A sequence of encoded commands is sent with a single vectored write, the
+	 * responses are collected afterwards @see Control#operator<<(const EncodedSequence&)
+	 *******************************************************************************/
+	class EncodedCommand
+	{
+	public:
+		/**
+		 * Encode <cmd> into the frame, which is sent over the wire
+		 */
+		EncodedCommand(const FwCommand& cmd);
+
+		const uint8_t *Data(void) const { return mFrame.data(); };
+		size_t Size(void) const { return mFrame.size(); };
+		uint8_t GetType(void) const { return mType; };
+		bool IsResponseRequired(void) const { return mResponseRequired; };
+
+	private:
+		std::vector<uint8_t> mFrame;
+		uint8_t mType;
+		bool mResponseRequired;
+	};
+
+	typedef std::vector<EncodedCommand> EncodedSequence;
+
+	/**
+	 * Encode all commands of <script> to add them to the firmware script buffer
+	 */
+	EncodedSequence Encode(const Script& script);
+} /* namespace WyLight */
+#endif /* #ifndef __WyLight__EncodedCommand__ */
@@ -20,28 +20,78 @@
 #define _ENDPOINT_H_
 #include <atomic>
 #include <cassert>
+#include <deque>
+#include <functional>
+#include <mutex>
 #include <ostream>
 #include <stddef.h>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
 #include <netinet/in.h>
 #include <sys/socket.h>
 #include <sys/time.h>
 
 namespace WyLight {
 
+	/*
+	 * Process wide table of interned device ids. Each distinct id is stored once,
+	 * endpoints only carry its 32 bit handle. Handle 0 is reserved for the empty id.
+	 */
+	class DeviceIdTable
+	{
+	public:
+		static DeviceIdTable& Instance(void) {
+			static DeviceIdTable table;
+			return table;
+		};
+
+		/*
+		 * @return handle of <deviceId>, it is added to the table if necessary
+		 */
+		uint32_t Intern(const std::string& deviceId) {
+			if(deviceId.empty()) return 0;
+			std::lock_guard<std::mutex> lock(mMutex);
+			auto it = mHandles.find(deviceId);
+			if(mHandles.end() != it) return it->second;
+			const uint32_t handle = static_cast<uint32_t>(mIds.size());
+			mIds.push_back(deviceId);
+			mHandles[deviceId] = handle;
+			return handle;
+		};
+
+		/*
+		 * @return the id belonging to <handle>, references stay valid for the lifetime of the process
+		 */
+		const std::string& Lookup(uint32_t handle) {
+			std::lock_guard<std::mutex> lock(mMutex);
+			return (handle < mIds.size()) ? mIds[handle] : mIds[0];
+		};
+
+	private:
+		std::deque<std::string> mIds;
+		std::unordered_map<std::string, uint32_t> mHandles;
+		std::mutex mMutex;
+
+		DeviceIdTable(void) : mIds(1) {};
+	};
+
 	class Endpoint
 	{
 	public:
-		Endpoint(sockaddr_storage& addr, const size_t size, uint16_t port, std::string devId = "")
-			: mScore(0)
+		/*
+		 * @param interfaceIndex of the network interface the endpoint was discovered on, 0 if unknown
+		 */
+		Endpoint(sockaddr_storage& addr, const size_t size, uint16_t port, const std::string& devId = "", uint32_t interfaceIndex = 0)
+			: mScore(0), mReserved(0), mInterface(interfaceIndex), mDeviceId(DeviceIdTable::Instance().Intern(devId))
 		{
 			assert(sizeof(sockaddr_in) == size);
 			mIp = ntohl(((sockaddr_in&)addr).sin_addr.s_addr);
 			mPort = ntohs(port);
-			mDeviceId = devId;
 		};
 
-		Endpoint(uint32_t ip = 0, uint16_t port = 0, uint8_t score = 0, std::string devId = "")
-			: mIp(ip), mPort(port), mScore(score), mDeviceId(devId)
+		Endpoint(uint32_t ip = 0, uint16_t port = 0, uint8_t score = 0, const std::string& devId = "", uint32_t interfaceIndex = 0)
+			: mIp(ip), mPort(port), mScore(score), mReserved(0), mInterface(interfaceIndex), mDeviceId(DeviceIdTable::Instance().Intern(devId))
 		{};
 
 		bool operator<(const Endpoint& ref) const {
@@ -57,7 +107,7 @@ namespace WyLight {
 				   << ((ref.mIp & 0x0000ff00) >> 8) << '.'
 				   << (ref.mIp & 0x000000ff)
 				   << ':' << ref.mPort
-				   << "  :  " << ref.mDeviceId;
+				   << "  :  " << ref.GetDeviceId();
 		};
 
 		friend bool operator== (const Endpoint& lhs, const Endpoint& rhs)
@@ -86,8 +136,15 @@ namespace WyLight {
 			return ((uint64_t)mIp << 32) | mPort;
 		};
 
-		std::string GetDeviceId(void) const {
-			return mDeviceId;
+		const std::string& GetDeviceId(void) const {
+			return DeviceIdTable::Instance().Lookup(mDeviceId);
+		};
+
+		/*
+		 * @return index of the network interface this endpoint was discovered on, 0 if unknown
+		 */
+		uint32_t GetInterface(void) const {
+			return mInterface;
 		};
 
 		uint32_t GetIp(void) const {
@@ -103,7 +160,11 @@ namespace WyLight {
 		};
 
 		void SetDeviceId(const std::string& deviceId) {
-			mDeviceId = deviceId;
+			mDeviceId = DeviceIdTable::Instance().Intern(deviceId);
+		};
+
+		void SetInterface(const uint32_t interfaceIndex) {
+			mInterface = interfaceIndex;
 		};
 
 		void SetScore(const uint8_t score) {
@@ -127,7 +188,20 @@ namespace WyLight {
 		uint32_t mIp;
 		uint16_t mPort;
 		uint8_t mScore;
-		std::string mDeviceId;
+		uint8_t mReserved;
+		uint32_t mInterface;
+		uint32_t mDeviceId;
+	};
+
+	static_assert(16 == sizeof(Endpoint), "Endpoint should be a compact 16 byte value");
+	static_assert(std::is_trivially_copyable<Endpoint>::value, "Endpoint should be copyable without allocation");
+}
+
+namespace std {
+	template<> struct hash<WyLight::Endpoint> {
+		size_t operator()(const WyLight::Endpoint& ref) const {
+			return std::hash<uint64_t>()(ref.AsUint64());
+		}
 	};
 }
 #endif /* #ifndef _ENDPOINT_H_ */
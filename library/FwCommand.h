@@ -104,6 +104,10 @@ namespace WyLight {
 			mReqFrame.data.wait.waitTmms = htons(std::max((uint16_t)1, waitTime));
 		};
 
+		uint16_t waitTime(void) const {
+			return ntohs(mReqFrame.data.wait.waitTmms);
+		};
+
 		std::ostream& Write(std::ostream& out, size_t& indentation) const override {
 			return FwCmdScript::Write(out, indentation) << TOKEN << ' ' << std::dec << ntohs(mReqFrame.data.wait.waitTmms);
 		};
@@ -117,6 +121,17 @@ namespace WyLight {
 		FwCmdClearScript(void) : FwCmdSimple(CLEAR_SCRIPT) {};
 	};
 
+/**
+ * Remove all commands beginning with <index> from the WyLight script controller,
+ * <index> is relative to the oldest command, which is still stored.
+ */
+	struct FwCmdTruncateScript : public FwCmdSimple
+	{
+		FwCmdTruncateScript(uint8_t index) : FwCmdSimple(TRUNCATE_SCRIPT, sizeof(cmd_truncate_script)) {
+			mReqFrame.data.truncate_script.index = index;
+		};
+	};
+
 	struct FwCmdGetCycletime : public FwCmdGet
 	{
 		CycletimeResponse mResponse;
@@ -138,6 +153,13 @@ namespace WyLight {
 		FwResponse& GetResponse(void) { return mResponse;       };
 	};
 	
+	struct FwCmdGetTraceEvents : public FwCmdGet
+	{
+		TraceEventsResponse mResponse;
+		FwCmdGetTraceEvents(void) : FwCmdGet(GET_TRACE_EVENTS) {};
+		FwResponse& GetResponse(void) { return mResponse;       };
+	};
+
 	struct FwCmdGetLedTyp : public FwCmdGet
 	{
 		LedTypResponse mResponse;
@@ -145,6 +167,27 @@ namespace WyLight {
 		FwResponse& GetResponse(void) { return mResponse;       };
 	};
 
+	struct FwCmdGetScriptState : public FwCmdGet
+	{
+		ScriptStateResponse mResponse;
+		FwCmdGetScriptState(void) : FwCmdGet(GET_SCRIPT_STATE) {};
+		FwResponse& GetResponse(void) { return mResponse;       };
+	};
+
+	struct FwCmdGetStats : public FwCmdGet
+	{
+		StatsResponse mResponse;
+		FwCmdGetStats(void) : FwCmdGet(GET_STATS) {};
+		FwResponse& GetResponse(void) { return mResponse;       };
+	};
+
+	struct FwCmdGetUartCredit : public FwCmdGet
+	{
+		UartCreditResponse mResponse;
+		FwCmdGetUartCredit(void) : FwCmdGet(GET_UART_CREDIT) {};
+		FwResponse& GetResponse(void) { return mResponse;       };
+	};
+
 	struct FwCmdGetVersion : public FwCmdGet
 	{
 		FirmwareVersionResponse mResponse;
@@ -168,6 +211,10 @@ namespace WyLight {
 		FwCmdLoopOff(uint8_t numLoops = 0) : FwCmdScript(LOOP_OFF, sizeof(cmd_loop_end)) {
 			mReqFrame.data.loopEnd.numLoops = numLoops;
 		};
+
+		uint8_t numLoops(void) const {
+			return mReqFrame.data.loopEnd.numLoops;
+		};
 		
 		std::ostream& Write(std::ostream& out, size_t& indentation) const override {
 			return FwCmdScript::Write(out, --indentation) << TOKEN << ' ' << std::dec << (int)mReqFrame.data.loopEnd.numLoops;
@@ -198,13 +245,14 @@ namespace WyLight {
 		 *        green(  0,255,  0) as argb is 0xff00ff00
 		 *        white(255,255,255) as argb is 0xffffffff
 		 * @param addr bitmask of leds which should be effected by this command, set bit to 1 to affect the led, default 0xffffffff
+		 * @param segment the leds of \<addr\> are counted from the first led of this segment, all other leds are turned off
 		 */
-		FwCmdSetColorDirect(uint32_t argb, uint32_t addr) : FwCmdSimple(SET_COLOR_DIRECT, sizeof(cmd_set_color_direct), false)
+		FwCmdSetColorDirect(uint32_t argb, uint32_t addr, uint8_t segment = 0) : FwCmdSimple(SET_COLOR_DIRECT, sizeof(cmd_set_color_direct), false)
 		{
 			const uint8_t red = (uint8_t)(argb >> 16);
 			const uint8_t green = (uint8_t)(argb >> 8);
 			const uint8_t blue = (uint8_t)argb;
-			mReqFrame.data.set_color_direct.Set(red, green, blue, addr);
+			mReqFrame.data.set_color_direct.Set(red, green, blue, addr, segment);
 		};
 
 		/**
@@ -212,11 +260,12 @@ namespace WyLight {
 		 * Example: to set the first led to yellow and the second to blue and all others to off use a \<pBuffer\> like this:
 		 * pBuffer[] = {0xff, 0xff, 0x00, 0x00, 0x00, 0xff}; bufferLength = 6;
 		 * @param pBuffer containing continouse rgb values r1g1b1r2g2b2...r32g32b32
-		 * @param bufferLength number of bytes in \<pBuffer\> usally 32 * 3 bytes
+		 * @param bufferLength number of bytes in \<pBuffer\> usally 32 * 3 bytes, additional bytes are ignored
+		 * @param segment of the leds, a frame carries the colors of NUM_OF_LED_PER_SEGMENT leds
 		 */
-		FwCmdSetColorDirect(const uint8_t *pBuffer, size_t bufferLength) : FwCmdSimple(SET_COLOR_DIRECT, sizeof(cmd_set_color_direct), false)
+		FwCmdSetColorDirect(const uint8_t *pBuffer, size_t bufferLength, uint8_t segment = 0) : FwCmdSimple(SET_COLOR_DIRECT, sizeof(cmd_set_color_direct), false)
 		{
-			mReqFrame.data.set_color_direct.Set(pBuffer, bufferLength);
+			mReqFrame.data.set_color_direct.Set(pBuffer, bufferLength, segment);
 		};
 	};
 
@@ -240,10 +289,11 @@ namespace WyLight {
 		 * @param fadeTime in hundreths of a second. Use 0 to set color immediately, default = 0
 		 * @param addr bitmask of leds which should be effected by this command, set bit to 1 to affect the led, default 0xffffffff
 		 * @param parallelFade if true other fades are allowed in parallel with this fade
+		 * @param segment the leds of \<addr\> are counted from the first led of this segment, default SEGMENT_ALL applies \<addr\> to each segment
 		 */
-		FwCmdSetFade(uint32_t argb, uint16_t fadeTime = 0, uint32_t addr = 0xffffffff, bool parallelFade = false)
+		FwCmdSetFade(uint32_t argb, uint16_t fadeTime = 0, uint32_t addr = 0xffffffff, bool parallelFade = false, uint8_t segment = SEGMENT_ALL)
 			: FwCmdScript(SET_FADE, sizeof(cmd_set_fade)) {
-			mReqFrame.data.set_fade.Set(addr, argb, (uint8_t)parallelFade, fadeTime);
+			mReqFrame.data.set_fade.Set(addr, argb, (uint8_t)parallelFade, fadeTime, segment);
 		};
 
 		uint32_t argb(void) const {
@@ -264,6 +314,19 @@ namespace WyLight {
 			mReqFrame.data.set_fade.fadeTmms = htons(tmms);
 		};
 
+		uint32_t addr(void) const {
+			const uns8 *const a = mReqFrame.data.set_fade.addr;
+			return (uint32_t)a[3] << 24 | (uint32_t)a[2] << 16 | (uint32_t)a[1] << 8 | a[0];
+		};
+
+		bool parallelFade(void) const {
+			return 0 != mReqFrame.data.set_fade.parallelFade;
+		};
+
+		uint8_t segment(void) const {
+			return mReqFrame.data.set_fade.segment;
+		};
+
 		std::ostream& Write(std::ostream& out, size_t& indentation) const override {
 			FwCmdScript::Write(out, indentation) << TOKEN << ' ';
 			return mReqFrame.data.set_fade.Write(out, indentation);
@@ -289,10 +352,11 @@ namespace WyLight {
 		       * @param parallelFade if true other fades are allowed in parallel with this fade
 		       * @param length is the number of led's from startposition to endposition
 		       * @param offset can be used to move the startposition of the gradient on the ledstrip
+		       * @param segment the \<offset\> is counted from the first led of this segment
 		       */
-		FwCmdSetGradient(uint32_t argb_1, uint32_t argb_2, uint16_t fadeTime = 0, bool parallelFade = false, uint8_t length = NUM_OF_LED, uint8_t offset = 0) : FwCmdScript(SET_GRADIENT, sizeof(cmd_set_gradient)) {
+		FwCmdSetGradient(uint32_t argb_1, uint32_t argb_2, uint16_t fadeTime = 0, bool parallelFade = false, uint8_t length = NUM_OF_LED, uint8_t offset = 0, uint8_t segment = 0) : FwCmdScript(SET_GRADIENT, sizeof(cmd_set_gradient)) {
 
-			mReqFrame.data.set_gradient.Set(argb_1, argb_2, parallelFade, offset, length, fadeTime);
+			mReqFrame.data.set_gradient.Set(argb_1, argb_2, parallelFade, offset, length, fadeTime, segment);
 		};
 
 		uint32_t StartColor(void) const {
@@ -315,6 +379,26 @@ namespace WyLight {
 			mReqFrame.data.set_gradient.blue_2 = (uint8_t)argb;
 		};
 
+		uint16_t fadeTime(void) const {
+			return ntohs(mReqFrame.data.set_gradient.fadeTmms);
+		};
+
+		bool parallelFade(void) const {
+			return 0 != (mReqFrame.data.set_gradient.parallelAndOffset & 0x80);
+		};
+
+		uint8_t offset(void) const {
+			return mReqFrame.data.set_gradient.parallelAndOffset & 0x7F;
+		};
+
+		uint8_t length(void) const {
+			return mReqFrame.data.set_gradient.numberOfLeds;
+		};
+
+		uint8_t segment(void) const {
+			return mReqFrame.data.set_gradient.segment;
+		};
+
 		std::ostream& Write(std::ostream& out, size_t& indentation) const override {
 			FwCmdScript::Write(out, indentation) << TOKEN << ' ';
 			return mReqFrame.data.set_gradient.Write(out, indentation);
@@ -66,6 +66,8 @@ namespace WyLight {
 				return false;
 			case BAD_COMMAND_CODE:
 				throw FatalError("FIRMWARE RECEIVED A BAD COMMAND CODE" + std::to_string(pData.cmd));
+			case BAD_SCRIPT_INDEX:
+				throw InvalidParameter("Script slot doesn't exist or can't be edited");
 			default:
 				throw FatalError("Unexpected response state: " + std::to_string(pData.state));
 			};
@@ -98,19 +100,77 @@ namespace WyLight {
 	class CycletimeResponse : public FwResponse
 	{
 	public:
+		/* the stopwatch of the firmware runs with 2MHz */
+		static constexpr double TICKS_PER_US = 2.0;
+
 		CycletimeResponse(void) : FwResponse(GET_CYCLETIME) {};
 		bool Init(response_frame& pData, size_t dataLength)
 		{
 			if(FwResponse::Init(pData, dataLength)
 			   && (dataLength >= 4 + sizeof(mCycletimes[0]) * CYCLETIME_METHODE_ENUM_SIZE)) {
-				for(size_t i = 0; i < CYCLETIME_METHODE_ENUM_SIZE && i < dataLength / sizeof(uns16); i++) {
-					mCycletimes[i] = ntohs(pData.data.max_cycle_times[i]);
+				for(size_t i = 0; i < CYCLETIME_METHODE_ENUM_SIZE; i++) {
+					const cycletime_stats& stats = pData.data.cycletimes[i];
+					mCycletimes[i].max = ntohs(stats.max);
+					mCycletimes[i].count = ntohs(stats.count);
+					mCycletimes[i].total = ntohl(stats.total);
+					std::copy(stats.histogram, stats.histogram + CYCLETIME_HISTOGRAM_SIZE, mCycletimes[i].histogram);
 				}
 				return true;
 			}
 			return false;
 		};
 
+		/**
+		 * @return number of measurements of <methode>, the firmware halves it before it overflows
+		 */
+		uint16_t Count(size_t methode) const { return mCycletimes[methode].count; };
+
+		/**
+		 * @return longest cycle time of <methode> in us
+		 */
+		double Max(size_t methode) const { return mCycletimes[methode].max / TICKS_PER_US; };
+
+		/**
+		 * @return mean cycle time of <methode> in us, 0 if it wasn't measured
+		 */
+		double Mean(size_t methode) const
+		{
+			const cycletime_stats& stats = mCycletimes[methode];
+			return stats.count ? stats.total / TICKS_PER_US / stats.count : 0;
+		};
+
+		/**
+		 * Estimates the cycle time of <methode>, which <percent> of all measurements
+		 * didn't exceed. The histogram of the firmware only knows the log2 bucket of
+		 * each measurement, so the result is interpolated linearly inside the bucket.
+		 * @return cycle time in us, 0 if <methode> wasn't measured
+		 */
+		double Percentile(size_t methode, unsigned int percent) const
+		{
+			const cycletime_stats& stats = mCycletimes[methode];
+			unsigned int numMeasurements = 0;
+			for(size_t bucket = 0; bucket < CYCLETIME_HISTOGRAM_SIZE; bucket++) {
+				numMeasurements += stats.histogram[bucket];
+			}
+
+			const double target = numMeasurements * percent / 100.0;
+			unsigned int seen = 0;
+			for(size_t bucket = 0; bucket < CYCLETIME_HISTOGRAM_SIZE; bucket++) {
+				const unsigned int inBucket = stats.histogram[bucket];
+				if(inBucket && (seen + inBucket >= target)) {
+					const double lower = bucket ? (1u << (CYCLETIME_HISTOGRAM_SHIFT + bucket - 1)) : 0;
+					double upper = stats.max;
+					if(bucket < CYCLETIME_HISTOGRAM_SIZE - 1) {
+						upper = std::min(upper, (double)(1u << (CYCLETIME_HISTOGRAM_SHIFT + bucket)));
+					}
+					upper = std::max(lower, upper);
+					return (lower + (upper - lower) * (target - seen) / inBucket) / TICKS_PER_US;
+				}
+				seen += inBucket;
+			}
+			return 0;
+		};
+
 		std::string ToString(void) const
 		{
 			std::stringstream stream;
@@ -122,15 +182,33 @@ namespace WyLight {
 
 		friend std::ostream& operator<< (std::ostream& out, const CycletimeResponse& ref)
 		{
-			out << "Cycletimes: \n";
+			out << "Cycletimes in us: \n";
+			out << std::setw(24) << std::left << "methode" << std::right;
+			out << std::setw(8) << "count" << std::setw(10) << "mean" << std::setw(10) << "p50";
+			out << std::setw(10) << "p90" << std::setw(10) << "p99" << std::setw(10) << "max" << '\n';
+			out << std::fixed << std::setprecision(1);
 			for(unsigned int i = 0; i < CYCLETIME_METHODE_ENUM_SIZE; i++) {
-				out << std::setw(3) << std::dec << i + 1 << ": " << std::setw(8) << std::dec << ref.mCycletimes[i] << " us\n";
+				out << std::setw(24) << std::left << MethodeName(i) << std::right;
+				out << std::setw(8) << ref.Count(i) << std::setw(10) << ref.Mean(i);
+				out << std::setw(10) << ref.Percentile(i, 50) << std::setw(10) << ref.Percentile(i, 90);
+				out << std::setw(10) << ref.Percentile(i, 99) << std::setw(10) << ref.Max(i) << '\n';
 			}
 			return out;
 		};
 
+		static const char *MethodeName(size_t methode)
+		{
+			static const char *const NAMES[] = {
+				"main", "Ledstrip_DoFade", "SET_FADE", "SET_COLOR", "SET_GRADIENT", "-",
+				"Ledstrip_UpdateLed", "CommandIO_GetCommands", "ScriptCtrl_Run",
+				"Platform_CheckInputs", "Error_Throw", "TIMER_WAIT"
+			};
+			static_assert(sizeof(NAMES) / sizeof(NAMES[0]) == CYCLETIME_METHODE_ENUM_SIZE, "names don't match enum CYCLETIME_METHODE");
+			return NAMES[methode];
+		};
+
 	private:
-		uint16_t mCycletimes[CYCLETIME_METHODE_ENUM_SIZE];
+		cycletime_stats mCycletimes[CYCLETIME_METHODE_ENUM_SIZE];
 	};
 
 	class TracebufferResponse : public FwResponse
@@ -165,6 +243,33 @@ namespace WyLight {
 		std::string mTraceMessage;
 	};
 
+	class TraceEventsResponse : public FwResponse
+	{
+	public:
+		TraceEventsResponse(void) : FwResponse(GET_TRACE_EVENTS) {};
+		bool Init(response_frame& pData, size_t dataLength)
+		{
+			const size_t headerSize = 4 + sizeof(mEvents.numLost);
+			if(FwResponse::Init(pData, dataLength)
+			   && (dataLength >= headerSize)
+			   && (0 == (dataLength - headerSize) % sizeof(trace_event))) {
+				mNumEvents = (dataLength - headerSize) / sizeof(trace_event);
+				memcpy(&mEvents, &pData.data.traceEvents, dataLength - 4);
+				return true;
+			}
+			return false;
+		};
+
+		/**
+		 * @return the events in network byte order, decode them with TraceEventLog
+		 */
+		const trace_events& GetEvents(void) const { return mEvents; };
+		size_t NumEvents(void) const { return mNumEvents; };
+	private:
+		trace_events mEvents;
+		size_t mNumEvents = 0;
+	};
+
 	class FirmwareVersionResponse : public FwResponse
 	{
 	public:
@@ -235,5 +340,93 @@ namespace WyLight {
 		uint16_t mLedTyp = LED_TYP_RGB;
 	};
 
+	class ScriptStateResponse : public FwResponse
+	{
+	public:
+		ScriptStateResponse(void) : FwResponse(GET_SCRIPT_STATE) {};
+		bool Init(response_frame& pData, size_t dataLength)
+		{
+			if(FwResponse::Init(pData, dataLength)
+			   && (dataLength == 4 + sizeof(script_state))) {
+				mState = pData.data.scriptState;
+				return true;
+			}
+			return false;
+		};
+
+		std::string ToString(void) const
+		{
+			std::stringstream stream;
+			stream << *this;
+			return stream.str();
+		};
+
+		const script_state& getState(void) const { return mState; }
+
+		friend std::ostream& operator<< (std::ostream& out, const ScriptStateResponse& ref)
+		{
+			return out << "free: " << (int)ref.mState.numFree
+				   << " read: " << (int)ref.mState.read
+				   << " execute: " << (int)ref.mState.execute
+				   << " write: " << (int)ref.mState.write;
+		};
+	private:
+		script_state mState = {0, 0, 0, 0};
+	};
+
+	class UartCreditResponse : public FwResponse
+	{
+	public:
+		UartCreditResponse(void) : FwResponse(GET_UART_CREDIT) {};
+		bool Init(response_frame& pData, size_t dataLength)
+		{
+			if(FwResponse::Init(pData, dataLength)
+			   && (dataLength == 4 + sizeof(uint8_t))) {
+				mCredit = pData.data.uartCredit;
+				return true;
+			}
+			return false;
+		};
+
+		/**
+		 * @return number of free bytes in the uart receive buffer of the firmware,
+		 *         when it processed the request
+		 */
+		uint8_t getCredit(void) const { return mCredit; }
+
+	private:
+		uint8_t mCredit = 0;
+	};
+
+	class StatsResponse : public FwResponse
+	{
+	public:
+		StatsResponse(void) : FwResponse(GET_STATS) {};
+		bool Init(response_frame& pData, size_t dataLength)
+		{
+			if(FwResponse::Init(pData, dataLength)
+			   && (dataLength == 4 + sizeof(device_stats))) {
+				const device_stats& stats = pData.data.stats;
+				mStats.rxBytes = ntohl(stats.rxBytes);
+				mStats.commands = ntohs(stats.commands);
+				mStats.crcErrors = ntohs(stats.crcErrors);
+				mStats.lengthErrors = ntohs(stats.lengthErrors);
+				mStats.scriptFull = ntohs(stats.scriptFull);
+				mStats.ringOverflows = ntohs(stats.ringOverflows);
+				mStats.ringHighWater = stats.ringHighWater;
+				return true;
+			}
+			return false;
+		};
+
+		/**
+		 * @return the counters of the firmware in host byte order
+		 */
+		const device_stats& getStats(void) const { return mStats; }
+
+	private:
+		device_stats mStats = {0, 0, 0, 0, 0, 0, 0};
+	};
+
 }
 #endif
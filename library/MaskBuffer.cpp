@@ -89,8 +89,9 @@ namespace WyLight {
 		}
 	}
 
-	bool UnmaskBuffer::Unmask(const uint8_t *pInput, size_t bytesMasked, bool checkCrc, bool crcInLittleEndian)
+	bool UnmaskBuffer::Unmask(const uint8_t *pInput, size_t bytesMasked, bool checkCrc, bool crcInLittleEndian, size_t *pBytesUsed)
 	{
+		const uint8_t *const pFirst = pInput;
 		while(bytesMasked-- > 0)
 		{
 			if(mLastWasDLE) {
@@ -104,6 +105,9 @@ namespace WyLight {
 					if(checkCrc) {
 						CheckAndRemoveCrc(crcInLittleEndian);
 					}
+					if(pBytesUsed) {
+						*pBytesUsed = pInput - pFirst + 1;
+					}
 					return true;
 				case BL_DLE:
 					mLastWasDLE = true;
@@ -93,9 +93,10 @@ namespace WyLight {
 		void CheckAndRemoveCrc(bool crcInLittleEndian) throw (FatalError);
 
 		/*
+		 * @param pBytesUsed optional pointer to store the number of input bytes processed up to and including the ETX
 		 * @return true if end of response reached (marked by an ETX), else false
 		 */
-		bool Unmask(const uint8_t *pInput, size_t bytesMasked, bool checkCrc, bool crcInLittleEndian);
+		bool Unmask(const uint8_t *pInput, size_t bytesMasked, bool checkCrc, bool crcInLittleEndian, size_t *pBytesUsed = NULL);
 
 	private:
 		uint16_t mPrePreCrc;
@@ -18,7 +18,10 @@
 
 #include "Script.h"
 #include "trace.h"
+#include <algorithm>
+#include <cctype>
 #include <fstream>
+#include <iterator>
 
 namespace WyLight {
 
@@ -26,6 +29,99 @@ namespace WyLight {
 	
 	const unsigned int Script::currentVersion = 1;
 
+	/**
+	 * Splits a script text into whitespace separated tokens without copying it
+	 */
+	class ScriptTokenizer
+	{
+		const char *mPos;
+		const char *const mEnd;
+
+	public:
+		ScriptTokenizer(const char *pBegin, const char *pEnd) : mPos(pBegin), mEnd(pEnd) {};
+
+		/**
+		 * @return false if the text is exhausted
+		 */
+		bool Next(const char *& pToken, size_t& length) {
+			while((mPos < mEnd) && std::isspace(static_cast<unsigned char>(*mPos))) {
+				++mPos;
+			}
+			pToken = mPos;
+			while((mPos < mEnd) && !std::isspace(static_cast<unsigned char>(*mPos))) {
+				++mPos;
+			}
+			length = mPos - pToken;
+			return length > 0;
+		};
+
+		/**
+		 * @return true if the next token is a number and not the next command
+		 */
+		bool NumberFollows(void) const {
+			const char *pCur = mPos;
+			while((pCur < mEnd) && std::isspace(static_cast<unsigned char>(*pCur))) {
+				++pCur;
+			}
+			return (pCur < mEnd) && std::isdigit(static_cast<unsigned char>(*pCur));
+		};
+
+		/**
+		 * Parse the next token as decimal number, or hexadecimal with an optional 0x prefix
+		 */
+		uint32_t Number(bool hex, uint32_t maxValue) throw (FatalError) {
+			const char *pToken;
+			size_t length;
+			if(!Next(pToken, length)) {
+				throw FatalError("Script ends in the middle of a command");
+			}
+
+			const char *pCur = pToken;
+			const char *const pEnd = pToken + length;
+			if(hex && (length > 2) && ('0' == pCur[0]) && ('x' == (pCur[1] | 0x20))) {
+				pCur += 2;
+			}
+
+			const uint64_t base = hex ? 16 : 10;
+			uint64_t value = 0;
+			for( ; pCur < pEnd; ++pCur) {
+				const char c = *pCur;
+				uint64_t digit;
+				if(('0' <= c) && (c <= '9')) {
+					digit = c - '0';
+				} else if(hex && ('a' <= (c | 0x20)) && ((c | 0x20) <= 'f')) {
+					digit = (c | 0x20) - 'a' + 10;
+				} else {
+					break;
+				}
+				value = value * base + digit;
+				if(value > maxValue) {
+					break;
+				}
+			}
+
+			if((pCur != pEnd) || (value > maxValue)) {
+				throw FatalError("Invalid parameter in script: " + std::string(pToken, length));
+			}
+			return (uint32_t)value;
+		};
+	};
+
+	static bool IsToken(const char *pToken, size_t length, const std::string& token)
+	{
+		return (length == token.size()) && (0 == memcmp(pToken, token.data(), length));
+	}
+
+	/**
+	 * Read a line without the line feed, just like std::getline() would
+	 */
+	static const char *GetLine(const char *pCur, const char *pEnd, std::string& line)
+	{
+		const char *const pLineEnd = std::find(pCur, pEnd, '\n');
+		line.assign(pCur, pLineEnd);
+		return (pLineEnd < pEnd) ? pLineEnd + 1 : pEnd;
+	}
+
 	Script::Script(const std::string& filename)
 	{
 		Script::deserialize(filename, *this);
@@ -36,21 +132,13 @@ namespace WyLight {
 		clear();
 	}
 	
+	Script::Script(const Script& other) : mName(other.mName), mList(other.mList) {}
+
 	Script::Script(Script&& other) : mName(std::move(other.mName)), mList(std::move(other.mList)) {}
 
 	bool Script::operator == (const Script& ref) const
 	{
-		if(size() != ref.size()) {
-			return false;
-		}
-
-		auto refIt = ref.begin();
-		for(const auto& cmd : *this) {
-			if(*cmd != **refIt++) {
-				return false;
-			}
-		}
-		return true;
+		return mList == ref.mList;
 	}
 
 	Script::ScriptList::const_iterator Script::begin() const noexcept
@@ -60,21 +148,24 @@ namespace WyLight {
 
 	void Script::clear()
 	{
-		for(auto& cmd : mList) {
-			cmd.reset();
-		}
 		mList.clear();
 	}
 
 	void Script::deserialize(const std::string& filename, Script& newScript) throw (FatalError)
 	{
-		std::ifstream inFile(filename);
+		std::ifstream inFile(filename, std::ios::in | std::ios::binary);
 		if(!inFile.is_open()) {
 			throw FatalError("Open '" + filename + "' to read script failed");
 		}
 
-		newScript.deserialize(inFile, newScript);
+		inFile.seekg(0, std::ios::end);
+		const std::streamoff fileSize = inFile.tellg();
+		inFile.seekg(0, std::ios::beg);
+		std::string text(fileSize > 0 ? fileSize : 0, '\0');
+		inFile.read(&text[0], text.size());
 		inFile.close();
+
+		deserialize(text.data(), text.data() + text.size(), newScript);
 		
 		if (newScript.mName.empty()) {
 			// std::string::npos+1 will overflow to 0 just like we want!
@@ -83,35 +174,57 @@ namespace WyLight {
 		}
 	}
 	
-	void Script::deserialize(std::istream &inStream, WyLight::Script &newScript)
+	void Script::deserialize(std::istream &inStream, WyLight::Script &newScript) throw (FatalError)
 	{
-		int c = inStream.peek();
-		if (c == EOF) {
+		const std::string text((std::istreambuf_iterator<char>(inStream)), std::istreambuf_iterator<char>());
+		deserialize(text.data(), text.data() + text.size(), newScript);
+	}
+
+	void Script::deserialize(const char *pBegin, const char *pEnd, Script& newScript) throw (FatalError)
+	{
+		if(pBegin == pEnd) {
 			return;
 		}
-		
-		if (std::isdigit(static_cast<unsigned char>(c))) {
+
+		if (std::isdigit(static_cast<unsigned char>(*pBegin))) {
 			std::string firstLine;
-			std::getline(inStream, firstLine);
-			//const int fileVersion = std::stoi(firstLine);
-			/* do something with different versions here */
-			std::getline(inStream, newScript.mName);
+			pBegin = GetLine(pBegin, pEnd, firstLine);
+			//const int fileVersion = std::stoi(firstLine);
+			/* do something with different versions here */
+			pBegin = GetLine(pBegin, pEnd, newScript.mName);
 		}
-		
-		std::string command;
-		while(inStream >> command) {
-			if(0 == command.compare(FwCmdLoopOn::TOKEN)) {
-				newScript.push_back(std::unique_ptr<FwCmdScript>(new FwCmdLoopOn()));
-			} else if(0 == command.compare(FwCmdLoopOff::TOKEN)) {
-				newScript.push_back(std::unique_ptr<FwCmdScript>(new FwCmdLoopOff(inStream)));
-			} else if(0 == command.compare(FwCmdWait::TOKEN)) {
-				newScript.push_back(std::unique_ptr<FwCmdScript>(new FwCmdWait(inStream)));
-			} else if(0 == command.compare(FwCmdSetFade::TOKEN)) {
-				newScript.push_back(std::unique_ptr<FwCmdScript>(new FwCmdSetFade(inStream)));
-			} else if(0 == command.compare(FwCmdSetGradient::TOKEN)) {
-				newScript.push_back(std::unique_ptr<FwCmdScript>(new FwCmdSetGradient(inStream)));
+
+		// one command per line is the common case
+		newScript.reserve(newScript.size() + std::count(pBegin, pEnd, '\n') + 1);
+
+		ScriptTokenizer tokenizer(pBegin, pEnd);
+		const char *pToken;
+		size_t length;
+		while(tokenizer.Next(pToken, length)) {
+			if(IsToken(pToken, length, FwCmdSetFade::TOKEN)) {
+				const uint32_t addr = tokenizer.Number(true, 0xffffffff);
+				const uint32_t argb = tokenizer.Number(true, 0xffffffff);
+				const uint16_t fadeTime = tokenizer.Number(false, 0xffff);
+				const bool parallelFade = 0 != tokenizer.Number(false, 0xffffffff);
+				const uint8_t segment = tokenizer.NumberFollows() ? tokenizer.Number(false, 0xff) : SEGMENT_ALL;
+				newScript.push_back(ScriptCommand::Fade(argb, fadeTime, addr, parallelFade, segment));
+			} else if(IsToken(pToken, length, FwCmdWait::TOKEN)) {
+				newScript.push_back(ScriptCommand::Wait(tokenizer.Number(false, 0xffff)));
+			} else if(IsToken(pToken, length, FwCmdLoopOn::TOKEN)) {
+				newScript.push_back(ScriptCommand::LoopOn());
+			} else if(IsToken(pToken, length, FwCmdLoopOff::TOKEN)) {
+				newScript.push_back(ScriptCommand::LoopOff(tokenizer.Number(false, 0xff)));
+			} else if(IsToken(pToken, length, FwCmdSetGradient::TOKEN)) {
+				const uint32_t argb_1 = tokenizer.Number(true, 0xffffffff);
+				const uint32_t argb_2 = tokenizer.Number(true, 0xffffffff);
+				const uint16_t fadeTime = tokenizer.Number(false, 0xffff);
+				const uint8_t offset = tokenizer.Number(false, 0xff);
+				const uint8_t length = tokenizer.Number(false, 0xff);
+				const bool parallelFade = 0 != tokenizer.Number(false, 0xffffffff);
+				const uint8_t segment = tokenizer.NumberFollows() ? tokenizer.Number(false, 0xff) : 0;
+				newScript.push_back(ScriptCommand::Gradient(argb_1, argb_2, fadeTime, parallelFade, length, offset, segment));
 			} else {
-				throw FatalError("Unknown command: " + command);
+				throw FatalError("Unknown command: " + std::string(pToken, length));
 			}
 		}
 	}
@@ -121,6 +234,16 @@ namespace WyLight {
 		return mList.end();
 	}
 
+	const ScriptCommand& Script::operator[](size_t index) const
+	{
+		return mList[index];
+	}
+
+	ScriptCommand& Script::operator[](size_t index)
+	{
+		return mList[index];
+	}
+
 	const std::string& Script::getName() const
 	{
 		return mName;
@@ -130,9 +253,14 @@ namespace WyLight {
 		mName = name;
 	}
 
-	void Script::push_back(std::unique_ptr<FwCmdScript>&& pNew)
+	void Script::push_back(const ScriptCommand& cmd)
+	{
+		mList.push_back(cmd);
+	}
+
+	void Script::reserve(size_t numCommands)
 	{
-		mList.push_back(std::move(pNew));
+		mList.reserve(numCommands);
 	}
 
 	void Script::serialize(const std::string& filename, const Script& newScript) throw (FatalError)
@@ -145,10 +273,9 @@ namespace WyLight {
 		outFile << currentVersion << '\n';
 		outFile << newScript.mName << '\n';
 
-		std::string command;
 		size_t identation = 0;
 		for(const auto& cmd : newScript) {
-			cmd->Write(outFile, identation) << '\n';
+			cmd.Write(outFile, identation) << '\n';
 		}
 		outFile.close();
 	}
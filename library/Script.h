@@ -19,29 +19,36 @@
 #ifndef __WyLight__Script__
 #define __WyLight__Script__
 
-#include "FwCommand.h"
+#include "ScriptCommand.h"
 
-#include <list>
 #include <string>
-#include <memory>
+#include <vector>
 
 namespace WyLight {
 
 	class Script
 	{
-	typedef std::list<std::unique_ptr<FwCmdScript>> ScriptList;
+	typedef std::vector<ScriptCommand> ScriptList;
 	std::string mName;
 	ScriptList mList;
 
 	public:
 		static const unsigned int currentVersion;
 		
-		static void deserialize(std::istream &inStream, WyLight::Script &newScript);
+		static void deserialize(std::istream &inStream, WyLight::Script &newScript) throw (FatalError);
 		static void deserialize(const std::string& filename, Script& newScript) throw (FatalError);
+
+		/**
+		 * Parse a script in text format from memory, <pBegin> to <pEnd> is not copied
+		 * fade and gradient take the segment of the leds as optional last parameter
+		 * @throw FatalError if the text contains an unknown command or a malformed parameter
+		 */
+		static void deserialize(const char *pBegin, const char *pEnd, Script& newScript) throw (FatalError);
 		static void serialize(const std::string& filename, const Script& newScript) throw (FatalError);
 
 		Script() = default;
 		Script(const std::string& filename);
+		Script(const Script& other);
 		Script(Script&& other);
 		~Script(void);
 		
@@ -50,11 +57,13 @@ namespace WyLight {
 		void clear();
 		ScriptList::const_iterator begin() const noexcept;
 		ScriptList::const_iterator end() const noexcept;
+		const ScriptCommand& operator[](size_t index) const;
+		ScriptCommand& operator[](size_t index);
 		const std::string& getName() const;
 		void setName(const std::string& name);
-		void push_back(std::unique_ptr<FwCmdScript>&& pNew);
+		void push_back(const ScriptCommand& cmd);
+		void reserve(size_t numCommands);
 		size_t size() const;
 	};
 } /* namespace WyLight */
 #endif /* #ifndef __WyLight__Script__ */
-
@@ -0,0 +1,261 @@
+/*
+ Copyright (C) 2013 Nils Weiss, Patrick Bruenn.
+
+ This file is part of Wifly_Light.
+
+ Wifly_Light is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Wifly_Light is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Wifly_Light.  If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef __WyLight__ScriptCommand__
+#define __WyLight__ScriptCommand__
+
+#include "FwCommand.h"
+
+#include <cstring>
+#include <type_traits>
+
+namespace WyLight {
+
+	/******************************************************************************/
+	/*! \file ScriptCommand.h
+	 * \brief Compact record of a single script command
+	 *
+	 * A ScriptCommand keeps the command in the same layout as the firmware frame,
+	 * but only the script commands of led_cmd.data are part of it. Thus a record
+	 * is 12 bytes, trivially copyable and can be stored contiguous in a vector.
+	 *******************************************************************************/
+	class ScriptCommand
+	{
+		struct __attribute__((__packed__)) Frame {
+			uns8 cmd;
+			union {
+				struct cmd_set_fade set_fade;
+				struct cmd_wait wait;
+				struct cmd_loop_end loopEnd;
+				struct cmd_set_gradient set_gradient;
+			}
+			data;
+		} mFrame;
+
+		ScriptCommand(uint8_t cmd) {
+			memset(&mFrame, 0, sizeof(mFrame));
+			mFrame.cmd = cmd;
+		};
+
+	public:
+		/**
+		 * Copy the frame of a script command created the classic way
+		 */
+		ScriptCommand(const FwCmdScript& cmd) {
+			memset(&mFrame, 0, sizeof(mFrame));
+			memcpy(&mFrame, cmd.GetData(), std::min(sizeof(mFrame), cmd.GetSize()));
+		};
+
+		static ScriptCommand Wait(uint16_t waitTime) {
+			ScriptCommand cmd(WAIT);
+			cmd.mFrame.data.wait.waitTmms = htons(std::max((uint16_t)1, waitTime));
+			return cmd;
+		};
+
+		static ScriptCommand LoopOn(void) {
+			return ScriptCommand(LOOP_ON);
+		};
+
+		static ScriptCommand LoopOff(uint8_t numLoops = 0) {
+			ScriptCommand cmd(LOOP_OFF);
+			cmd.mFrame.data.loopEnd.numLoops = numLoops;
+			return cmd;
+		};
+
+		/**
+		 * Same parameters as FwCmdSetFade
+		 */
+		static ScriptCommand Fade(uint32_t argb, uint16_t fadeTime = 0, uint32_t addr = 0xffffffff, bool parallelFade = false, uint8_t segment = SEGMENT_ALL) {
+			ScriptCommand cmd(SET_FADE);
+			cmd.mFrame.data.set_fade.Set(addr, argb, (uint8_t)parallelFade, fadeTime, segment);
+			return cmd;
+		};
+
+		/**
+		 * Same parameters as FwCmdSetGradient
+		 */
+		static ScriptCommand Gradient(uint32_t argb_1, uint32_t argb_2, uint16_t fadeTime = 0, bool parallelFade = false, uint8_t length = NUM_OF_LED, uint8_t offset = 0, uint8_t segment = 0) {
+			ScriptCommand cmd(SET_GRADIENT);
+			cmd.mFrame.data.set_gradient.Set(argb_1, argb_2, parallelFade, offset, length, fadeTime, segment);
+			return cmd;
+		};
+
+		uint8_t GetType(void) const { return mFrame.cmd; };
+
+		/**
+		 * @return the frame as it is send to the firmware, use GetSize() for its length
+		 */
+		const uint8_t *GetData(void) const { return reinterpret_cast<const uint8_t *>(&mFrame); };
+
+		size_t GetSize(void) const {
+			switch(mFrame.cmd) {
+			case SET_FADE: return 1 + sizeof(cmd_set_fade);
+			case SET_GRADIENT: return 1 + sizeof(cmd_set_gradient);
+			case WAIT: return 1 + sizeof(cmd_wait);
+			case LOOP_OFF: return 1 + sizeof(cmd_loop_end);
+			default: return 1;
+			}
+		};
+
+		const std::string& GetToken(void) const {
+			static const std::string unknown("unknown");
+			switch(mFrame.cmd) {
+			case SET_FADE: return FwCmdSetFade::TOKEN;
+			case SET_GRADIENT: return FwCmdSetGradient::TOKEN;
+			case WAIT: return FwCmdWait::TOKEN;
+			case LOOP_ON: return FwCmdLoopOn::TOKEN;
+			case LOOP_OFF: return FwCmdLoopOff::TOKEN;
+			default: return unknown;
+			}
+		};
+
+		/* WAIT */
+		uint16_t waitTime(void) const { return ntohs(mFrame.data.wait.waitTmms); };
+
+		/* LOOP_OFF */
+		uint8_t numLoops(void) const { return mFrame.data.loopEnd.numLoops; };
+
+		/* SET_FADE */
+		uint32_t addr(void) const {
+			const uns8 *const a = mFrame.data.set_fade.addr;
+			return (uint32_t)a[3] << 24 | (uint32_t)a[2] << 16 | (uint32_t)a[1] << 8 | a[0];
+		};
+
+		uint32_t argb(void) const {
+			return 0xff000000 | (uint32_t)mFrame.data.set_fade.red << 16 | (uint32_t)mFrame.data.set_fade.green << 8 | mFrame.data.set_fade.blue;
+		};
+
+		void argb(uint32_t argb) {
+			mFrame.data.set_fade.red = (uint8_t)(argb >> 16);
+			mFrame.data.set_fade.green = (uint8_t)(argb >> 8);
+			mFrame.data.set_fade.blue = (uint8_t)argb;
+		};
+
+		/* SET_FADE and SET_GRADIENT */
+		uint16_t fadeTime(void) const {
+			return ntohs((SET_GRADIENT == mFrame.cmd) ? mFrame.data.set_gradient.fadeTmms : mFrame.data.set_fade.fadeTmms);
+		};
+
+		void fadeTime(uint16_t tmms) {
+			if(SET_GRADIENT == mFrame.cmd) {
+				mFrame.data.set_gradient.fadeTmms = htons(tmms);
+			} else {
+				mFrame.data.set_fade.fadeTmms = htons(tmms);
+			}
+		};
+
+		bool parallelFade(void) const {
+			return (SET_GRADIENT == mFrame.cmd) ? (0 != (mFrame.data.set_gradient.parallelAndOffset & 0x80)) : (0 != mFrame.data.set_fade.parallelFade);
+		};
+
+		uint8_t segment(void) const {
+			return (SET_GRADIENT == mFrame.cmd) ? mFrame.data.set_gradient.segment : mFrame.data.set_fade.segment;
+		};
+
+		/* SET_GRADIENT */
+		uint32_t StartColor(void) const {
+			const cmd_set_gradient& g = mFrame.data.set_gradient;
+			return 0xff000000 | (uint32_t)g.red_1 << 16 | (uint32_t)g.green_1 << 8 | g.blue_1;
+		};
+
+		void StartColor(uint32_t argb) {
+			mFrame.data.set_gradient.red_1 = (uint8_t)(argb >> 16);
+			mFrame.data.set_gradient.green_1 = (uint8_t)(argb >> 8);
+			mFrame.data.set_gradient.blue_1 = (uint8_t)argb;
+		};
+
+		uint32_t EndColor(void) const {
+			const cmd_set_gradient& g = mFrame.data.set_gradient;
+			return 0xff000000 | (uint32_t)g.red_2 << 16 | (uint32_t)g.green_2 << 8 | g.blue_2;
+		};
+
+		void EndColor(uint32_t argb) {
+			mFrame.data.set_gradient.red_2 = (uint8_t)(argb >> 16);
+			mFrame.data.set_gradient.green_2 = (uint8_t)(argb >> 8);
+			mFrame.data.set_gradient.blue_2 = (uint8_t)argb;
+		};
+
+		uint8_t offset(void) const { return mFrame.data.set_gradient.parallelAndOffset & 0x7F; };
+
+		uint8_t length(void) const { return mFrame.data.set_gradient.numberOfLeds; };
+
+		/**
+		 * Write the command in the text format of a script file, the same as FwCmdScript::Write()
+		 */
+		std::ostream& Write(std::ostream& out, size_t& indentation) const {
+			if(LOOP_OFF == mFrame.cmd) {
+				--indentation;
+			}
+			const size_t numCharacters = std::min(FwCmdScript::INDENTATION_MAX, 2 * indentation);
+			out << std::string(numCharacters, FwCmdScript::INDENTATION_CHARACTER) << GetToken();
+			switch(mFrame.cmd) {
+			case SET_FADE:
+				return mFrame.data.set_fade.Write(out << ' ', indentation);
+			case SET_GRADIENT:
+				return mFrame.data.set_gradient.Write(out << ' ', indentation);
+			case WAIT:
+				return out << ' ' << std::dec << waitTime();
+			case LOOP_ON:
+				++indentation;
+				return out;
+			case LOOP_OFF:
+				return out << ' ' << std::dec << (int)numLoops();
+			}
+			return out;
+		};
+
+		bool operator==(const ScriptCommand& ref) const {
+			return (GetType() == ref.GetType()) && (0 == memcmp(GetData(), ref.GetData(), GetSize()));
+		};
+
+		bool operator!=(const ScriptCommand& ref) const {
+			return !(*this == ref);
+		};
+	};
+
+	static_assert(12 == sizeof(ScriptCommand), "ScriptCommand should be as small as the largest script frame");
+	static_assert(std::is_trivially_copyable<ScriptCommand>::value, "ScriptCommand has to be trivially copyable");
+
+	/**
+	 * Send a ScriptCommand through the regular FwCommand path
+	 */
+	class FwCmdScriptCommand : public FwCmdScript
+	{
+	public:
+		FwCmdScriptCommand(const ScriptCommand& cmd) : FwCmdScript(cmd.GetType(), cmd.GetSize() - 1) {
+			memcpy(&mReqFrame, cmd.GetData(), cmd.GetSize());
+		};
+	};
+
+	/**
+	 * Overwrite the command stored in slot <index> of the firmware script ring,
+	 * <index> is relative to the oldest command, which is still stored.
+	 */
+	class FwCmdSetScriptSlot : public FwCmdSimple
+	{
+	public:
+		FwCmdSetScriptSlot(uint8_t index, const ScriptCommand& cmd) throw (InvalidParameter) : FwCmdSimple(SET_SCRIPT_SLOT, 1 + cmd.GetSize()) {
+			if((LOOP_ON == cmd.GetType()) || (LOOP_OFF == cmd.GetType())) {
+				throw InvalidParameter("Loop commands can't replace a script slot");
+			}
+			mReqFrame.data.set_script_slot.index = index;
+			memcpy(&mReqFrame.data.set_script_slot.cmd, cmd.GetData(), cmd.GetSize());
+		};
+	};
+} /* namespace WyLight */
+#endif /* #ifndef __WyLight__ScriptCommand__ */
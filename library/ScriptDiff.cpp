@@ -0,0 +1,100 @@
+/*
+ Copyright (C) 2013 Nils Weiss, Patrick Bruenn.
+
+ This file is part of Wifly_Light.
+
+ Wifly_Light is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Wifly_Light is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Wifly_Light.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include "ScriptDiff.h"
+#include "trace.h"
+
+#include <algorithm>
+
+namespace WyLight {
+
+	static const uint32_t g_DebugZones = ZONE_ERROR | ZONE_WARNING | ZONE_INFO | ZONE_VERBOSE;
+
+	const size_t ScriptDiff::NO_TRUNCATION;
+
+	static bool IsLoop(const ScriptCommand& cmd)
+	{
+		return (LOOP_ON == cmd.GetType()) || (LOOP_OFF == cmd.GetType());
+	}
+
+	ScriptDiff::ScriptDiff(const Script& oldScript, const Script& newScript, const script_state& state)
+		: mNewScript(newScript), mRestart(false), mTruncation(NO_TRUNCATION), mAppend(newScript.size())
+	{
+		const size_t numStored = (state.write - state.read) & SCRIPTCTRL_NUM_CMD_MAX;
+		if(numStored > oldScript.size()) {
+			Trace(ZONE_INFO, "script ring contains unknown commands\n");
+			mRestart = true;
+			mAppend = 0;
+			return;
+		}
+
+		// the executed commands have to match, they can't be changed anymore
+		const size_t numExecuted = oldScript.size() - numStored;
+		if((newScript.size() < numExecuted) || !std::equal(oldScript.begin(), oldScript.begin() + numExecuted, newScript.begin())) {
+			mRestart = true;
+			mAppend = 0;
+			return;
+		}
+
+		const size_t numNew = newScript.size() - numExecuted;
+		const size_t numCommon = std::min(numStored, numNew);
+		for(size_t i = 0; i < numCommon; ++i) {
+			const ScriptCommand& oldCmd = oldScript[numExecuted + i];
+			const ScriptCommand& newCmd = newScript[numExecuted + i];
+			if(oldCmd == newCmd) {
+				continue;
+			}
+
+			// the firmware resolves loops while they are added, so we have to add them again
+			if(IsLoop(oldCmd) || IsLoop(newCmd)) {
+				mTruncation = i;
+				mAppend = numExecuted + i;
+				return;
+			}
+			mOverwrites.push_back(Overwrite {(uint8_t)i, newCmd});
+		}
+
+		if(numNew < numStored) {
+			mTruncation = numNew;
+		} else {
+			mAppend = numExecuted + numStored;
+		}
+	}
+
+	size_t ScriptDiff::NumCommands(void) const
+	{
+		return (mRestart ? 1 : 0) + mOverwrites.size() + ((NO_TRUNCATION != mTruncation) ? 1 : 0) + (mNewScript.size() - mAppend);
+	}
+
+	void ScriptDiff::Apply(Control& control) const throw (ConnectionTimeout, FatalError, ScriptBufferFull)
+	{
+		if(mRestart) {
+			control << FwCmdClearScript();
+		}
+		for(const auto& overwrite : mOverwrites) {
+			control << FwCmdSetScriptSlot(overwrite.index, overwrite.cmd);
+		}
+		if(NO_TRUNCATION != mTruncation) {
+			control << FwCmdTruncateScript((uint8_t)mTruncation);
+		}
+		for(size_t i = mAppend; i < mNewScript.size(); ++i) {
+			control << FwCmdScriptCommand(mNewScript[i]);
+		}
+		Trace(ZONE_VERBOSE, "updated script with %zu commands\n", NumCommands());
+	}
+} /* namespace WyLight */
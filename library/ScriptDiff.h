@@ -0,0 +1,100 @@
+/*
+ Copyright (C) 2013 Nils Weiss, Patrick Bruenn.
+
+ This file is part of Wifly_Light.
+
+ Wifly_Light is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Wifly_Light is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Wifly_Light.  If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef __WyLight__ScriptDiff__
+#define __WyLight__ScriptDiff__
+
+#include "Script.h"
+#include "WiflyControl.h"
+#include "WiflyControlException.h"
+
+#include <stdint.h>
+#include <vector>
+
+namespace WyLight {
+
+	/******************************************************************************/
+	/*! \file ScriptDiff.h
+	 * \brief Minimal edit to replace a script, which was sent to the firmware
+	 *
+	 * Instead of clearing the script ring and sending each command again, the
+	 * diff overwrites changed commands in place (SET_SCRIPT_SLOT). If the loop
+	 * structure or the length of the script changed, the ring is truncated
+	 * (TRUNCATE_SCRIPT) at the first difference and the rest of the new script
+	 * is appended.
+	 *
+	 * Commands the firmware executed already left the ring, they can't be
+	 * edited anymore. If the new script differs in these commands, it is sent
+	 * from the start.
+	 *******************************************************************************/
+	class ScriptDiff
+	{
+	public:
+		struct Overwrite {
+			uint8_t index;
+			ScriptCommand cmd;
+		};
+
+		static const size_t NO_TRUNCATION = SIZE_MAX;
+
+		/**
+		 * Compare <oldScript>, which was sent completely, with <newScript>
+		 * @param state of the firmware script ring, it tells how many commands of
+		 *        <oldScript> are still stored
+		 */
+		ScriptDiff(const Script& oldScript, const Script& newScript, const script_state& state);
+
+		/**
+		 * @return true if the script ring has to be cleared and the whole new script sent
+		 */
+		bool IsRestartRequired(void) const { return mRestart; };
+
+		/**
+		 * @return slots to overwrite in place, the index is relative to the oldest stored command
+		 */
+		const std::vector<Overwrite>& GetOverwrites(void) const { return mOverwrites; };
+
+		/**
+		 * @return first slot to remove or NO_TRUNCATION
+		 */
+		size_t GetTruncation(void) const { return mTruncation; };
+
+		/**
+		 * @return index of the first command of the new script, which has to be appended
+		 */
+		size_t GetAppendIndex(void) const { return mAppend; };
+
+		/**
+		 * @return number of commands Apply() sends to the firmware
+		 */
+		size_t NumCommands(void) const;
+
+		/**
+		 * Send the edit to the firmware
+		 */
+		void Apply(Control& control) const throw (ConnectionTimeout, FatalError, ScriptBufferFull);
+
+	private:
+		const Script mNewScript;
+		bool mRestart;
+		std::vector<Overwrite> mOverwrites;
+		size_t mTruncation;
+		size_t mAppend;
+	};
+} /* namespace WyLight */
+#endif /* #ifndef __WyLight__ScriptDiff__ */
@@ -0,0 +1,424 @@
+/*
+ Copyright (C) 2013 Nils Weiss, Patrick Bruenn.
+
+ This file is part of Wifly_Light.
+
+ Wifly_Light is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Wifly_Light is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Wifly_Light.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include "unittest.h"
+#include "ScriptDiff.h"
+#include "ScriptSimulator.h"
+#include "CommandIO.h"
+#include "ScriptCtrl.h"
+#include "eeprom.h"
+#include "ledstrip.h"
+#include <random>
+
+using namespace WyLight;
+
+static const uint32_t g_DebugZones = ZONE_ERROR | ZONE_WARNING | ZONE_INFO | ZONE_VERBOSE;
+
+const std::string FwCmdSetFade::TOKEN("fade");
+const std::string FwCmdSetGradient::TOKEN("gradient");
+const std::string FwCmdLoopOn::TOKEN("loop");
+const std::string FwCmdLoopOff::TOKEN("loop_off");
+const std::string FwCmdWait::TOKEN("wait");
+
+const size_t FwCmdScript::INDENTATION_MAX;
+const char FwCmdScript::INDENTATION_CHARACTER;
+
+/***** Wrappers ****/
+ClientSocket::ClientSocket(uint32_t addr, uint16_t port, int style) throw (FatalError) : mSock(0), mSockAddr(addr, port) {}
+ClientSocket::~ClientSocket(void) {}
+TcpSocket::TcpSocket(uint32_t addr, uint16_t port, uint32_t interfaceIndex, uint32_t connectTimeoutMs) throw (ConnectionLost, FatalError) : ClientSocket(addr, port, 0) {}
+size_t TcpSocket::Recv(uint8_t *pBuffer, size_t length, timeval *timeout) const throw (FatalError) {
+	return 0;
+}
+size_t TcpSocket::Send(const uint8_t *frame, size_t length) const {
+	return 0;
+}
+ComProxy::ComProxy(const TcpSocket& sock) : mSock (sock) {}
+TelnetProxy::TelnetProxy(const TcpSocket& sock) : mSock (sock) {}
+UdpSocket::UdpSocket(uint32_t addr, uint16_t port, bool doBind, int enableBroadcast, uint32_t interfaceIndex) throw (FatalError) : ClientSocket(addr, port, SOCK_DGRAM) {}
+size_t UdpSocket::Send(const uint8_t *frame, size_t length) const {
+	return length;
+}
+
+Control::Control(uint32_t addr, uint16_t port, uint32_t interfaceIndex, uint32_t connectTimeoutMs)
+	: mTcpSock(addr, port), mUdpSock(addr, port, false, 0), mProxy(mTcpSock), mTelnet(mTcpSock), mCredit(0)
+{}
+
+static size_t g_NumCommands;
+
+/* the control talks directly to the firmware script controller */
+script_state Control::FwGetScriptState(void) throw (ConnectionTimeout, FatalError, ScriptBufferFull)
+{
+	script_state state;
+	ScriptCtrl_GetState(&state);
+	return state;
+}
+
+Control& Control::operator<<(FwCommand&& cmd) throw (ConnectionTimeout, FatalError, ScriptBufferFull)
+{
+	struct led_cmd frame;
+	memcpy(&frame, cmd.GetData(), cmd.GetSize());
+	++g_NumCommands;
+	switch(ScriptCtrl_Add(&frame)) {
+	case OK:
+		break;
+	case BAD_SCRIPT_INDEX:
+		throw InvalidParameter("");
+	default:
+		throw ScriptBufferFull();
+	}
+
+	// the main cycle completes a CLEAR_SCRIPT before the next command arrives
+	if(CLEAR_SCRIPT == frame.cmd) {
+		ScriptCtrl_Run();
+	}
+	return *this;
+}
+
+/**************** wrapping the firmware ****************/
+jmp_buf g_ResetEnvironment;
+struct response_frame g_ResponseBuf;
+
+void CommandIO_CreateResponse(struct response_frame *mFrame, uns8 cmd, ErrorCode mState)
+{}
+
+void CommandIO_SendResponse(struct response_frame *mFrame)
+{}
+
+void UART_Flush(void)
+{}
+
+void SPI_Init(void)
+{}
+
+void SPI_SendLedBuffer(uns8 *array)
+{}
+
+static void Firmware_Init(void)
+{
+	Ledstrip_Init();
+	ScriptCtrl_Clear();
+	gScriptBuf.loopDepth = 0;
+	g_NumCommands = 0;
+}
+
+/**
+ * Upload <script> as a whole, like the sendscript command does
+ */
+static void Firmware_Load(Control& control, const Script& script)
+{
+	Firmware_Init();
+	for(const auto& cmd : script) {
+		control << FwCmdScriptCommand(cmd);
+	}
+	g_NumCommands = 0;
+}
+
+/**
+ * Run everything up to the next time consuming command
+ */
+static void Firmware_RunCommands(void)
+{
+	for(size_t i = 0; i < ScriptSimulator::MAX_COMMANDS_PER_TICK; ++i) {
+		ScriptCtrl_Run();
+	}
+}
+
+/**
+ * One timer interrupt followed by the main cycle
+ */
+static void Firmware_Step(void)
+{
+	ScriptCtrl_DecrementWaitValue();
+	ScriptCtrl_Run();
+	Ledstrip_DoFade();
+	Firmware_RunCommands();
+}
+
+/**
+ * Compare the commands stored in the firmware script ring with the end of <script>
+ */
+static bool Firmware_Stores(const Script& script)
+{
+	script_state state;
+	ScriptCtrl_GetState(&state);
+	const size_t numStored = (state.write - state.read) & SCRIPTCTRL_NUM_CMD_MAX;
+	if(numStored > script.size()) {
+		return false;
+	}
+
+	for(size_t i = 0; i < numStored; ++i) {
+		const ScriptCommand& cmd = script[script.size() - numStored + i];
+		struct led_cmd stored;
+		const uns8 slot = (state.read + i) & SCRIPTCTRL_NUM_CMD_MAX;
+		Eeprom_ReadBlock((uns8 *)&stored, EEPROM_SCRIPTBUF_BASE + slot * sizeof(struct led_cmd), sizeof(stored));
+		if(cmd.GetType() != stored.cmd) {
+			return false;
+		}
+		// loop_off is completed by the firmware
+		if(LOOP_OFF == cmd.GetType()) {
+			if(cmd.numLoops() != stored.data.loopEnd.numLoops) {
+				return false;
+			}
+		} else if(0 != memcmp(cmd.GetData(), &stored, cmd.GetSize())) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool Firmware_Equals(const ScriptSimulator& simulator)
+{
+	return 0 == memcmp(gLedBuf.led_array, simulator.GetLedArray(), sizeof(gLedBuf.led_array));
+}
+
+static void AddRandomBlock(Script& script, std::mt19937& rng, size_t depth)
+{
+	const size_t numCommands = 1 + rng() % 5;
+	for(size_t i = 0; (i < numCommands) && (script.size() < 40); ++i) {
+		const uint32_t color = 0xff000000 | (rng() & 0xffffff);
+		switch(rng() % 5) {
+		case 0:
+			script.push_back(FwCmdWait(1 + rng() % 50));
+			break;
+		case 1:
+			if(depth < ScriptSimulator::LOOP_DEPTH_MAX) {
+				script.push_back(FwCmdLoopOn());
+				AddRandomBlock(script, rng, depth + 1);
+				script.push_back(FwCmdWait(1 + rng() % 50));
+				script.push_back(FwCmdLoopOff(1 + rng() % 3));
+				break;
+			}
+		case 2:
+			script.push_back(FwCmdSetGradient(color, 0xff000000 | (rng() & 0xffffff), 1 + rng() % 100, rng() & 1, NUM_OF_LED, 0));
+			break;
+		default:
+			script.push_back(FwCmdSetFade(color, 1 + rng() % 100, rng(), rng() & 1));
+			break;
+		}
+	}
+}
+
+/**
+ * Typical edits while working on a script
+ */
+static Script Mutate(const Script& script, std::mt19937& rng)
+{
+	Script mutated;
+	const size_t position = rng() % script.size();
+	const unsigned int kind = rng() % 4;
+	for(size_t i = 0; i < script.size(); ++i) {
+		ScriptCommand cmd = script[i];
+		if(i == position) {
+			if(0 == kind) {
+				if(SET_FADE == cmd.GetType()) {
+					cmd.argb(rng());
+				} else if(SET_GRADIENT == cmd.GetType()) {
+					cmd.EndColor(rng());
+				} else if(LOOP_OFF == cmd.GetType()) {
+					cmd = ScriptCommand::LoopOff(1 + cmd.numLoops());
+				}
+			} else if((1 == kind) && (LOOP_ON != cmd.GetType()) && (LOOP_OFF != cmd.GetType())) {
+				// delete
+				continue;
+			} else if(2 == kind) {
+				mutated.push_back(ScriptCommand::Wait(1 + rng() % 20));
+			}
+		}
+		mutated.push_back(cmd);
+	}
+	if(3 == kind) {
+		mutated.push_back(ScriptCommand::Fade(0xff000000 | rng(), 1 + rng() % 50));
+	}
+	return mutated;
+}
+
+static script_state StateOf(size_t numStored)
+{
+	const script_state state {(uns8)(SCRIPTCTRL_NUM_CMD_MAX - numStored), 0, 0, (uns8)numStored};
+	return state;
+}
+
+size_t ut_ScriptDiff_Edits(void)
+{
+	TestCaseBegin();
+	Script script;
+	script.push_back(FwCmdLoopOn());
+	for(size_t i = 0; i < 58; ++i) {
+		script.push_back(FwCmdSetFade(0xff000000 | i, 10));
+	}
+	script.push_back(FwCmdLoopOff(0));
+	const script_state state = StateOf(script.size());
+
+	ScriptDiff unchanged(script, script, state);
+	CHECK(!unchanged.IsRestartRequired());
+	CHECK(0 == unchanged.NumCommands());
+
+	// a single fade is overwritten in place
+	Script fade(script);
+	fade[30] = ScriptCommand::Fade(0xffff0000, 10);
+	ScriptDiff fadeDiff(script, fade, state);
+	CHECK(1 == fadeDiff.NumCommands());
+	CHECK(1 == fadeDiff.GetOverwrites().size());
+	CHECK(30 == fadeDiff.GetOverwrites()[0].index);
+	CHECK(fade[30] == fadeDiff.GetOverwrites()[0].cmd);
+	CHECK(ScriptDiff::NO_TRUNCATION == fadeDiff.GetTruncation());
+
+	// loops are added again
+	Script loop(script);
+	loop[59] = ScriptCommand::LoopOff(2);
+	ScriptDiff loopDiff(script, loop, state);
+	CHECK(2 == loopDiff.NumCommands());
+	CHECK(59 == loopDiff.GetTruncation());
+	CHECK(59 == loopDiff.GetAppendIndex());
+
+	// shorter and longer scripts
+	Script shorter;
+	shorter.push_back(FwCmdWait(10));
+	shorter.push_back(FwCmdWait(20));
+	Script longer(shorter);
+	longer.push_back(FwCmdWait(30));
+	ScriptDiff longDiff(shorter, longer, StateOf(shorter.size()));
+	CHECK(0 == longDiff.GetOverwrites().size());
+	CHECK(ScriptDiff::NO_TRUNCATION == longDiff.GetTruncation());
+	CHECK(2 == longDiff.GetAppendIndex());
+	CHECK(1 == longDiff.NumCommands());
+	ScriptDiff shortDiff(longer, shorter, StateOf(longer.size()));
+	CHECK(2 == shortDiff.GetTruncation());
+	CHECK(1 == shortDiff.NumCommands());
+
+	// the first command was executed already and can't be changed
+	Script executed;
+	executed.push_back(FwCmdWait(10));
+	executed.push_back(FwCmdWait(20));
+	Script changed(executed);
+	changed[0] = ScriptCommand::Wait(30);
+	ScriptDiff restart(executed, changed, StateOf(1));
+	CHECK(restart.IsRestartRequired());
+	CHECK(3 == restart.NumCommands());
+	changed[0] = ScriptCommand::Wait(10);
+	changed[1] = ScriptCommand::Wait(30);
+	ScriptDiff noRestart(executed, changed, StateOf(1));
+	CHECK(!noRestart.IsRestartRequired());
+	CHECK(1 == noRestart.NumCommands());
+	TestCaseEnd();
+}
+
+/**
+ * Edit random scripts in the firmware, it has to show the same colors as if
+ * the new script was uploaded after a clear.
+ */
+size_t ut_ScriptDiff_GoldenFirmware(void)
+{
+	TestCaseBegin();
+	std::mt19937 rng(4711);
+	Control control(0, 0);
+	size_t numCommands = 0;
+	size_t numFull = 0;
+	for(size_t i = 0; i < 200; ++i) {
+		Script oldScript;
+		AddRandomBlock(oldScript, rng, 0);
+		AddRandomBlock(oldScript, rng, 0);
+		const Script newScript = Mutate(oldScript, rng);
+
+		Firmware_Load(control, oldScript);
+		const ScriptDiff diff(oldScript, newScript, control.FwGetScriptState());
+		diff.Apply(control);
+		CHECK(diff.NumCommands() == g_NumCommands);
+		CHECK(Firmware_Stores(newScript));
+		numCommands += g_NumCommands;
+		numFull += newScript.size();
+
+		ScriptSimulator simulator(newScript);
+		Firmware_RunCommands();
+		for(size_t tick = 0; tick < 2000; ++tick) {
+			if(!Firmware_Equals(simulator)) {
+				CHECK(false);
+				Trace(ZONE_ERROR, "script %zu differs at tick %zu\n", i, tick);
+				break;
+			}
+			Firmware_Step();
+			simulator.Step();
+		}
+	}
+	Trace(ZONE_INFO, "%zu commands instead of %zu\n", numCommands, numFull);
+	CHECK(numCommands < numFull / 3);
+	TestCaseEnd();
+}
+
+/**
+ * Edit a script while it is running
+ */
+size_t ut_ScriptDiff_RunningScript(void)
+{
+	TestCaseBegin();
+	Control control(0, 0);
+	Script oldScript;
+	oldScript.push_back(FwCmdSetFade(0xffff0000, 10));
+	oldScript.push_back(FwCmdWait(10));
+	oldScript.push_back(FwCmdLoopOn());
+	oldScript.push_back(FwCmdSetFade(0xff00ff00, 10));
+	oldScript.push_back(FwCmdSetFade(0xff0000ff, 10));
+	oldScript.push_back(FwCmdLoopOff(0));
+	Firmware_Load(control, oldScript);
+	for(size_t tick = 0; tick < 50; ++tick) {
+		Firmware_Step();
+	}
+	CHECK(gScriptBuf.inLoop);
+
+	// change a color inside the running loop
+	Script newScript(oldScript);
+	newScript[4] = ScriptCommand::Fade(0xffffffff, 10);
+	ScriptDiff colorDiff(oldScript, newScript, control.FwGetScriptState());
+	CHECK(1 == colorDiff.NumCommands());
+	colorDiff.Apply(control);
+	CHECK(Firmware_Stores(newScript));
+
+	// replace the loop with a single fade
+	Script fadeScript;
+	for(size_t i = 0; i < 2; ++i) {
+		fadeScript.push_back(oldScript[i]);
+	}
+	fadeScript.push_back(FwCmdSetFade(0xff123456, 10));
+	ScriptDiff fadeDiff(newScript, fadeScript, control.FwGetScriptState());
+	CHECK(0 == fadeDiff.GetTruncation());
+	fadeDiff.Apply(control);
+	CHECK(Firmware_Stores(fadeScript));
+	CHECK(!gScriptBuf.inLoop);
+	for(size_t tick = 0; tick < 20; ++tick) {
+		Firmware_Step();
+	}
+	CHECK(0x56 == gLedBuf.led_array[0]);
+	CHECK(0x34 == gLedBuf.led_array[1]);
+	CHECK(0x12 == gLedBuf.led_array[2]);
+
+	// changing a command which was executed already requires a restart
+	fadeScript[0] = ScriptCommand::Fade(0xff000000, 10);
+	ScriptDiff restart(oldScript, fadeScript, control.FwGetScriptState());
+	CHECK(restart.IsRestartRequired());
+	TestCaseEnd();
+}
+
+int main (int argc, const char *argv[])
+{
+	UnitTestMainBegin();
+	RunTest(true, ut_ScriptDiff_Edits);
+	RunTest(true, ut_ScriptDiff_GoldenFirmware);
+	RunTest(true, ut_ScriptDiff_RunningScript);
+	UnitTestMainEnd();
+}
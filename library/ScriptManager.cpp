@@ -18,47 +18,134 @@
 
 #include "ScriptManager.h"
 #include "trace.h"
-#include <sys/types.h>
+#include <algorithm>
 #include <dirent.h>
+#include <future>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
 
 namespace WyLight {
 
 	static const uint32_t g_DebugZones = ZONE_ERROR | ZONE_WARNING | ZONE_INFO | ZONE_VERBOSE;
-	static const std::string EMPTY_STRING {};
 	const std::string ScriptManager::EXTENSION {".wyscript"};
 
-	ScriptManager::ScriptManager(const std::string& path) throw (FatalError)
-		: m_Path(path + '/')
+#ifdef __linux__
+	static const uint32_t WATCH_EVENTS = IN_CLOSE_WRITE | IN_MODIFY | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO;
+#endif
+
+	/**
+	 * Read modification time in nanoseconds and size of <path>
+	 * @return false if <path> doesn't exist
+	 */
+	static bool GetModification(const std::string& path, int64_t& modified, off_t& size)
 	{
-		DIR *const searchDir = opendir(path.c_str());
-		if(NULL == searchDir) {
-			throw FatalError("Open script directory failed");
+		struct stat fileStat;
+		if(0 != stat(path.c_str(), &fileStat)) {
+			return false;
 		}
+#ifdef __APPLE__
+		modified = (int64_t)fileStat.st_mtimespec.tv_sec * 1000000000 + fileStat.st_mtimespec.tv_nsec;
+#else
+		modified = (int64_t)fileStat.st_mtim.tv_sec * 1000000000 + fileStat.st_mtim.tv_nsec;
+#endif
+		size = fileStat.st_size;
+		return true;
+	}
 
-		for(struct dirent *file = readdir(searchDir); NULL != file; file = readdir(searchDir)) {
-			std::string filename(file->d_name);
-			if(hasScriptFileExtension(filename)) {
-				m_ScriptFiles.push_back(filename);
+	/**
+	 * Like GetModification(), but returns -1 as modification time if <path> was
+	 * modified so recently, that another change could end up with the same timestamp.
+	 * Such entries never match and are read again on the next access.
+	 */
+	static bool GetStableModification(const std::string& path, int64_t& modified, off_t& size)
+	{
+		// FAT stores modification times with two seconds resolution
+		static const int64_t RACY_INTERVAL = 2000000000;
+
+		if(!GetModification(path, modified, size)) {
+			return false;
+		}
+		struct timespec now;
+		clock_gettime(CLOCK_REALTIME, &now);
+		if(modified + RACY_INTERVAL > (int64_t)now.tv_sec * 1000000000 + now.tv_nsec) {
+			modified = -1;
+		}
+		return true;
+	}
+
+	ScriptManager::ScriptManager(const std::string& path, Watch watch) throw (FatalError)
+		: m_Path(path + '/'), m_DirModified(0), m_WatchFd(-1)
+	{
+#ifdef __linux__
+		// start watching before the scan, so we can't miss any change
+		if(WATCH_INOTIFY == watch) {
+			m_WatchFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+			if((-1 != m_WatchFd) && (-1 == inotify_add_watch(m_WatchFd, path.c_str(), WATCH_EVENTS))) {
+				close(m_WatchFd);
+				m_WatchFd = -1;
 			}
 		}
-		closedir(searchDir);
-		std::sort(m_ScriptFiles.begin(), m_ScriptFiles.end());
+#endif
+		if((WATCH_INOTIFY == watch) && !isWatching()) {
+			Trace(ZONE_WARNING, "inotify unavailable, polling '%s' for changes\n", path.c_str());
+		}
+
+		try {
+			scanDirectory();
+		} catch(FatalError& e) {
+			if(isWatching()) {
+				close(m_WatchFd);
+			}
+			throw;
+		}
+		preload();
 	}
 
 	ScriptManager::~ScriptManager(void)
-	{}
+	{
+		if(isWatching()) {
+			close(m_WatchFd);
+		}
+	}
 
 	Script ScriptManager::getScript(size_t index) const throw (FatalError)
 	{
-		return Script {m_Path + getScriptName(index)};
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		update();
+		const std::string& name = nameAt(index);
+		const std::string filename = m_Path + name;
+
+		auto cached = m_Cache.find(name);
+		if(m_Cache.end() != cached) {
+			// with inotify outdated entries are already removed by update()
+			if(isWatching()) {
+				return *cached->second.script;
+			}
+
+			int64_t modified;
+			off_t size;
+			if(GetModification(filename, modified, size) && (modified == cached->second.modified) && (size == cached->second.size)) {
+				return *cached->second.script;
+			}
+			m_Cache.erase(cached);
+		}
+
+		const CachedScript entry = load(filename);
+		m_Cache.emplace(name, entry);
+		return *entry.script;
 	}
 
-	const std::string& ScriptManager::getScriptName(size_t index) const throw (FatalError)
+	std::string ScriptManager::getScriptName(size_t index) const throw (FatalError)
 	{
-		if(index < m_ScriptFiles.size()) {
-			return m_ScriptFiles[index];
-		}
-		throw FatalError("ScriptManager: Index out of bounds");
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		update();
+		return nameAt(index);
 	}
 
 	bool ScriptManager::hasScriptFileExtension(const std::string& filename)
@@ -69,8 +156,129 @@ namespace WyLight {
 		return (0 == filename.compare(filename.length() - EXTENSION.length(), EXTENSION.length(), EXTENSION));
 	}
 
+	ScriptManager::CachedScript ScriptManager::load(const std::string& filename) throw (FatalError)
+	{
+		// stat before parsing, a change while we parse is detected on the next access
+		CachedScript entry {0, 0, nullptr};
+		GetStableModification(filename, entry.modified, entry.size);
+		entry.script = std::make_shared<const Script>(filename);
+		return entry;
+	}
+
+	const std::string& ScriptManager::nameAt(size_t index) const throw (FatalError)
+	{
+		if(index < m_ScriptFiles.size()) {
+			return m_ScriptFiles[index];
+		}
+		throw FatalError("ScriptManager: Index out of bounds");
+	}
+
 	size_t ScriptManager::numScripts() const
 	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		update();
 		return m_ScriptFiles.size();
 	}
+
+	void ScriptManager::preload(void)
+	{
+		const size_t numFiles = m_ScriptFiles.size();
+		const size_t numWorkers = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), numFiles);
+		std::vector<CachedScript> loaded(numFiles);
+		std::vector<std::future<void> > workers;
+
+		for(size_t worker = 0; worker < numWorkers; ++worker) {
+			workers.push_back(std::async(std::launch::async, [this, &loaded, worker, numWorkers]() {
+				for(size_t i = worker; i < loaded.size(); i += numWorkers) {
+					try {
+						loaded[i] = load(m_Path + m_ScriptFiles[i]);
+					} catch(FatalError& e) {
+						// not cached, getScript() will report the error
+						Trace(ZONE_WARNING, "preloading '%s' failed: %s\n", m_ScriptFiles[i].c_str(), e.what());
+					}
+				}
+			}));
+		}
+		for(auto& worker : workers) {
+			worker.get();
+		}
+
+		for(size_t i = 0; i < numFiles; ++i) {
+			if(loaded[i].script) {
+				m_Cache.emplace(m_ScriptFiles[i], loaded[i]);
+			}
+		}
+		Trace(ZONE_INFO, "preloaded %zu of %zu scripts with %zu threads\n", m_Cache.size(), numFiles, numWorkers);
+	}
+
+	void ScriptManager::scanDirectory(void) const throw (FatalError)
+	{
+		off_t size;
+		if(!GetStableModification(m_Path, m_DirModified, size)) {
+			throw FatalError("Open script directory failed");
+		}
+
+		DIR *const searchDir = opendir(m_Path.c_str());
+		if(NULL == searchDir) {
+			throw FatalError("Open script directory failed");
+		}
+
+		m_ScriptFiles.clear();
+		for(struct dirent *file = readdir(searchDir); NULL != file; file = readdir(searchDir)) {
+			std::string filename(file->d_name);
+			if(hasScriptFileExtension(filename)) {
+				m_ScriptFiles.push_back(filename);
+			}
+		}
+		closedir(searchDir);
+		std::sort(m_ScriptFiles.begin(), m_ScriptFiles.end());
+
+		// drop scripts which were removed from the directory
+		for(auto it = m_Cache.begin(); it != m_Cache.end();) {
+			if(std::binary_search(m_ScriptFiles.begin(), m_ScriptFiles.end(), it->first)) {
+				++it;
+			} else {
+				it = m_Cache.erase(it);
+			}
+		}
+	}
+
+	void ScriptManager::update(void) const
+	{
+		bool rescan = false;
+#ifdef __linux__
+		if(isWatching()) {
+			alignas(struct inotify_event) char buffer[4096];
+			for(ssize_t bytesRead = read(m_WatchFd, buffer, sizeof(buffer)); bytesRead > 0; bytesRead = read(m_WatchFd, buffer, sizeof(buffer))) {
+				for(const char *pNext = buffer; pNext < buffer + bytesRead;) {
+					const struct inotify_event *const event = reinterpret_cast<const struct inotify_event *>(pNext);
+					if(event->mask & IN_Q_OVERFLOW) {
+						// events were lost, so we can't trust anything we cached
+						m_Cache.clear();
+						rescan = true;
+					} else if((event->len > 0) && hasScriptFileExtension(event->name)) {
+						m_Cache.erase(event->name);
+						rescan |= (0 != (event->mask & (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO)));
+					}
+					pNext += sizeof(struct inotify_event) + event->len;
+				}
+			}
+		} else
+#endif
+		{
+			int64_t modified;
+			off_t size;
+			rescan = !GetModification(m_Path, modified, size) || (modified != m_DirModified);
+		}
+
+		if(rescan) {
+			try {
+				scanDirectory();
+			} catch(FatalError& e) {
+				Trace(ZONE_WARNING, "rescan of '%s' failed: %s\n", m_Path.c_str(), e.what());
+				m_ScriptFiles.clear();
+				m_Cache.clear();
+			}
+		}
+	}
 } /* namespace WyLight */
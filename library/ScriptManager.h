@@ -21,26 +21,73 @@
 
 #include "Script.h"
 #include "WiflyControlException.h"
+#include <memory>
+#include <mutex>
+#include <stdint.h>
 #include <string>
+#include <sys/types.h>
+#include <unordered_map>
 #include <vector>
 
 namespace WyLight {
 
+	/******************************************************************************/
+	/*! \file ScriptManager.h
+	 * \brief Lists the scripts of a directory and caches them after parsing
+	 *
+	 * All scripts are parsed in parallel during construction and kept in memory
+	 * keyed by their filename, modification time and size. Changes to the
+	 * directory are picked up on the next access: with inotify, if available,
+	 * otherwise by comparing modification times and sizes.
+	 *******************************************************************************/
 	class ScriptManager
 	{
+	struct CachedScript {
+		int64_t modified;
+		off_t size;
+		std::shared_ptr<const Script> script;
+	};
+
 	const std::string m_Path;
-	std::vector<std::string> m_ScriptFiles;
+	mutable std::vector<std::string> m_ScriptFiles;
+	mutable std::unordered_map<std::string, CachedScript> m_Cache;
+	mutable std::mutex m_Mutex;
+	mutable int64_t m_DirModified;
+	int m_WatchFd;
+
 	static bool hasScriptFileExtension(const std::string& filename);
+	static CachedScript load(const std::string& filename) throw (FatalError);
+	const std::string& nameAt(size_t index) const throw (FatalError);
+	void scanDirectory(void) const throw (FatalError);
+	void preload(void);
+	void update(void) const;
 
 	public:
 		static const std::string EXTENSION;
 
-		ScriptManager(const std::string& path) throw (FatalError);
+		enum Watch {
+			WATCH_INOTIFY,
+			WATCH_POLLING
+		};
+
+		/**
+		 * Scan <path> for scripts and parse all of them in parallel
+		 * @param watch WATCH_INOTIFY falls back to WATCH_POLLING if inotify is unavailable
+		 * @throw FatalError if <path> can't be opened
+		 */
+		ScriptManager(const std::string& path, Watch watch = WATCH_INOTIFY) throw (FatalError);
+		ScriptManager(const ScriptManager&) = delete;
+		ScriptManager& operator=(const ScriptManager&) = delete;
 		~ScriptManager(void);
 
+		/**
+		 * @return the parsed script, which is only read from disk if it changed since the last call
+		 * @throw FatalError if <index> is out of bounds or parsing the script failed
+		 */
 		Script getScript(size_t index) const throw (FatalError);
-		const std::string& getScriptName(size_t index) const throw (FatalError);
+		std::string getScriptName(size_t index) const throw (FatalError);
 		size_t numScripts() const;
+		bool isWatching(void) const { return -1 != m_WatchFd; };
 	};
 } /* namespace WyLight */
 #endif /* #ifndef __WyLight__ScriptManager__ */
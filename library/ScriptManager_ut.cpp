@@ -69,11 +69,73 @@ size_t ut_ScriptManager_Good(void)
 	TestCaseEnd();
 }
 
+static std::string TempScript(const std::string& name)
+{
+	return std::string("./binary/") + name + ScriptManager::EXTENSION;
+}
+
+static size_t CheckCacheInvalidation(ScriptManager::Watch watch)
+{
+	TestCaseBegin();
+	const Script refScript("TestInput.txt");
+	const Script refScript2("TestInput2.txt");
+	Script::serialize(TempScript("TestOutput1"), refScript);
+	Script::serialize(TempScript("TestOutput2"), refScript2);
+
+	ScriptManager testee {"./binary", watch};
+	CHECK((ScriptManager::WATCH_INOTIFY == watch) == testee.isWatching());
+	CHECK(        2 == testee.numScripts());
+	CHECK(refScript == testee.getScript(0));
+	CHECK(refScript == testee.getScript(0));
+	CHECK(refScript2 == testee.getScript(1));
+
+	// modified script
+	Script::serialize(TempScript("TestOutput1"), refScript2);
+	CHECK(refScript2 == testee.getScript(0));
+
+	// new script
+	Script::serialize(TempScript("TestOutput0"), refScript);
+	CHECK(        3 == testee.numScripts());
+	CHECK(0 == testee.getScriptName(0).compare("TestOutput0" + ScriptManager::EXTENSION));
+	CHECK(refScript == testee.getScript(0));
+	CHECK(refScript2 == testee.getScript(1));
+
+	// removed script
+	std::remove(TempScript("TestOutput0").c_str());
+	CHECK(        2 == testee.numScripts());
+	CHECK(refScript2 == testee.getScript(0));
+
+	// renamed script
+	std::rename(TempScript("TestOutput2").c_str(), TempScript("TestOutput3").c_str());
+	CHECK(        2 == testee.numScripts());
+	CHECK(0 == testee.getScriptName(1).compare("TestOutput3" + ScriptManager::EXTENSION));
+	CHECK(refScript2 == testee.getScript(1));
+
+	std::remove(TempScript("TestOutput1").c_str());
+	std::remove(TempScript("TestOutput3").c_str());
+	CHECK(        0 == testee.numScripts());
+	TestCaseEnd();
+}
+
+size_t ut_ScriptManager_Inotify(void)
+{
+	return CheckCacheInvalidation(ScriptManager::WATCH_INOTIFY);
+}
+
+size_t ut_ScriptManager_Polling(void)
+{
+	return CheckCacheInvalidation(ScriptManager::WATCH_POLLING);
+}
+
 int main (int argc, const char *argv[])
 {
 	UnitTestMainBegin();
 	RunTest(true, ut_ScriptManager_Empty);
 	RunTest(true, ut_ScriptManager_Good);
+#ifdef __linux__
+	RunTest(true, ut_ScriptManager_Inotify);
+#endif
+	RunTest(true, ut_ScriptManager_Polling);
 	UnitTestMainEnd();
 }
 
@@ -0,0 +1,569 @@
+/*
+ Copyright (C) 2013 Nils Weiss, Patrick Bruenn.
+
+ This file is part of Wifly_Light.
+
+ Wifly_Light is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Wifly_Light is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Wifly_Light.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include "ScriptOptimizer.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <array>
+#include <map>
+#include <vector>
+
+namespace WyLight {
+
+	static const uint32_t g_DebugZones = ZONE_ERROR | ZONE_WARNING;
+
+	/**
+	 * Tree representation of a script, loops own their body
+	 */
+	struct ScriptNode {
+		uint8_t cmd;
+		uint32_t addr;
+		uint32_t argb;
+		uint32_t argb2;
+		uint16_t time;
+		bool parallel;
+		uint8_t offset;
+		uint8_t length;
+		uint8_t numLoops;
+		uint8_t segment;
+		std::vector<ScriptNode> body;
+
+		ScriptNode(uint8_t command) : cmd(command), addr(0), argb(0), argb2(0), time(0), parallel(false), offset(0), length(0), numLoops(0), segment(0) {};
+
+		bool IsFade(void) const { return SET_FADE == cmd; };
+		bool IsLoop(void) const { return LOOP_ON == cmd; };
+		bool IsWait(void) const { return WAIT == cmd; };
+	};
+
+	typedef std::vector<ScriptNode> ScriptBlock;
+
+	/**
+	 * Known state of a single led, used to detect fades to the current color
+	 */
+	struct LedState {
+		bool known;
+		uint32_t argb;
+		uint64_t settledAt;
+	};
+
+	typedef std::array<LedState, NUM_OF_LED_PER_SEGMENT> SegmentState;
+
+	/**
+	 * Known state of the whole strip, segments without an entry in <segments>
+	 * are in the state of <others>
+	 */
+	struct StripState {
+		std::map<uint8_t, SegmentState> segments;
+		SegmentState others;
+
+		StripState(void) {
+			Forget();
+		};
+
+		void Forget(void) {
+			segments.clear();
+			for(auto& led : others) {
+				led.known = false;
+			}
+		};
+
+		SegmentState& operator[](uint8_t segment) {
+			return segments.insert(std::make_pair(segment, others)).first->second;
+		};
+	};
+
+	static ScriptBlock BuildTree(const Script& script) throw (InvalidParameter)
+	{
+		std::vector<ScriptBlock> stack(1);
+		for(const auto& cmd : script) {
+			ScriptNode node(cmd.GetType());
+			switch(cmd.GetType()) {
+			case WAIT:
+				node.time = cmd.waitTime();
+				break;
+			case SET_FADE:
+				node.addr = cmd.addr();
+				node.argb = cmd.argb();
+				node.time = cmd.fadeTime();
+				node.parallel = cmd.parallelFade();
+				node.segment = cmd.segment();
+				break;
+			case SET_GRADIENT:
+				node.argb = cmd.StartColor();
+				node.argb2 = cmd.EndColor();
+				node.time = cmd.fadeTime();
+				node.parallel = cmd.parallelFade();
+				node.offset = cmd.offset();
+				node.length = cmd.length();
+				node.segment = cmd.segment();
+				break;
+			case LOOP_ON:
+				stack.push_back(ScriptBlock());
+				continue;
+			case LOOP_OFF:
+			{
+				if(stack.size() < 2) {
+					throw InvalidParameter("ScriptOptimizer: loop_off without loop");
+				}
+				node.cmd = LOOP_ON;
+				node.numLoops = cmd.numLoops();
+				node.body = std::move(stack.back());
+				stack.pop_back();
+				break;
+			}
+			default:
+				throw InvalidParameter("ScriptOptimizer: unsupported command");
+			}
+			stack.back().push_back(std::move(node));
+		}
+
+		if(stack.size() != 1) {
+			throw InvalidParameter("ScriptOptimizer: loop without loop_off");
+		}
+		return std::move(stack.front());
+	}
+
+	static void Flatten(const ScriptBlock& block, Script& out)
+	{
+		for(const auto& node : block) {
+			switch(node.cmd) {
+			case WAIT:
+				out.push_back(ScriptCommand::Wait(node.time));
+				break;
+			case SET_FADE:
+				out.push_back(ScriptCommand::Fade(node.argb, node.time, node.addr, node.parallel, node.segment));
+				break;
+			case SET_GRADIENT:
+				out.push_back(ScriptCommand::Gradient(node.argb, node.argb2, node.time, node.parallel, node.length, node.offset, node.segment));
+				break;
+			case LOOP_ON:
+				out.push_back(ScriptCommand::LoopOn());
+				Flatten(node.body, out);
+				out.push_back(ScriptCommand::LoopOff(node.numLoops));
+				break;
+			}
+		}
+	}
+
+	static size_t NumCommands(const ScriptBlock& block)
+	{
+		size_t numCommands = 0;
+		for(const auto& node : block) {
+			numCommands += node.IsLoop() ? 2 + NumCommands(node.body) : 1;
+		}
+		return numCommands;
+	}
+
+	static void Analyze(const ScriptBlock& block, size_t depth, ScriptOptimizer::Report& report)
+	{
+		report.loopDepth = std::max(report.loopDepth, depth);
+		for(const auto& node : block) {
+			if(node.IsLoop()) {
+				ScriptOptimizer::Report body {0, 0, false, 0};
+				Analyze(node.body, depth + 1, body);
+				report.numCommands += 2 + body.numCommands;
+				// loops, which are never reached, are still uploaded and nested
+				report.loopDepth = std::max(report.loopDepth, body.loopDepth);
+				if(report.isInfinite) {
+					continue;
+				}
+				if(LOOP_INFINITE == node.numLoops) {
+					report.durationTmms += body.durationTmms;
+					report.isInfinite = true;
+				} else {
+					report.durationTmms += body.durationTmms * node.numLoops;
+					report.isInfinite = body.isInfinite;
+				}
+				continue;
+			}
+
+			++report.numCommands;
+			if(report.isInfinite) {
+				// never reached, but still uploaded
+				continue;
+			}
+			if(node.IsWait() || !node.parallel) {
+				report.durationTmms += node.time;
+			}
+		}
+	}
+
+	static bool RunsForever(const ScriptNode& node)
+	{
+		if(!node.IsLoop()) {
+			return false;
+		}
+		return (LOOP_INFINITE == node.numLoops) || std::any_of(node.body.begin(), node.body.end(), RunsForever);
+	}
+
+	/**
+	 * Commands behind an infinite loop are never executed
+	 */
+	static bool DropDeadCode(ScriptBlock& block)
+	{
+		for(auto it = block.begin(); it != block.end(); ++it) {
+			if(RunsForever(*it) && (it + 1 != block.end())) {
+				block.erase(it + 1, block.end());
+				return true;
+			}
+		}
+		return false;
+	}
+
+	static bool FoldLoops(ScriptBlock& block)
+	{
+		bool changed = false;
+		for(size_t i = 0; i < block.size(); ) {
+			ScriptNode& loop = block[i];
+			if(!loop.IsLoop()) {
+				++i;
+				continue;
+			}
+
+			// a finite loop without body does nothing
+			if(loop.body.empty() && (LOOP_INFINITE != loop.numLoops)) {
+				block.erase(block.begin() + i);
+				changed = true;
+				continue;
+			}
+
+			// a single iteration needs no loop at all
+			if(1 == loop.numLoops) {
+				ScriptBlock body = std::move(loop.body);
+				block.erase(block.begin() + i);
+				block.insert(block.begin() + i, body.begin(), body.end());
+				changed = true;
+				continue;
+			}
+
+			// a loop wrapping nothing but another loop
+			if((1 == loop.body.size()) && loop.body.front().IsLoop()) {
+				ScriptNode inner = std::move(loop.body.front());
+				const unsigned int product = (unsigned int)loop.numLoops * inner.numLoops;
+				if(LOOP_INFINITE == inner.numLoops) {
+					block[i] = std::move(inner);
+					changed = true;
+					continue;
+				} else if((LOOP_INFINITE == loop.numLoops) || (product <= 0xff)) {
+					loop.numLoops = (LOOP_INFINITE == loop.numLoops) ? LOOP_INFINITE : (uint8_t)product;
+					loop.body = std::move(inner.body);
+					changed = true;
+					continue;
+				}
+				loop.body.front() = std::move(inner);
+			}
+			++i;
+		}
+		return changed;
+	}
+
+	static bool MergeWaits(ScriptBlock& block)
+	{
+		bool changed = false;
+		for(size_t i = 1; i < block.size(); ) {
+			ScriptNode& prev = block[i - 1];
+			const ScriptNode& cur = block[i];
+			if(prev.IsWait() && cur.IsWait() && ((uint32_t)prev.time + cur.time <= 0xffff)) {
+				prev.time += cur.time;
+				block.erase(block.begin() + i);
+				changed = true;
+			} else {
+				++i;
+			}
+		}
+		return changed;
+	}
+
+	/**
+	 * Fades are applied in the same cycle as long as the previous fades are parallel.
+	 * Within such a group a later fade completely replaces an earlier one on all
+	 * leds they share, and fades with the same color and time can share one command.
+	 * A fade of SEGMENT_ALL shares the leds of its mask with each segment.
+	 */
+	static bool OptimizeFadeGroup(ScriptBlock& block, size_t first, size_t last)
+	{
+		bool changed = false;
+		std::map<uint8_t, uint32_t> coveredLater;
+		for(size_t i = last + 1; i-- > first; ) {
+			ScriptNode& fade = block[i];
+			uint32_t covered = coveredLater[SEGMENT_ALL];
+			if(SEGMENT_ALL != fade.segment) {
+				covered |= coveredLater[fade.segment];
+			}
+			const uint32_t visible = fade.addr & ~covered;
+			coveredLater[fade.segment] |= fade.addr;
+			if(visible != fade.addr) {
+				fade.addr = visible;
+				changed = true;
+			}
+		}
+
+		for(size_t i = first; i < last; ++i) {
+			ScriptNode& fade = block[i];
+			if(0 == fade.addr) {
+				continue;
+			}
+			for(size_t k = i + 1; k <= last; ++k) {
+				ScriptNode& later = block[k];
+				if((later.segment != fade.segment) && ((SEGMENT_ALL == later.segment) || (SEGMENT_ALL == fade.segment))) {
+					// the fades might share leds in another segment, moving across is not safe
+					break;
+				}
+				if((0 != later.addr) && (later.segment == fade.segment) && (later.argb == fade.argb) && (later.time == fade.time)) {
+					// masks are disjoint now, so moving the earlier fade back to the later one is safe
+					later.addr |= fade.addr;
+					fade.addr = 0;
+					changed = true;
+					break;
+				}
+			}
+		}
+
+		for(size_t i = last + 1; i-- > first; ) {
+			ScriptNode& fade = block[i];
+			if(0 != fade.addr) {
+				continue;
+			}
+			if(fade.parallel) {
+				block.erase(block.begin() + i);
+			} else {
+				// a blocking fade without leds still delays the script
+				const uint16_t time = fade.time;
+				fade = ScriptNode(WAIT);
+				fade.time = time;
+				changed = true;
+			}
+		}
+		return changed;
+	}
+
+	static bool OptimizeFades(ScriptBlock& block)
+	{
+		bool changed = false;
+		for(size_t first = 0; first < block.size(); ) {
+			if(!block[first].IsFade()) {
+				++first;
+				continue;
+			}
+			size_t last = first;
+			while(block[last].parallel && (last + 1 < block.size()) && block[last + 1].IsFade()) {
+				++last;
+			}
+			const size_t sizeBefore = block.size();
+			changed |= OptimizeFadeGroup(block, first, last);
+			first = last + 1 - (sizeBefore - block.size());
+		}
+		return changed;
+	}
+
+	/**
+	 * Port of the CALC_COLOR macro of ledstrip.c: the firmware fades in whole
+	 * steps, so depending on the distance to the new color a fade might need
+	 * a few ticks more than <fadeTmms>. A fade started after Ledstrip_DoFade()
+	 * makes its first step only in the next tick, which costs another one.
+	 * @return number of ticks until the slowest color channel reached its target
+	 */
+	static uint64_t FadeTicks(uint16_t fadeTmms)
+	{
+		// the firmware handles a fade time of zero as one
+		fadeTmms = std::max<uint16_t>(1, fadeTmms);
+		uint64_t ticks = 0;
+		for(unsigned int delta = 1; delta <= 0xff; ++delta) {
+			// the smallest step size, which leaves a period of at least one tick
+			const unsigned int stepSize = delta / (fadeTmms + 1) + 1;
+			const uint64_t numSteps = (delta + stepSize - 1) / stepSize;
+			ticks = std::max<uint64_t>(ticks, numSteps * (fadeTmms / (delta / stepSize)));
+		}
+		return ticks + 1;
+	}
+
+	static bool IsSettled(const SegmentState& leds, const ScriptNode& fade, uint64_t now)
+	{
+		for(size_t led = 0; led < leds.size(); ++led) {
+			if((fade.addr & (1u << led)) && !(leds[led].known && (leds[led].argb == fade.argb) && (leds[led].settledAt <= now))) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	static void Settle(SegmentState& leds, const ScriptNode& fade, uint64_t now)
+	{
+		const uint64_t settledAt = now + FadeTicks(fade.time);
+		for(size_t led = 0; led < leds.size(); ++led) {
+			if(fade.addr & (1u << led)) {
+				leds[led].known = true;
+				leds[led].argb = fade.argb;
+				leds[led].settledAt = settledAt;
+			}
+		}
+	}
+
+	/**
+	 * Track which leds reached a known color and replace fades to that color
+	 */
+	static bool DropRedundantFades(ScriptBlock& block)
+	{
+		StripState strip;
+
+		bool changed = false;
+		uint64_t now = 0;
+		for(size_t i = 0; i < block.size(); ++i) {
+			ScriptNode& node = block[i];
+			if(node.IsWait()) {
+				now += node.time;
+			} else if(node.IsFade()) {
+				bool redundant;
+				if(SEGMENT_ALL == node.segment) {
+					redundant = IsSettled(strip.others, node, now);
+					for(const auto& segment : strip.segments) {
+						redundant = redundant && IsSettled(segment.second, node, now);
+					}
+				} else {
+					redundant = IsSettled(strip[node.segment], node, now);
+				}
+
+				if(redundant) {
+					changed = true;
+					if(node.parallel) {
+						block.erase(block.begin() + i--);
+						continue;
+					}
+					// keep the timing of a blocking fade
+					const uint16_t time = node.time;
+					node = ScriptNode(WAIT);
+					node.time = time;
+					now += time;
+					continue;
+				}
+
+				if(SEGMENT_ALL == node.segment) {
+					Settle(strip.others, node, now);
+					for(auto& segment : strip.segments) {
+						Settle(segment.second, node, now);
+					}
+				} else {
+					Settle(strip[node.segment], node, now);
+				}
+				if(!node.parallel) {
+					now += node.time;
+				}
+			} else {
+				// gradients and loops leave the leds in a state we don't track
+				strip.Forget();
+				if(!node.IsLoop() && !node.parallel) {
+					now += node.time;
+				}
+			}
+		}
+		return changed;
+	}
+
+	static bool OptimizeBlock(ScriptBlock& block)
+	{
+		bool changed = false;
+		bool again;
+		do {
+			again = false;
+			for(auto& node : block) {
+				if(node.IsLoop()) {
+					again |= OptimizeBlock(node.body);
+				}
+			}
+			again |= DropDeadCode(block);
+			again |= FoldLoops(block);
+			again |= MergeWaits(block);
+			again |= OptimizeFades(block);
+			again |= DropRedundantFades(block);
+			changed |= again;
+		}
+		while(again);
+		return changed;
+	}
+
+	/**
+	 * Unroll finite loops which are nested deeper than the firmware supports,
+	 * as long as the whole script of <numCommands> commands still fits into
+	 * the script buffer. Loops, which would exceed it, are left as they are.
+	 */
+	static bool UnrollDeepLoops(ScriptBlock& block, size_t depth, size_t& numCommands)
+	{
+		bool changed = false;
+		for(size_t i = 0; i < block.size(); ) {
+			ScriptNode& node = block[i];
+			if(!node.IsLoop()) {
+				++i;
+				continue;
+			}
+
+			if((depth + 1 > ScriptOptimizer::LOOP_DEPTH_MAX) && (LOOP_INFINITE != node.numLoops)) {
+				const size_t numLoops = node.numLoops;
+				const size_t bodySize = NumCommands(node.body);
+				const size_t unrolled = numCommands - 2 - bodySize + numLoops * bodySize;
+				if(unrolled > ScriptOptimizer::SCRIPT_BUFFER_SLOTS) {
+					++i;
+					continue;
+				}
+				numCommands = unrolled;
+				ScriptBlock body = std::move(node.body);
+				block.erase(block.begin() + i);
+				for(size_t n = 0; n < numLoops; ++n) {
+					block.insert(block.begin() + i, body.begin(), body.end());
+				}
+				changed = true;
+				continue;
+			}
+
+			changed |= UnrollDeepLoops(node.body, depth + 1, numCommands);
+			++i;
+		}
+		return changed;
+	}
+
+	ScriptOptimizer::Report ScriptOptimizer::Analyze(const Script& script) throw (InvalidParameter)
+	{
+		Report report {0, 0, false, 0};
+		WyLight::Analyze(BuildTree(script), 0, report);
+		return report;
+	}
+
+	Script ScriptOptimizer::Optimize(const Script& script, Report *pReport) throw (InvalidParameter)
+	{
+		ScriptBlock tree = BuildTree(script);
+		OptimizeBlock(tree);
+		size_t numCommands = NumCommands(tree);
+		if(UnrollDeepLoops(tree, 0, numCommands)) {
+			OptimizeBlock(tree);
+		}
+
+		Report report {0, 0, false, 0};
+		WyLight::Analyze(tree, 0, report);
+		if(report.loopDepth > LOOP_DEPTH_MAX) {
+			Trace(ZONE_WARNING, "loops nested %zu levels deep are infinite or don't fit into the script buffer, when unrolled\n", report.loopDepth);
+		}
+		if(pReport) {
+			*pReport = report;
+		}
+
+		Script optimized;
+		optimized.setName(script.getName());
+		Flatten(tree, optimized);
+		return optimized;
+	}
+} /* namespace WyLight */
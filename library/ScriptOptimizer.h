@@ -0,0 +1,103 @@
+/*
+ Copyright (C) 2013 Nils Weiss, Patrick Bruenn.
+
+ This file is part of Wifly_Light.
+
+ Wifly_Light is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Wifly_Light is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Wifly_Light.  If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef __WyLight__ScriptOptimizer__
+#define __WyLight__ScriptOptimizer__
+
+#include "Script.h"
+#include "ScriptCtrl.h"
+#include "WiflyControlException.h"
+
+#include <stdint.h>
+
+namespace WyLight {
+
+	/******************************************************************************/
+	/*! \file ScriptOptimizer.h
+	 * \brief Optimising pass over a Script before it is uploaded
+	 *
+	 * Every script command occupies one slot in the 63 slot EEPROM ring of the
+	 * firmware script controller. The optimizer rewrites a script into an
+	 * equivalent one with fewer commands:
+	 * - consecutive waits are merged
+	 * - fades which are overwritten before any time passes are dropped
+	 * - fades to a color the leds already settled at in the firmware become waits or vanish
+	 * - parallel fades with equal color and fade time are merged into one
+	 * - loops with a single iteration or with only a loop inside are folded,
+	 *   loops nested deeper than the firmware supports are unrolled, as long as
+	 *   the result fits into the script buffer, Report::loopDepth shows the rest
+	 * - commands behind an infinite loop are dropped
+	 * Gradients are left untouched and act as barriers for the fade passes.
+	 *******************************************************************************/
+	class ScriptOptimizer
+	{
+	public:
+		/**
+		 * Number of usable command slots in the firmware script ring
+		 */
+		static const size_t SCRIPT_BUFFER_SLOTS = SCRIPTCTRL_NUM_CMD_MAX;
+
+		/**
+		 * Maximum number of nested loops the firmware script controller supports
+		 */
+		static const size_t LOOP_DEPTH_MAX = SCRIPTCTRL_LOOP_DEPTH_MAX;
+
+		struct Report {
+			/**
+			 * number of commands, each of them uses one slot in the firmware script ring
+			 */
+			size_t numCommands;
+
+			/**
+			 * estimated time to run the script in hundredths of a second. For infinite
+			 * scripts this is the time until the first pass of the infinite loop completed.
+			 */
+			uint64_t durationTmms;
+
+			/**
+			 * true if the script contains an infinite loop
+			 */
+			bool isInfinite;
+
+			/**
+			 * deepest loop nesting
+			 */
+			size_t loopDepth;
+
+			bool FitsScriptBuffer(void) const {
+				return (numCommands <= SCRIPT_BUFFER_SLOTS) && (loopDepth <= LOOP_DEPTH_MAX);
+			};
+		};
+
+		/**
+		 * Estimate duration and resource usage of <script>
+		 * @throw InvalidParameter if the loops of <script> are unbalanced
+		 */
+		static Report Analyze(const Script& script) throw (InvalidParameter);
+
+		/**
+		 * Create an optimized copy of <script>
+		 * @param script to optimize, it is not modified
+		 * @param pReport if not NULL, receives the analysis of the optimized script
+		 * @return the optimized script with the same name as <script>
+		 * @throw InvalidParameter if the loops of <script> are unbalanced
+		 */
+		static Script Optimize(const Script& script, Report *pReport = NULL) throw (InvalidParameter);
+	};
+} /* namespace WyLight */
+#endif /* #ifndef __WyLight__ScriptOptimizer__ */
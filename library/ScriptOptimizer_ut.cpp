@@ -0,0 +1,402 @@
+/*
+ Copyright (C) 2013 Nils Weiss, Patrick Bruenn.
+
+ This file is part of Wifly_Light.
+
+ Wifly_Light is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Wifly_Light is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Wifly_Light.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include "unittest.h"
+#include "ScriptOptimizer.h"
+#include "ScriptSimulator.h"
+#include <random>
+#include <vector>
+
+using namespace WyLight;
+
+static const uint32_t g_DebugZones = ZONE_ERROR | ZONE_WARNING | ZONE_INFO | ZONE_VERBOSE;
+
+const std::string FwCmdSetFade::TOKEN("fade");
+const std::string FwCmdSetGradient::TOKEN("gradient");
+const std::string FwCmdLoopOn::TOKEN("loop");
+const std::string FwCmdLoopOff::TOKEN("loop_off");
+const std::string FwCmdWait::TOKEN("wait");
+
+const size_t FwCmdScript::INDENTATION_MAX;
+const char FwCmdScript::INDENTATION_CHARACTER;
+
+static const uint64_t SIMULATION_HORIZON = 3000;
+static const size_t NUM_RANDOM_SCRIPTS = 500;
+static const size_t NUM_SEGMENTS = NUM_OF_LED / NUM_OF_LED_PER_SEGMENT;
+
+static bool IsRunnable(const Script& script)
+{
+	return ScriptOptimizer::Analyze(script).loopDepth <= ScriptSimulator::LOOP_DEPTH_MAX;
+}
+
+/**
+ * The firmware can't run loops nested deeper than LOOP_DEPTH_MAX, so the
+ * reference for such a script repeats the body of those loops literally. An
+ * infinite loop never returns to the loops around it, which are dropped.
+ * @return index of the loop_off, which closes the block starting at <pos>
+ */
+static size_t AppendRunnable(Script& out, const Script& script, size_t pos, size_t depth, bool& isInfinite)
+{
+	while((pos < script.size()) && (LOOP_OFF != script[pos].GetType())) {
+		const ScriptCommand& cmd = script[pos++];
+		if(LOOP_ON != cmd.GetType()) {
+			if(!isInfinite) {
+				out.push_back(cmd);
+			}
+			continue;
+		}
+
+		Script body;
+		bool bodyIsInfinite = false;
+		const size_t loopOff = AppendRunnable(body, script, pos, depth + 1, bodyIsInfinite);
+		const uint8_t numLoops = script[loopOff].numLoops();
+		pos = loopOff + 1;
+		if(isInfinite) {
+			// never reached
+			continue;
+		}
+
+		const bool keepLoop = !bodyIsInfinite && ((LOOP_INFINITE == numLoops) || (depth < ScriptSimulator::LOOP_DEPTH_MAX));
+		const size_t numCopies = (bodyIsInfinite || keepLoop) ? 1 : numLoops;
+		if(keepLoop) {
+			out.push_back(cmd);
+		}
+		for(size_t i = 0; i < numCopies; ++i) {
+			for(const auto& bodyCmd : body) {
+				out.push_back(bodyCmd);
+			}
+		}
+		if(keepLoop) {
+			out.push_back(script[loopOff]);
+		}
+		isInfinite = bodyIsInfinite || (LOOP_INFINITE == numLoops);
+	}
+	return pos;
+}
+
+/**
+ * Both scripts have to show the same colors on the strip, tick by tick, as
+ * ScriptSimulator predicts it for the firmware.
+ */
+static bool IsEquivalent(const Script& original, const Script& optimized)
+{
+	Script reference;
+	bool isInfinite = false;
+	AppendRunnable(reference, original, 0, 0, isInfinite);
+	ScriptSimulator expected(reference);
+	ScriptSimulator actual(optimized);
+	for(uint64_t tick = 0; tick < SIMULATION_HORIZON; ++tick) {
+		if(expected.GetFrame() != actual.GetFrame()) {
+			Trace(ZONE_ERROR, "scripts differ at tick %llu\n", (unsigned long long)tick);
+			return false;
+		}
+		expected.Advance(1);
+		actual.Advance(1);
+	}
+	return true;
+}
+
+static void AddRandomBlock(Script& script, std::mt19937& rng, size_t depth)
+{
+	static const uint32_t colors[] = {0xff000000, 0xffff0000, 0xff00ff00, 0xff0000ff};
+	static const uint32_t masks[] = {0x1, 0x3, 0xf0, 0xffffffff, 0x0000ffff, 0xffff0000, 0x5};
+	static const uint16_t times[] = {1, 10, 25, 100};
+	static const uint8_t segments[] = {0, 0, 1, 2, SEGMENT_ALL};
+
+	const size_t numCommands = 1 + rng() % 6;
+	for(size_t i = 0; i < numCommands; ++i) {
+		switch(rng() % 6) {
+		case 0:
+			script.push_back(FwCmdWait(times[rng() % 4]));
+			break;
+		case 1:
+			if(depth < 6) {
+				script.push_back(FwCmdLoopOn());
+				AddRandomBlock(script, rng, depth + 1);
+				// make sure every loop iteration takes time
+				script.push_back(FwCmdWait(times[rng() % 4]));
+				script.push_back(FwCmdLoopOff(rng() % 4));
+				break;
+			}
+			/* too deep for another loop, add a gradient instead */
+		case 2:
+			script.push_back(FwCmdSetGradient(colors[rng() % 4], colors[rng() % 4], times[rng() % 4], rng() & 1, 1 + rng() % 8, rng() % 8, rng() % NUM_SEGMENTS));
+			break;
+		default:
+			script.push_back(FwCmdSetFade(colors[rng() % 4], times[rng() % 4], masks[rng() % 7], rng() & 1, segments[rng() % 5]));
+			break;
+		}
+	}
+}
+
+size_t ut_ScriptOptimizer_MergeWaits(void)
+{
+	TestCaseBegin();
+	Script script;
+	script.push_back(FwCmdSetFade(0xffff0000, 10));
+	script.push_back(FwCmdWait(100));
+	script.push_back(FwCmdWait(200));
+	script.push_back(FwCmdWait(300));
+
+	ScriptOptimizer::Report report;
+	Script optimized = ScriptOptimizer::Optimize(script, &report);
+	CHECK(2 == optimized.size());
+	CHECK(2 == report.numCommands);
+	CHECK(610 == report.durationTmms);
+	CHECK(!report.isInfinite);
+	CHECK(WAIT == optimized[1].GetType());
+	CHECK(600 == optimized[1].waitTime());
+	CHECK(IsEquivalent(script, optimized));
+	TestCaseEnd();
+}
+
+size_t ut_ScriptOptimizer_MergeParallelFades(void)
+{
+	TestCaseBegin();
+	Script script;
+	// completely overwritten by the following fades before any time passes
+	script.push_back(FwCmdSetFade(0xff00ff00, 50, 0x0000000f, true));
+	script.push_back(FwCmdSetFade(0xffff0000, 50, 0x000000ff, true));
+	script.push_back(FwCmdSetFade(0xffff0000, 50, 0x0000ff00, false));
+
+	Script optimized = ScriptOptimizer::Optimize(script);
+	CHECK(1 == optimized.size());
+	const ScriptCommand& fade = optimized[0];
+	CHECK(0x0000ffff == fade.addr());
+	CHECK(!fade.parallelFade());
+	CHECK(IsEquivalent(script, optimized));
+	TestCaseEnd();
+}
+
+size_t ut_ScriptOptimizer_RedundantFade(void)
+{
+	TestCaseBegin();
+	Script script;
+	script.push_back(FwCmdSetFade(0xffff0000, 100, 0x3, false));
+	// the firmware fades in whole steps, which takes a few ticks longer
+	script.push_back(FwCmdWait(5));
+	script.push_back(FwCmdSetFade(0xffff0000, 20, 0x1, true));
+	script.push_back(FwCmdSetFade(0xffff0000, 40, 0x2, false));
+	script.push_back(FwCmdWait(10));
+
+	ScriptOptimizer::Report report;
+	Script optimized = ScriptOptimizer::Optimize(script, &report);
+	// the redundant blocking fade turns into a wait, which is merged
+	CHECK(2 == optimized.size());
+	CHECK(SET_FADE == optimized[0].GetType());
+	CHECK(55 == optimized[1].waitTime());
+	CHECK(155 == report.durationTmms);
+	CHECK(IsEquivalent(script, optimized));
+
+	// without the wait the leds are still fading
+	Script fading;
+	fading.push_back(FwCmdSetFade(0xffff0000, 100, 0x3, false));
+	fading.push_back(FwCmdSetFade(0xffff0000, 20, 0x1, true));
+	fading.push_back(FwCmdSetFade(0xffff0000, 40, 0x2, false));
+	Script kept = ScriptOptimizer::Optimize(fading);
+	CHECK(3 == kept.size());
+	CHECK(IsEquivalent(fading, kept));
+	CHECK(IsEquivalent(script, optimized));
+	TestCaseEnd();
+}
+
+size_t ut_ScriptOptimizer_Segments(void)
+{
+	TestCaseBegin();
+	Script script;
+	// the same mask addresses different leds in different segments
+	script.push_back(FwCmdSetFade(0xffff0000, 50, 0x1, true, 1));
+	script.push_back(FwCmdSetFade(0xffff0000, 50, 0x1, true, 0));
+	// a later fade of a single segment covers only a part of a fade to all segments
+	script.push_back(FwCmdSetFade(0xff00ff00, 50, 0x2, true, SEGMENT_ALL));
+	script.push_back(FwCmdSetFade(0xff0000ff, 50, 0x2, true, 2));
+	// merging the fades to all segments would overwrite the fade of segment 2
+	script.push_back(FwCmdSetFade(0xff00ff00, 50, 0x4, false, SEGMENT_ALL));
+	script.push_back(FwCmdWait(5));
+	script.push_back(FwCmdSetFade(0xff00ff00, 10, 0x4, false, 2));
+
+	Script optimized = ScriptOptimizer::Optimize(script);
+	CHECK(6 == optimized.size());
+	CHECK(SET_FADE == optimized[4].GetType());
+	CHECK(WAIT == optimized[5].GetType());
+	CHECK(IsEquivalent(script, optimized));
+
+	// the fade to all segments settled segment 1 as well
+	script.push_back(FwCmdSetFade(0xff00ff00, 50, 0x4, false, 1));
+	Script settled = ScriptOptimizer::Optimize(script);
+	CHECK(6 == settled.size());
+	CHECK(65 == settled[5].waitTime());
+	CHECK(IsEquivalent(script, settled));
+	TestCaseEnd();
+}
+
+size_t ut_ScriptOptimizer_FoldLoops(void)
+{
+	TestCaseBegin();
+	Script script;
+	script.push_back(FwCmdLoopOn());
+	script.push_back(FwCmdLoopOn());
+	script.push_back(FwCmdSetFade(0xffff0000, 10));
+	script.push_back(FwCmdSetFade(0xff0000ff, 10));
+	script.push_back(FwCmdLoopOff(3));
+	script.push_back(FwCmdLoopOff(5));
+	script.push_back(FwCmdLoopOn());
+	script.push_back(FwCmdWait(10));
+	script.push_back(FwCmdLoopOff(1));
+	script.push_back(FwCmdLoopOn());
+	script.push_back(FwCmdLoopOff(7));
+	script.push_back(FwCmdLoopOn());
+	script.push_back(FwCmdSetFade(0xff00ff00, 10));
+	script.push_back(FwCmdLoopOff(LOOP_INFINITE));
+	// never reached
+	script.push_back(FwCmdWait(10));
+
+	ScriptOptimizer::Report before = ScriptOptimizer::Analyze(script);
+	CHECK(15 == before.numCommands);
+	CHECK(2 == before.loopDepth);
+	CHECK(before.isInfinite);
+	CHECK(320 == before.durationTmms);
+
+	ScriptOptimizer::Report report;
+	Script optimized = ScriptOptimizer::Optimize(script, &report);
+	CHECK(8 == optimized.size());
+	CHECK(8 == report.numCommands);
+	CHECK(1 == report.loopDepth);
+	CHECK(report.isInfinite);
+	CHECK(320 == report.durationTmms);
+	CHECK(15 == optimized[3].numLoops());
+	CHECK(IsEquivalent(script, optimized));
+	TestCaseEnd();
+}
+
+size_t ut_ScriptOptimizer_UnrollDeepLoops(void)
+{
+	TestCaseBegin();
+	Script script;
+	script.push_back(FwCmdLoopOn());
+	for(size_t i = 0; i < ScriptOptimizer::LOOP_DEPTH_MAX; ++i) {
+		script.push_back(FwCmdLoopOn());
+		script.push_back(FwCmdSetFade(0xff000000 | (uint32_t)i, 10, 0x1 << i, false));
+	}
+	for(size_t i = 0; i < ScriptOptimizer::LOOP_DEPTH_MAX; ++i) {
+		script.push_back(FwCmdLoopOff(2));
+	}
+	script.push_back(FwCmdWait(5));
+	script.push_back(FwCmdLoopOff(LOOP_INFINITE));
+
+	CHECK(!ScriptOptimizer::Analyze(script).FitsScriptBuffer());
+	ScriptOptimizer::Report report;
+	Script optimized = ScriptOptimizer::Optimize(script, &report);
+	CHECK(ScriptOptimizer::LOOP_DEPTH_MAX == report.loopDepth);
+	CHECK(report.FitsScriptBuffer());
+	CHECK(IsEquivalent(script, optimized));
+	TestCaseEnd();
+}
+
+/* unrolling a loop must not blow up the script beyond the script buffer */
+size_t ut_ScriptOptimizer_UnrollLimit(void)
+{
+	TestCaseBegin();
+	Script script;
+	for(size_t i = 0; i < ScriptOptimizer::LOOP_DEPTH_MAX; ++i) {
+		script.push_back(FwCmdLoopOn());
+		script.push_back(FwCmdSetFade(0xff000000 | (uint32_t)i, 10, 0x1 << i, false));
+	}
+	script.push_back(FwCmdLoopOn());
+	script.push_back(FwCmdLoopOn());
+	script.push_back(FwCmdSetFade(0xffff0000, 1));
+	script.push_back(FwCmdSetFade(0xff0000ff, 1));
+	script.push_back(FwCmdLoopOff(255));
+	script.push_back(FwCmdLoopOff(255));
+	for(size_t i = 0; i < ScriptOptimizer::LOOP_DEPTH_MAX; ++i) {
+		script.push_back(FwCmdLoopOff(2));
+	}
+
+	ScriptOptimizer::Report report;
+	Script optimized = ScriptOptimizer::Optimize(script, &report);
+	CHECK(script.size() == optimized.size());
+	CHECK(ScriptOptimizer::LOOP_DEPTH_MAX + 2 == report.loopDepth);
+	CHECK(!report.FitsScriptBuffer());
+	CHECK(!IsRunnable(optimized));
+	TestCaseEnd();
+}
+
+size_t ut_ScriptOptimizer_Unbalanced(void)
+{
+	TestCaseBegin();
+	Script script;
+	script.push_back(FwCmdLoopOn());
+	script.push_back(FwCmdWait(10));
+	try {
+		ScriptOptimizer::Optimize(script);
+		CHECK(false);
+	} catch (InvalidParameter& e) {}
+
+	Script other;
+	other.push_back(FwCmdLoopOff(2));
+	try {
+		ScriptOptimizer::Analyze(other);
+		CHECK(false);
+	} catch (InvalidParameter& e) {}
+	TestCaseEnd();
+}
+
+size_t ut_ScriptOptimizer_RandomEquivalence(void)
+{
+	TestCaseBegin();
+	std::mt19937 rng(4711);
+	size_t numBefore = 0;
+	size_t numAfter = 0;
+	size_t numRejected = 0;
+	for(size_t i = 0; i < NUM_RANDOM_SCRIPTS; ++i) {
+		Script script;
+		AddRandomBlock(script, rng, 0);
+		AddRandomBlock(script, rng, 0);
+		Script optimized = ScriptOptimizer::Optimize(script);
+		numBefore += script.size();
+		numAfter += optimized.size();
+		// only unrolling loops, which are nested too deep, adds commands
+		CHECK((optimized.size() <= script.size()) || (ScriptOptimizer::Analyze(script).loopDepth > ScriptOptimizer::LOOP_DEPTH_MAX));
+		// infinite loops nested too deep can't be unrolled, the firmware rejects them anyway
+		if(!IsRunnable(optimized)) {
+			CHECK(ScriptOptimizer::Analyze(optimized).loopDepth > ScriptOptimizer::LOOP_DEPTH_MAX);
+			++numRejected;
+			continue;
+		}
+		CHECK(IsEquivalent(script, optimized));
+	}
+	Trace(ZONE_INFO, "%zu commands optimized to %zu, %zu scripts nested too deep\n", numBefore, numAfter, numRejected);
+	CHECK(numRejected < NUM_RANDOM_SCRIPTS / 10);
+	CHECK(numAfter < numBefore);
+	TestCaseEnd();
+}
+
+int main (int argc, const char *argv[])
+{
+	UnitTestMainBegin();
+	RunTest(true, ut_ScriptOptimizer_MergeWaits);
+	RunTest(true, ut_ScriptOptimizer_MergeParallelFades);
+	RunTest(true, ut_ScriptOptimizer_RedundantFade);
+	RunTest(true, ut_ScriptOptimizer_Segments);
+	RunTest(true, ut_ScriptOptimizer_FoldLoops);
+	RunTest(true, ut_ScriptOptimizer_UnrollDeepLoops);
+	RunTest(true, ut_ScriptOptimizer_UnrollLimit);
+	RunTest(true, ut_ScriptOptimizer_Unbalanced);
+	RunTest(true, ut_ScriptOptimizer_RandomEquivalence);
+	UnitTestMainEnd();
+}
@@ -0,0 +1,386 @@
+/*
+ Copyright (C) 2013 Nils Weiss, Patrick Bruenn.
+
+ This file is part of Wifly_Light.
+
+ Wifly_Light is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Wifly_Light is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Wifly_Light.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include "ScriptSimulator.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+namespace WyLight {
+
+	static const uint32_t g_DebugZones = ZONE_ERROR | ZONE_WARNING | ZONE_INFO | ZONE_VERBOSE;
+
+	const size_t ScriptSimulator::NUM_LEDS;
+	const size_t ScriptSimulator::LOOP_DEPTH_MAX;
+	const size_t ScriptSimulator::MAX_COMMANDS_PER_TICK;
+	const size_t ScriptSimulator::COMMANDS_PER_PASS;
+
+	ScriptSimulator::ScriptSimulator(const Script& script) throw (InvalidParameter)
+	{
+		// resolve loops like ScriptCtrl_Add() does
+		std::vector<size_t> loopStart;
+		mProgram.reserve(script.size());
+		for(const auto& cmd : script) {
+			Instruction next {cmd, 0, 0};
+			switch(cmd.GetType()) {
+			case LOOP_ON:
+				if(loopStart.size() >= LOOP_DEPTH_MAX) {
+					throw InvalidParameter("ScriptSimulator: loops nested too deep");
+				}
+				loopStart.push_back(mProgram.size());
+				break;
+			case LOOP_OFF:
+				if(loopStart.empty()) {
+					throw InvalidParameter("ScriptSimulator: loop_off without loop");
+				}
+				next.startIndex = loopStart.back() + 1;
+				loopStart.pop_back();
+				next.depth = (uint8_t)loopStart.size();
+				break;
+			case SET_FADE:
+			case SET_GRADIENT:
+			case WAIT:
+				break;
+			default:
+				throw InvalidParameter("ScriptSimulator: unsupported command");
+			}
+			mProgram.push_back(next);
+		}
+
+		if(!loopStart.empty()) {
+			throw InvalidParameter("ScriptSimulator: loop without loop_off");
+		}
+		Reset();
+	}
+
+	void ScriptSimulator::Reset(void)
+	{
+		mLoopCounter.resize(mProgram.size());
+		for(size_t i = 0; i < mProgram.size(); ++i) {
+			mLoopCounter[i] = mProgram[i].cmd.numLoops();
+		}
+		mExecute = 0;
+		mWaitValue = 0;
+		mNow = 0;
+
+		memset(mLed, 0, sizeof(mLed));
+		memset(mDelta, 0, sizeof(mDelta));
+		memset(mCyclesLeft, 0, sizeof(mCyclesLeft));
+		memset(mPeriodeLength, 0, sizeof(mPeriodeLength));
+		memset(mStepDown, 0, sizeof(mStepDown));
+		memset(mStepSize, 0, sizeof(mStepSize));
+
+		// everything up to the first time consuming command starts immediately
+		RunCommands(MAX_COMMANDS_PER_TICK);
+	}
+
+	void ScriptSimulator::Step(void)
+	{
+		// timer interrupt
+		++mNow;
+		if(mWaitValue > 0) {
+			--mWaitValue;
+		}
+
+		// first pass of the main cycle after the interrupt
+		RunCommands(COMMANDS_PER_PASS);
+		DoFade();
+
+		// the following passes until the next interrupt
+		if(MAX_COMMANDS_PER_TICK == RunCommands(MAX_COMMANDS_PER_TICK)) {
+			Trace(ZONE_VERBOSE, "%zu commands at %llu without any delay\n", MAX_COMMANDS_PER_TICK, (unsigned long long)mNow);
+		}
+	}
+
+	void ScriptSimulator::Advance(uint64_t ticks)
+	{
+		while(ticks > 0) {
+			// number of ticks, which neither execute a command nor step a fade
+			uint64_t idle = ticks;
+			if(mExecute < mProgram.size()) {
+				idle = std::min<uint64_t>(idle, (mWaitValue > 0) ? mWaitValue - 1 : 0);
+			}
+			for(size_t k = 0; (k < NUM_CHANNELS) && (idle > 0); ++k) {
+				if(mDelta[k] > 0) {
+					idle = std::min<uint64_t>(idle, (mCyclesLeft[k] > 0) ? mCyclesLeft[k] - 1 : 0);
+				}
+			}
+
+			if(0 == idle) {
+				Step();
+				--ticks;
+				continue;
+			}
+
+			mNow += idle;
+			ticks -= idle;
+			mWaitValue = (mWaitValue > idle) ? (uint16_t)(mWaitValue - idle) : 0;
+			for(size_t k = 0; k < NUM_CHANNELS; ++k) {
+				if((mDelta[k] > 0) && (mCyclesLeft[k] > 0)) {
+					mCyclesLeft[k] -= (uint16_t)idle;
+				}
+			}
+		}
+	}
+
+	bool ScriptSimulator::IsIdle(void) const
+	{
+		if((mExecute < mProgram.size()) || (mWaitValue > 0)) {
+			return false;
+		}
+		return std::all_of(mDelta, mDelta + NUM_CHANNELS, [](uint8_t delta) {return 0 == delta; });
+	}
+
+	uint32_t ScriptSimulator::GetColor(size_t led) const
+	{
+		const uint8_t *const pLed = mLed + 3 * led;
+		return 0xff000000 | (uint32_t)pLed[2] << 16 | (uint32_t)pLed[1] << 8 | pLed[0];
+	}
+
+	ScriptSimulator::Frame ScriptSimulator::GetFrame(void) const
+	{
+		Frame frame;
+		for(size_t led = 0; led < NUM_LEDS; ++led) {
+			frame[led] = GetColor(led);
+		}
+		return frame;
+	}
+
+	std::vector<ScriptSimulator::Frame> ScriptSimulator::Render(uint64_t interval, size_t numFrames)
+	{
+		std::vector<Frame> frames;
+		frames.reserve(numFrames);
+		for(size_t i = 0; i < numFrames; ++i) {
+			if(i > 0) {
+				Advance(interval);
+			}
+			frames.push_back(GetFrame());
+		}
+		return frames;
+	}
+
+	/**
+	 * Port of the CALC_COLOR macro of ledstrip.c
+	 */
+	void ScriptSimulator::CalcColor(size_t channel, uint8_t newColor, uint16_t fadeTmms)
+	{
+		if(channel >= NUM_CHANNELS) {
+			return;
+		}
+
+		uint8_t delta = mLed[channel];
+		mStepDown[channel] = delta > newColor;
+		delta = mStepDown[channel] ? delta - newColor : newColor - delta;
+
+		// the firmware handles a fade time of zero as one
+		fadeTmms = std::max<uint16_t>(1, fadeTmms);
+		uint8_t stepSize = 1;
+		uint16_t periodeLength = 0;
+		if(0 != delta) {
+			do {
+				const uint8_t numSteps = delta / stepSize;
+				periodeLength = fadeTmms / numSteps;
+				if(periodeLength < 1) {
+					++stepSize;
+				}
+			} while(periodeLength < 1);
+		}
+		mStepSize[channel] = stepSize;
+		mDelta[channel] = delta;
+		mPeriodeLength[channel] = periodeLength;
+		mCyclesLeft[channel] = periodeLength;
+	}
+
+	/**
+	 * Port of Ledstrip_DoFade()
+	 */
+	void ScriptSimulator::DoFade(void)
+	{
+		for(size_t k = 0; k < NUM_CHANNELS; ++k) {
+			if((mDelta[k] > 0) && (mCyclesLeft[k] > 0)) {
+				--mCyclesLeft[k];
+			}
+		}
+
+		for(size_t k = 0; k < NUM_CHANNELS; ++k) {
+			if((mDelta[k] > 0) && (mCyclesLeft[k] == 0)) {
+				uint8_t stepSize = mStepSize[k];
+				if(mDelta[k] < stepSize) {
+					stepSize = mDelta[k];
+					mDelta[k] = 0;
+				} else {
+					mDelta[k] -= stepSize;
+				}
+				mCyclesLeft[k] = mPeriodeLength[k];
+				mLed[k] = mStepDown[k] ? mLed[k] - stepSize : mLed[k] + stepSize;
+			}
+		}
+	}
+
+	/**
+	 * Port of one iteration of ScriptCtrl_Run()
+	 * @return false if no command was executed, because we wait or the script is over
+	 */
+	bool ScriptSimulator::RunCommand(void)
+	{
+		if((mWaitValue > 0) || (mExecute >= mProgram.size())) {
+			return false;
+		}
+
+		const Instruction& next = mProgram[mExecute];
+		cmd_set_fade fade;
+		cmd_set_gradient gradient;
+		switch(next.cmd.GetType())
+		{
+		case LOOP_ON:
+			++mExecute;
+			break;
+		case LOOP_OFF:
+		{
+			uint8_t& counter = mLoopCounter[mExecute];
+			if(LOOP_INFINITE == counter) {
+				mExecute = next.startIndex;
+			} else if(counter > 1) {
+				--counter;
+				mExecute = next.startIndex;
+			} else {
+				// only inner loops are rearmed, the outer loop is removed from the ring
+				if(0 != next.depth) {
+					counter = next.cmd.numLoops();
+				}
+				++mExecute;
+			}
+			break;
+		}
+		case SET_FADE:
+			memcpy(&fade, next.cmd.GetData() + 1, sizeof(fade));
+			SetFade(fade);
+			if(0 == fade.parallelFade) {
+				mWaitValue = ntohs(fade.fadeTmms);
+			}
+			++mExecute;
+			break;
+		case SET_GRADIENT:
+			memcpy(&gradient, next.cmd.GetData() + 1, sizeof(gradient));
+			SetGradient(gradient);
+			if(0 == (gradient.parallelAndOffset & 0x80)) {
+				mWaitValue = ntohs(gradient.fadeTmms);
+			}
+			++mExecute;
+			break;
+		case WAIT:
+			mWaitValue = next.cmd.waitTime();
+			++mExecute;
+			break;
+		}
+		return true;
+	}
+
+	/**
+	 * Port of ScriptCtrl_Run()
+	 * @return number of executed commands
+	 */
+	size_t ScriptSimulator::RunCommands(size_t maxCommands)
+	{
+		size_t numExecuted = 0;
+		while((numExecuted < maxCommands) && RunCommand()) {
+			++numExecuted;
+		}
+		return numExecuted;
+	}
+
+	/**
+	 * Port of Ledstrip_SetFade()
+	 */
+	void ScriptSimulator::SetFade(const cmd_set_fade& fade)
+	{
+		const uint16_t fadeTmms = ntohs(fade.fadeTmms);
+
+		// the address mask selects leds of a single segment or of each segment
+		size_t first = 0;
+		size_t end = NUM_LEDS;
+		if(SEGMENT_ALL != fade.segment) {
+			first = fade.segment * NUM_OF_LED_PER_SEGMENT;
+			end = std::min(NUM_LEDS, first + NUM_OF_LED_PER_SEGMENT);
+		}
+
+		for(size_t led = first; led < end; ++led) {
+			const size_t bit = led % NUM_OF_LED_PER_SEGMENT;
+			if(0 != (fade.addr[bit / 8] & (1 << (bit % 8)))) {
+				CalcColor(3 * led, fade.blue, fadeTmms);
+				CalcColor(3 * led + 1, fade.green, fadeTmms);
+				CalcColor(3 * led + 2, fade.red, fadeTmms);
+			}
+		}
+	}
+
+	/**
+	 * Port of Ledstrip_SetGradient(), all calculations are done with 8 bit like
+	 * the firmware does, positions with the width of its led_index
+	 */
+	void ScriptSimulator::SetGradient(const cmd_set_gradient& gradient)
+	{
+		if(gradient.segment >= NUM_OF_SEGMENTS) {
+			return;
+		}
+
+		typedef std::conditional<(NUM_CHANNELS > 255), uint16_t, uint8_t>::type led_index;
+		const uint16_t fadeTmms = ntohs(gradient.fadeTmms);
+		uint8_t numOfLeds = gradient.numberOfLeds - 1;
+		if((255 == numOfLeds) || (0 == numOfLeds)) {
+			numOfLeds = 1;
+		}
+
+		auto calcDelta = [numOfLeds](uint8_t color_1, uint8_t color_2) {
+			return (uint8_t)(((color_1 > color_2) ? color_1 - color_2 : color_2 - color_1) / numOfLeds);
+		};
+		auto adjustColor = [](uint8_t& color, uint8_t compare, uint8_t diff) {
+			color = (color > compare) ? color - diff : color + diff;
+		};
+		const uint8_t deltaRed = calcDelta(gradient.red_1, gradient.red_2);
+		const uint8_t deltaGreen = calcDelta(gradient.green_1, gradient.green_2);
+		const uint8_t deltaBlue = calcDelta(gradient.blue_1, gradient.blue_2);
+
+		uint8_t red = gradient.red_1;
+		uint8_t green = gradient.green_1;
+		uint8_t blue = gradient.blue_1;
+
+		const led_index offset = (led_index)((gradient.segment * NUM_OF_LED_PER_SEGMENT + (gradient.parallelAndOffset & 0x7f)) * 3);
+		const led_index endPosition = (led_index)(offset + numOfLeds * 3);
+
+		for(size_t k = 0; k < NUM_CHANNELS; ++k) {
+			if(k >= endPosition) {
+				CalcColor(k, gradient.blue_2, fadeTmms);
+				CalcColor(k + 1, gradient.green_2, fadeTmms);
+				CalcColor(k + 2, gradient.red_2, fadeTmms);
+				return;
+			}
+
+			if(k >= offset) {
+				CalcColor(k, blue, fadeTmms);
+				CalcColor(++k, green, fadeTmms);
+				CalcColor(++k, red, fadeTmms);
+				adjustColor(red, gradient.red_2, deltaRed);
+				adjustColor(green, gradient.green_2, deltaGreen);
+				adjustColor(blue, gradient.blue_2, deltaBlue);
+			}
+		}
+	}
+} /* namespace WyLight */
@@ -0,0 +1,150 @@
+/*
+ Copyright (C) 2013 Nils Weiss, Patrick Bruenn.
+
+ This file is part of Wifly_Light.
+
+ Wifly_Light is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Wifly_Light is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Wifly_Light.  If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef __WyLight__ScriptSimulator__
+#define __WyLight__ScriptSimulator__
+
+#include "Script.h"
+#include "ScriptCtrl.h"
+#include "WiflyControlException.h"
+
+#include <array>
+#include <stdint.h>
+#include <vector>
+
+namespace WyLight {
+
+	/******************************************************************************/
+	/*! \file ScriptSimulator.h
+	 * \brief Runs a Script in virtual time, the way the firmware would run it
+	 *
+	 * The simulator is a host side port of the script controller (ScriptCtrl.c)
+	 * and the fade engine (ledstrip.c) including their integer arithmetic, so
+	 * it produces the same colors the ledstrip shows at the same time.
+	 * Time is counted in ticks of the firmware fade timer, one tick is one
+	 * hundredth of a second like all times in a script.
+	 *
+	 * Each tick mirrors the firmware main cycle after a timer interrupt: the
+	 * wait counter is decremented, the first pass executes the commands up to
+	 * the first one which consumes time (at most COMMANDS_PER_PASS) and steps
+	 * the fades, the following passes run the commands beyond that budget.
+	 * Ticks without any fade step or command are skipped, so rendering a script
+	 * takes only a fraction of its runtime.
+	 *
+	 * Differences to the firmware:
+	 * - the 63 slot script ring is not modeled, the script is always complete
+	 * - at most MAX_COMMANDS_PER_TICK commands run without time passing, the
+	 *   firmware would spin on a loop of parallel fades until the next tick
+	 *******************************************************************************/
+	class ScriptSimulator
+	{
+	public:
+		static const size_t NUM_LEDS = NUM_OF_LED;
+		static const size_t LOOP_DEPTH_MAX = SCRIPTCTRL_LOOP_DEPTH_MAX;
+		static const size_t MAX_COMMANDS_PER_TICK = 256;
+		static const size_t COMMANDS_PER_PASS = SCRIPTCTRL_RUN_BUDGET;
+
+		/**
+		 * Colors of all leds as 0xffRRGGBB, index 0 is the first led of the strip
+		 */
+		typedef std::array<uint32_t, NUM_OF_LED> Frame;
+
+		/**
+		 * Load <script> and rewind to its start, all leds are off
+		 * @throw InvalidParameter if the loops of <script> are unbalanced or nested
+		 *        deeper than the firmware supports
+		 */
+		ScriptSimulator(const Script& script) throw (InvalidParameter);
+
+		/**
+		 * Rewind to the start of the script and switch all leds off
+		 */
+		void Reset(void);
+
+		/**
+		 * Run exactly one tick of the fade timer
+		 */
+		void Step(void);
+
+		/**
+		 * Run the script for <ticks>, identical to calling Step() <ticks> times
+		 */
+		void Advance(uint64_t ticks);
+
+		/**
+		 * @return ticks since the start of the script
+		 */
+		uint64_t Now(void) const { return mNow; };
+
+		/**
+		 * @return true if all commands were executed and all fades are complete
+		 */
+		bool IsIdle(void) const;
+
+		/**
+		 * @return color of <led> as 0xffRRGGBB
+		 */
+		uint32_t GetColor(size_t led) const;
+		Frame GetFrame(void) const;
+
+		/**
+		 * @return the led buffer in firmware layout: blue, green, red for each led
+		 */
+		const uint8_t *GetLedArray(void) const { return mLed; };
+
+		/**
+		 * Render <numFrames> frames, starting with the current state and advancing
+		 * <interval> ticks after each frame
+		 */
+		std::vector<Frame> Render(uint64_t interval, size_t numFrames);
+
+	private:
+		/**
+		 * A script command with the loop information ScriptCtrl_Add() stores
+		 * along with the LOOP_OFF command
+		 */
+		struct Instruction {
+			ScriptCommand cmd;
+			size_t startIndex;
+			uint8_t depth;
+		};
+
+		static const size_t NUM_CHANNELS = NUM_OF_LED * 3;
+
+		std::vector<Instruction> mProgram;
+		std::vector<uint8_t> mLoopCounter;
+		size_t mExecute;
+		uint16_t mWaitValue;
+		uint64_t mNow;
+
+		uint8_t mLed[NUM_CHANNELS];
+		uint8_t mDelta[NUM_CHANNELS];
+		uint16_t mCyclesLeft[NUM_CHANNELS];
+		uint16_t mPeriodeLength[NUM_CHANNELS];
+		bool mStepDown[NUM_CHANNELS];
+		uint8_t mStepSize[NUM_CHANNELS];
+
+		void CalcColor(size_t channel, uint8_t newColor, uint16_t fadeTmms);
+		void DoFade(void);
+		bool RunCommand(void);
+		size_t RunCommands(size_t maxCommands);
+		void SetFade(const cmd_set_fade& fade);
+		void SetGradient(const cmd_set_gradient& gradient);
+	};
+} /* namespace WyLight */
+#endif /* #ifndef __WyLight__ScriptSimulator__ */
@@ -0,0 +1,312 @@
+/*
+ Copyright (C) 2013 Nils Weiss, Patrick Bruenn.
+
+ This file is part of Wifly_Light.
+
+ Wifly_Light is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Wifly_Light is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Wifly_Light.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include "unittest.h"
+#include "ScriptSimulator.h"
+#include "CommandIO.h"
+#include "ScriptCtrl.h"
+#include "ledstrip.h"
+#include <chrono>
+#include <iostream>
+#include <random>
+
+using namespace WyLight;
+
+static const uint32_t g_DebugZones = ZONE_ERROR | ZONE_WARNING | ZONE_INFO | ZONE_VERBOSE;
+
+const std::string FwCmdSetFade::TOKEN("fade");
+const std::string FwCmdSetGradient::TOKEN("gradient");
+const std::string FwCmdLoopOn::TOKEN("loop");
+const std::string FwCmdLoopOff::TOKEN("loop_off");
+const std::string FwCmdWait::TOKEN("wait");
+
+const size_t FwCmdScript::INDENTATION_MAX;
+const char FwCmdScript::INDENTATION_CHARACTER;
+
+static const size_t NUM_RANDOM_SCRIPTS = 200;
+static const size_t NUM_GOLDEN_TICKS = 3000;
+
+/**************** wrapping the firmware for the golden tests ****************/
+jmp_buf g_ResetEnvironment;
+struct response_frame g_ResponseBuf;
+
+void CommandIO_CreateResponse(struct response_frame *mFrame, uns8 cmd, ErrorCode mState)
+{}
+
+void CommandIO_SendResponse(struct response_frame *mFrame)
+{}
+
+void UART_Flush(void)
+{}
+
+void SPI_Init(void)
+{}
+
+void SPI_SendLedBuffer(uns8 *array)
+{}
+
+/**
+ * Upload <script> into the firmware script controller and run everything
+ * up to the first time consuming command
+ */
+static void Firmware_Load(const Script& script)
+{
+	Ledstrip_Init();
+	ScriptCtrl_Clear();
+	gScriptBuf.loopDepth = 0;
+	for(const auto& cmd : script) {
+		struct led_cmd frame;
+		memcpy(&frame, cmd.GetData(), cmd.GetSize());
+		ScriptCtrl_Add(&frame);
+	}
+	for(size_t i = 0; i < ScriptSimulator::MAX_COMMANDS_PER_TICK; ++i) {
+		ScriptCtrl_Run();
+	}
+}
+
+/**
+ * One timer interrupt followed by the main cycle
+ */
+static void Firmware_Step(void)
+{
+	ScriptCtrl_DecrementWaitValue();
+	ScriptCtrl_Run();
+	Ledstrip_DoFade();
+	for(size_t i = 0; i < ScriptSimulator::MAX_COMMANDS_PER_TICK; ++i) {
+		ScriptCtrl_Run();
+	}
+}
+
+static bool Firmware_Equals(const ScriptSimulator& simulator)
+{
+	return 0 == memcmp(gLedBuf.led_array, simulator.GetLedArray(), sizeof(gLedBuf.led_array));
+}
+
+/**
+ * Random script with at most 60 commands, so it fits into the firmware script ring
+ */
+static void AddRandomBlock(Script& script, std::mt19937& rng, size_t depth)
+{
+	const size_t numCommands = 1 + rng() % 5;
+	for(size_t i = 0; (i < numCommands) && (script.size() < 52); ++i) {
+		const uint32_t color = 0xff000000 | (rng() & 0xffffff);
+		const uint16_t fadeTime = 1 + rng() % 300;
+		// mostly the first segment, sometimes all or one beyond the strip
+		static const uint8_t segments[] = {0, 0, 0, 0, 1, SEGMENT_ALL};
+		const uint8_t segment = segments[rng() % sizeof(segments)];
+		switch(rng() % 6) {
+		case 0:
+			script.push_back(FwCmdWait(1 + rng() % 50));
+			break;
+		case 1:
+			if(depth < ScriptSimulator::LOOP_DEPTH_MAX) {
+				script.push_back(FwCmdLoopOn());
+				AddRandomBlock(script, rng, depth + 1);
+				script.push_back(FwCmdWait(1 + rng() % 50));
+				script.push_back(FwCmdLoopOff(rng() % 4));
+				break;
+			}
+			/* too deep for another loop, add a gradient instead */
+		case 2:
+		{
+			const uint8_t offset = rng() % NUM_OF_LED;
+			const uint8_t length = 1 + rng() % (NUM_OF_LED - offset);
+			script.push_back(FwCmdSetGradient(color, 0xff000000 | (rng() & 0xffffff), fadeTime, rng() & 1, length, offset, segment));
+			break;
+		}
+		default:
+			script.push_back(FwCmdSetFade(color, fadeTime, rng(), rng() & 1, segment));
+			break;
+		}
+	}
+}
+
+size_t ut_ScriptSimulator_Fade(void)
+{
+	TestCaseBegin();
+	Script script;
+	script.push_back(FwCmdSetFade(0xffff0000, 255, 0x00000001));
+	ScriptSimulator testee(script);
+
+	// one step each tick
+	CHECK(0xff000000 == testee.GetColor(0));
+	testee.Advance(100);
+	CHECK(100 == testee.Now());
+	CHECK(0xff640000 == testee.GetColor(0));
+	CHECK(0xff000000 == testee.GetColor(1));
+	CHECK(!testee.IsIdle());
+
+	testee.Advance(155);
+	CHECK(0xffff0000 == testee.GetColor(0));
+	CHECK(testee.IsIdle());
+
+	// rewind
+	testee.Reset();
+	CHECK(0 == testee.Now());
+	CHECK(0xff000000 == testee.GetColor(0));
+	TestCaseEnd();
+}
+
+size_t ut_ScriptSimulator_Gradient(void)
+{
+	TestCaseBegin();
+	Script script;
+	script.push_back(FwCmdSetGradient(0xff000000, 0xff0000ff, 1, false, NUM_OF_LED, 0));
+	ScriptSimulator testee(script);
+	testee.Advance(10);
+
+	// 255 / 31 leds leaves a gap between the last two leds, like the firmware does
+	for(size_t led = 0; led < NUM_OF_LED - 1; ++led) {
+		CHECK((0xff000000 | 8 * led) == testee.GetColor(led));
+	}
+	CHECK(0xff0000ff == testee.GetColor(NUM_OF_LED - 1));
+	TestCaseEnd();
+}
+
+size_t ut_ScriptSimulator_Loops(void)
+{
+	TestCaseBegin();
+	Script script;
+	script.push_back(FwCmdLoopOn());
+	script.push_back(FwCmdLoopOn());
+	script.push_back(FwCmdSetFade(0xff0000ff, 10));
+	script.push_back(FwCmdSetFade(0xff000000, 10));
+	script.push_back(FwCmdLoopOff(2));
+	script.push_back(FwCmdWait(5));
+	script.push_back(FwCmdLoopOff(3));
+	ScriptSimulator testee(script);
+
+	testee.Advance(3 * (2 * 20 + 5) - 1);
+	CHECK(!testee.IsIdle());
+	testee.Step();
+	CHECK(testee.IsIdle());
+	CHECK(0xff000000 == testee.GetColor(0));
+
+	Script infinite;
+	infinite.push_back(FwCmdLoopOn());
+	infinite.push_back(FwCmdSetFade(0xff0000ff, 10, 0xffffffff, true));
+	infinite.push_back(FwCmdLoopOff(0));
+	ScriptSimulator spinning(infinite);
+	spinning.Advance(100);
+	CHECK(!spinning.IsIdle());
+	// the fade is restarted each tick, so it slows down and never completes
+	CHECK(0xff000000 != spinning.GetColor(5));
+	CHECK(0xff0000ff != spinning.GetColor(5));
+
+	Script unbalanced;
+	unbalanced.push_back(FwCmdLoopOff(1));
+	try {
+		ScriptSimulator failing(unbalanced);
+		CHECK(false);
+	} catch (InvalidParameter& e) {}
+
+	Script tooDeep;
+	for(size_t i = 0; i <= ScriptSimulator::LOOP_DEPTH_MAX; ++i) {
+		tooDeep.push_back(FwCmdLoopOn());
+	}
+	try {
+		ScriptSimulator failing(tooDeep);
+		CHECK(false);
+	} catch (InvalidParameter& e) {}
+	TestCaseEnd();
+}
+
+size_t ut_ScriptSimulator_Render(void)
+{
+	TestCaseBegin();
+	const Script script("TestInput.txt");
+	ScriptSimulator stepped(script);
+	ScriptSimulator rendered(script);
+
+	const auto frames = rendered.Render(7, 50);
+	CHECK(50 == frames.size());
+	CHECK(49 * 7 == rendered.Now());
+	for(const auto& frame : frames) {
+		CHECK(frame == stepped.GetFrame());
+		for(size_t i = 0; i < 7; ++i) {
+			stepped.Step();
+		}
+	}
+	TestCaseEnd();
+}
+
+/**
+ * The simulator has to produce the same led buffer as the firmware code in each tick
+ */
+size_t ut_ScriptSimulator_GoldenFirmware(void)
+{
+	TestCaseBegin();
+	std::mt19937 rng(4711);
+	for(size_t i = 0; i < NUM_RANDOM_SCRIPTS; ++i) {
+		Script script;
+		AddRandomBlock(script, rng, 0);
+		AddRandomBlock(script, rng, 0);
+
+		ScriptSimulator stepped(script);
+		ScriptSimulator skipping(script);
+		Firmware_Load(script);
+		CHECK(Firmware_Equals(stepped));
+
+		size_t nextSync = 0;
+		for(size_t tick = 1; tick <= NUM_GOLDEN_TICKS; ++tick) {
+			Firmware_Step();
+			stepped.Step();
+			if(!Firmware_Equals(stepped)) {
+				CHECK(false);
+				Trace(ZONE_ERROR, "script %zu differs at tick %zu\n", i, tick);
+				break;
+			}
+
+			// Advance() skips idle ticks, it has to end up in the same state
+			if(tick >= nextSync) {
+				skipping.Advance(tick - skipping.Now());
+				CHECK(skipping.GetFrame() == stepped.GetFrame());
+				nextSync = tick + rng() % 500;
+			}
+		}
+	}
+	TestCaseEnd();
+}
+
+size_t ut_ScriptSimulator_Benchmark(void)
+{
+	TestCaseBegin();
+	const Script script("TestInput2.txt");
+	static const uint64_t ONE_HOUR = 60 * 60 * 100;
+
+	ScriptSimulator testee(script);
+	const auto start = std::chrono::steady_clock::now();
+	testee.Render(100 / 25, ONE_HOUR / 4);
+	const auto duration = std::chrono::steady_clock::now() - start;
+
+	std::cout << "Rendering one hour at 25 fps took " << std::chrono::duration_cast<std::chrono::milliseconds>(duration).count() << " ms\n";
+	CHECK(ONE_HOUR - 4 == testee.Now());
+	TestCaseEnd();
+}
+
+int main (int argc, const char *argv[])
+{
+	UnitTestMainBegin();
+	RunTest(true, ut_ScriptSimulator_Fade);
+	RunTest(true, ut_ScriptSimulator_Gradient);
+	RunTest(true, ut_ScriptSimulator_Loops);
+	RunTest(true, ut_ScriptSimulator_Render);
+	RunTest(true, ut_ScriptSimulator_GoldenFirmware);
+	RunTest(true, ut_ScriptSimulator_Benchmark);
+	UnitTestMainEnd();
+}
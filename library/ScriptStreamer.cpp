@@ -0,0 +1,120 @@
+/*
+ Copyright (C) 2013 Nils Weiss, Patrick Bruenn.
+
+ This file is part of Wifly_Light.
+
+ Wifly_Light is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Wifly_Light is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Wifly_Light.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include "ScriptStreamer.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace WyLight {
+
+	static const uint32_t g_DebugZones = ZONE_ERROR | ZONE_WARNING | ZONE_INFO | ZONE_VERBOSE;
+
+	const size_t ScriptStreamer::NUM_SLOTS;
+	const size_t ScriptStreamer::MIN_BATCH;
+
+	ScriptStreamer::ScriptStreamer(const Script& script, size_t minBatch) throw (InvalidParameter)
+		: mScript(script), mMinBatch(std::max<size_t>(1, std::min(minBatch, NUM_SLOTS))), mEnd(script.size()), mNext(0), mLoopDepth(0)
+	{
+		size_t depth = 0;
+		size_t loopStart = 0;
+		for(size_t i = 0; i < mScript.size(); ++i) {
+			const ScriptCommand& cmd = mScript[i];
+			if(LOOP_ON == cmd.GetType()) {
+				if(0 == depth) {
+					loopStart = i;
+				}
+				++depth;
+			} else if(LOOP_OFF == cmd.GetType()) {
+				if(0 == depth) {
+					throw InvalidParameter("ScriptStreamer: loop_off without loop");
+				}
+				if(0 == --depth) {
+					if(i - loopStart + 1 > NUM_SLOTS) {
+						throw InvalidParameter("ScriptStreamer: loop doesn't fit into the script buffer");
+					}
+					if(0 == cmd.numLoops()) {
+						// an infinite loop never releases its slots
+						mEnd = i + 1;
+						break;
+					}
+				}
+			}
+		}
+
+		if(depth > 0) {
+			throw InvalidParameter("ScriptStreamer: loop without loop_off");
+		}
+	}
+
+	size_t ScriptStreamer::NumToSend(const script_state& state) const
+	{
+		const size_t numSend = std::min<size_t>(state.numFree, NumRemaining());
+		const size_t numPending = (state.write - state.execute) & NUM_SLOTS;
+
+		// the firmware doesn't release any slot until an incomplete loop is sent
+		if((numSend >= mMinBatch) || (numSend == NumRemaining()) || (numPending < mMinBatch) || (mLoopDepth > 0)) {
+			return numSend;
+		}
+		return 0;
+	}
+
+	void ScriptStreamer::CommandSent(void)
+	{
+		const uint8_t type = NextCommand().GetType();
+		if(LOOP_ON == type) {
+			++mLoopDepth;
+		} else if(LOOP_OFF == type) {
+			--mLoopDepth;
+		}
+		++mNext;
+	}
+
+	size_t ScriptStreamer::TopUp(Control& control) throw (ConnectionTimeout, FatalError)
+	{
+		const script_state state = control.FwGetScriptState();
+		const size_t numSend = NumToSend(state);
+		const size_t first = mNext;
+		try {
+			for(size_t i = 0; i < numSend; ++i) {
+				control << FwCmdScriptCommand(NextCommand());
+				CommandSent();
+			}
+		} catch (ScriptBufferFull& e) {
+			// the ring state was outdated, retry with the next poll
+			Trace(ZONE_WARNING, "script buffer full after %zu commands\n", mNext);
+		}
+		return mNext - first;
+	}
+
+	void ScriptStreamer::Run(Control& control, std::chrono::milliseconds minInterval, std::chrono::milliseconds maxInterval) throw (ConnectionTimeout, FatalError)
+	{
+		std::chrono::milliseconds interval = minInterval;
+		while(!IsComplete()) {
+			const size_t numSent = NumSent();
+			TopUp(control);
+			if(IsComplete()) {
+				break;
+			}
+			interval = (NumSent() != numSent) ? minInterval : std::min(2 * interval, maxInterval);
+			std::this_thread::sleep_for(interval);
+		}
+		Trace(ZONE_INFO, "streamed %zu commands\n", NumSent());
+	}
+} /* namespace WyLight */
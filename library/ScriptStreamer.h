@@ -0,0 +1,106 @@
+/*
+ Copyright (C) 2013 Nils Weiss, Patrick Bruenn.
+
+ This file is part of Wifly_Light.
+
+ Wifly_Light is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Wifly_Light is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Wifly_Light.  If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef __WyLight__ScriptStreamer__
+#define __WyLight__ScriptStreamer__
+
+#include "Script.h"
+#include "WiflyControl.h"
+#include "WiflyControlException.h"
+
+#include <chrono>
+#include <stdint.h>
+
+namespace WyLight {
+
+	/******************************************************************************/
+	/*! \file ScriptStreamer.h
+	 * \brief Plays scripts, which are longer than the firmware script ring
+	 *
+	 * The firmware stores at most NUM_SLOTS commands and rejects further commands
+	 * with SCRIPT_FULL. The streamer sends the script in order and tops up the
+	 * ring as the firmware consumes commands, so a script of any length plays
+	 * without gaps.
+	 *
+	 * To keep the link idle most of the time, the streamer waits until at least
+	 * MIN_BATCH slots are free and sends them at once. Only if less than
+	 * MIN_BATCH commands are left for execution, smaller batches are sent to
+	 * avoid a gap. Run() polls the ring state and doubles its poll interval
+	 * each time nothing could be sent.
+	 *
+	 * A top level loop occupies its slots until it is completed, so each top
+	 * level loop has to fit into the ring as a whole. A loop, which occupies all
+	 * slots, delays the following command by one tick, because it can't be sent
+	 * before the loop completes. Commands after an infinite top level loop are
+	 * never executed and thus not streamed.
+	 *******************************************************************************/
+	class ScriptStreamer
+	{
+	public:
+		static const size_t NUM_SLOTS = SCRIPTCTRL_NUM_CMD_MAX;
+		static const size_t MIN_BATCH = 16;
+
+		/**
+		 * @throw InvalidParameter if the loops of <script> are unbalanced or a
+		 *        top level loop doesn't fit into the firmware script ring
+		 */
+		ScriptStreamer(const Script& script, size_t minBatch = MIN_BATCH) throw (InvalidParameter);
+
+		/**
+		 * @return true if all commands, which will ever be executed, were sent
+		 */
+		bool IsComplete(void) const { return mNext >= mEnd; };
+		size_t NumSent(void) const { return mNext; };
+		size_t NumRemaining(void) const { return mEnd - mNext; };
+
+		/**
+		 * @return number of commands to send now, if the firmware script ring is in <state>
+		 */
+		size_t NumToSend(const script_state& state) const;
+
+		const ScriptCommand& NextCommand(void) const { return mScript[mNext]; };
+
+		/**
+		 * Call this after NextCommand() was accepted by the firmware
+		 */
+		void CommandSent(void);
+
+		/**
+		 * Query the script ring and send as many commands as NumToSend() allows
+		 * @return number of commands sent
+		 */
+		size_t TopUp(Control& control) throw (ConnectionTimeout, FatalError);
+
+		/**
+		 * Call TopUp() until the script is complete. After commands were sent the
+		 * next poll follows after <minInterval>, each poll without progress doubles
+		 * the interval up to <maxInterval>.
+		 */
+		void Run(Control& control,
+			 std::chrono::milliseconds minInterval = std::chrono::milliseconds(100),
+			 std::chrono::milliseconds maxInterval = std::chrono::milliseconds(3200)) throw (ConnectionTimeout, FatalError);
+
+	private:
+		const Script mScript;
+		const size_t mMinBatch;
+		size_t mEnd;
+		size_t mNext;
+		size_t mLoopDepth;
+	};
+} /* namespace WyLight */
+#endif /* #ifndef __WyLight__ScriptStreamer__ */
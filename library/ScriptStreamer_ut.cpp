@@ -0,0 +1,308 @@
+/*
+ Copyright (C) 2013 Nils Weiss, Patrick Bruenn.
+
+ This file is part of Wifly_Light.
+
+ Wifly_Light is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Wifly_Light is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Wifly_Light.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include "unittest.h"
+#include "ScriptStreamer.h"
+#include "ScriptSimulator.h"
+#include "CommandIO.h"
+#include "ScriptCtrl.h"
+#include "ledstrip.h"
+#include <random>
+
+using namespace WyLight;
+
+static const uint32_t g_DebugZones = ZONE_ERROR | ZONE_WARNING | ZONE_INFO | ZONE_VERBOSE;
+
+const std::string FwCmdSetFade::TOKEN("fade");
+const std::string FwCmdSetGradient::TOKEN("gradient");
+const std::string FwCmdLoopOn::TOKEN("loop");
+const std::string FwCmdLoopOff::TOKEN("loop_off");
+const std::string FwCmdWait::TOKEN("wait");
+
+const size_t FwCmdScript::INDENTATION_MAX;
+const char FwCmdScript::INDENTATION_CHARACTER;
+
+/***** Wrappers ****/
+ClientSocket::ClientSocket(uint32_t addr, uint16_t port, int style) throw (FatalError) : mSock(0), mSockAddr(addr, port) {}
+ClientSocket::~ClientSocket(void) {}
+TcpSocket::TcpSocket(uint32_t addr, uint16_t port, uint32_t interfaceIndex, uint32_t connectTimeoutMs) throw (ConnectionLost, FatalError) : ClientSocket(addr, port, 0) {}
+size_t TcpSocket::Recv(uint8_t *pBuffer, size_t length, timeval *timeout) const throw (FatalError) {
+	return 0;
+}
+size_t TcpSocket::Send(const uint8_t *frame, size_t length) const {
+	return 0;
+}
+ComProxy::ComProxy(const TcpSocket& sock) : mSock (sock) {}
+TelnetProxy::TelnetProxy(const TcpSocket& sock) : mSock (sock) {}
+UdpSocket::UdpSocket(uint32_t addr, uint16_t port, bool doBind, int enableBroadcast, uint32_t interfaceIndex) throw (FatalError) : ClientSocket(addr, port, SOCK_DGRAM) {}
+size_t UdpSocket::Send(const uint8_t *frame, size_t length) const {
+	return length;
+}
+
+Control::Control(uint32_t addr, uint16_t port, uint32_t interfaceIndex, uint32_t connectTimeoutMs)
+	: mTcpSock(addr, port), mUdpSock(addr, port, false, 0), mProxy(mTcpSock), mTelnet(mTcpSock), mCredit(0)
+{}
+
+static size_t g_NumQueries;
+static size_t g_NumCommands;
+
+/* the control talks directly to the firmware script controller */
+script_state Control::FwGetScriptState(void) throw (ConnectionTimeout, FatalError, ScriptBufferFull)
+{
+	script_state state;
+	ScriptCtrl_GetState(&state);
+	++g_NumQueries;
+	return state;
+}
+
+Control& Control::operator<<(FwCommand&& cmd) throw (ConnectionTimeout, FatalError, ScriptBufferFull)
+{
+	struct led_cmd frame;
+	memcpy(&frame, cmd.GetData(), cmd.GetSize());
+	if(OK != ScriptCtrl_Add(&frame)) {
+		throw ScriptBufferFull();
+	}
+	++g_NumCommands;
+	return *this;
+}
+
+/**************** wrapping the firmware ****************/
+jmp_buf g_ResetEnvironment;
+struct response_frame g_ResponseBuf;
+
+void CommandIO_CreateResponse(struct response_frame *mFrame, uns8 cmd, ErrorCode mState)
+{}
+
+void CommandIO_SendResponse(struct response_frame *mFrame)
+{}
+
+void UART_Flush(void)
+{}
+
+void SPI_Init(void)
+{}
+
+void SPI_SendLedBuffer(uns8 *array)
+{}
+
+static void Firmware_Init(void)
+{
+	Ledstrip_Init();
+	ScriptCtrl_Clear();
+	gScriptBuf.loopDepth = 0;
+	g_NumQueries = 0;
+	g_NumCommands = 0;
+}
+
+/**
+ * Run everything up to the next time consuming command
+ */
+static void Firmware_RunCommands(void)
+{
+	for(size_t i = 0; i < ScriptSimulator::MAX_COMMANDS_PER_TICK; ++i) {
+		ScriptCtrl_Run();
+	}
+}
+
+/**
+ * One timer interrupt followed by the main cycle
+ */
+static void Firmware_Step(void)
+{
+	ScriptCtrl_DecrementWaitValue();
+	ScriptCtrl_Run();
+	Ledstrip_DoFade();
+	Firmware_RunCommands();
+}
+
+static bool Firmware_Equals(const ScriptSimulator& simulator)
+{
+	return 0 == memcmp(gLedBuf.led_array, simulator.GetLedArray(), sizeof(gLedBuf.led_array));
+}
+
+/**
+ * Random commands, which consume time, so the firmware executes at most a
+ * few of them per tick
+ */
+static void AddRandomCommand(Script& script, std::mt19937& rng)
+{
+	const uint32_t color = 0xff000000 | (rng() & 0xffffff);
+	switch(rng() % 3) {
+	case 0:
+		script.push_back(FwCmdWait(1 + rng() % 20));
+		break;
+	case 1:
+		script.push_back(FwCmdSetGradient(color, 0xff000000 | (rng() & 0xffffff), 1 + rng() % 50, false, NUM_OF_LED, 0));
+		break;
+	default:
+		script.push_back(FwCmdSetFade(color, 1 + rng() % 50, rng(), false));
+		break;
+	}
+}
+
+static Script LongScript(void)
+{
+	std::mt19937 rng(4711);
+	Script script;
+	for(size_t i = 0; i < 100; ++i) {
+		AddRandomCommand(script, rng);
+	}
+
+	// a top level loop, which leaves only two slots to prefetch the following commands
+	script.push_back(FwCmdLoopOn());
+	for(size_t i = 0; i < ScriptStreamer::NUM_SLOTS - 4; ++i) {
+		AddRandomCommand(script, rng);
+	}
+	script.push_back(FwCmdLoopOff(2));
+
+	for(size_t i = 0; i < 300; ++i) {
+		if(0 == rng() % 40) {
+			script.push_back(FwCmdLoopOn());
+			script.push_back(FwCmdLoopOn());
+			AddRandomCommand(script, rng);
+			script.push_back(FwCmdLoopOff(3));
+			AddRandomCommand(script, rng);
+			script.push_back(FwCmdLoopOff(2));
+		}
+		AddRandomCommand(script, rng);
+	}
+	return script;
+}
+
+size_t ut_ScriptStreamer_Loops(void)
+{
+	TestCaseBegin();
+	Script fitting;
+	fitting.push_back(FwCmdLoopOn());
+	for(size_t i = 0; i < ScriptStreamer::NUM_SLOTS - 2; ++i) {
+		fitting.push_back(FwCmdWait(1));
+	}
+	fitting.push_back(FwCmdLoopOff(2));
+	ScriptStreamer streamer(fitting);
+	CHECK(ScriptStreamer::NUM_SLOTS == streamer.NumRemaining());
+
+	Script tooLarge(fitting);
+	tooLarge.push_back(FwCmdWait(1));
+	tooLarge[ScriptStreamer::NUM_SLOTS - 1] = ScriptCommand::Wait(1);
+	tooLarge[ScriptStreamer::NUM_SLOTS] = ScriptCommand::LoopOff(2);
+	try {
+		ScriptStreamer failing(tooLarge);
+		CHECK(false);
+	} catch (InvalidParameter& e) {}
+
+	Script unbalanced;
+	unbalanced.push_back(FwCmdLoopOn());
+	try {
+		ScriptStreamer failing(unbalanced);
+		CHECK(false);
+	} catch (InvalidParameter& e) {}
+
+	// commands after an infinite loop are never executed
+	Script infinite;
+	infinite.push_back(FwCmdWait(1));
+	infinite.push_back(FwCmdLoopOn());
+	infinite.push_back(FwCmdWait(1));
+	infinite.push_back(FwCmdLoopOff(0));
+	infinite.push_back(FwCmdWait(1));
+	ScriptStreamer truncated(infinite);
+	CHECK(4 == truncated.NumRemaining());
+	TestCaseEnd();
+}
+
+size_t ut_ScriptStreamer_Batching(void)
+{
+	TestCaseBegin();
+	Script script;
+	for(size_t i = 0; i < 100; ++i) {
+		script.push_back(FwCmdWait(1));
+	}
+	ScriptStreamer testee(script);
+
+	// empty ring
+	script_state state = {ScriptStreamer::NUM_SLOTS, 0, 0, 0};
+	CHECK(ScriptStreamer::NUM_SLOTS == testee.NumToSend(state));
+	for(size_t i = 0; i < ScriptStreamer::NUM_SLOTS; ++i) {
+		testee.CommandSent();
+	}
+
+	// small batches are delayed, as long as enough commands are pending
+	state = {ScriptStreamer::MIN_BATCH - 1, ScriptStreamer::MIN_BATCH - 1, ScriptStreamer::MIN_BATCH - 1, ScriptStreamer::NUM_SLOTS};
+	CHECK(0 == testee.NumToSend(state));
+	state = {ScriptStreamer::MIN_BATCH, ScriptStreamer::MIN_BATCH, ScriptStreamer::MIN_BATCH, ScriptStreamer::NUM_SLOTS};
+	CHECK(ScriptStreamer::MIN_BATCH == testee.NumToSend(state));
+
+	// ... but not if the ring is about to run empty
+	state = {3, 1, ScriptStreamer::NUM_SLOTS - 5, ScriptStreamer::NUM_SLOTS - 3};
+	CHECK(3 == testee.NumToSend(state));
+
+	// the rest of the script fits
+	for(size_t i = 0; i < 30; ++i) {
+		testee.CommandSent();
+	}
+	state = {10, 10, 10, ScriptStreamer::NUM_SLOTS};
+	CHECK(7 == testee.NumToSend(state));
+	TestCaseEnd();
+}
+
+/**
+ * Stream a script much longer than the ring into the firmware, it has to
+ * show the same colors as if the whole script fit into the ring.
+ */
+size_t ut_ScriptStreamer_Seamless(void)
+{
+	TestCaseBegin();
+	const Script script = LongScript();
+	ScriptSimulator simulator(script);
+	ScriptStreamer testee(script);
+	Control control(0, 0);
+
+	Firmware_Init();
+	testee.TopUp(control);
+	Firmware_RunCommands();
+	CHECK(Firmware_Equals(simulator));
+
+	size_t numBatches = 0;
+	while(!simulator.IsIdle()) {
+		Firmware_Step();
+		simulator.Step();
+		if(!Firmware_Equals(simulator)) {
+			CHECK(false);
+			Trace(ZONE_ERROR, "differs at tick %zu\n", (size_t)simulator.Now());
+			break;
+		}
+		if(testee.TopUp(control) > 0) {
+			++numBatches;
+		}
+	}
+	CHECK(testee.IsComplete());
+	CHECK(script.size() == g_NumCommands);
+
+	// most of the polls are answered without sending any command
+	CHECK(numBatches < script.size() / 4);
+	Trace(ZONE_INFO, "%zu commands in %zu batches, %zu polls\n", g_NumCommands, numBatches, g_NumQueries);
+	TestCaseEnd();
+}
+
+int main (int argc, const char *argv[])
+{
+	UnitTestMainBegin();
+	RunTest(true, ut_ScriptStreamer_Loops);
+	RunTest(true, ut_ScriptStreamer_Batching);
+	RunTest(true, ut_ScriptStreamer_Seamless);
+	UnitTestMainEnd();
+}
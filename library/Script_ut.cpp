@@ -18,6 +18,9 @@
 
 #include "unittest.h"
 #include "Script.h"
+#include <chrono>
+#include <iostream>
+#include <sstream>
 
 
 /**************** includes, classes and functions for wrapping ****************/
@@ -105,15 +108,15 @@ size_t ut_Script_ReadGood(void)
 	Script newScript("TestInput.txt");
 	auto nextCmd = newScript.begin();
 
-	CHECK(refLoop == **newScript.begin());
-	CHECK(refLoop == **nextCmd++);
-	CHECK(refGradient == **nextCmd++);
-	CHECK(refFade == **nextCmd++);
-	CHECK(refFadeRed == **nextCmd++);
-	CHECK(refFadeGreen == **nextCmd++);
-	CHECK(refFadeBlue == **nextCmd++);
-	CHECK(refWait == **nextCmd++);
-	CHECK(refLoopOff == **nextCmd++);
+	CHECK(*newScript.begin() == refLoop);
+	CHECK(*nextCmd++ == refLoop);
+	CHECK(*nextCmd++ == refGradient);
+	CHECK(*nextCmd++ == refFade);
+	CHECK(*nextCmd++ == refFadeRed);
+	CHECK(*nextCmd++ == refFadeGreen);
+	CHECK(*nextCmd++ == refFadeBlue);
+	CHECK(*nextCmd++ == refWait);
+	CHECK(*nextCmd++ == refLoopOff);
 	CHECK(nextCmd == newScript.end());
 	TestCaseEnd();
 }
@@ -140,6 +143,113 @@ size_t ut_Script_WriteGoodWithVersion(void)
 	TestCaseEnd();
 }
 
+size_t ut_Script_ParseErrors(void)
+{
+	TestCaseBegin();
+	static const char *const badScripts[] = {
+		"loop\n  jump 5\nloop_off 0\n",
+		"wait\n",
+		"wait 70000\n",
+		"wait 12a\n",
+		"fade 0x1234 0xgg 100 1\n",
+		"gradient 0x112233 0x445566 100 1 300 0\n",
+		"loop_off 256\n",
+	};
+
+	for(const auto& text : badScripts) {
+		Script newScript;
+		try {
+			Script::deserialize(text, text + strlen(text), newScript);
+			CHECK(false);
+		} catch (FatalError& e) {}
+	}
+
+	// hex colors with and without prefix, any whitespace between tokens
+	static const char goodScript[] = "fade\t1234  0X112233\r\n100 1 wait 5000";
+	Script newScript;
+	Script::deserialize(goodScript, goodScript + sizeof(goodScript) - 1, newScript);
+	CHECK(2 == newScript.size());
+	CHECK(newScript[0] == refFade);
+	CHECK(newScript[1] == refWait);
+	TestCaseEnd();
+}
+
+size_t ut_Script_Segments(void)
+{
+	TestCaseBegin();
+	static const char text[] = "fade 0x1 0xff0000 10 1 2\ngradient 0x112233 0x445566 100 1 2 0 3 fade 0x1234 0x112233 100 1\nfade 0x80000000 0xff 20 0 255\nwait 5000";
+	Script newScript;
+	Script::deserialize(text, text + sizeof(text) - 1, newScript);
+	CHECK(5 == newScript.size());
+	CHECK(newScript[0] == FwCmdSetFade(0xff0000, 10, 0x1, true, 2));
+	CHECK(newScript[1] == FwCmdSetGradient(0x112233, 0x445566, 100, false, 2, 1, 3));
+	CHECK(newScript[2] == refFade);
+	CHECK(newScript[3] == FwCmdSetFade(0xff, 20, 0x80000000, false, SEGMENT_ALL));
+	CHECK(newScript[4] == refWait);
+	CHECK(2 == newScript[0].segment());
+	CHECK(3 == newScript[1].segment());
+	CHECK(SEGMENT_ALL == newScript[2].segment());
+
+	// the segment is written only if a fade doesn't apply to all segments
+	std::stringstream out;
+	size_t indentation = 0;
+	for(const auto& cmd : newScript) {
+		cmd.Write(out, indentation) << '\n';
+	}
+	CHECK(std::string::npos != out.str().find("fade 0x1234 0x112233 100 1\n"));
+	CHECK(std::string::npos != out.str().find("fade 0x80000000 0xff 20 0\n"));
+	const std::string written = out.str();
+	Script readBack;
+	Script::deserialize(written.data(), written.data() + written.size(), readBack);
+	CHECK(readBack == newScript);
+
+	static const char tooLarge[] = "fade 0x1 0xff0000 10 1 256\n";
+	try {
+		Script::deserialize(tooLarge, tooLarge + sizeof(tooLarge) - 1, readBack);
+		CHECK(false);
+	} catch (FatalError& e) {}
+	TestCaseEnd();
+}
+
+size_t ut_Script_Benchmark(void)
+{
+	TestCaseBegin();
+	static const size_t NUM_LOOPS = 10000;
+	std::stringstream text;
+	text << Script::currentVersion << "\nBenchmark\n";
+	size_t indentation = 0;
+	for(size_t i = 0; i < NUM_LOOPS; ++i) {
+		ScriptCommand(refLoop).Write(text, indentation) << '\n';
+		ScriptCommand(refGradient).Write(text, indentation) << '\n';
+		ScriptCommand(refFadeRed).Write(text, indentation) << '\n';
+		ScriptCommand(refWait).Write(text, indentation) << '\n';
+		ScriptCommand(refLoopOff).Write(text, indentation) << '\n';
+	}
+	const std::string buffer = text.str();
+
+	auto start = std::chrono::steady_clock::now();
+	Script newScript;
+	Script::deserialize(buffer.data(), buffer.data() + buffer.size(), newScript);
+	auto parsed = std::chrono::steady_clock::now();
+
+	uint64_t waitTime = 0;
+	for(const auto& cmd : newScript) {
+		if(WAIT == cmd.GetType()) {
+			waitTime += cmd.waitTime();
+		}
+	}
+	auto iterated = std::chrono::steady_clock::now();
+
+	CHECK(5 * NUM_LOOPS == newScript.size());
+	CHECK(NUM_LOOPS * 5000 == waitTime);
+	CHECK(0 == newScript.getName().compare("Benchmark"));
+	std::cout << "Script_ut benchmark: parsed " << newScript.size() << " commands (" << buffer.size() << " bytes) in "
+	          << std::chrono::duration_cast<std::chrono::microseconds>(parsed - start).count() << " us, iterated in "
+	          << std::chrono::duration_cast<std::chrono::microseconds>(iterated - parsed).count() << " us, "
+	          << sizeof(ScriptCommand) << " bytes per command\n";
+	TestCaseEnd();
+}
+
 int main (int argc, const char *argv[])
 {
 	UnitTestMainBegin();
@@ -153,6 +263,9 @@ int main (int argc, const char *argv[])
 #endif
 	RunTest(true, ut_Script_WriteGood);
 	RunTest(true, ut_Script_WriteGoodWithVersion);
+	RunTest(true, ut_Script_ParseErrors);
+	RunTest(true, ut_Script_Segments);
+	RunTest(true, ut_Script_Benchmark);
 	UnitTestMainEnd();
 }
 
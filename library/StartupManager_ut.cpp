@@ -43,7 +43,7 @@ namespace WyLight {
 	/***** Wrappers ****/
 	ClientSocket::ClientSocket(uint32_t addr, uint16_t port, int style) throw (FatalError) : mSock(0), mSockAddr(addr, port) {}
 	ClientSocket::~ClientSocket(void) {}
-	TcpSocket::TcpSocket(uint32_t addr, uint16_t port) throw (ConnectionLost, FatalError) : ClientSocket(addr, port, 0) {}
+	TcpSocket::TcpSocket(uint32_t addr, uint16_t port, uint32_t interfaceIndex, uint32_t connectTimeoutMs) throw (ConnectionLost, FatalError) : ClientSocket(addr, port, 0) {}
 	size_t TcpSocket::Recv(uint8_t *pBuffer, size_t length, timeval *timeout) const throw (FatalError) {
 		return 0;
 	}
@@ -52,14 +52,14 @@ namespace WyLight {
 	}
 	ComProxy::ComProxy(const TcpSocket& sock) : mSock (sock) {}
 	TelnetProxy::TelnetProxy(const TcpSocket& sock) : mSock (sock) {}
-	UdpSocket::UdpSocket(uint32_t addr, uint16_t port, bool doBind, int enableBroadcast) throw (FatalError) : ClientSocket(addr, port, SOCK_DGRAM) {}
+	UdpSocket::UdpSocket(uint32_t addr, uint16_t port, bool doBind, int enableBroadcast, uint32_t interfaceIndex) throw (FatalError) : ClientSocket(addr, port, SOCK_DGRAM) {}
 	size_t UdpSocket::Send(const uint8_t *frame, size_t length) const {
 		return length;
 	}
 
 
-	Control::Control(uint32_t addr, uint16_t port)
-		: mTcpSock(addr, port), mUdpSock(addr, port, false, 0), mProxy(mTcpSock), mTelnet(mTcpSock)
+	Control::Control(uint32_t addr, uint16_t port, uint32_t interfaceIndex, uint32_t connectTimeoutMs)
+		: mTcpSock(addr, port), mUdpSock(addr, port, false, 0), mProxy(mTcpSock), mTelnet(mTcpSock), mCredit(0)
 	{}
 
 	uint16_t Control::FwGetVersion() throw (WyLight::ConnectionTimeout, WyLight::FatalError, WyLight::ScriptBufferFull) {
@@ -0,0 +1,114 @@
+/*
+ Copyright (C) 2014 Nils Weiss, Patrick Bruenn.
+
+ This file is part of Wifly_Light.
+
+ Wifly_Light is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Wifly_Light is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Wifly_Light.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include "TraceEvent.h"
+
+#include <algorithm>
+#include <iomanip>
+
+namespace WyLight {
+
+	constexpr double TraceEventLog::TICKS_PER_US;
+
+	static const char *const TRACE_EVENT_NAMES[] = {
+		"INIT_DONE",
+		"RECEIVEBUFFER_FULL",
+		"COMMAND",
+		"SCRIPT_COMMAND",
+		"LEDSTRIP_FRAME",
+		"LEDSTRIP_FRAME_DONE",
+		"UART_TX_DONE"
+	};
+	static_assert(sizeof(TRACE_EVENT_NAMES) / sizeof(TRACE_EVENT_NAMES[0]) == TRACE_EVENT_ENUM_SIZE, "names don't match enum TRACE_EVENT");
+
+	const char *TraceEvent::Name(void) const
+	{
+		return (id < TRACE_EVENT_ENUM_SIZE) ? TRACE_EVENT_NAMES[id] : "UNKNOWN";
+	}
+
+	void TraceEventLog::Decode(const trace_events& events, size_t numEvents)
+	{
+		mNumLost += events.numLost;
+		for(size_t i = 0; i < numEvents; i++) {
+			const trace_event& event = events.event[i];
+			const uint32_t timestamp = ((uint32_t)ntohs(event.epoch) << 16) | ntohs(event.time);
+			mEvents.push_back(TraceEvent {
+				(uint8_t)(event.id & ~TRACE_EVENT_ISR),
+				event.arg,
+				0 != (event.id & TRACE_EVENT_ISR),
+				Unwrap(timestamp)
+			});
+		}
+		// the interrupt and the main cycle are recorded separately
+		std::stable_sort(mEvents.begin(), mEvents.end(), [](const TraceEvent& a, const TraceEvent& b) {
+			return a.timestamp < b.timestamp;
+		});
+	}
+
+	// the contexts aren't in order, but they are much closer than half of a wrap around (18 minutes)
+	uint64_t TraceEventLog::Unwrap(uint32_t timestamp)
+	{
+		static const uint64_t WRAP = 1ULL << 32;
+		uint64_t unwrapped = (mLastTimestamp & ~(WRAP - 1)) | timestamp;
+		if(unwrapped + WRAP / 2 < mLastTimestamp) {
+			unwrapped += WRAP;
+		} else if((unwrapped > mLastTimestamp + WRAP / 2) && (unwrapped >= WRAP)) {
+			unwrapped -= WRAP;
+		}
+		mLastTimestamp = std::max(mLastTimestamp, unwrapped);
+		return unwrapped;
+	}
+
+	void TraceEventLog::WriteChromeTrace(std::ostream& out) const
+	{
+		const std::ios::fmtflags flags = out.flags();
+		out << "{\"traceEvents\":[\n";
+		out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"main cycle\"}},\n";
+		out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"interrupt\"}}";
+		out << std::fixed << std::setprecision(1);
+		for(const auto& event : mEvents) {
+			out << ",\n{\"name\":\"" << event.Name() << "\",\"ph\":\"i\",\"s\":\"t\"";
+			out << ",\"ts\":" << event.timestamp / TICKS_PER_US;
+			out << ",\"pid\":1,\"tid\":" << (event.isr ? 1 : 0);
+			out << ",\"args\":{\"arg\":" << (int)event.arg << "}}";
+		}
+		out << "\n]}\n";
+		out.flags(flags);
+	}
+
+	std::ostream& operator<< (std::ostream& out, const TraceEventLog& ref)
+	{
+		const std::ios::fmtflags flags = out.flags();
+		out << "Trace events (" << ref.mNumLost << " lost):\n";
+		if(ref.mEvents.empty()) {
+			return out;
+		}
+
+		const uint64_t start = ref.mEvents.front().timestamp;
+		out << std::fixed << std::setprecision(1);
+		for(const auto& event : ref.mEvents) {
+			out << std::setw(12) << (event.timestamp - start) / TraceEventLog::TICKS_PER_US << " us  ";
+			out << (event.isr ? "isr " : "main") << "  ";
+			out << std::left << std::setw(20) << event.Name() << std::right;
+			out << " 0x" << std::hex << std::setw(2) << std::setfill('0') << (int)event.arg;
+			out << std::dec << std::setfill(' ') << '\n';
+		}
+		out.flags(flags);
+		return out;
+	}
+} /* namespace WyLight */
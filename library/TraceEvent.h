@@ -0,0 +1,93 @@
+/*
+ Copyright (C) 2014 Nils Weiss, Patrick Bruenn.
+
+ This file is part of Wifly_Light.
+
+ Wifly_Light is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Wifly_Light is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Wifly_Light.  If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef __WyLight__TraceEvent__
+#define __WyLight__TraceEvent__
+
+#include "wifly_cmd.h"
+#include <ostream>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace WyLight {
+
+	/******************************************************************************/
+	/*! \file TraceEvent.h
+	 * \brief Decoder for the binary trace events of the firmware
+	 *
+	 * The firmware records events of the interrupt and the main cycle in two
+	 * separate buffers and GET_TRACE_EVENTS empties both of them. TraceEventLog
+	 * collects the events of any number of these dumps, extends their 32 bit
+	 * timestamps and merges both contexts into one timeline. The timeline can be
+	 * printed as text or written in the trace event format of Chrome, which can
+	 * be viewed with chrome://tracing or Perfetto.
+	 *******************************************************************************/
+	struct TraceEvent
+	{
+		uint8_t id;         /* enum TRACE_EVENT */
+		uint8_t arg;
+		bool isr;           /* recorded by the interrupt */
+		uint64_t timestamp; /* ticks of timer3 */
+
+		const char *Name(void) const;
+	};
+
+	class TraceEventLog
+	{
+	public:
+		/* timer3 of the firmware runs with 2MHz */
+		static constexpr double TICKS_PER_US = 2.0;
+
+		/**
+		 * Adds the events of one GET_TRACE_EVENTS response
+		 * @param events the response in network byte order
+		 * @param numEvents number of valid entries in <events.event>
+		 */
+		void Decode(const trace_events& events, size_t numEvents);
+
+		/**
+		 * @return all events sorted by their timestamp
+		 */
+		const std::vector<TraceEvent>& Events(void) const { return mEvents; };
+
+		/**
+		 * @return number of events the firmware dropped, because a buffer was full
+		 */
+		size_t NumLost(void) const { return mNumLost; };
+
+		/**
+		 * Writes the timeline in the json trace event format of Chrome.
+		 * Each context is shown as a thread, each event as an instant.
+		 */
+		void WriteChromeTrace(std::ostream& out) const;
+
+		/**
+		 * Writes the timeline as text, one event per line
+		 */
+		friend std::ostream& operator<< (std::ostream& out, const TraceEventLog& ref);
+
+	private:
+		std::vector<TraceEvent> mEvents;
+		size_t mNumLost = 0;
+		uint64_t mLastTimestamp = 0;
+
+		uint64_t Unwrap(uint32_t timestamp);
+	};
+} /* namespace WyLight */
+#endif /* #ifndef __WyLight__TraceEvent__ */
@@ -0,0 +1,137 @@
+/*
+ Copyright (C) 2014 Nils Weiss, Patrick Bruenn.
+
+ This file is part of Wifly_Light.
+
+ Wifly_Light is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Wifly_Light is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Wifly_Light.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include "unittest.h"
+#include "TraceEvent.h"
+#include "FwResponse.h"
+#include <sstream>
+
+using namespace WyLight;
+
+static const uint32_t g_DebugZones = ZONE_ERROR | ZONE_WARNING;
+
+static void SetEvent(trace_event& event, uint8_t id, uint8_t arg, uint32_t timestamp)
+{
+	event.id = id;
+	event.arg = arg;
+	event.epoch = htons((uint16_t)(timestamp >> 16));
+	event.time = htons((uint16_t)timestamp);
+}
+
+/* the firmware reports the interrupt events first, the host merges both contexts */
+size_t ut_TraceEvent_Decode(void)
+{
+	TestCaseBegin();
+	response_frame frame;
+	frame.cmd = GET_TRACE_EVENTS;
+	frame.state = OK;
+	trace_events& events = frame.data.traceEvents;
+	events.numLost = 3;
+	SetEvent(events.event[0], eTRACE_UART_TX_DONE | TRACE_EVENT_ISR, 0, 0x00020003);
+	SetEvent(events.event[1], eTRACE_COMMAND, SET_COLOR_DIRECT, 0x0001fffe);
+	SetEvent(events.event[2], eTRACE_SCRIPT_COMMAND, WAIT, 0x00020004);
+
+	TraceEventsResponse response;
+	CHECK(!response.Init(frame, 4));
+	CHECK(!response.Init(frame, 4 + 1 + 3 * sizeof(trace_event) - 1));
+	CHECK(response.Init(frame, 4 + 1 + 3 * sizeof(trace_event)));
+	CHECK(3 == response.NumEvents());
+
+	TraceEventLog log;
+	log.Decode(response.GetEvents(), response.NumEvents());
+	CHECK(3 == log.NumLost());
+	CHECK(3 == log.Events().size());
+	CHECK(eTRACE_COMMAND == log.Events()[0].id);
+	CHECK(SET_COLOR_DIRECT == log.Events()[0].arg);
+	CHECK(!log.Events()[0].isr);
+	CHECK(0x0001fffe == log.Events()[0].timestamp);
+	CHECK(eTRACE_UART_TX_DONE == log.Events()[1].id);
+	CHECK(log.Events()[1].isr);
+	CHECK(std::string("UART_TX_DONE") == log.Events()[1].Name());
+	CHECK(eTRACE_SCRIPT_COMMAND == log.Events()[2].id);
+
+	// the next dump extends the timeline
+	SetEvent(events.event[0], eTRACE_LEDSTRIP_FRAME, 0, 0x00020000);
+	log.Decode(events, 1);
+	CHECK(6 == log.NumLost());
+	CHECK(4 == log.Events().size());
+	CHECK(eTRACE_LEDSTRIP_FRAME == log.Events()[1].id);
+	TestCaseEnd();
+}
+
+/* the 32 bit timestamps of the firmware are extended, even if the contexts are out of order */
+size_t ut_TraceEvent_WrapAround(void)
+{
+	TestCaseBegin();
+	trace_events events;
+	events.numLost = 0;
+	SetEvent(events.event[0], eTRACE_INIT_DONE, 0, 0xffffff00);
+
+	TraceEventLog log;
+	log.Decode(events, 1);
+	CHECK(0xffffff00 == log.Events()[0].timestamp);
+
+	SetEvent(events.event[0], eTRACE_LEDSTRIP_FRAME_DONE | TRACE_EVENT_ISR, 0, 0x00000010);
+	SetEvent(events.event[1], eTRACE_COMMAND, 0, 0xfffffff0);
+	SetEvent(events.event[2], eTRACE_COMMAND, 1, 0x00000020);
+	log.Decode(events, 3);
+	CHECK(4 == log.Events().size());
+	CHECK(0xffffff00 == log.Events()[0].timestamp);
+	CHECK(0xfffffff0 == log.Events()[1].timestamp);
+	CHECK(0x100000010ULL == log.Events()[2].timestamp);
+	CHECK(log.Events()[2].isr);
+	CHECK(0x100000020ULL == log.Events()[3].timestamp);
+	TestCaseEnd();
+}
+
+size_t ut_TraceEvent_WriteChromeTrace(void)
+{
+	TestCaseBegin();
+	trace_events events;
+	events.numLost = 0;
+	SetEvent(events.event[0], eTRACE_LEDSTRIP_FRAME_DONE | TRACE_EVENT_ISR, 0, 2000);
+	SetEvent(events.event[1], eTRACE_COMMAND, SET_FADE, 1000);
+	SetEvent(events.event[2], 0x7f, 0, 3000);
+
+	TraceEventLog log;
+	log.Decode(events, 3);
+	std::ostringstream json;
+	log.WriteChromeTrace(json);
+	const std::string out = json.str();
+	CHECK(0 == out.find("{\"traceEvents\":["));
+	CHECK(std::string::npos != out.find("{\"name\":\"COMMAND\",\"ph\":\"i\",\"s\":\"t\",\"ts\":500.0,\"pid\":1,\"tid\":0,\"args\":{\"arg\":" + std::to_string(SET_FADE) + "}}"));
+	CHECK(std::string::npos != out.find("{\"name\":\"LEDSTRIP_FRAME_DONE\",\"ph\":\"i\",\"s\":\"t\",\"ts\":1000.0,\"pid\":1,\"tid\":1,"));
+	CHECK(std::string::npos != out.find("\"name\":\"UNKNOWN\""));
+	CHECK(out.find("COMMAND") < out.find("LEDSTRIP_FRAME_DONE"));
+	CHECK(std::string::npos != out.find("\n]}\n"));
+
+	std::ostringstream text;
+	text << log;
+	CHECK(std::string::npos != text.str().find("0 lost"));
+	CHECK(std::string::npos != text.str().find("500.0 us  isr   LEDSTRIP_FRAME_DONE"));
+	TestCaseEnd();
+}
+
+int main (int argc, const char *argv[])
+{
+	UnitTestMainBegin();
+	RunTest(true, ut_TraceEvent_Decode);
+	RunTest(true, ut_TraceEvent_WrapAround);
+	RunTest(true, ut_TraceEvent_WriteChromeTrace);
+	UnitTestMainEnd();
+}
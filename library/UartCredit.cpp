@@ -0,0 +1,65 @@
+/*
+ Copyright (C) 2014 Nils Weiss, Patrick Bruenn.
+
+ This file is part of Wifly_Light.
+
+ Wifly_Light is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Wifly_Light is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Wifly_Light.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include "UartCredit.h"
+
+#include <algorithm>
+
+namespace WyLight {
+
+	const size_t UartCredit::QUERY_INTERVAL;
+
+	// without any credit the buffer has to take at least one request, like for any other command
+	UartCredit::UartCredit(size_t querySize, size_t queryInterval)
+		: mQuerySize(querySize), mQueryInterval(queryInterval), mSent(0), mLimit(querySize), mLastQuery(0)
+	{}
+
+	bool UartCredit::IsAvailable(size_t numBytes) const
+	{
+		return mSent + numBytes + mQuerySize <= mLimit;
+	}
+
+	bool UartCredit::IsQueryDue(void) const
+	{
+		return (mSent - mLastQuery >= mQueryInterval) && (mSent + mQuerySize <= mLimit);
+	}
+
+	void UartCredit::Sent(size_t numBytes)
+	{
+		mSent += numBytes;
+	}
+
+	void UartCredit::QuerySent(void)
+	{
+		mSent += mQuerySize;
+		mLastQuery = mSent;
+		mQueries.push_back(mSent);
+	}
+
+	void UartCredit::CreditReceived(uint8_t credit)
+	{
+		const uint64_t query = mQueries.front();
+		mQueries.pop_front();
+		mLimit = std::max(mLimit, query + credit);
+	}
+
+	void UartCredit::QueryLost(void)
+	{
+		mQueries.pop_front();
+	}
+} /* namespace WyLight */
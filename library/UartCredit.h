@@ -0,0 +1,106 @@
+/*
+ Copyright (C) 2014 Nils Weiss, Patrick Bruenn.
+
+ This file is part of Wifly_Light.
+
+ Wifly_Light is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Wifly_Light is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Wifly_Light.  If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef __WyLight__UartCredit__
+#define __WyLight__UartCredit__
+
+#include <deque>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace WyLight {
+
+	/******************************************************************************/
+	/*! \file UartCredit.h
+	 * \brief Host side accounting of the uart receive buffer of the firmware
+	 *
+	 * The firmware answers GET_UART_CREDIT with the number of free bytes in its
+	 * receive buffer. All bytes sent before the request were taken out of the
+	 * buffer already, all bytes sent after it may still be in there. So the host
+	 * may send <credit> bytes counted from the end of the request, before it
+	 * needs a new credit.
+	 *
+	 * Requests are sent in between the data each QUERY_INTERVAL bytes and
+	 * their responses are read only when the credit is used up, so the link is
+	 * never idle while the host waits for a response. The last <querySize>
+	 * bytes of each credit are reserved for a request, this way a new credit
+	 * can always be requested without overflowing the buffer.
+	 *
+	 * The credit is only correct if all bytes are sent over the same tcp
+	 * connection. Commands with a response are fine, because their response
+	 * proves the firmware took them out of the buffer. Udp frames can overtake
+	 * the tcp stream in the WLAN module and aren't accounted.
+	 *******************************************************************************/
+	class UartCredit
+	{
+	public:
+		static const size_t QUERY_INTERVAL = 64;
+
+		/**
+		 * @param querySize number of bytes of an encoded GET_UART_CREDIT request
+		 * @param queryInterval number of bytes to send before the next request
+		 */
+		UartCredit(size_t querySize, size_t queryInterval = QUERY_INTERVAL);
+
+		/**
+		 * @return true if a frame of <numBytes> can be sent now
+		 */
+		bool IsAvailable(size_t numBytes) const;
+
+		/**
+		 * @return true if a request should follow the last frame to keep the credit flowing
+		 */
+		bool IsQueryDue(void) const;
+
+		/**
+		 * @return number of requests, which responses weren't read yet
+		 */
+		size_t NumQueriesPending(void) const { return mQueries.size(); };
+
+		/**
+		 * Call this after <numBytes> were sent
+		 */
+		void Sent(size_t numBytes);
+
+		/**
+		 * Call this after a GET_UART_CREDIT request was sent
+		 */
+		void QuerySent(void);
+
+		/**
+		 * Call this with the response to the oldest pending request
+		 */
+		void CreditReceived(uint8_t credit);
+
+		/**
+		 * Call this if the response to the oldest pending request was corrupted
+		 */
+		void QueryLost(void);
+
+	private:
+		const size_t mQuerySize;
+		const size_t mQueryInterval;
+
+		/* all positions are counted in bytes sent since construction */
+		uint64_t mSent;
+		uint64_t mLimit;
+		uint64_t mLastQuery;
+		std::deque<uint64_t> mQueries;
+	};
+} /* namespace WyLight */
+#endif /* #ifndef __WyLight__UartCredit__ */
@@ -0,0 +1,271 @@
+/*
+ Copyright (C) 2014 Nils Weiss, Patrick Bruenn.
+
+ This file is part of Wifly_Light.
+
+ Wifly_Light is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Wifly_Light is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Wifly_Light.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include "unittest.h"
+#include "UartCredit.h"
+#include "EncodedCommand.h"
+#include "FwResponse.h"
+#include "MaskBuffer.h"
+#include "CommandIO.h"
+#include "RingBuf.h"
+#include "ScriptCtrl.h"
+#include "rtc.h"
+#include "timer.h"
+#include "trace.h"
+#include "usart.h"
+#include "Version.h"
+#include <deque>
+
+using namespace WyLight;
+
+static const uint32_t g_DebugZones = ZONE_ERROR | ZONE_WARNING;
+
+const std::string FwCmdSetFade::TOKEN("fade");
+const std::string FwCmdSetGradient::TOKEN("gradient");
+const std::string FwCmdLoopOn::TOKEN("loop");
+const std::string FwCmdLoopOff::TOKEN("loop_off");
+const std::string FwCmdWait::TOKEN("wait");
+
+const size_t FwCmdScript::INDENTATION_MAX;
+const char FwCmdScript::INDENTATION_CHARACTER;
+
+/**
+ * The simulation advances in ticks, one tick is the time to transfer one
+ * byte over the uart with 115200 baud (10 bits per byte).
+ */
+static const size_t TICKS_PER_MS = 12;
+static const size_t NETWORK_LATENCY = 3 * TICKS_PER_MS;
+static const size_t SIMULATION_TICKS = 5000 * TICKS_PER_MS;
+
+struct WireByte {
+	size_t tick; /* the byte can't be transferred before this tick */
+	uint8_t value;
+};
+
+static size_t g_Now;
+static size_t g_TxFree;
+static std::deque<WireByte> g_ToHost;
+static size_t g_NumColorFrames;
+
+/***** Firmware wrappers ****/
+uns8 ScriptCtrl_Add(struct led_cmd *pCmd)
+{
+	if(SET_COLOR_DIRECT == pCmd->cmd) {
+		++g_NumColorFrames;
+		return NO_RESPONSE;
+	}
+	return OK;
+}
+void ScriptCtrl_GetState(struct script_state *pState) {}
+void Rtc_Ctl(enum RTC_request req, struct rtc_time *pRtcTime) {}
+uns8 Timer_PrintCycletime(struct cycletime_stats *pArray, const uns16 arraySize) { return 0; }
+uns8 Trace_Print(uns8 *pArray, const uns16 arraySize) { return 0; }
+uns8 Trace_PrintEvents(struct trace_events *pEvents, const uns16 arraySize) { return 0; }
+uns16 Version_Print(void) { return 0; }
+uns8 SPI_Send(const uns8 data) { return data; }
+
+/* the response is transmitted byte by byte and travels through the network afterwards */
+void UART_Send(const uns8 ch)
+{
+	g_TxFree = std::max(g_Now, g_TxFree) + 1;
+	g_ToHost.push_back(WireByte {g_TxFree + NETWORK_LATENCY, ch});
+}
+
+/**
+ * The main cycle of the firmware is blocked for <stallTicks> every
+ * <stallInterval> ticks, like by an eeprom write. Apart from that, each
+ * cycle takes a ledstrip update of 2ms.
+ */
+struct Simulation {
+	bool useCredit;
+	size_t stallInterval;
+	size_t stallTicks;
+
+	size_t numSent;
+	size_t numBytesTransferred;
+	size_t numOverflows;
+	size_t numBadResponses;
+};
+
+static void Simulate(Simulation& sim)
+{
+	const EncodedCommand color(FwCmdSetColorDirect(0xff0000ff, 0xffffffff));
+	const EncodedCommand query {FwCmdGetUartCredit {}};
+	UartCredit credit(query.Size());
+	std::deque<WireByte> toFirmware;
+	UnmaskBuffer response {sizeof(response_frame)};
+
+	RingBuf_Init(&g_RingBuf);
+	CommandIO_Init();
+	g_ToHost.clear();
+	g_TxFree = 0;
+	g_NumColorFrames = 0;
+	sim.numSent = sim.numBytesTransferred = sim.numOverflows = sim.numBadResponses = 0;
+
+	size_t busyUntil = 0;
+	for(g_Now = 0; g_Now < SIMULATION_TICKS; ++g_Now) {
+		// host
+		while(!g_ToHost.empty() && (g_ToHost.front().tick <= g_Now)) {
+			if(response.Unmask(&g_ToHost.front().value, 1, true, false)) {
+				response_frame frame;
+				memcpy(&frame, response.Data(), response.Size());
+				UartCreditResponse creditResponse;
+				if(creditResponse.Init(frame, response.Size())) {
+					credit.CreditReceived(creditResponse.getCredit());
+				} else {
+					++sim.numBadResponses;
+					if(credit.NumQueriesPending()) {
+						credit.QueryLost();
+					}
+				}
+			}
+			g_ToHost.pop_front();
+		}
+
+		std::vector<const EncodedCommand *> frames;
+		if(sim.useCredit) {
+			if(credit.IsAvailable(color.Size())) {
+				frames.push_back(&color);
+				credit.Sent(color.Size());
+				if(credit.IsQueryDue()) {
+					frames.push_back(&query);
+					credit.QuerySent();
+				}
+			} else if(0 == credit.NumQueriesPending()) {
+				frames.push_back(&query);
+				credit.QuerySent();
+			}
+		} else if(toFirmware.size() < color.Size()) {
+			// without flow control the host keeps the link busy
+			frames.push_back(&color);
+		}
+		for(const auto& frame : frames) {
+			sim.numSent += (frame == &color) ? 1 : 0;
+			for(size_t i = 0; i < frame->Size(); ++i) {
+				toFirmware.push_back(WireByte {g_Now + NETWORK_LATENCY, frame->Data()[i]});
+			}
+		}
+
+		// uart receive interrupt of the firmware
+		if(!toFirmware.empty() && (toFirmware.front().tick <= g_Now)) {
+			RingBuf_Put(&g_RingBuf, toFirmware.front().value);
+			if(RingBuf_HasError(&g_RingBuf)) {
+				++sim.numOverflows;
+			}
+			toFirmware.pop_front();
+			++sim.numBytesTransferred;
+		}
+
+		// main cycle of the firmware
+		if(busyUntil <= g_Now) {
+			CommandIO_GetCommands();
+			busyUntil = g_Now + 2 * TICKS_PER_MS;
+			if(sim.stallInterval && (g_Now % sim.stallInterval < 2 * TICKS_PER_MS)) {
+				busyUntil += sim.stallTicks;
+			}
+		}
+	}
+	Trace(ZONE_WARNING, "%zu frames sent, %zu received, %zu of %zu ticks busy, %zu overflows\n",
+	      sim.numSent, (size_t)g_NumColorFrames, sim.numBytesTransferred, SIMULATION_TICKS, sim.numOverflows);
+}
+
+size_t ut_UartCredit_Accounting(void)
+{
+	TestCaseBegin();
+	UartCredit credit(6, 64);
+
+	// without credit only a request fits into the buffer
+	CHECK(!credit.IsAvailable(1));
+	CHECK(credit.IsQueryDue() == false);
+	credit.QuerySent();
+	CHECK(1 == credit.NumQueriesPending());
+
+	// the credit counts from the end of the request, the last 6 bytes are reserved for the next one
+	credit.Sent(10);
+	credit.CreditReceived(100);
+	CHECK(0 == credit.NumQueriesPending());
+	CHECK(credit.IsAvailable(100 - 10 - 6));
+	CHECK(!credit.IsAvailable(100 - 10 - 6 + 1));
+
+	// a request follows each 64 bytes, if it fits
+	credit.Sent(53);
+	CHECK(!credit.IsQueryDue());
+	credit.Sent(1);
+	CHECK(credit.IsQueryDue());
+	credit.QuerySent();
+	CHECK(!credit.IsQueryDue());
+
+	// an old credit never reduces the limit, a lost response doesn't change it
+	credit.QuerySent();
+	credit.CreditReceived(0);
+	CHECK(credit.IsAvailable(100 - 64 - 6 - 6 - 6));
+	credit.QueryLost();
+	CHECK(0 == credit.NumQueriesPending());
+	CHECK(credit.IsAvailable(100 - 64 - 6 - 6 - 6));
+	CHECK(!credit.IsAvailable(100 - 64 - 6 - 6 - 6 + 1));
+	TestCaseEnd();
+}
+
+/* eeprom writes block the main cycle longer than the buffer lasts, without credit it overflows */
+size_t ut_UartCredit_StressWithoutCredit(void)
+{
+	TestCaseBegin();
+	Simulation sim = {false, 100 * TICKS_PER_MS, 40 * TICKS_PER_MS};
+	Simulate(sim);
+	CHECK(0 < sim.numOverflows);
+	CHECK(g_NumColorFrames < sim.numSent);
+	TestCaseEnd();
+}
+
+size_t ut_UartCredit_Stress(void)
+{
+	TestCaseBegin();
+	Simulation sim = {true, 100 * TICKS_PER_MS, 40 * TICKS_PER_MS};
+	Simulate(sim);
+	CHECK(0 == sim.numOverflows);
+	CHECK(0 == sim.numBadResponses);
+	CHECK(0 < g_NumColorFrames);
+	CHECK(sim.numSent - g_NumColorFrames <= RingBufferSize / sizeof(cmd_set_color_direct) + 1);
+	TestCaseEnd();
+}
+
+/* as long as the firmware keeps up, the link is always busy */
+size_t ut_UartCredit_Utilisation(void)
+{
+	TestCaseBegin();
+	Simulation sim = {true, 0, 0};
+	Simulate(sim);
+	CHECK(0 == sim.numOverflows);
+	CHECK(0 == sim.numBadResponses);
+	CHECK(sim.numBytesTransferred > SIMULATION_TICKS * 95 / 100);
+
+	// most of the bandwidth is used for the color frames
+	const EncodedCommand color(FwCmdSetColorDirect(0xff0000ff, 0xffffffff));
+	CHECK(g_NumColorFrames * color.Size() > SIMULATION_TICKS * 85 / 100);
+	TestCaseEnd();
+}
+
+int main (int argc, const char *argv[])
+{
+	UnitTestMainBegin();
+	RunTest(true, ut_UartCredit_Accounting);
+	RunTest(true, ut_UartCredit_StressWithoutCredit);
+	RunTest(true, ut_UartCredit_Stress);
+	RunTest(true, ut_UartCredit_Utilisation);
+	UnitTestMainEnd();
+}
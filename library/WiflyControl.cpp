@@ -134,7 +134,23 @@ namespace WyLight {
 	const std::string FwCmdLoopOff::TOKEN("loop_off");
 	const std::string FwCmdWait::TOKEN("wait");
 
-	Control::Control(uint32_t addr, uint16_t port) : mTcpSock(addr, port), mUdpSock(addr, port, false, 0), mProxy(mTcpSock), mTelnet(mTcpSock) {}
+	static const EncodedCommand& CreditQuery(void)
+	{
+		static const EncodedCommand query {FwCmdGetUartCredit {}};
+		return query;
+	}
+
+	Control::Control(uint32_t addr, uint16_t port, uint32_t interfaceIndex, uint32_t connectTimeoutMs) : mTcpSock(addr, port, interfaceIndex, connectTimeoutMs), mUdpSock(addr, port, false, 0, interfaceIndex), mProxy(mTcpSock), mTelnet(mTcpSock), mCredit(CreditQuery().Size()) {}
+
+	TcpSocket::State Control::GetConnectionState(void) const
+	{
+		return mTcpSock.GetState();
+	}
+
+	void Control::WaitConnected(void) const throw (ConnectionLost)
+	{
+		mTcpSock.WaitConnected();
+	}
 
 	size_t Control::GetTargetMode(void) const throw(FatalError)
 	{
@@ -759,6 +775,13 @@ namespace WyLight {
 		return cmd.mResponse.ToString();
 	}
 
+	void Control::FwGetTraceEvents(TraceEventLog& log) throw (ConnectionTimeout, FatalError, ScriptBufferFull)
+	{
+		FwCmdGetTraceEvents cmd;
+		*this << cmd;
+		log.Decode(cmd.mResponse.GetEvents(), cmd.mResponse.NumEvents());
+	}
+
 	uint16_t Control::FwGetVersion(void) throw (ConnectionTimeout, FatalError, ScriptBufferFull)
 	{
 		FwCmdGetVersion cmd;
@@ -773,10 +796,25 @@ namespace WyLight {
 		return cmd.mResponse.getLedTyp();
 	}
 
+	script_state Control::FwGetScriptState(void) throw (ConnectionTimeout, FatalError, ScriptBufferFull)
+	{
+		FwCmdGetScriptState cmd;
+		*this << cmd;
+		return cmd.mResponse.getState();
+	}
+
+	device_stats Control::FwGetStats(void) throw (ConnectionTimeout, FatalError, ScriptBufferFull)
+	{
+		FwCmdGetStats cmd;
+		*this << cmd;
+		return cmd.mResponse.getStats();
+	}
+
 
 	void Control::FwSend(FwCommand& cmd) const throw (ConnectionTimeout, FatalError, ScriptBufferFull)
 	{
 		if(cmd.IsResponseRequired()) {
+			FwFlushCredit();
 
 			response_frame buffer;
 			size_t numCrcRetries = 8;
@@ -800,6 +838,56 @@ namespace WyLight {
 		}
 	}
 
+	void Control::FwSend(const EncodedCommand *pCommands, size_t numCommands) const throw (ConnectionTimeout, FatalError, ScriptBufferFull)
+	{
+		if(0 == numCommands) {
+			return;
+		}
+		FwFlushCredit();
+
+		std::vector<response_frame> responses(numCommands);
+		std::vector<size_t> bytesRead(numCommands);
+		mProxy.Send(pCommands, numCommands, responses.data(), bytesRead.data());
+
+		for(size_t i = 0; i < numCommands; ++i) {
+			FwResponse response(pCommands[i].GetType());
+			size_t numCrcRetries = 8;
+			while(!response.Init(responses[i], bytesRead[i])) {
+				if(0 == --numCrcRetries) {
+					throw FatalError(std::string(__FILE__) + ':' + __FUNCTION__ + ": Too many retries");
+				}
+				mProxy.Send(pCommands + i, 1, &responses[i], &bytesRead[i]);
+			}
+		}
+	}
+
+	void Control::FwQueryCredit(void) const throw (FatalError)
+	{
+		mProxy.Write(&CreditQuery(), 1);
+		mCredit.QuerySent();
+	}
+
+	void Control::FwRecvCredit(void) const throw (ConnectionTimeout, FatalError, ScriptBufferFull)
+	{
+		response_frame buffer;
+		const size_t bytesRead = mProxy.RecvResponse(&buffer);
+
+		UartCreditResponse response;
+		if(response.Init(buffer, bytesRead)) {
+			mCredit.CreditReceived(response.getCredit());
+		} else {
+			Trace(ZONE_WARNING, "corrupted uart credit response\n");
+			mCredit.QueryLost();
+		}
+	}
+
+	void Control::FwFlushCredit(void) const throw (ConnectionTimeout, FatalError, ScriptBufferFull)
+	{
+		while(0 < mCredit.NumQueriesPending()) {
+			FwRecvCredit();
+		}
+	}
+
 	void Control::FwStressTest(void)
 	{
 		*this << FwCmdClearScript {};
@@ -851,8 +939,81 @@ namespace WyLight {
 
 	Control& Control::operator<<(const Script& script) throw (ConnectionTimeout, FatalError, ScriptBufferFull)
 	{
-		for(auto it = script.begin(); it != script.end(); ++it) {
-			*this << **it;
+		for(const auto& cmd : script) {
+			*this << FwCmdScriptCommand(cmd);
+		}
+		return *this;
+	}
+
+	Control& Control::operator<<(const CompiledScript& script) throw (ConnectionTimeout, FatalError, ScriptBufferFull)
+	{
+		for(const auto& cmd : script) {
+			*this << FwCmdScriptCommand(cmd);
+		}
+		return *this;
+	}
+
+	Control& Control::operator<<(const EncodedCommand& cmd) throw (ConnectionTimeout, FatalError, ScriptBufferFull)
+	{
+		if(cmd.IsResponseRequired()) {
+			FwSend(&cmd, 1);
+		} else if(cmd.Size() != mUdpSock.Send(cmd.Data(), cmd.Size())) {
+			throw FatalError("mUdpSock.Send() failed");
+		}
+		return *this;
+	}
+
+	Control& Control::operator<<(const EncodedSequence& sequence) throw (ConnectionTimeout, FatalError, ScriptBufferFull)
+	{
+		size_t first = 0;
+		size_t numBytes = 0;
+		for(size_t i = 0; i < sequence.size(); ++i) {
+			const EncodedCommand& cmd = sequence[i];
+			// pipelined frames must not overflow the uart buffer of the firmware
+			if(!cmd.IsResponseRequired() || (numBytes + cmd.Size() > RingBufferSize)) {
+				FwSend(sequence.data() + first, i - first);
+				first = i;
+				numBytes = 0;
+			}
+
+			if(cmd.IsResponseRequired()) {
+				numBytes += cmd.Size();
+			} else {
+				*this << cmd;
+				first = i + 1;
+			}
+		}
+		FwSend(sequence.data() + first, sequence.size() - first);
+		return *this;
+	}
+
+	Control& Control::FwStream(const EncodedCommand& cmd) throw (ConnectionTimeout, FatalError, ScriptBufferFull)
+	{
+		if(cmd.IsResponseRequired()) {
+			FwSend(&cmd, 1);
+			return *this;
+		}
+
+		// a request is sent before the credit is used up, usually its response arrived already
+		while(!mCredit.IsAvailable(cmd.Size())) {
+			if(0 == mCredit.NumQueriesPending()) {
+				FwQueryCredit();
+			}
+			FwRecvCredit();
+		}
+
+		mProxy.Write(&cmd, 1);
+		mCredit.Sent(cmd.Size());
+		if(mCredit.IsQueryDue()) {
+			FwQueryCredit();
+		}
+		return *this;
+	}
+
+	Control& Control::FwStream(const EncodedSequence& sequence) throw (ConnectionTimeout, FatalError, ScriptBufferFull)
+	{
+		for(const auto& cmd : sequence) {
+			FwStream(cmd);
 		}
 		return *this;
 	}
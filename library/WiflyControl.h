@@ -20,6 +20,7 @@
 #ifndef _WIFLYCONTROL_H_
 #define _WIFLYCONTROL_H_
 
+#include <list>
 #include <string>
 #include "ComProxy.h"
 #include "wifly_cmd.h"
@@ -27,7 +28,10 @@
 #include "TelnetProxy.h"
 #include "WiflyControlException.h"
 #include "FwCommand.h"
+#include "CompiledScript.h"
 #include "Script.h"
+#include "UartCredit.h"
+#include "TraceEvent.h"
 
 
 namespace WyLight {
@@ -64,11 +68,26 @@ namespace WyLight {
 		static const std::list<std::string> RN171_SOFT_AP_DEFAULT_PARAMETERS;
 		static const std::list<std::string> RN171_FACTORY_RESET_PARAMETER;
 		/**
-		 * Connect to a wifly device
+		 * Start connecting to a wifly device. The constructor returns immediately,
+		 * the connection is completed in the background and waited for on first use.
 		 * @param addr ipv4 address as 32 bit value in host byte order
 		 * @param port number of the wifly device server in host byte order
+		 * @param interfaceIndex network interface the device was discovered on @see Endpoint#GetInterface, 0 to let the routing table decide
+		 * @param connectTimeoutMs time in milliseconds the connection may take to establish
 		 */
-		Control(uint32_t addr, uint16_t port);
+		Control(uint32_t addr, uint16_t port, uint32_t interfaceIndex = 0, uint32_t connectTimeoutMs = TcpSocket::DEFAULT_CONNECT_TIMEOUT_MS);
+
+		/**
+		 * Check the progress of the connection without blocking
+		 * @return TcpSocket::CONNECTING, TcpSocket::CONNECTED or TcpSocket::FAILED
+		 */
+		TcpSocket::State GetConnectionState(void) const;
+
+		/**
+		 * Block until the connection is established
+		 * @throw ConnectionLost if the connection failed or timed out
+		 */
+		void WaitConnected(void) const throw (ConnectionLost);
 
 		/*
 		 * Send a byte sequence to ident the current software running on PIC
@@ -275,6 +294,15 @@ namespace WyLight {
 		 */
 		std::string FwGetTracebuffer(void) throw (ConnectionTimeout, FatalError, ScriptBufferFull);
 
+		/**
+		 * Reads the binary trace events from wifly device, the buffers of the firmware are empty afterwards
+		 * @param log the events are added to this timeline
+		 * @throw ConnectionTimeout if response timed out
+		 * @throw FatalError if command code of the response doesn't match the code of the request, or too many retries failed
+		 * @throw ScriptBufferFull if script buffer in PIC firmware is full and request couldn't be executed
+		 */
+		void FwGetTraceEvents(TraceEventLog& log) throw (ConnectionTimeout, FatalError, ScriptBufferFull);
+
 		/**
 		 * Reads the firmware version currently running on the wifly device.
 		 * @return a string representing the version number of the PIC firmware
@@ -293,6 +321,26 @@ namespace WyLight {
 		 */
 		uint8_t FwGetLedTyp(void) throw (ConnectionTimeout, FatalError, ScriptBufferFull);
 
+		/**
+		 * Reads the state of the script ring in the PIC firmware. Use it to keep the
+		 * ring filled while the firmware consumes commands, see ScriptStreamer.
+		 * @return number of free script slots and the positions of the ring pointers
+		 * @throw ConnectionTimeout if response timed out
+		 * @throw FatalError if command code of the response doesn't match the code of the request, or too many retries failed
+		 * @throw ScriptBufferFull if script buffer in PIC firmware is full and request couldn't be executed
+		 */
+		script_state FwGetScriptState(void) throw (ConnectionTimeout, FatalError, ScriptBufferFull);
+
+		/**
+		 * Reads the statistic counters of the PIC firmware. They count since the
+		 * firmware started and aren't reset by this request.
+		 * @return bytes received, commands processed, rejected frames and receive buffer usage
+		 * @throw ConnectionTimeout if response timed out
+		 * @throw FatalError if command code of the response doesn't match the code of the request, or too many retries failed
+		 * @throw ScriptBufferFull if script buffer in PIC firmware is full and request couldn't be executed
+		 */
+		device_stats FwGetStats(void) throw (ConnectionTimeout, FatalError, ScriptBufferFull);
+
 
 		//TODO move this test functions to the integration test
 		void FwTest(void);
@@ -302,6 +350,37 @@ namespace WyLight {
 		Control& operator<<(FwCommand& cmd) throw (ConnectionTimeout, FatalError, ScriptBufferFull);
 		Control& operator<<(const Script& script) throw (ConnectionTimeout, FatalError, ScriptBufferFull);
 
+		/**
+		 * Upload the records of a memory mapped script as they are
+		 */
+		Control& operator<<(const CompiledScript& script) throw (ConnectionTimeout, FatalError, ScriptBufferFull);
+
+		/**
+		 * Send a command, which was encoded once to be sent to several devices
+		 */
+		Control& operator<<(const EncodedCommand& cmd) throw (ConnectionTimeout, FatalError, ScriptBufferFull);
+
+		/**
+		 * Send encoded commands pipelined: as many frames as fit into the uart
+		 * buffer of the firmware are written at once, before their responses are read.
+		 * @throw ScriptBufferFull if the firmware rejected a command, the following
+		 *        commands of the same burst were sent to the firmware anyway
+		 */
+		Control& operator<<(const EncodedSequence& sequence) throw (ConnectionTimeout, FatalError, ScriptBufferFull);
+
+		/**
+		 * Stream commands over tcp, limited by the credit the firmware advertises
+		 * for its uart receive buffer @see UartCredit. Use this instead of udp for
+		 * continuous streams like SET_COLOR_DIRECT, so no frame is lost while the
+		 * firmware is busy with a fade or an eeprom write.
+		 * Commands, which require a response, are sent like with operator<<
+		 * @throw ConnectionTimeout if a credit response timed out
+		 * @throw FatalError if sending to socket failed
+		 * @throw ScriptBufferFull if the firmware rejected a command
+		 */
+		Control& FwStream(const EncodedCommand& cmd) throw (ConnectionTimeout, FatalError, ScriptBufferFull);
+		Control& FwStream(const EncodedSequence& sequence) throw (ConnectionTimeout, FatalError, ScriptBufferFull);
+
 /* ------------------------- VERSION EXTRACT METHODE ------------------------- */
 		/**
 		 * Methode to extract the firmware version from a hex file
@@ -333,6 +412,11 @@ namespace WyLight {
 		 */
 		const TelnetProxy mTelnet;
 
+		/**
+		 * Free space in the uart receive buffer of the firmware for FwStream()
+		 */
+		mutable UartCredit mCredit;
+
 		/**
 		 * Instructs the bootloader to erase the specified area of the flash.
 		 * The wifly device has to be in bootloader mode for this command.
@@ -386,6 +470,37 @@ namespace WyLight {
 		 */
 		void FwSend(FwCommand& cmd) const throw (ConnectionTimeout, FatalError, ScriptBufferFull);
 
+		/**
+		 * Sends encoded wifly command frames, which require a response, with a single write
+		 * @param pCommands array of encoded commands
+		 * @param numCommands number of commands in pCommands, all of them have to fit into the uart buffer of the firmware
+		 * @throw ConnectionTimeout if response timed out
+		 * @throw FatalError if command code of the response doesn't match the code of the request, or too many retries failed
+		 * @throw ScriptBufferFull if script buffer in PIC firmware is full and a request couldn't be executed
+		 */
+		void FwSend(const EncodedCommand *pCommands, size_t numCommands) const throw (ConnectionTimeout, FatalError, ScriptBufferFull);
+
+		/**
+		 * Sends a GET_UART_CREDIT request without waiting for its response
+		 * @throw FatalError if sending to socket failed
+		 */
+		void FwQueryCredit(void) const throw (FatalError);
+
+		/**
+		 * Reads the response to the oldest pending GET_UART_CREDIT request
+		 * @throw ConnectionTimeout if response timed out
+		 * @throw FatalError if command code of the response doesn't match the code of the request
+		 */
+		void FwRecvCredit(void) const throw (ConnectionTimeout, FatalError, ScriptBufferFull);
+
+		/**
+		 * Reads the responses to all pending GET_UART_CREDIT requests, so the next
+		 * response on the connection belongs to the next request
+		 * @throw ConnectionTimeout if response timed out
+		 * @throw FatalError if command code of the response doesn't match the code of the request
+		 */
+		void FwFlushCredit(void) const throw (ConnectionTimeout, FatalError, ScriptBufferFull);
+
 		/**
 		 * Instructs the bootloader to create crc-16 checksums for the content of
 		 * the specified flash area. TODO crc values are in little endian byte order
@@ -22,8 +22,8 @@ namespace WyLight {
 
 	static const int g_DebugZones = ZONE_ERROR | ZONE_WARNING | ZONE_INFO | ZONE_VERBOSE;
 
-	ControlNoThrow::ControlNoThrow(uint32_t addr, uint16_t port)
-		: mControl(addr, port) {}
+	ControlNoThrow::ControlNoThrow(uint32_t addr, uint16_t port, uint32_t interfaceIndex, uint32_t connectTimeoutMs)
+		: mControl(addr, port, interfaceIndex, connectTimeoutMs) {}
 
 	uint32_t ControlNoThrow::BlEnableAutostart(void) const
 	{
@@ -132,6 +132,11 @@ namespace WyLight {
 		return Try(std::bind(&Control::FwGetTracebuffer, std::ref(mControl)), output);
 	}
 
+	uint32_t ControlNoThrow::FwGetTraceEvents(TraceEventLog& log)
+	{
+		return Try(std::bind(&Control::FwGetTraceEvents, std::ref(mControl), std::ref(log)));
+	}
+
 	uint32_t ControlNoThrow::FwGetVersion(uint16_t& output)
 	{
 		return Try(std::bind(&Control::FwGetVersion, std::ref(mControl)), output);
@@ -142,6 +147,16 @@ namespace WyLight {
 		return Try(std::bind(&Control::FwGetLedTyp, std::ref(mControl)), output);
 	}
 
+	uint32_t ControlNoThrow::FwGetScriptState(script_state& output)
+	{
+		return Try(std::bind(&Control::FwGetScriptState, std::ref(mControl)), output);
+	}
+
+	uint32_t ControlNoThrow::FwGetStats(device_stats& output)
+	{
+		return Try(std::bind(&Control::FwGetStats, std::ref(mControl)), output);
+	}
+
 	uint32_t ControlNoThrow::FwLoopOff(const uint8_t numLoops)
 	{
 		return Try(FwCmdLoopOff {numLoops}
@@ -156,8 +171,20 @@ namespace WyLight {
 
 	uint32_t ControlNoThrow::FwSetColorDirect(const std::vector<uint8_t> buffer)
 	{
-		return Try(FwCmdSetColorDirect {buffer.data(), buffer.size()}
-			   );
+		// a frame carries the colors of one segment, longer strips are send segment by segment
+		const size_t segmentLength = NUM_OF_LED_PER_SEGMENT * 3;
+		size_t first = 0;
+		uint8_t segment = 0;
+		do {
+			const uint32_t result = Try(FwCmdSetColorDirect {buffer.data() + first, std::min(segmentLength, buffer.size() - first), segment}
+						    );
+			if(NO_ERROR != result) {
+				return result;
+			}
+			first += segmentLength;
+			++segment;
+		} while(first < buffer.size());
+		return NO_ERROR;
 	}
 
 	uint32_t ControlNoThrow::FwSetFade(const uint32_t argb, const uint16_t fadeTime, const uint32_t addr, const bool parallelFade)
@@ -203,55 +230,20 @@ namespace WyLight {
 			return NO_ERROR;
 		} catch(FatalError& e) {
 			return e.AsErrorCode();
-		} catch(std::exception) {
-			std::cout << "CATCH std::exception";
-			std::cerr << "CATCH std::exception";
-			//std::terminate();
-			return FATAL_ERROR;
-		}
-	}
-
-	uint32_t ControlNoThrow::Try(const std::function<std::string(void)> call, std::string& returnString) const
-	{
-		try {
-			returnString = call();
-			return NO_ERROR;
-		} catch(FatalError& e) {
-			return e.AsErrorCode();
-		} catch(std::exception) {
-			std::cout << "CATCH std::exception";
-			std::cerr << "CATCH std::exception";
-			//std::terminate();
+		} catch(const std::exception&) {
 			return FATAL_ERROR;
 		}
 	}
 
-	uint32_t ControlNoThrow::Try(const std::function<uint16_t(void)> call, uint16_t& returnValue) const
-	{
-		try {
-			returnValue = call();
-			return NO_ERROR;
-		} catch(FatalError& e) {
-			return e.AsErrorCode();
-		} catch(std::exception) {
-			std::cout << "CATCH std::exception";
-			std::cerr << "CATCH std::exception";
-			//std::terminate();
-			return FATAL_ERROR;
-		}
-	}
-	
-	uint32_t ControlNoThrow::Try(const std::function<uint8_t(void)> call, uint8_t& returnValue) const
+	template<typename Call, typename T>
+	uint32_t ControlNoThrow::Try(const Call& call, T& returnValue) const
 	{
 		try {
 			returnValue = call();
 			return NO_ERROR;
 		} catch(FatalError& e) {
 			return e.AsErrorCode();
-		} catch(std::exception) {
-			std::cout << "CATCH std::exception";
-			std::cerr << "CATCH std::exception";
-			//std::terminate();
+		} catch(const std::exception&) {
 			return FATAL_ERROR;
 		}
 	}
@@ -263,10 +255,7 @@ namespace WyLight {
 			return NO_ERROR;
 		} catch(FatalError& e) {
 			return e.AsErrorCode();
-		} catch(std::exception) {
-			std::cout << "CATCH std::exception";
-			std::cerr << "CATCH std::exception";
-			//std::terminate();
+		} catch(const std::exception&) {
 			return FATAL_ERROR;
 		}
 	}
@@ -53,8 +53,10 @@ namespace WyLight {
 		 * Connect to a wifly device
 		 * @param addr ipv4 address as 32 bit value in host byte order
 		 * @param port number of the wifly device server in host byte order
+		 * @param interfaceIndex network interface the device was discovered on, 0 to let the routing table decide
+		 * @param connectTimeoutMs time in milliseconds the connection may take to establish, @see Control#Control
 		 */
-		ControlNoThrow(uint32_t addr, uint16_t port);
+		ControlNoThrow(uint32_t addr, uint16_t port, uint32_t interfaceIndex = 0, uint32_t connectTimeoutMs = TcpSocket::DEFAULT_CONNECT_TIMEOUT_MS);
 
 /* ------------------------- BOOTLOADER METHODES ------------------------- */
 		/**
@@ -279,6 +281,17 @@ namespace WyLight {
 		 */
 		uint32_t FwGetTracebuffer(std::string& output);
 
+		/**
+		 * Reads the binary trace events from wifly device and adds them to <log>
+		 * @param log the timeline to extend
+		 * @return Indexed by ::WiflyError
+		        <BR><B>CONNECTION_TIMEOUT</B> if response timed out
+		        <BR><B>FATAL_ERROR</B> if command code of the response doesn't match the code of the request, or too many retries failed
+		        <BR><B>SCRIPT_FULL</B> if script buffer in PIC firmware is full and request couldn't be executed
+		        <BR><B>NO_ERROR</B> is returned if no error occurred
+		 */
+		uint32_t FwGetTraceEvents(TraceEventLog& log);
+
 
 		/**
 		 * Reads the firmware version currently running on the wifly device.
@@ -302,6 +315,28 @@ namespace WyLight {
 		 */
 		uint32_t FwGetLedTyp(uint8_t& output);
 
+		/**
+		 * Reads the state of the script ring in the PIC firmware
+		 * @param output number of free script slots and the positions of the ring pointers
+		 * @return Indexed by ::WiflyError
+		 <BR><B>CONNECTION_TIMEOUT</B> if response timed out
+		 <BR><B>FATAL_ERROR</B> if command code of the response doesn't match the code of the request, or too many retries failed
+		 <BR><B>SCRIPT_FULL</B> if script buffer in PIC firmware is full and request couldn't be executed
+		 <BR><B>NO_ERROR</B> is returned if no error occurred
+		 */
+		uint32_t FwGetScriptState(script_state& output);
+
+		/**
+		 * Reads the statistic counters of the PIC firmware
+		 * @param output the counters in host byte order
+		 * @return Indexed by ::WiflyError
+		 <BR><B>CONNECTION_TIMEOUT</B> if response timed out
+		 <BR><B>FATAL_ERROR</B> if command code of the response doesn't match the code of the request, or too many retries failed
+		 <BR><B>SCRIPT_FULL</B> if script buffer in PIC firmware is full and request couldn't be executed
+		 <BR><B>NO_ERROR</B> is returned if no error occurred
+		 */
+		uint32_t FwGetStats(device_stats& output);
+
 		/**
 		 * Injects a LoopOff command into the wifly script controller
 		 * @param numLoops number of rounds before termination of the loop, use 0 for infinite loops. To terminate an infinite loop you have to call \<FwClearScript\>
@@ -327,7 +362,8 @@ namespace WyLight {
 		 * Sets all leds with different colors directly. This doesn't affect the WyLight script controller
 		 * Example: to set the first led to yellow and the second to blue and all others to off use a \<buffer\> like this:
 		 * buffer[] = {0xff, 0xff, 0x00, 0x00, 0x00, 0xff}; bufferLength = 6;
-		 * @param buffer containing continouse rgb values r1g1b1r2g2b2...r32g32b32
+		 * @param buffer containing continouse rgb values r1g1b1r2g2b2...r32g32b32, buffers longer
+		 *        than one segment are send as one frame per NUM_OF_LED_PER_SEGMENT leds
 		 * @return Indexed by ::WiflyError
 		        <BR><B>CONNECTION_TIMEOUT</B> if response timed out
 		        <BR><B>FATAL_ERROR</B> if command code of the response doesn't match the code of the request, or too many retries failed
@@ -418,9 +454,8 @@ namespace WyLight {
 		Control mControl;
 		uint32_t Try(FwCommand&& cmd);
 		uint32_t Try(const std::function<void(void)> call) const;
-		uint32_t Try(const std::function<std::string(void)> call, std::string& returnString) const;
-		uint32_t Try(const std::function<uint16_t(void)> call, uint16_t& returnValue) const;
-		uint32_t Try(const std::function<uint8_t(void)> call, uint8_t& returnValue) const;
+		template<typename Call, typename T>
+		uint32_t Try(const Call& call, T& returnValue) const;
 
 	};
 }
@@ -29,7 +29,7 @@ static const uint32_t g_DebugZones = ZONE_ERROR | ZONE_WARNING | ZONE_INFO | ZON
 /***** Wrappers ****/
 ClientSocket::ClientSocket(uint32_t addr, uint16_t port, int style) throw (FatalError) : mSock(0), mSockAddr(addr, port) {}
 ClientSocket::~ClientSocket(void) {}
-TcpSocket::TcpSocket(uint32_t addr, uint16_t port) throw (ConnectionLost, FatalError) : ClientSocket(addr, port, 0) {}
+TcpSocket::TcpSocket(uint32_t addr, uint16_t port, uint32_t interfaceIndex, uint32_t connectTimeoutMs) throw (ConnectionLost, FatalError) : ClientSocket(addr, port, 0) {}
 size_t TcpSocket::Recv(uint8_t *pBuffer, size_t length, timeval *timeout) const throw (FatalError) {
 	return 0;
 }
@@ -38,14 +38,14 @@ size_t TcpSocket::Send(const uint8_t *frame, size_t length) const {
 }
 ComProxy::ComProxy(const TcpSocket& sock) : mSock (sock) {}
 TelnetProxy::TelnetProxy(const TcpSocket& sock) : mSock (sock) {}
-UdpSocket::UdpSocket(uint32_t addr, uint16_t port, bool doBind, int enableBroadcast) throw (FatalError) : ClientSocket(addr, port, SOCK_DGRAM) {}
+UdpSocket::UdpSocket(uint32_t addr, uint16_t port, bool doBind, int enableBroadcast, uint32_t interfaceIndex) throw (FatalError) : ClientSocket(addr, port, SOCK_DGRAM) {}
 size_t UdpSocket::Send(const uint8_t *frame, size_t length) const {
 	return length;
 }
 
 
-Control::Control(uint32_t addr, uint16_t port)
-	: mTcpSock(addr, port), mUdpSock(addr, port, false, 0), mProxy(mTcpSock), mTelnet(mTcpSock)
+Control::Control(uint32_t addr, uint16_t port, uint32_t interfaceIndex, uint32_t connectTimeoutMs)
+	: mTcpSock(addr, port), mUdpSock(addr, port, false, 0), mProxy(mTcpSock), mTelnet(mTcpSock), mCredit(0)
 {}
 
 static WiflyError g_ErrorCode;
@@ -189,6 +189,10 @@ std::string Control::FwGetTracebuffer(void) throw (ConnectionTimeout, FatalError
 	throwExceptions(); return "";
 }
 
+void Control::FwGetTraceEvents(TraceEventLog& log) throw (ConnectionTimeout, FatalError, ScriptBufferFull) {
+	throwExceptions();
+}
+
 uint16_t Control::FwGetVersion(void) throw (ConnectionTimeout, FatalError, ScriptBufferFull) {
 	throwExceptions(); return 0;
 }
@@ -201,9 +205,22 @@ uint8_t Control::FwGetLedTyp(void) throw (ConnectionTimeout, FatalError, ScriptB
 	throwExceptions(); return 0;
 }
 
+script_state Control::FwGetScriptState(void) throw (ConnectionTimeout, FatalError, ScriptBufferFull) {
+	throwExceptions(); return script_state();
+}
+
+device_stats Control::FwGetStats(void) throw (ConnectionTimeout, FatalError, ScriptBufferFull) {
+	throwExceptions(); return device_stats();
+}
+
+static std::vector<uint8_t> g_ColorDirectSegments;
+
 Control& Control::operator<<(FwCommand&& cmd) throw (ConnectionTimeout, FatalError, ScriptBufferFull)
 {
 	throwExceptions();
+	if(SET_COLOR_DIRECT == cmd.GetData()[0]) {
+		g_ColorDirectSegments.push_back(reinterpret_cast<const led_cmd *>(cmd.GetData())->data.set_color_direct.segment);
+	}
 	return *this;
 }
 
@@ -217,6 +234,9 @@ size_t ut_WiflyControlNoThrow_FwFunctions(void)
 
 	std::string tempStr = "";
 	uint16_t tempValue;
+	script_state tempState;
+	TraceEventLog tempLog;
+	device_stats tempStats;
 	tm tempTime;
 	std::vector<uint8_t> buffer;
 
@@ -227,7 +247,10 @@ size_t ut_WiflyControlNoThrow_FwFunctions(void)
 		CHECK(e == testee.FwGetCycletime(tempStr));
 		CHECK(e == testee.FwGetRtc(tempTime));
 		CHECK(e == testee.FwGetTracebuffer(tempStr));
+		CHECK(e == testee.FwGetTraceEvents(tempLog));
 		CHECK(e == testee.FwGetVersion(tempValue));
+		CHECK(e == testee.FwGetScriptState(tempState));
+		CHECK(e == testee.FwGetStats(tempStats));
 		CHECK(e == testee.FwLoopOff(0));
 		CHECK(e == testee.FwSetRtc(tempTime));
 		CHECK(e == testee.FwSetWait(0));
@@ -241,6 +264,34 @@ size_t ut_WiflyControlNoThrow_FwFunctions(void)
 	TestCaseEnd();
 }
 
+size_t ut_WiflyControlNoThrow_FwSetColorDirectSegments(void)
+{
+	TestCaseBegin();
+	ControlNoThrow testee(0, 0);
+	g_ErrorCode = NO_ERROR;
+
+	// one frame turns the first segment off
+	g_ColorDirectSegments.clear();
+	CHECK(NO_ERROR == testee.FwSetColorDirect(std::vector<uint8_t>()));
+	CHECK(1 == g_ColorDirectSegments.size());
+	CHECK(0 == g_ColorDirectSegments[0]);
+
+	// one frame per segment
+	g_ColorDirectSegments.clear();
+	CHECK(NO_ERROR == testee.FwSetColorDirect(std::vector<uint8_t>(3 * (3 * NUM_OF_LED_PER_SEGMENT + 1), 0xff)));
+	CHECK(4 == g_ColorDirectSegments.size());
+	for(size_t i = 0; i < g_ColorDirectSegments.size(); ++i) {
+		CHECK(i == g_ColorDirectSegments[i]);
+	}
+
+	// stop with the first error
+	g_ErrorCode = CONNECTION_TIMEOUT;
+	g_ColorDirectSegments.clear();
+	CHECK(CONNECTION_TIMEOUT == testee.FwSetColorDirect(std::vector<uint8_t>(6 * NUM_OF_LED_PER_SEGMENT, 0xff)));
+	CHECK(g_ColorDirectSegments.empty());
+	TestCaseEnd();
+}
+
 size_t ut_WiflyControlNoThrow_ConfFunctions(void)
 {
 	TestCaseBegin();
@@ -388,6 +439,7 @@ int main (int argc, const char *argv[])
 {
 	UnitTestMainBegin();
 	RunTest(true, ut_WiflyControlNoThrow_FwFunctions);
+	RunTest(true, ut_WiflyControlNoThrow_FwSetColorDirectSegments);
 	RunTest(true, ut_WiflyControlNoThrow_ConfFunctions);
 	RunTest(true, ut_WiflyControlNoThrow_BlFunctions);
 	RunTest(true, ut_WiflyControlNoThrow_BlReadFlash);
@@ -20,6 +20,8 @@
 #include "unittest.h"
 #include "WiflyControl.h"
 #include "MaskBuffer.h"
+#include <algorithm>
+#include <deque>
 #include <string>
 #include <stdlib.h>
 #include <time.h>
@@ -36,15 +38,19 @@ namespace WyLight {
 	// empty wrappers to satisfy the linker
 	ClientSocket::ClientSocket(uint32_t addr, uint16_t port, int style) throw (FatalError) : mSock(0), mSockAddr(addr, port) {}
 	ClientSocket::~ClientSocket(void) {}
-	TcpSocket::TcpSocket(uint32_t addr, uint16_t port) throw (ConnectionLost, FatalError) : ClientSocket(addr, port, 0) {}
+	TcpSocket::TcpSocket(uint32_t addr, uint16_t port, uint32_t interfaceIndex, uint32_t connectTimeoutMs) throw (ConnectionLost, FatalError) : ClientSocket(addr, port, 0) {}
 	size_t TcpSocket::Recv(uint8_t *pBuffer, size_t length, timeval *timeout) const throw (FatalError) {
 		return 0;
 	}
+	TcpSocket::State TcpSocket::GetState(void) const {
+		return CONNECTED;
+	}
+	void TcpSocket::WaitConnected(void) const throw (ConnectionLost) {}
 	size_t TcpSocket::Send(const uint8_t *frame, size_t length) const {
 		return 0;
 	}
 	ComProxy::ComProxy(const TcpSocket& sock) : mSock (sock) {}
-	UdpSocket::UdpSocket(uint32_t addr, uint16_t port, bool doBind, int enableBroadcast) throw (FatalError) : ClientSocket(addr, port, SOCK_DGRAM) {}
+	UdpSocket::UdpSocket(uint32_t addr, uint16_t port, bool doBind, int enableBroadcast, uint32_t interfaceIndex) throw (FatalError) : ClientSocket(addr, port, SOCK_DGRAM) {}
 	size_t UdpSocket::Send(const uint8_t *frame, size_t length) const {
 		UnmaskBuffer unMask {512};
 		unMask.Unmask(frame, length, true, false);
@@ -136,6 +142,60 @@ namespace WyLight {
 		pResponse->state = OK;
 		return pResponse->length;
 	}
+	struct EncodedBurst {
+		size_t numCommands;
+		size_t numBytes;
+	};
+	static std::vector<EncodedBurst> g_EncodedBursts;
+
+	void ComProxy::Send(const EncodedCommand *pCommands, size_t numCommands, response_frame *pResponses, size_t *pBytesRead) const throw(ConnectionTimeout, FatalError)
+	{
+		EncodedBurst burst = {numCommands, 0};
+		for(size_t i = 0; i < numCommands; ++i) {
+			burst.numBytes += pCommands[i].Size();
+			pResponses[i].length = sizeof(uns8) + sizeof(uns16) + sizeof(ErrorCode);
+			pResponses[i].cmd = pCommands[i].GetType();
+			pResponses[i].state = OK;
+			pBytesRead[i] = pResponses[i].length;
+		}
+		g_EncodedBursts.push_back(burst);
+	}
+
+	// the firmware answers each GET_UART_CREDIT with a fixed credit and never drains its buffer beyond that
+	static uint8_t g_UartCredit = RingBufferSize;
+	static std::vector<uint8_t> g_StreamedTypes;
+	static std::deque<size_t> g_CreditQueries;
+	static size_t g_StreamedBytes;
+	static size_t g_StreamLimit;
+	static size_t g_StreamOverflows;
+
+	void ComProxy::Write(const EncodedCommand *pCommands, size_t numCommands) const throw(FatalError)
+	{
+		for(size_t i = 0; i < numCommands; ++i) {
+			g_StreamedBytes += pCommands[i].Size();
+			g_StreamedTypes.push_back(pCommands[i].GetType());
+			if(GET_UART_CREDIT == pCommands[i].GetType()) {
+				g_CreditQueries.push_back(g_StreamedBytes);
+			} else if(g_StreamedBytes > g_StreamLimit) {
+				g_StreamOverflows++;
+			}
+		}
+	}
+
+	size_t ComProxy::RecvResponse(response_frame *pResponse) const throw(ConnectionTimeout)
+	{
+		if(g_CreditQueries.empty()) {
+			throw ConnectionTimeout("no pending request");
+		}
+		g_StreamLimit = std::max(g_StreamLimit, g_CreditQueries.front() + g_UartCredit);
+		g_CreditQueries.pop_front();
+		pResponse->length = sizeof(uns8) + sizeof(uns16) + sizeof(ErrorCode) + sizeof(uns8);
+		pResponse->cmd = GET_UART_CREDIT;
+		pResponse->state = OK;
+		pResponse->data.uartCredit = g_UartCredit;
+		return pResponse->length;
+	}
+
 	size_t ComProxy::SyncWithTarget() const throw (FatalError)
 	{
 		return BL_IDENT;
@@ -465,8 +525,9 @@ namespace WyLight {
 		uint8_t shortBuffer[1] {0xff};
 		led_cmd expectedOutgoingFrame;
 		expectedOutgoingFrame.cmd = SET_COLOR_DIRECT;
+		expectedOutgoingFrame.data.set_color_direct.segment = 0;
 		memcpy(expectedOutgoingFrame.data.set_color_direct.ptr_led_array, shortBuffer, sizeof(shortBuffer));
-		memset(expectedOutgoingFrame.data.set_color_direct.ptr_led_array + sizeof(shortBuffer), 0x00, sizeof(cmd_set_color_direct) - sizeof(shortBuffer));
+		memset(expectedOutgoingFrame.data.set_color_direct.ptr_led_array + sizeof(shortBuffer), 0x00, sizeof(expectedOutgoingFrame.data.set_color_direct.ptr_led_array) - sizeof(shortBuffer));
 
 		testee << FwCmdSetColorDirect {shortBuffer, sizeof(shortBuffer)};
 
@@ -487,8 +548,9 @@ namespace WyLight {
 		shortBuffer[2 * 3 + 2] = 0xff; //third led blue
 		led_cmd expectedOutgoingFrame;
 		expectedOutgoingFrame.cmd = SET_COLOR_DIRECT;
+		expectedOutgoingFrame.data.set_color_direct.segment = 0;
 		memcpy(expectedOutgoingFrame.data.set_color_direct.ptr_led_array, shortBuffer, sizeof(shortBuffer));
-		memset(expectedOutgoingFrame.data.set_color_direct.ptr_led_array + sizeof(shortBuffer), 0x00, sizeof(cmd_set_color_direct) - sizeof(shortBuffer));
+		memset(expectedOutgoingFrame.data.set_color_direct.ptr_led_array + sizeof(shortBuffer), 0x00, sizeof(expectedOutgoingFrame.data.set_color_direct.ptr_led_array) - sizeof(shortBuffer));
 
 		testee << FwCmdSetColorDirect {shortBuffer, sizeof(shortBuffer)};
 
@@ -511,6 +573,7 @@ namespace WyLight {
 		shortBuffer[2 * 3 + 2] = 0xff; //third led blue
 		led_cmd expectedOutgoingFrame;
 		expectedOutgoingFrame.cmd = SET_COLOR_DIRECT;
+		expectedOutgoingFrame.data.set_color_direct.segment = 0;
 		memset(expectedOutgoingFrame.data.set_color_direct.ptr_led_array, 0, 3 * NUM_OF_LED);
 		expectedOutgoingFrame.data.set_color_direct.ptr_led_array[0] = 0xff;
 		expectedOutgoingFrame.data.set_color_direct.ptr_led_array[1] = 0xff;
@@ -542,6 +605,7 @@ namespace WyLight {
 		memset(shortBuffer, 0xff, sizeof(shortBuffer));
 		led_cmd expectedOutgoingFrame;
 		expectedOutgoingFrame.cmd = SET_COLOR_DIRECT;
+		expectedOutgoingFrame.data.set_color_direct.segment = 0;
 		memcpy(expectedOutgoingFrame.data.set_color_direct.ptr_led_array, shortBuffer, NUM_OF_LED * 3);
 
 		testee << FwCmdSetColorDirect(shortBuffer, sizeof(shortBuffer));
@@ -564,6 +628,7 @@ namespace WyLight {
 		expectedOutgoingFrame.data.set_fade.parallelFade = 0x00;
 		//TODO why do we use fadeTmms == 1 for SetColor?
 		expectedOutgoingFrame.data.set_fade.fadeTmms = htons(0x0001);
+		expectedOutgoingFrame.data.set_fade.segment = SEGMENT_ALL;
 
 		TestCaseBegin();
 		Control testee(0, 0);
@@ -592,6 +657,7 @@ namespace WyLight {
 		expectedOutgoingFrame.data.set_fade.parallelFade = 0x01;
 		//TODO why do we use fadeTmms == 1 for SetColor?
 		expectedOutgoingFrame.data.set_fade.fadeTmms = htons(1000);
+		expectedOutgoingFrame.data.set_fade.segment = SEGMENT_ALL;
 
 		TestCaseBegin();
 		Control testee(0, 0);
@@ -733,6 +799,42 @@ namespace WyLight {
 		TestCaseEnd();
 	}
 
+	size_t ut_WiflyControl_CycletimeResponse(void)
+	{
+		TestCaseBegin();
+		response_frame frame;
+		memset(&frame, 0, sizeof(frame));
+		frame.cmd = GET_CYCLETIME;
+		frame.state = OK;
+		cycletime_stats& stats = frame.data.cycletimes[eMAIN];
+		stats.max = htons(10000);
+		stats.count = htons(100);
+		stats.total = htonl(50000);
+		stats.histogram[1] = 90;
+		stats.histogram[5] = 9;
+		stats.histogram[7] = 1;
+
+		CycletimeResponse response;
+		CHECK(!response.Init(frame, 4 + sizeof(stats) * CYCLETIME_METHODE_ENUM_SIZE - 1));
+		CHECK(response.Init(frame, 4 + sizeof(stats) * CYCLETIME_METHODE_ENUM_SIZE));
+		CHECK(100 == response.Count(eMAIN));
+		CHECK(250.0 == response.Mean(eMAIN));
+		CHECK(5000.0 == response.Max(eMAIN));
+
+		// percentiles are interpolated inside the log2 buckets, the last bucket ends at max
+		CHECK(std::abs(response.Percentile(eMAIN, 50) - (128 + 128 * 50 / 90.0) / 2) < 0.01);
+		CHECK(128.0 == response.Percentile(eMAIN, 90));
+		CHECK(2048.0 == response.Percentile(eMAIN, 99));
+		CHECK(5000.0 == response.Percentile(eMAIN, 100));
+
+		// nothing measured
+		CHECK(0 == response.Count(eSET_FADE));
+		CHECK(0.0 == response.Mean(eSET_FADE));
+		CHECK(0.0 == response.Percentile(eSET_FADE, 99));
+		CHECK(std::string::npos != response.ToString().find("ScriptCtrl_Run"));
+		TestCaseEnd();
+	}
+
 	size_t ut_WiflyControl_FwGetRtc(void)
 	{
 		tm timeinfo;
@@ -773,6 +875,115 @@ namespace WyLight {
 		TestCaseEnd();
 	}
 
+	size_t ut_WiflyControl_FwGetScriptState(void)
+	{
+		led_cmd expectedOutgoingFrame = {0xff};
+		expectedOutgoingFrame.cmd = GET_SCRIPT_STATE;
+
+		TestCaseBegin();
+		Control testee(0, 0);
+
+		try {
+			testee.FwGetScriptState();
+		} catch(const std::exception&) { }
+
+		TraceBuffer(ZONE_INFO, &g_SendFrame,           1, "%02x ", "IS  :");
+		TraceBuffer(ZONE_INFO, &expectedOutgoingFrame, 1, "%02x ", "SOLL:");
+		CHECK(0 == memcmp(&g_SendFrame, &expectedOutgoingFrame, 1));
+
+		TestCaseEnd();
+	}
+
+	size_t ut_WiflyControl_StatsResponse(void)
+	{
+		TestCaseBegin();
+		response_frame frame;
+		memset(&frame, 0, sizeof(frame));
+		frame.cmd = GET_STATS;
+		frame.state = OK;
+		frame.data.stats.rxBytes = htonl(0x12345678);
+		frame.data.stats.commands = htons(1000);
+		frame.data.stats.crcErrors = htons(2);
+		frame.data.stats.lengthErrors = htons(3);
+		frame.data.stats.scriptFull = htons(4);
+		frame.data.stats.ringOverflows = htons(0x0105);
+		frame.data.stats.ringHighWater = 200;
+
+		StatsResponse response;
+		CHECK(!response.Init(frame, 4 + sizeof(device_stats) - 1));
+		CHECK(response.Init(frame, 4 + sizeof(device_stats)));
+		CHECK(0x12345678 == response.getStats().rxBytes);
+		CHECK(1000 == response.getStats().commands);
+		CHECK(2 == response.getStats().crcErrors);
+		CHECK(3 == response.getStats().lengthErrors);
+		CHECK(4 == response.getStats().scriptFull);
+		CHECK(0x0105 == response.getStats().ringOverflows);
+		CHECK(200 == response.getStats().ringHighWater);
+		TestCaseEnd();
+	}
+
+	size_t ut_WiflyControl_FwSendEncoded(void)
+	{
+		TestCaseBegin();
+		Control first(0, 0);
+		Control second(0, 0);
+		const EncodedCommand fade(FwCmdSetFade(0xff00ff00, 200, 0xffffffff, false));
+
+		// one encoded command is sent to several devices
+		g_EncodedBursts.clear();
+		first << fade;
+		second << fade;
+		CHECK(2 == g_EncodedBursts.size());
+		CHECK(1 == g_EncodedBursts[1].numCommands);
+		CHECK(fade.Size() == g_EncodedBursts[1].numBytes);
+
+		// bursts are limited by the uart buffer of the firmware, commands without response go over udp
+		EncodedSequence sequence(40, fade);
+		sequence[20] = EncodedCommand(FwCmdSetColorDirect(0xff0000ff, 0xffffffff));
+		g_EncodedBursts.clear();
+		first << sequence;
+		CHECK(SET_COLOR_DIRECT == g_SendFrame.cmd);
+
+		size_t numSent = 0;
+		for(const auto& burst : g_EncodedBursts) {
+			CHECK(burst.numBytes <= RingBufferSize);
+			numSent += burst.numCommands;
+		}
+		CHECK(39 == numSent);
+		CHECK(sequence.size() * fade.Size() / RingBufferSize < g_EncodedBursts.size());
+		CHECK(g_EncodedBursts.size() < sequence.size() / 4);
+		TestCaseEnd();
+	}
+
+	size_t ut_WiflyControl_FwStream(void)
+	{
+		TestCaseBegin();
+		Control testee(0, 0);
+		const EncodedCommand color(FwCmdSetColorDirect(0xff0000ff, 0xffffffff));
+		EncodedSequence sequence(40, color);
+
+		g_UartCredit = 150;
+		g_StreamedTypes.clear();
+		g_CreditQueries.clear();
+		g_StreamedBytes = 0;
+		g_StreamLimit = 0;
+		g_StreamOverflows = 0;
+		testee.FwStream(sequence);
+
+		// all frames are sent over tcp, never more than the advertised credit
+		CHECK(0 == g_StreamOverflows);
+		CHECK(40 == std::count(g_StreamedTypes.begin(), g_StreamedTypes.end(), SET_COLOR_DIRECT));
+		CHECK(40 * color.Size() / g_UartCredit <= (size_t)std::count(g_StreamedTypes.begin(), g_StreamedTypes.end(), GET_UART_CREDIT));
+
+		// the next request collects the pending credit responses first
+		g_EncodedBursts.clear();
+		testee << EncodedCommand(FwCmdGetVersion {});
+		CHECK(g_CreditQueries.empty());
+		CHECK(1 == g_EncodedBursts.size());
+		g_UartCredit = RingBufferSize;
+		TestCaseEnd();
+	}
+
 	size_t ut_WiflyControl_FwLoopOff(void)
 	{
 		led_cmd expectedOutgoingFrame = {0xff};
@@ -837,9 +1048,14 @@ int main (int argc, const char *argv[])
 	RunTest(true, ut_WiflyControl_FwGetTracebuffer);
 	RunTest(true, ut_WiflyControl_FwGetRtc);
 	RunTest(true, ut_WiflyControl_FwGetCycletime);
+	RunTest(true, ut_WiflyControl_CycletimeResponse);
 	RunTest(true, ut_WiflyControl_FwClearScript);
 	RunTest(true, ut_WiflyControl_FwLoopOff);
 	RunTest(true, ut_WiflyControl_FwGetVersion);
+	RunTest(true, ut_WiflyControl_FwGetScriptState);
 	RunTest(true, ut_WiflyControl_FwLoopOn);
+	RunTest(true, ut_WiflyControl_StatsResponse);
+	RunTest(true, ut_WiflyControl_FwSendEncoded);
+	RunTest(true, ut_WiflyControl_FwStream);
 	UnitTestMainEnd();
 }